@@ -109,6 +109,7 @@
 
 #include "domdec_constraints.h"
 #include "domdec_internal.h"
+#include "domdec_specatomcomm.h"
 #include "domdec_vsite.h"
 
 #define DDRANK(dd, rank)    (rank)
@@ -163,9 +164,10 @@ typedef struct
     real     *bound_max;   /* Temp. var.: upper limit for cell boundary      */
     gmx_bool  bLimited;    /* State var.: is DLB limited in this dim and row */
     real     *buf_ncd;     /* Temp. var.                                     */
+    real     *listed;      /* Temp. var.: listed interaction load per cell   */
 } gmx_domdec_root_t;
 
-#define DD_NLOAD_MAX 9
+#define DD_NLOAD_MAX 10
 
 /* Here floats are accurate enough, since these variables
  * only influence the load balancing, not the actual MD results.
@@ -178,6 +180,7 @@ typedef struct
     float  max;
     float  sum_m;
     float  cvol_min;
+    float  listed;
     float  mdf;
     float  pme;
     int    flags;
@@ -374,6 +377,10 @@ typedef struct gmx_domdec_comm
     /* Communication buffer for general use */
     vec_rvec_t vbuf;
 
+    /* Requests for the first coordinate pulse started by dd_move_x_start */
+    MPI_Request movex_req[2];
+    int         movex_nreq;
+
     /* Temporary storage for thread parallel communication setup */
     int                   nth;
     dd_comm_setup_work_t *dth;
@@ -425,6 +432,9 @@ typedef struct gmx_domdec_comm
     /* Statistics */
     double sum_nat[ddnatNR-ddnatZONE];
     int    ndecomp;
+    /* The number of non-empty halo messages sent and the number of MD steps */
+    gmx_int64_t nmsg_zone;
+    gmx_int64_t nmsg_nstep;
     int    nload;
     double load_step;
     double load_sum;
@@ -678,116 +688,193 @@ void dd_get_constraint_range(gmx_domdec_t *dd, int *at_start, int *at_end)
     *at_end   = dd->comm->nat[ddnatCON];
 }
 
-void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
+/*! \brief Puts the coordinates to send for pulse \p p along dimension
+ * index \p d in the send buffer, returns the send buffer */
+static rvec *dd_move_x_pack(gmx_domdec_t *dd, matrix box, rvec x[],
+                            int d, int p, int nzone)
 {
-    int                    nzone, nat_tot, n, d, p, i, j, at0, at1, zone;
+    int                    n, i, j, at0, at1;
     int                   *index, *cgindex;
-    gmx_domdec_comm_t     *comm;
-    gmx_domdec_comm_dim_t *cd;
     gmx_domdec_ind_t      *ind;
-    rvec                   shift = {0, 0, 0}, *buf, *rbuf;
+    rvec                   shift = {0, 0, 0}, *buf;
     gmx_bool               bPBC, bScrew;
 
-    comm = dd->comm;
-
     cgindex = dd->cgindex;
 
-    buf = comm->vbuf.v;
+    buf = dd->comm->vbuf.v;
 
-    nzone   = 1;
-    nat_tot = dd->nat_home;
-    for (d = 0; d < dd->ndim; d++)
+    bPBC   = (dd->ci[dd->dim[d]] == 0);
+    bScrew = (bPBC && dd->bScrewPBC && dd->dim[d] == XX);
+    if (bPBC)
     {
-        bPBC   = (dd->ci[dd->dim[d]] == 0);
-        bScrew = (bPBC && dd->bScrewPBC && dd->dim[d] == XX);
-        if (bPBC)
+        copy_rvec(box[dd->dim[d]], shift);
+    }
+    ind   = &dd->comm->cd[d].ind[p];
+    index = ind->index;
+    n     = 0;
+    if (!bPBC)
+    {
+        for (i = 0; i < ind->nsend[nzone]; i++)
         {
-            copy_rvec(box[dd->dim[d]], shift);
+            at0 = cgindex[index[i]];
+            at1 = cgindex[index[i]+1];
+            for (j = at0; j < at1; j++)
+            {
+                copy_rvec(x[j], buf[n]);
+                n++;
+            }
         }
-        cd = &comm->cd[d];
-        for (p = 0; p < cd->np; p++)
+    }
+    else if (!bScrew)
+    {
+        for (i = 0; i < ind->nsend[nzone]; i++)
         {
-            ind   = &cd->ind[p];
-            index = ind->index;
-            n     = 0;
-            if (!bPBC)
+            at0 = cgindex[index[i]];
+            at1 = cgindex[index[i]+1];
+            for (j = at0; j < at1; j++)
             {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        copy_rvec(x[j], buf[n]);
-                        n++;
-                    }
-                }
+                /* We need to shift the coordinates */
+                rvec_add(x[j], shift, buf[n]);
+                n++;
             }
-            else if (!bScrew)
+        }
+    }
+    else
+    {
+        for (i = 0; i < ind->nsend[nzone]; i++)
+        {
+            at0 = cgindex[index[i]];
+            at1 = cgindex[index[i]+1];
+            for (j = at0; j < at1; j++)
             {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        /* We need to shift the coordinates */
-                        rvec_add(x[j], shift, buf[n]);
-                        n++;
-                    }
-                }
+                /* Shift x */
+                buf[n][XX] = x[j][XX] + shift[XX];
+                /* Rotate y and z.
+                 * This operation requires a special shift force
+                 * treatment, which is performed in calc_vir.
+                 */
+                buf[n][YY] = box[YY][YY] - x[j][YY];
+                buf[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
+                n++;
             }
-            else
+        }
+    }
+
+    return buf;
+}
+
+/*! \brief Returns the receive buffer for pulse \p p along dimension
+ * index \p d, \p nat_tot is the number of atoms received so far */
+static rvec *dd_move_x_recv_buf(gmx_domdec_t *dd, rvec x[],
+                                int d, int nat_tot)
+{
+    if (dd->comm->cd[d].bInPlace)
+    {
+        return x + nat_tot;
+    }
+    else
+    {
+        return dd->comm->vbuf2.v;
+    }
+}
+
+/*! \brief Copies received coordinates to x, when not received in place */
+static void dd_move_x_unpack(gmx_domdec_t *dd, rvec x[],
+                             int d, int p, int nzone, rvec *rbuf)
+{
+    gmx_domdec_ind_t *ind;
+    int               zone, i, j;
+
+    if (!dd->comm->cd[d].bInPlace)
+    {
+        ind = &dd->comm->cd[d].ind[p];
+        j   = 0;
+        for (zone = 0; zone < nzone; zone++)
+        {
+            for (i = ind->cell2at0[zone]; i < ind->cell2at1[zone]; i++)
             {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        /* Shift x */
-                        buf[n][XX] = x[j][XX] + shift[XX];
-                        /* Rotate y and z.
-                         * This operation requires a special shift force
-                         * treatment, which is performed in calc_vir.
-                         */
-                        buf[n][YY] = box[YY][YY] - x[j][YY];
-                        buf[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
-                        n++;
-                    }
-                }
+                copy_rvec(rbuf[j], x[i]);
+                j++;
             }
+        }
+    }
+}
 
-            if (cd->bInPlace)
+/*! \brief Communicates the coordinates for all pulses.
+ *
+ * When \p bFirstPulseStarted is TRUE, the first pulse has been started
+ * by dd_move_x_start and we only wait for its completion.
+ */
+static void dd_move_x_pulses(gmx_domdec_t *dd, matrix box, rvec x[],
+                             gmx_bool bFirstPulseStarted)
+{
+    int                    nzone, nat_tot, d, p;
+    gmx_domdec_comm_t     *comm;
+    gmx_domdec_ind_t      *ind;
+    rvec                  *buf, *rbuf;
+
+    comm = dd->comm;
+
+    nzone   = 1;
+    nat_tot = dd->nat_home;
+    for (d = 0; d < dd->ndim; d++)
+    {
+        for (p = 0; p < comm->cd[d].np; p++)
+        {
+            ind  = &comm->cd[d].ind[p];
+            rbuf = dd_move_x_recv_buf(dd, x, d, nat_tot);
+            if (d == 0 && p == 0 && bFirstPulseStarted)
             {
-                rbuf = x + nat_tot;
+                dd_wait_requests(comm->movex_nreq, comm->movex_req);
             }
             else
             {
-                rbuf = comm->vbuf2.v;
-            }
-            /* Send and receive the coordinates */
-            dd_sendrecv_rvec(dd, d, dddirBackward,
-                             buf,  ind->nsend[nzone+1],
-                             rbuf, ind->nrecv[nzone+1]);
-            if (!cd->bInPlace)
-            {
-                j = 0;
-                for (zone = 0; zone < nzone; zone++)
-                {
-                    for (i = ind->cell2at0[zone]; i < ind->cell2at1[zone]; i++)
-                    {
-                        copy_rvec(rbuf[j], x[i]);
-                        j++;
-                    }
-                }
+                buf = dd_move_x_pack(dd, box, x, d, p, nzone);
+                /* Send and receive the coordinates */
+                dd_sendrecv_rvec(dd, d, dddirBackward,
+                                 buf,  ind->nsend[nzone+1],
+                                 rbuf, ind->nrecv[nzone+1]);
+                comm->nmsg_zone += (ind->nsend[nzone+1] > 0);
             }
+            dd_move_x_unpack(dd, x, d, p, nzone, rbuf);
             nat_tot += ind->nrecv[nzone+1];
         }
         nzone += nzone;
     }
 }
 
+void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    dd_move_x_pulses(dd, box, x, FALSE);
+}
+
+void dd_move_x_start(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    gmx_domdec_comm_t *comm;
+    gmx_domdec_ind_t  *ind;
+    rvec              *buf, *rbuf;
+
+    comm = dd->comm;
+
+    /* Only the first pulse can be started here, as all other pulses
+     * (can) send coordinates received in earlier pulses.
+     */
+    ind  = &comm->cd[0].ind[0];
+    buf  = dd_move_x_pack(dd, box, x, 0, 0, 1);
+    rbuf = dd_move_x_recv_buf(dd, x, 0, dd->nat_home);
+    comm->movex_nreq =
+        dd_isendrecv_rvec(dd, 0, dddirBackward,
+                          buf,  ind->nsend[2],
+                          rbuf, ind->nrecv[2],
+                          comm->movex_req);
+    comm->nmsg_zone += (ind->nsend[2] > 0);
+}
+
+void dd_move_x_finish(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    dd_move_x_pulses(dd, box, x, TRUE);
+}
+
 void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
 {
     int                    nzone, nat_tot, n, d, p, i, j, at0, at1, zone;
@@ -849,6 +936,7 @@ void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
             dd_sendrecv_rvec(dd, d, dddirForward,
                              sbuf, ind->nrecv[nzone+1],
                              buf,  ind->nsend[nzone+1]);
+            comm->nmsg_zone += (ind->nrecv[nzone+1] > 0);
             index = ind->index;
             /* Add the received forces */
             n = 0;
@@ -2841,6 +2929,28 @@ static int dd_load_count(gmx_domdec_comm_t *comm)
     return (comm->eFlop ? comm->flop_n : comm->cycl_n[ddCyclF]);
 }
 
+/* Returns the listed interaction part of the force load,
+ * for the same number of steps as used in dd_force_load.
+ */
+static float dd_listed_load(gmx_domdec_comm_t *comm)
+{
+    float load;
+
+    if (comm->eFlop || comm->cycl_n[ddCyclListed] == 0)
+    {
+        return 0;
+    }
+
+    load = comm->cycl[ddCyclListed];
+    if (comm->cycl_n[ddCyclF] > 1)
+    {
+        /* dd_force_load leaves out the step with the maximum count */
+        load *= (comm->cycl_n[ddCyclF] - 1)/(float)comm->cycl_n[ddCyclListed];
+    }
+
+    return load;
+}
+
 static float dd_force_load(gmx_domdec_comm_t *comm)
 {
     float load;
@@ -3437,6 +3547,63 @@ static void dd_cell_sizes_dlb_root_enforce_limits(gmx_domdec_t *dd,
 }
 
 
+/* Returns the part of the average cell load that moves with the cell
+ * boundaries. The listed interactions of a cell are assigned by the
+ * location of their atoms, so with localized expensive interactions,
+ * such as restraints or CMAP, their load does not scale with the cell
+ * volume. We assume that the listed load of a cell stays in the cell.
+ * To avoid overshooting for cells dominated by listed interactions,
+ * we never consider less than half of the average load as movable.
+ */
+static real dd_load_movable(real load_aver, real load_listed)
+{
+    if (load_aver <= 0)
+    {
+        return 1;
+    }
+
+    return std::max(load_aver - load_listed, static_cast<real>(0.5)*load_aver);
+}
+
+void dd_dlb_scale_cell_sizes(int ncd, real load_aver,
+                             const float *load, int load_stride,
+                             const real *listed, real change_limit,
+                             const real *cell_f, real *cell_size)
+{
+    real load_i, imbalance, change, change_max, sc;
+    real relax = 0.5;
+    int  i;
+
+    change_max = 0;
+    for (i = 0; i < ncd; i++)
+    {
+        /* Determine the relative imbalance of cell i */
+        load_i    = load[i*load_stride];
+        imbalance = (load_i - load_aver)/dd_load_movable(load_aver, listed[i]);
+        /* Determine the change of the cell size using underrelaxation */
+        change     = -relax*imbalance;
+        change_max = std::max(change_max, std::max(change, -change));
+    }
+    /* Limit the amount of scaling.
+     * We need to use the same rescaling for all cells in one row,
+     * otherwise the load balancing might not converge.
+     */
+    sc = relax;
+    if (change_max > change_limit)
+    {
+        sc *= change_limit/change_max;
+    }
+    for (i = 0; i < ncd; i++)
+    {
+        /* Determine the relative imbalance of cell i */
+        load_i    = load[i*load_stride];
+        imbalance = (load_i - load_aver)/dd_load_movable(load_aver, listed[i]);
+        /* Determine the change of the cell size using underrelaxation */
+        change       = -sc*imbalance;
+        cell_size[i] = (cell_f[i+1]-cell_f[i])*(1 + change);
+    }
+}
+
 static void set_dd_cell_sizes_dlb_root(gmx_domdec_t *dd,
                                        int d, int dim, gmx_domdec_root_t *root,
                                        gmx_ddbox_t *ddbox, gmx_bool bDynamicBox,
@@ -3445,10 +3612,8 @@ static void set_dd_cell_sizes_dlb_root(gmx_domdec_t *dd,
     gmx_domdec_comm_t *comm;
     int                ncd, d1, i, pos;
     real              *cell_size;
-    real               load_aver, load_i, imbalance, change, change_max, sc;
     real               cellsize_limit_f, dist_min_f, dist_min_f_hard, space;
     real               change_limit;
-    real               relax = 0.5;
     gmx_bool           bPBC;
     int                range[] = { 0, 0 };
 
@@ -3477,35 +3642,10 @@ static void set_dd_cell_sizes_dlb_root(gmx_domdec_t *dd,
     }
     else if (dd_load_count(comm) > 0)
     {
-        load_aver  = comm->load[d].sum_m/ncd;
-        change_max = 0;
-        for (i = 0; i < ncd; i++)
-        {
-            /* Determine the relative imbalance of cell i */
-            load_i    = comm->load[d].load[i*comm->load[d].nload+2];
-            imbalance = (load_i - load_aver)/(load_aver > 0 ? load_aver : 1);
-            /* Determine the change of the cell size using underrelaxation */
-            change     = -relax*imbalance;
-            change_max = std::max(change_max, std::max(change, -change));
-        }
-        /* Limit the amount of scaling.
-         * We need to use the same rescaling for all cells in one row,
-         * otherwise the load balancing might not converge.
-         */
-        sc = relax;
-        if (change_max > change_limit)
-        {
-            sc *= change_limit/change_max;
-        }
-        for (i = 0; i < ncd; i++)
-        {
-            /* Determine the relative imbalance of cell i */
-            load_i    = comm->load[d].load[i*comm->load[d].nload+2];
-            imbalance = (load_i - load_aver)/(load_aver > 0 ? load_aver : 1);
-            /* Determine the change of the cell size using underrelaxation */
-            change       = -sc*imbalance;
-            cell_size[i] = (root->cell_f[i+1]-root->cell_f[i])*(1 + change);
-        }
+        dd_dlb_scale_cell_sizes(ncd, comm->load[d].sum_m/ncd,
+                                comm->load[d].load + 2, comm->load[d].nload,
+                                root->listed, change_limit,
+                                root->cell_f, cell_size);
     }
 
     cellsize_limit_f  = cellsize_min_dlb(comm, d, dim)/ddbox->box_size[dim];
@@ -5298,6 +5438,7 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
                 {
                     sbuf[pos++] = sbuf[0];
                     sbuf[pos++] = cell_frac;
+                    sbuf[pos++] = dd_listed_load(comm);
                     if (d > 0)
                     {
                         sbuf[pos++] = comm->cell_f_max0[d];
@@ -5319,6 +5460,7 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
                     sbuf[pos++] = comm->load[d+1].sum_m;
                     sbuf[pos++] = comm->load[d+1].cvol_min*cell_frac;
                     sbuf[pos++] = comm->load[d+1].flags;
+                    sbuf[pos++] = comm->load[d+1].listed;
                     if (d > 0)
                     {
                         sbuf[pos++] = comm->cell_f_max0[d];
@@ -5351,6 +5493,7 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
                 load->max      = 0;
                 load->sum_m    = 0;
                 load->cvol_min = 1;
+                load->listed   = 0;
                 load->flags    = 0;
                 load->mdf      = 0;
                 load->pme      = 0;
@@ -5380,6 +5523,17 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
                         {
                             load->flags = (int)(load->load[pos++] + 0.5);
                         }
+                        root->listed[i] = load->load[pos];
+                        if (root->bLimited)
+                        {
+                            /* Use the same measure as for sum_m */
+                            load->listed = std::max(load->listed, load->load[pos]);
+                        }
+                        else
+                        {
+                            load->listed += load->load[pos];
+                        }
+                        pos++;
                         if (d > 0)
                         {
                             root->cell_f_max0[i] = load->load[pos++];
@@ -5396,8 +5550,9 @@ static void get_load_distribution(gmx_domdec_t *dd, gmx_wallcycle_t wcycle)
                 }
                 if (comm->bDynLoadBal && root->bLimited)
                 {
-                    load->sum_m *= dd->nc[dim];
-                    load->flags |= (1<<d);
+                    load->sum_m  *= dd->nc[dim];
+                    load->listed *= dd->nc[dim];
+                    load->flags  |= (1<<d);
                 }
             }
         }
@@ -5664,6 +5819,7 @@ static void make_load_communicator(gmx_domdec_t *dd, int dim_ind, ivec loc)
                     snew(root->bound_max, dd->nc[dim]);
                 }
                 snew(root->buf_ncd, dd->nc[dim]);
+                snew(root->listed, dd->nc[dim]);
             }
             else
             {
@@ -6619,11 +6775,13 @@ static gmx_domdec_comm_t *init_dd_comm()
     {
         comm->sum_nat[i] = 0;
     }
-    comm->ndecomp   = 0;
-    comm->nload     = 0;
-    comm->load_step = 0;
-    comm->load_sum  = 0;
-    comm->load_max  = 0;
+    comm->ndecomp    = 0;
+    comm->nmsg_zone  = 0;
+    comm->nmsg_nstep = 0;
+    comm->nload      = 0;
+    comm->load_step  = 0;
+    comm->load_sum   = 0;
+    comm->load_max   = 0;
     clear_ivec(comm->load_lim);
     comm->load_mdf  = 0;
     comm->load_pme  = 0;
@@ -9218,10 +9376,47 @@ static void add_dd_statistics(gmx_domdec_t *dd)
     comm->ndecomp++;
 }
 
+/* Gets the numbers of non-empty messages sent for the halo, vsite
+ * and constraint communication, ordered as the atom counts.
+ */
+static void get_dd_message_counts(const gmx_domdec_t *dd, gmx_int64_t *nmsg)
+{
+    nmsg[ddnatZONE-ddnatZONE]  = dd->comm->nmsg_zone;
+    nmsg[ddnatVSITE-ddnatZONE] = (dd->vsite_comm ? dd->vsite_comm->nmsg : 0);
+    nmsg[ddnatCON-ddnatZONE]   = (dd->constraint_comm ? dd->constraint_comm->nmsg : 0);
+}
+
+/* Sets the message counts, the inverse of get_dd_message_counts */
+static void set_dd_message_counts(gmx_domdec_t *dd, const gmx_int64_t *nmsg)
+{
+    dd->comm->nmsg_zone = nmsg[ddnatZONE-ddnatZONE];
+    if (dd->vsite_comm)
+    {
+        dd->vsite_comm->nmsg = nmsg[ddnatVSITE-ddnatZONE];
+    }
+    if (dd->constraint_comm)
+    {
+        dd->constraint_comm->nmsg = nmsg[ddnatCON-ddnatZONE];
+    }
+}
+
+void dd_start_step_message_count(gmx_domdec_t *dd)
+{
+    gmx_int64_t nmsg[ddnatNR-ddnatZONE] = { 0 };
+
+    if (dd->comm->nmsg_nstep == 0)
+    {
+        /* Discard the messages sent before the first counted step */
+        set_dd_message_counts(dd, nmsg);
+    }
+    dd->comm->nmsg_nstep++;
+}
+
 void reset_dd_statistics_counters(gmx_domdec_t *dd)
 {
     gmx_domdec_comm_t *comm;
     int                ddnat;
+    gmx_int64_t        nmsg[ddnatNR-ddnatZONE] = { 0 };
 
     comm = dd->comm;
 
@@ -9230,11 +9425,13 @@ void reset_dd_statistics_counters(gmx_domdec_t *dd)
     {
         comm->sum_nat[ddnat-ddnatZONE] = 0;
     }
-    comm->ndecomp   = 0;
-    comm->nload     = 0;
-    comm->load_step = 0;
-    comm->load_sum  = 0;
-    comm->load_max  = 0;
+    comm->ndecomp    = 0;
+    set_dd_message_counts(dd, nmsg);
+    comm->nmsg_nstep = 0;
+    comm->nload      = 0;
+    comm->load_step  = 0;
+    comm->load_sum   = 0;
+    comm->load_max   = 0;
     clear_ivec(comm->load_lim);
     comm->load_mdf = 0;
     comm->load_pme = 0;
@@ -9245,11 +9442,21 @@ void print_dd_statistics(t_commrec *cr, t_inputrec *ir, FILE *fplog)
     gmx_domdec_comm_t *comm;
     int                ddnat;
     double             av;
+    gmx_int64_t        nmsg_count[ddnatNR-ddnatZONE];
+    double             nmsg[ddnatNR-ddnatZONE];
 
     comm = cr->dd->comm;
 
     gmx_sumd(ddnatNR-ddnatZONE, comm->sum_nat, cr);
 
+    /* Sum the messages over all ranks, ordered as the atom counts */
+    get_dd_message_counts(cr->dd, nmsg_count);
+    for (ddnat = ddnatZONE; ddnat < ddnatNR; ddnat++)
+    {
+        nmsg[ddnat-ddnatZONE] = nmsg_count[ddnat-ddnatZONE];
+    }
+    gmx_sumd(ddnatNR-ddnatZONE, nmsg, cr);
+
     if (fplog == NULL)
     {
         return;
@@ -9288,6 +9495,33 @@ void print_dd_statistics(t_commrec *cr, t_inputrec *ir, FILE *fplog)
                 gmx_incons(" Unknown type for DD statistics");
         }
     }
+    if (comm->nmsg_nstep > 0)
+    {
+        /* These are the messages of the halo, vsite and constraint
+         * communication during the MD steps, summed over all ranks.
+         * The messages during partitioning are not counted.
+         */
+        fprintf(fplog,
+                " av. #messages sent per step for force:       %.1f\n",
+                nmsg[ddnatZONE-ddnatZONE]/comm->nmsg_nstep);
+        if (cr->dd->vsite_comm)
+        {
+            fprintf(fplog,
+                    " av. #messages sent per step for vsites:      %.1f\n",
+                    nmsg[ddnatVSITE-ddnatZONE]/comm->nmsg_nstep);
+        }
+        if (cr->dd->constraint_comm)
+        {
+            fprintf(fplog,
+                    " av. #messages sent per step for constraints: %.1f\n",
+                    nmsg[ddnatCON-ddnatZONE]/comm->nmsg_nstep);
+        }
+        fprintf(fplog,
+                " av. #messages sent per step in total:        %.1f\n",
+                (nmsg[ddnatZONE-ddnatZONE] +
+                 nmsg[ddnatVSITE-ddnatZONE] +
+                 nmsg[ddnatCON-ddnatZONE])/comm->nmsg_nstep);
+    }
     fprintf(fplog, "\n");
 
     if (comm->bRecordLoad && EI_DYNAMICS(ir->eI))
@@ -9321,6 +9555,7 @@ void dd_partition_system(FILE                *fplog,
     gmx_ddbox_t        ddbox = {0};
     t_block           *cgs_gl;
     gmx_int64_t        step_pcoupl;
+    gmx_int64_t        nmsg[ddnatNR-ddnatZONE];
     rvec               cell_ns_x0, cell_ns_x1;
     int                i, n, ncgindex_set, ncg_home_old = -1, ncg_moved, nat_f_novirsum;
     gmx_bool           bBoxChanged, bNStGlobalComm, bDoDLB, bCheckDLB, bTurnOnDLB, bLogLoad;
@@ -9332,6 +9567,9 @@ void dd_partition_system(FILE                *fplog,
     dd   = cr->dd;
     comm = dd->comm;
 
+    /* The messages sent during the partitioning are not counted */
+    get_dd_message_counts(dd, nmsg);
+
     bBoxChanged = (bMasterState || DEFORM(*ir));
     if (ir->epc != epcNO)
     {
@@ -9915,4 +10153,5 @@ void dd_partition_system(FILE                *fplog,
         check_index_consistency(dd, top_global->natoms, ncg_mtop(top_global),
                                 "after partitioning");
     }
+    set_dd_message_counts(dd, nmsg);
 }
@@ -208,7 +208,7 @@ void dd_collect_state(gmx_domdec_t *dd,
 
 /*! \brief Cycle counter indices used internally in the domain decomposition */
 enum {
-    ddCyclStep, ddCyclPPduringPME, ddCyclF, ddCyclWaitGPU, ddCyclPME, ddCyclNr
+    ddCyclStep, ddCyclPPduringPME, ddCyclF, ddCyclWaitGPU, ddCyclPME, ddCyclListed, ddCyclNr
 };
 
 /*! \brief Add the wallcycle count to the DD counter */
@@ -229,6 +229,19 @@ float dd_pme_f_ratio(gmx_domdec_t *dd);
 /*! \brief Communicate the coordinates to the neighboring cells and do pbc. */
 void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[]);
 
+/*! \brief Start communicating the coordinates to the neighboring cells.
+ *
+ * Starts the first communication pulse using non-blocking communication,
+ * so work on the home atoms can be done while the coordinates are in
+ * flight. dd_move_x_finish should be called before the next call to any
+ * other DD communication function and before accessing non-home atoms.
+ * The home coordinates should not change in between.
+ */
+void dd_move_x_start(gmx_domdec_t *dd, matrix box, rvec x[]);
+
+/*! \brief Complete the coordinate communication started by dd_move_x_start. */
+void dd_move_x_finish(gmx_domdec_t *dd, matrix box, rvec x[]);
+
 /*! \brief Sum the forces over the neighboring cells.
  *
  * When fshift!=NULL the shift forces are updated to obtain
@@ -269,6 +282,13 @@ void dd_partition_system(FILE                *fplog,
                          gmx_wallcycle_t      wcycle,
                          gmx_bool             bVerbose);
 
+/*! \brief Counts an MD step for the DD message statistics
+ *
+ * Should be called at the start of each MD step. The messages sent
+ * before the first counted step and during partitioning are not counted.
+ */
+void dd_start_step_message_count(gmx_domdec_t *dd);
+
 /*! \brief Reset all the statistics and counters for total run counting */
 void reset_dd_statistics_counters(gmx_domdec_t *dd);
 
@@ -52,4 +52,26 @@ real dd_cutoff_multibody(const gmx_domdec_t *dd);
 /*! \brief Returns the DD cut-off distance for two-body interactions */
 real dd_cutoff_twobody(const gmx_domdec_t *dd);
 
+/*! \brief Computes the new DLB cell sizes of a row from the cell loads
+ *
+ * The relative imbalance of each cell is computed with respect to
+ * the part of the average load that moves with the cell boundaries,
+ * i.e. excluding the listed interaction load of the cell.
+ * The cell sizes are changed with underrelaxation and the maximum
+ * change over the row is limited by \p change_limit.
+ *
+ * \param[in]  ncd           The number of cells in the row
+ * \param[in]  load_aver     The average load of the cells in the row
+ * \param[in]  load          The load of cell i is load[i*load_stride]
+ * \param[in]  load_stride   The stride of \p load
+ * \param[in]  listed        The listed interaction load of each cell
+ * \param[in]  change_limit  The maximum relative change of a cell size
+ * \param[in]  cell_f        The ncd+1 current relative cell boundaries
+ * \param[out] cell_size     The ncd new, not yet normalized, cell sizes
+ */
+void dd_dlb_scale_cell_sizes(int ncd, real load_aver,
+                             const float *load, int load_stride,
+                             const real *listed, real change_limit,
+                             const real *cell_f, real *cell_size);
+
 #endif
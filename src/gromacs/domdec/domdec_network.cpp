@@ -154,6 +154,47 @@ void dd_sendrecv_rvec(const gmx_domdec_t gmx_unused *dd,
 #endif
 }
 
+int dd_isendrecv_rvec(const gmx_domdec_t gmx_unused *dd,
+                      int gmx_unused ddimind, int gmx_unused direction,
+                      rvec gmx_unused *buf_s, int gmx_unused n_s,
+                      rvec gmx_unused *buf_r, int gmx_unused n_r,
+                      MPI_Request gmx_unused *req)
+{
+    int nreq;
+
+    nreq = 0;
+#ifdef GMX_MPI
+    int rank_s, rank_r;
+
+    rank_s = dd->neighbor[ddimind][direction == dddirForward ? 0 : 1];
+    rank_r = dd->neighbor[ddimind][direction == dddirForward ? 1 : 0];
+
+    /* Post the receive first, so the message can go directly to buf_r */
+    if (n_r)
+    {
+        MPI_Irecv(buf_r[0], n_r*sizeof(rvec), MPI_BYTE,
+                  rank_r, 0, dd->mpi_comm_all, &req[nreq++]);
+    }
+    if (n_s)
+    {
+        MPI_Isend(buf_s[0], n_s*sizeof(rvec), MPI_BYTE,
+                  rank_s, 0, dd->mpi_comm_all, &req[nreq++]);
+    }
+#endif
+
+    return nreq;
+}
+
+void dd_wait_requests(int gmx_unused nreq, MPI_Request gmx_unused *req)
+{
+#ifdef GMX_MPI
+    if (nreq > 0)
+    {
+        MPI_Waitall(nreq, req, MPI_STATUSES_IGNORE);
+    }
+#endif
+}
+
 void dd_sendrecv2_rvec(const gmx_domdec_t gmx_unused *dd,
                        int gmx_unused ddimind,
                        rvec gmx_unused *buf_s_fw, int gmx_unused n_s_fw,
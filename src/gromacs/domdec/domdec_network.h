@@ -49,6 +49,7 @@
 #define GMX_DOMDEC_DOMDEC_NETWORK_H
 
 #include "gromacs/legacyheaders/typedefs.h"
+#include "gromacs/utility/gmxmpi.h"
 
 /* \brief */
 enum {
@@ -104,6 +105,25 @@ dd_sendrecv2_rvec(const gmx_domdec_t *dd,
                   rvec *buf_r_bw, int n_r_bw);
 
 
+/*! \brief Start moving rvec's in the comm. region one cell along the domain decomposition
+ *
+ * Non-blocking version of dd_sendrecv_rvec. The buffers should not be
+ * accessed until dd_wait_requests has been called with the requests
+ * stored in \p req, which should have space for 2 requests.
+ *
+ * \returns the number of requests stored in \p req.
+ */
+int
+dd_isendrecv_rvec(const gmx_domdec_t *dd,
+                  int ddimind, int direction,
+                  rvec *buf_s, int n_s,
+                  rvec *buf_r, int n_r,
+                  MPI_Request *req);
+
+/*! \brief Wait for the completion of \p nreq non-blocking requests in \p req */
+void
+dd_wait_requests(int nreq, MPI_Request *req);
+
 /* The functions below perform the same operations as the MPI functions
  * with the same name appendices, but over the domain decomposition
  * nodes only.
@@ -89,6 +89,7 @@ void dd_move_f_specat(gmx_domdec_t *dd, gmx_domdec_specat_comm_t *spac,
             dd_sendrecv2_rvec(dd, d,
                               f+n+n1, n0, vbuf, spas[0].nsend,
                               f+n, n1, vbuf+spas[0].nsend, spas[1].nsend);
+            spac->nmsg += (n0 > 0) + (n1 > 0);
             for (dir = 0; dir < 2; dir++)
             {
                 bPBC   = ((dir == 0 && dd->ci[dim] == 0) ||
@@ -146,6 +147,7 @@ void dd_move_f_specat(gmx_domdec_t *dd, gmx_domdec_specat_comm_t *spac,
             /* Send and receive the coordinates */
             dd_sendrecv_rvec(dd, d, dddirForward,
                              f+n, spas->nrecv, spac->vbuf, spas->nsend);
+            spac->nmsg += (spas->nrecv > 0);
             /* Sum the buffer into the required forces */
             if (dd->bScrewPBC && dim == XX &&
                 (dd->ci[dim] == 0 ||
@@ -259,6 +261,7 @@ void dd_move_x_specat(gmx_domdec_t *dd, gmx_domdec_specat_comm_t *spac,
             nr0  = spas[0].nrecv;
             ns1  = spas[1].nsend;
             nr1  = spas[1].nrecv;
+            spac->nmsg += (ns0 > 0) + (ns1 > 0);
             if (nvec == 1)
             {
                 dd_sendrecv2_rvec(dd, d,
@@ -323,6 +326,7 @@ void dd_move_x_specat(gmx_domdec_t *dd, gmx_domdec_specat_comm_t *spac,
                 }
             }
             /* Send and receive the coordinates */
+            spac->nmsg += (spas->nsend > 0);
             if (nvec == 1)
             {
                 dd_sendrecv_rvec(dd, d, dddirBackward,
@@ -79,6 +79,8 @@ typedef struct gmx_domdec_specat_comm {
     /* The range in the local buffer(s) for received atoms */
     int              at_start;         /**< Start index of received atoms */
     int              at_end;           /**< End index of received atoms */
+    /* Statistics */
+    gmx_int64_t      nmsg;             /**< The number of non-empty messages sent */
 
     /* The atom indices we need from the surrounding cells.
      * We can gather the indices over nthread threads.
@@ -0,0 +1,163 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the dynamic load balancing cell size scaling.
+ *
+ * A row of two cells of equal size is given an imbalanced load,
+ * with and without listed interaction load localized in the
+ * overloaded cell.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include <gtest/gtest.h>
+
+#include "gromacs/domdec/domdec_internal.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+using gmx::test::defaultRealTolerance;
+
+//! Number of cells in the test row
+const int c_numCells = 2;
+
+/*! \brief Test fixture for the DLB cell size scaling
+ *
+ * The loads are stored with a stride, as in the DD load buffers.
+ */
+class DlbCellSizeTest : public ::testing::Test
+{
+    public:
+        //! Stride of the loads in the load buffer
+        static const int loadStride_ = 3;
+
+        DlbCellSizeTest()
+        {
+            for (int i = 0; i < c_numCells*loadStride_; i++)
+            {
+                load_[i] = -1;
+            }
+            load_[0*loadStride_] = 1.5;
+            load_[1*loadStride_] = 0.5;
+            listed_[0]           = 0;
+            listed_[1]           = 0;
+            cellF_[0]            = 0;
+            cellF_[1]            = 0.5;
+            cellF_[2]            = 1;
+        }
+
+        //! Computes the new cell sizes with average load 1
+        void scaleCellSizes(real changeLimit)
+        {
+            dd_dlb_scale_cell_sizes(c_numCells, 1, load_, loadStride_,
+                                    listed_, changeLimit,
+                                    cellF_, cellSize_);
+        }
+
+        //! The cell loads
+        float load_[c_numCells*loadStride_];
+        //! The listed interaction load of the cells
+        real  listed_[c_numCells];
+        //! The relative cell boundaries
+        real  cellF_[c_numCells + 1];
+        //! The new cell sizes
+        real  cellSize_[c_numCells];
+};
+
+TEST_F(DlbCellSizeTest, ScalesWithLoadWithoutListedLoad)
+{
+    scaleCellSizes(1);
+
+    /* The imbalance of +-0.5 with relaxation 0.5 changes the sizes by 25% */
+    EXPECT_REAL_EQ_TOL(0.375, cellSize_[0], defaultRealTolerance());
+    EXPECT_REAL_EQ_TOL(0.625, cellSize_[1], defaultRealTolerance());
+}
+
+TEST_F(DlbCellSizeTest, LocalizedListedLoadShrinksCellMore)
+{
+    listed_[0] = 0.4;
+
+    scaleCellSizes(1);
+
+    /* Only the movable load of 1 - 0.4 shifts with the boundaries,
+     * so cell 0 has a relative imbalance of 0.5/0.6.
+     */
+    EXPECT_REAL_EQ_TOL(0.5*(1 - 0.5*0.5/0.6), cellSize_[0], defaultRealTolerance());
+    EXPECT_REAL_EQ_TOL(0.625, cellSize_[1], defaultRealTolerance());
+}
+
+TEST_F(DlbCellSizeTest, DominatingListedLoadDoesNotOvershoot)
+{
+    listed_[0] = 0.9;
+
+    scaleCellSizes(1);
+
+    /* At least half of the average load is considered movable */
+    EXPECT_REAL_EQ_TOL(0.25, cellSize_[0], defaultRealTolerance());
+    EXPECT_REAL_EQ_TOL(0.625, cellSize_[1], defaultRealTolerance());
+}
+
+TEST_F(DlbCellSizeTest, ChangeLimitAppliesToWholeRow)
+{
+    listed_[0] = 0.4;
+
+    scaleCellSizes(0.1);
+
+    /* Cell 0 has the maximum change, which is limited to 10%,
+     * the change of cell 1 is scaled down by the same factor.
+     */
+    real scale = 0.1/(0.5*0.5/0.6);
+    EXPECT_REAL_EQ_TOL(0.45, cellSize_[0], defaultRealTolerance());
+    EXPECT_REAL_EQ_TOL(0.5*(1 + scale*0.5*0.5), cellSize_[1], defaultRealTolerance());
+}
+
+TEST_F(DlbCellSizeTest, ZeroLoadKeepsCellSizes)
+{
+    load_[0*loadStride_] = 0;
+    load_[1*loadStride_] = 0;
+
+    dd_dlb_scale_cell_sizes(c_numCells, 0, load_, loadStride_,
+                            listed_, 1, cellF_, cellSize_);
+
+    EXPECT_REAL_EQ_TOL(0.5, cellSize_[0], defaultRealTolerance());
+    EXPECT_REAL_EQ_TOL(0.5, cellSize_[1], defaultRealTolerance());
+}
+
+} // namespace
@@ -75,7 +75,7 @@
 void gather_f_bsplines(struct gmx_pme_t *pme, real *grid,
                        gmx_bool bClearF, pme_atomcomm_t *atc,
                        splinedata_t *spline,
-                       real scale)
+                       real scale, gmx_bool bCalcFVir)
 {
     /* sum forces for local particles */
     int    nn, n, ithx, ithy, ithz, i0, j0, k0;
@@ -89,6 +89,8 @@ void gather_f_bsplines(struct gmx_pme_t *pme, real *grid,
     int    norder;
     real   rxx, ryx, ryy, rzx, rzy, rzz;
     int    order;
+    real   ffx, ffy, ffz;
+    real   xfxx, xfxy, xfxz, xfyx, xfyy, xfyz, xfzx, xfzy, xfzz;
 
 #ifdef PME_SIMD4_SPREAD_GATHER
     // cppcheck-suppress unreadVariable cppcheck seems not to analyze code from pme-simd4.h
@@ -116,6 +118,16 @@ void gather_f_bsplines(struct gmx_pme_t *pme, real *grid,
     rzy   = pme->recipbox[ZZ][YY];
     rzz   = pme->recipbox[ZZ][ZZ];
 
+    xfxx  = 0;
+    xfxy  = 0;
+    xfxz  = 0;
+    xfyx  = 0;
+    xfyy  = 0;
+    xfyz  = 0;
+    xfzx  = 0;
+    xfzy  = 0;
+    xfzz  = 0;
+
     for (nn = 0; nn < spline->n; nn++)
     {
         n           = spline->ind[nn];
@@ -176,11 +188,43 @@ void gather_f_bsplines(struct gmx_pme_t *pme, real *grid,
                     break;
             }
 
-            atc->f[n][XX] += -coefficient*( fx*nx*rxx );
-            atc->f[n][YY] += -coefficient*( fx*nx*ryx + fy*ny*ryy );
-            atc->f[n][ZZ] += -coefficient*( fx*nx*rzx + fy*ny*rzy + fz*nz*rzz );
+            ffx            = -coefficient*( fx*nx*rxx );
+            ffy            = -coefficient*( fx*nx*ryx + fy*ny*ryy );
+            ffz            = -coefficient*( fx*nx*rzx + fy*ny*rzy + fz*nz*rzz );
+            atc->f[n][XX] += ffx;
+            atc->f[n][YY] += ffy;
+            atc->f[n][ZZ] += ffz;
+
+            if (bCalcFVir)
+            {
+                xfxx += atc->x[n][XX]*ffx;
+                xfxy += atc->x[n][XX]*ffy;
+                xfxz += atc->x[n][XX]*ffz;
+                xfyx += atc->x[n][YY]*ffx;
+                xfyy += atc->x[n][YY]*ffy;
+                xfyz += atc->x[n][YY]*ffz;
+                xfzx += atc->x[n][ZZ]*ffx;
+                xfzy += atc->x[n][ZZ]*ffy;
+                xfzz += atc->x[n][ZZ]*ffz;
+            }
         }
     }
+
+    if (bCalcFVir)
+    {
+        /* The single sum virial, computed later, will subtract
+         * 0.5*x f of these forces, which we return here to add back.
+         */
+        spline->fvir[XX][XX] = 0.5*xfxx;
+        spline->fvir[XX][YY] = 0.5*xfxy;
+        spline->fvir[XX][ZZ] = 0.5*xfxz;
+        spline->fvir[YY][XX] = 0.5*xfyx;
+        spline->fvir[YY][YY] = 0.5*xfyy;
+        spline->fvir[YY][ZZ] = 0.5*xfyz;
+        spline->fvir[ZZ][XX] = 0.5*xfzx;
+        spline->fvir[ZZ][YY] = 0.5*xfzy;
+        spline->fvir[ZZ][ZZ] = 0.5*xfzz;
+    }
     /* Since the energy and not forces are interpolated
      * the net force might not be exactly zero.
      * This can be solved by also interpolating F, but
@@ -43,7 +43,7 @@ void
 gather_f_bsplines(struct gmx_pme_t *pme, real *grid,
                   gmx_bool bClearF, pme_atomcomm_t *atc,
                   splinedata_t *spline,
-                  real scale);
+                  real scale, gmx_bool bCalcFVir);
 
 real
 gather_energy_bsplines(struct gmx_pme_t *pme, real *grid,
@@ -763,18 +763,14 @@ void pmegrids_init(pmegrids_t *grids,
 
 void pmegrids_destroy(pmegrids_t *grids)
 {
-    int t;
-
     if (grids->grid.grid != NULL)
     {
-        sfree(grids->grid.grid);
+        sfree_aligned(grids->grid.grid);
 
-        if (grids->nthread > 0)
+        if (grids->grid_th != NULL)
         {
-            for (t = 0; t < grids->nthread; t++)
-            {
-                sfree(grids->grid_th[t].grid);
-            }
+            /* The thread grids are all stored in grid_all */
+            sfree_aligned(grids->grid_all);
             sfree(grids->grid_th);
         }
     }
@@ -151,10 +151,14 @@ typedef struct {
     int      *thread_one;
     int       n;
     int      *ind;
+    int      *ind_work;         /* Work array for sorting ind on spread tiles */
+    int      *tile_count;       /* Number of atoms per spread tile           */
+    int       tile_count_nalloc;
     splinevec theta;
     real     *ptr_theta_z;
     splinevec dtheta;
     real     *ptr_dtheta_z;
+    matrix    fvir;             /* 0.5*sum x f of the gathered forces        */
 } splinedata_t;
 
 /*! \brief Data structure for coordinating transfer between PP and PME ranks*/
@@ -241,6 +245,7 @@ typedef struct gmx_pme_t {
 
     gmx_bool   bUseThreads;   /* Does any of the PME ranks have nthread>1 ?  */
     int        nthread;       /* The number of threads doing PME on our rank */
+    gmx_bool   bSpreadTiles;  /* Sort atoms on cache sized tiles for spreading */
 
     gmx_bool   bPPnode;       /* Node also does particle-particle forces */
     gmx_bool   bFEP;          /* Compute Free energy contribution */
@@ -62,6 +62,7 @@
 #include "gromacs/legacyheaders/sim_util.h"
 #include "gromacs/legacyheaders/types/commrec.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/mdlib/nb_verlet.h"
 #include "gromacs/mdlib/nbnxn_gpu_data_mgmt.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/timing/wallcycle.h"
@@ -745,6 +746,12 @@ pme_load_balance(pme_load_balancing_t      *pme_lb,
 
     set = &pme_lb->setup[pme_lb->cur];
 
+    if (nbv->bDynamicPruning)
+    {
+        /* Keep the buffer of the dynamically pruned pair list constant */
+        nbv->rlistInner += set->rcut_coulomb - ic->rcoulomb;
+    }
+
     ic->rcoulomb     = set->rcut_coulomb;
     ic->rlist        = set->rlist;
     ic->rlistlong    = set->rlistlong;
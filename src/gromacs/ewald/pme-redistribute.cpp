@@ -156,6 +156,7 @@ static void pme_realloc_splinedata(splinedata_t *spline, pme_atomcomm_t *atc)
     int i;
 
     srenew(spline->ind, atc->nalloc);
+    srenew(spline->ind_work, atc->nalloc);
     /* Initialize the index to identity so it works without threads */
     for (i = 0; i < atc->nalloc; i++)
     {
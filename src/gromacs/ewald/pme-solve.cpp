@@ -69,6 +69,16 @@ struct pme_solve_work_t
     real *   eterm;
     real *   m2inv;
 
+    /* Cache of the influence function for the grid points of this thread,
+     * used as long as the box and the Ewald coefficient do not change.
+     */
+    real    *eterm_cache;
+    int      eterm_cache_nalloc;
+    gmx_bool bEtermCacheValid;
+    matrix   cache_recipbox;
+    real     cache_vol;
+    real     cache_ewaldcoeff;
+
     real     energy_q;
     matrix   vir_q;
     real     energy_lj;
@@ -140,6 +150,7 @@ static void free_work(struct pme_solve_work_t *work)
     sfree_aligned(work->tmp2);
     sfree_aligned(work->eterm);
     sfree(work->m2inv);
+    sfree(work->eterm_cache);
 }
 
 void pme_free_all_work(struct pme_solve_work_t **work, int nthread)
@@ -150,7 +161,7 @@ void pme_free_all_work(struct pme_solve_work_t **work, int nthread)
     {
         free_work(&(*work)[thread]);
     }
-    sfree(work);
+    sfree(*work);
     *work = NULL;
 }
 
@@ -279,6 +290,54 @@ gmx_inline static void calc_exponentials_lj(int start, int end, real *r, real *t
 }
 #endif
 
+/* Checks if the influence function cache of work can be used
+ * with the current box and Ewald coefficient. The cache is only filled
+ * when the same parameters are used in two consecutive calls, so with
+ * pressure coupling we do not spend time on filling it.
+ */
+static void check_eterm_cache(struct pme_solve_work_t *work,
+                              const struct gmx_pme_t *pme,
+                              real ewaldcoeff, real vol, int ncache,
+                              gmx_bool *bUseCache, gmx_bool *bFillCache)
+{
+    gmx_bool bSameParams;
+    int      i, j;
+
+    bSameParams = (ewaldcoeff == work->cache_ewaldcoeff &&
+                   vol == work->cache_vol);
+    for (i = 0; i < DIM; i++)
+    {
+        for (j = 0; j < DIM; j++)
+        {
+            bSameParams = bSameParams &&
+                (pme->recipbox[i][j] == work->cache_recipbox[i][j]);
+        }
+    }
+
+    *bUseCache  = FALSE;
+    *bFillCache = FALSE;
+    if (!bSameParams)
+    {
+        work->cache_ewaldcoeff = ewaldcoeff;
+        work->cache_vol        = vol;
+        copy_mat(pme->recipbox, work->cache_recipbox);
+        work->bEtermCacheValid = FALSE;
+    }
+    else if (work->bEtermCacheValid)
+    {
+        *bUseCache = TRUE;
+    }
+    else
+    {
+        if (ncache > work->eterm_cache_nalloc)
+        {
+            work->eterm_cache_nalloc = ncache;
+            srenew(work->eterm_cache, work->eterm_cache_nalloc);
+        }
+        *bFillCache = TRUE;
+    }
+}
+
 int solve_pme_yzx(struct gmx_pme_t *pme, t_complex *grid,
                   real ewaldcoeff, real vol,
                   gmx_bool bEnerVir,
@@ -303,6 +362,8 @@ int solve_pme_yzx(struct gmx_pme_t *pme, t_complex *grid,
     ivec                     complex_order;
     ivec                     local_ndata, local_offset, local_size;
     real                     elfac;
+    gmx_bool                 bUseCache, bFillCache;
+    real                    *eterm_cache;
 
     elfac = ONE_4PI_EPS0/pme->epsilon_r;
 
@@ -340,11 +401,19 @@ int solve_pme_yzx(struct gmx_pme_t *pme, t_complex *grid,
     iyz0 = local_ndata[YY]*local_ndata[ZZ]* thread   /nthread;
     iyz1 = local_ndata[YY]*local_ndata[ZZ]*(thread+1)/nthread;
 
+    check_eterm_cache(work, pme, ewaldcoeff, vol,
+                      (iyz1 - iyz0)*local_ndata[XX], &bUseCache, &bFillCache);
+
     for (iyz = iyz0; iyz < iyz1; iyz++)
     {
         iy = iyz/local_ndata[ZZ];
         iz = iyz - iy*local_ndata[ZZ];
 
+        /* The influence function cache for this grid line,
+         * local_offset[XX]=0, so we can index with kx.
+         */
+        eterm_cache = work->eterm_cache + (iyz - iyz0)*local_ndata[XX];
+
         ky = iy + local_offset[YY];
 
         if (ky < maxky)
@@ -432,7 +501,22 @@ int solve_pme_yzx(struct gmx_pme_t *pme, t_complex *grid,
                 m2inv[kx] = 1.0/m2[kx];
             }
 
-            calc_exponentials_q(kxstart, kxend, elfac, denom, tmp1, eterm);
+            if (bUseCache)
+            {
+                eterm = eterm_cache;
+            }
+            else
+            {
+                eterm = work->eterm;
+                calc_exponentials_q(kxstart, kxend, elfac, denom, tmp1, eterm);
+                if (bFillCache)
+                {
+                    for (kx = kxstart; kx < kxend; kx++)
+                    {
+                        eterm_cache[kx] = eterm[kx];
+                    }
+                }
+            }
 
             for (kx = kxstart; kx < kxend; kx++, p0++)
             {
@@ -468,33 +552,51 @@ int solve_pme_yzx(struct gmx_pme_t *pme, t_complex *grid,
              * In this case the triclinic overhead is small.
              */
 
-            /* Two explicit loops to avoid a conditional inside the loop */
-
-            for (kx = kxstart; kx < maxkx; kx++)
+            if (bUseCache)
             {
-                mx = kx;
-
-                mhxk      = mx * rxx;
-                mhyk      = mx * ryx + my * ryy;
-                mhzk      = mx * rzx + my * rzy + mz * rzz;
-                m2k       = mhxk*mhxk + mhyk*mhyk + mhzk*mhzk;
-                denom[kx] = m2k*bz*by*pme->bsp_mod[XX][kx];
-                tmp1[kx]  = -factor*m2k;
+                /* The solve is only a multiplication with the cached values */
+                eterm = eterm_cache;
             }
-
-            for (kx = maxkx; kx < kxend; kx++)
+            else
             {
-                mx = (kx - nx);
+                eterm = work->eterm;
 
-                mhxk      = mx * rxx;
-                mhyk      = mx * ryx + my * ryy;
-                mhzk      = mx * rzx + my * rzy + mz * rzz;
-                m2k       = mhxk*mhxk + mhyk*mhyk + mhzk*mhzk;
-                denom[kx] = m2k*bz*by*pme->bsp_mod[XX][kx];
-                tmp1[kx]  = -factor*m2k;
-            }
+                /* Two explicit loops to avoid a conditional inside the loop */
 
-            calc_exponentials_q(kxstart, kxend, elfac, denom, tmp1, eterm);
+                for (kx = kxstart; kx < maxkx; kx++)
+                {
+                    mx = kx;
+
+                    mhxk      = mx * rxx;
+                    mhyk      = mx * ryx + my * ryy;
+                    mhzk      = mx * rzx + my * rzy + mz * rzz;
+                    m2k       = mhxk*mhxk + mhyk*mhyk + mhzk*mhzk;
+                    denom[kx] = m2k*bz*by*pme->bsp_mod[XX][kx];
+                    tmp1[kx]  = -factor*m2k;
+                }
+
+                for (kx = maxkx; kx < kxend; kx++)
+                {
+                    mx = (kx - nx);
+
+                    mhxk      = mx * rxx;
+                    mhyk      = mx * ryx + my * ryy;
+                    mhzk      = mx * rzx + my * rzy + mz * rzz;
+                    m2k       = mhxk*mhxk + mhyk*mhyk + mhzk*mhzk;
+                    denom[kx] = m2k*bz*by*pme->bsp_mod[XX][kx];
+                    tmp1[kx]  = -factor*m2k;
+                }
+
+                calc_exponentials_q(kxstart, kxend, elfac, denom, tmp1, eterm);
+
+                if (bFillCache)
+                {
+                    for (kx = kxstart; kx < kxend; kx++)
+                    {
+                        eterm_cache[kx] = eterm[kx];
+                    }
+                }
+            }
 
             for (kx = kxstart; kx < kxend; kx++, p0++)
             {
@@ -526,6 +628,11 @@ int solve_pme_yzx(struct gmx_pme_t *pme, t_complex *grid,
         work->energy_q = 0.5*energy;
     }
 
+    if (bFillCache)
+    {
+        work->bEtermCacheValid = TRUE;
+    }
+
     /* Return the loop count */
     return local_ndata[YY]*local_ndata[XX];
 }
@@ -41,6 +41,7 @@
 #include "config.h"
 
 #include <assert.h>
+#include <math.h>
 
 #include <algorithm>
 
@@ -199,6 +200,92 @@ static void make_thread_local_ind(pme_atomcomm_t *atc,
     spline->n = n;
 }
 
+/* The target size in bytes of the part of a thread-local grid
+ * touched when spreading the atoms in one tile, about the L1 cache size.
+ */
+#define PME_SPREAD_TILE_BYTES  (32*1024)
+
+/* Returns the spread tile index for grid index \p idx */
+static gmx_inline int spread_tile_index(const int *idx, const pmegrid_t *grid,
+                                        int tile_size, int ntx, int nty)
+{
+    int tx, ty;
+
+    tx = (idx[XX] - grid->offset[XX])/tile_size;
+    ty = (idx[YY] - grid->offset[YY])/tile_size;
+    tx = std::min(std::max(tx, 0), ntx - 1);
+    ty = std::min(std::max(ty, 0), nty - 1);
+
+    return tx*nty + ty;
+}
+
+/* Sort the atom indices of a thread on tiles in x and y of its local grid.
+ * With large thread-local grids, spreading atoms in arbitrary order
+ * accesses the whole grid for every few atoms. With sorting, consecutive
+ * atoms only access the grid lines of one tile, which stay in cache.
+ * The sort is stable, so the result is the same for each call with
+ * the same interpolation indices, as required for the gather.
+ */
+static void sort_thread_ind_on_tiles(const pme_atomcomm_t *atc,
+                                     const pmegrid_t      *grid,
+                                     splinedata_t         *spline)
+{
+    int  order, tile_size, ntx, nty, ntile, i, t, sum, cnt;
+    int *tmp;
+
+    order = grid->order;
+
+    /* The tile size in x and y, the tile grid covers (tile_size+order-1)^2
+     * grid lines of length s[ZZ].
+     */
+    tile_size = (int)sqrt(PME_SPREAD_TILE_BYTES/(double)(sizeof(real)*grid->s[ZZ])) - (order - 1);
+    tile_size = std::max(tile_size, 1);
+
+    ntx   = (grid->n[XX] - (order - 1) + tile_size - 1)/tile_size;
+    nty   = (grid->n[YY] - (order - 1) + tile_size - 1)/tile_size;
+    ntile = ntx*nty;
+
+    if (ntile <= 1 || spline->n <= 1)
+    {
+        /* The whole local grid fits in cache, no need to sort */
+        return;
+    }
+
+    if (ntile > spline->tile_count_nalloc)
+    {
+        spline->tile_count_nalloc = over_alloc_large(ntile);
+        srenew(spline->tile_count, spline->tile_count_nalloc);
+    }
+    for (t = 0; t < ntile; t++)
+    {
+        spline->tile_count[t] = 0;
+    }
+
+    for (i = 0; i < spline->n; i++)
+    {
+        spline->tile_count[spread_tile_index(atc->idx[spline->ind[i]], grid, tile_size, ntx, nty)]++;
+    }
+
+    /* Convert the counts to tile start indices */
+    sum = 0;
+    for (t = 0; t < ntile; t++)
+    {
+        cnt                   = spline->tile_count[t];
+        spline->tile_count[t] = sum;
+        sum                  += cnt;
+    }
+
+    for (i = 0; i < spline->n; i++)
+    {
+        t = spread_tile_index(atc->idx[spline->ind[i]], grid, tile_size, ntx, nty);
+        spline->ind_work[spline->tile_count[t]++] = spline->ind[i];
+    }
+
+    tmp              = spline->ind;
+    spline->ind      = spline->ind_work;
+    spline->ind_work = tmp;
+}
+
 /* Macro to force loop unrolling by fixing order.
  * This gives a significant performance gain.
  */
@@ -923,6 +1010,12 @@ void spread_on_grid(struct gmx_pme_t *pme,
             {
                 /* Get the indices our thread should operate on */
                 make_thread_local_ind(atc, thread, spline);
+
+                if (pme->bSpreadTiles)
+                {
+                    sort_thread_ind_on_tiles(atc, &grids->grid_th[thread],
+                                             spline);
+                }
             }
 
             grid = &grids->grid_th[thread];
@@ -164,8 +164,7 @@ int gmx_pme_destroy(FILE *log, struct gmx_pme_t **pmedata)
     for (i = 0; i < (*pmedata)->ngrids; ++i)
     {
         pmegrids_destroy(&(*pmedata)->pmegrid[i]);
-        sfree((*pmedata)->fftgrid[i]);
-        sfree((*pmedata)->cfftgrid[i]);
+        /* This also frees fftgrid[i] and cfftgrid[i] */
         gmx_parallel_3dfft_destroy((*pmedata)->pfft_setup[i]);
     }
 
@@ -584,6 +583,8 @@ int gmx_pme_init(struct gmx_pme_t **pmedata,
     }
     pme->bUseThreads = (sum_use_threads > 0);
 
+    pme->bSpreadTiles = (getenv("GMX_PME_NO_SPREAD_TILES") == NULL);
+
     if (ir->ePBC == epbcSCREW)
     {
         gmx_fatal(FARGS, "pme does not (yet) work with pbc = screw");
@@ -890,6 +891,18 @@ calc_next_lb_coeffs(struct gmx_pme_t *pme, real *local_sigma)
     }
 }
 
+/*! \brief Add the virial correction for gathering into a force array
+ * for which the single sum virial is computed to \p vir */
+static void add_gather_fvir(const struct gmx_pme_t *pme, matrix vir)
+{
+    int thread;
+
+    for (thread = 0; thread < pme->nthread; thread++)
+    {
+        m_add(vir, pme->atc[0].spline[thread].fvir, vir);
+    }
+}
+
 int gmx_pme_do(struct gmx_pme_t *pme,
                int start,       int homenr,
                rvec x[],        rvec f[],
@@ -926,6 +939,7 @@ int gmx_pme_do(struct gmx_pme_t *pme,
     int                  fep_states_lj           = pme->bFEP_lj ? 2 : 1;
     const gmx_bool       bCalcEnerVir            = flags & GMX_PME_CALC_ENER_VIR;
     const gmx_bool       bCalcF                  = flags & GMX_PME_CALC_F;
+    const gmx_bool       bCalcFVir               = (bCalcEnerVir && (flags & GMX_PME_F_IN_VIRSUM));
 
     assert(pme->nnodes > 0);
     assert(pme->nnodes == 1 || pme->ndecompdim > 0);
@@ -1200,7 +1214,12 @@ int gmx_pme_do(struct gmx_pme_t *pme,
             {
                 gather_f_bsplines(pme, grid, bClearF, atc,
                                   &atc->spline[thread],
-                                  pme->bFEP ? (grid_index % 2 == 0 ? 1.0-lambda : lambda) : 1.0);
+                                  pme->bFEP ? (grid_index % 2 == 0 ? 1.0-lambda : lambda) : 1.0,
+                                  bCalcFVir);
+            }
+            if (bCalcFVir)
+            {
+                add_gather_fvir(pme, grid_index < DO_Q ? vir_q : vir_lj);
             }
 
             where();
@@ -1465,7 +1484,11 @@ int gmx_pme_do(struct gmx_pme_t *pme,
                     {
                         gather_f_bsplines(pme, grid, bClearF, &pme->atc[0],
                                           &pme->atc[0].spline[thread],
-                                          scale);
+                                          scale, bCalcFVir);
+                    }
+                    if (bCalcFVir)
+                    {
+                        add_gather_fvir(pme, vir_lj);
                     }
                     where();
 
@@ -92,6 +92,10 @@ int gmx_pme_destroy(FILE *log, struct gmx_pme_t **pmedata);
 #define GMX_PME_CALC_ENER_VIR (1<<3)
 /* This forces the grid to be backtransformed even without GMX_PME_CALC_F */
 #define GMX_PME_CALC_POT      (1<<4)
+/* The forces are gathered into an array for which the single sum virial
+ * is computed later, correct the returned mesh virial for this.
+ */
+#define GMX_PME_F_IN_VIRSUM   (1<<5)
 
 /* These values label bits used for sending messages to PME nodes using the
  * routines in pme_pp.c and shouldn't conflict with the flags used there
@@ -0,0 +1,323 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for PME.
+ *
+ * The optimized code paths of the PME mesh part are compared against
+ * the plain code paths on a system of random charges.
+ *
+ * \ingroup module_ewald
+ */
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/ewald/pme-internal.h"
+#include "gromacs/ewald/pme.h"
+#include "gromacs/fft/parallel_3dfft.h"
+#include "gromacs/legacyheaders/network.h"
+#include "gromacs/legacyheaders/nrnb.h"
+#include "gromacs/legacyheaders/types/commrec.h"
+#include "gromacs/legacyheaders/types/inputrec.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+//! Ewald coefficient for a cut-off of 0.9 nm and ewald-rtol=1e-5
+const real ewaldCoeff = 3.47127;
+
+/*! \brief Test fixture for PME
+ *
+ * The system consists of 400 charges of alternating sign, spread
+ * over a rectangular box with a grid that is large enough for
+ * the thread-local grids to be sorted on tiles with four threads.
+ */
+class PmeTest : public ::testing::Test
+{
+    public:
+        //! Number of atoms in the system
+        static const int numAtoms_ = 400;
+
+        PmeTest() : cr_(init_commrec()), x_(numAtoms_), f_(numAtoms_),
+                    charge_(numAtoms_)
+        {
+#ifdef GMX_OPENMP
+            numThreads_ = 4;
+#else
+            numThreads_ = 1;
+#endif
+
+            snew(ir_, 1);
+            ir_->ePBC                   = epbcXYZ;
+            ir_->coulombtype            = eelPME;
+            ir_->vdwtype                = evdwCUT;
+            ir_->efep                   = efepNO;
+            ir_->epsilon_r              = 1;
+            ir_->nkx                    = 52;
+            ir_->nky                    = 48;
+            ir_->nkz                    = 48;
+            ir_->pme_order              = 4;
+            ir_->ljpme_combination_rule = eljpmeGEOM;
+
+            clear_mat(box_);
+            box_[XX][XX] = 4.3;
+            box_[YY][YY] = 4.0;
+            box_[ZZ][ZZ] = 3.9;
+
+            /* Quasi-random positions, without clustering */
+            for (int i = 0; i < numAtoms_; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    real frac = std::fmod((i + 1)*(0.7548776662 + 0.2*d*d) + 0.13*d, 1.0);
+
+                    x_[i][d] = frac*box_[d][d];
+                }
+                charge_[i] = (i % 2 == 0 ? 0.8 : -0.8);
+            }
+
+            init_nrnb(&nrnb_);
+        }
+
+        ~PmeTest()
+        {
+            sfree(ir_);
+            sfree(cr_);
+        }
+
+        //! Initializes PME with the requested number of threads
+        gmx_pme_t *initPme(int numThreads)
+        {
+            gmx_pme_t *pme;
+
+            gmx_pme_init(&pme, cr_, 1, 1, ir_, numAtoms_,
+                         FALSE, FALSE, FALSE, numThreads);
+
+            return pme;
+        }
+
+        //! Runs the PME mesh part for \p flags, clears f_ first
+        void runPme(gmx_pme_t *pme, int flags, matrix vir, real *energy)
+        {
+            matrix vir_lj;
+            real   energy_lj, dvdl_q = 0, dvdl_lj = 0;
+
+            for (int i = 0; i < numAtoms_; i++)
+            {
+                clear_rvec(f_[i]);
+            }
+            clear_mat(vir);
+            clear_mat(vir_lj);
+            *energy = 0;
+
+            gmx_pme_do(pme, 0, numAtoms_, as_rvec_array(&x_[0]), as_rvec_array(&f_[0]),
+                       &charge_[0], NULL, NULL, NULL, NULL, NULL,
+                       box_, cr_, 0, 0, &nrnb_, NULL,
+                       vir, ewaldCoeff, vir_lj, 0,
+                       energy, &energy_lj, 0, 0, &dvdl_q, &dvdl_lj,
+                       flags);
+        }
+
+        //! Returns the real space grid after spreading the charges
+        std::vector<real> spreadGrid(gmx_pme_t *pme)
+        {
+            matrix            vir;
+            real              energy;
+            ivec              local_ndata, local_offset, local_size;
+            std::vector<real> grid;
+
+            runPme(pme, GMX_PME_SPREAD | GMX_PME_DO_COULOMB, vir, &energy);
+
+            gmx_parallel_3dfft_real_limits(pme->pfft_setup[0],
+                                           local_ndata, local_offset, local_size);
+            for (int ix = 0; ix < local_ndata[XX]; ix++)
+            {
+                for (int iy = 0; iy < local_ndata[YY]; iy++)
+                {
+                    for (int iz = 0; iz < local_ndata[ZZ]; iz++)
+                    {
+                        int index = (ix*local_size[YY] + iy)*local_size[ZZ] + iz;
+
+                        grid.push_back(pme->fftgrid[0][index]);
+                    }
+                }
+            }
+
+            return grid;
+        }
+
+        //! Expects \p energy, \p vir and f_ to match the reference output
+        void compareWithReference(real energyRef, matrix virRef,
+                                  const std::vector<gmx::RVec> &fRef,
+                                  real energy, matrix vir,
+                                  const gmx::test::FloatingPointTolerance &virialTolerance
+                                      = gmx::test::defaultRealTolerance())
+        {
+            gmx::test::FloatingPointTolerance tolerance(
+                    gmx::test::defaultRealTolerance());
+
+            EXPECT_REAL_EQ_TOL(energyRef, energy, tolerance);
+            for (int d1 = 0; d1 < DIM; d1++)
+            {
+                for (int d2 = 0; d2 < DIM; d2++)
+                {
+                    EXPECT_REAL_EQ_TOL(virRef[d1][d2], vir[d1][d2], virialTolerance)
+                    << "virial element " << d1 << " " << d2;
+                }
+            }
+            for (int i = 0; i < numAtoms_; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ_TOL(fRef[i][d], f_[i][d], tolerance)
+                    << "force on atom " << i << " dim " << d;
+                }
+            }
+        }
+
+        t_commrec              *cr_;
+        t_inputrec             *ir_;
+        t_nrnb                  nrnb_;
+        int                     numThreads_;
+        matrix                  box_;
+        std::vector<gmx::RVec>  x_;
+        std::vector<gmx::RVec>  f_;
+        std::vector<real>       charge_;
+};
+
+TEST_F(PmeTest, SpreadOnTilesMatchesUnsortedSpread)
+{
+    gmx_pme_t *pme = initPme(numThreads_);
+
+    pme->bSpreadTiles = FALSE;
+    std::vector<real> unsortedGrid = spreadGrid(pme);
+    pme->bSpreadTiles = TRUE;
+    std::vector<real> sortedGrid   = spreadGrid(pme);
+
+    ASSERT_EQ(unsortedGrid.size(), sortedGrid.size());
+    /* Sorting only changes the summation order on the grid */
+    gmx::test::FloatingPointTolerance tolerance(
+            gmx::test::absoluteTolerance(GMX_REAL_EPS*100));
+    for (size_t i = 0; i < sortedGrid.size(); i++)
+    {
+        EXPECT_REAL_EQ_TOL(unsortedGrid[i], sortedGrid[i], tolerance) << "grid index " << i;
+    }
+
+    gmx_pme_destroy(NULL, &pme);
+}
+
+TEST_F(PmeTest, CachedInfluenceFunctionGivesSameResult)
+{
+    const int  flags = (GMX_PME_SPREAD | GMX_PME_SOLVE | GMX_PME_CALC_F |
+                        GMX_PME_CALC_ENER_VIR | GMX_PME_DO_COULOMB);
+    gmx_pme_t *pme   = initPme(numThreads_);
+    matrix     virRef, vir;
+    real       energyRef, energy;
+
+    /* The first call computes the influence function */
+    runPme(pme, flags, virRef, &energyRef);
+    std::vector<gmx::RVec> fRef(f_);
+
+    /* The second call fills the cache, the third one uses it */
+    for (int call = 0; call < 2; call++)
+    {
+        SCOPED_TRACE(call == 0 ? "Filling the cache" : "Using the cache");
+        runPme(pme, flags, vir, &energy);
+        compareWithReference(energyRef, virRef, fRef, energy, vir);
+    }
+
+    /* Changing the box should invalidate the cache */
+    svmul(1.02, box_[XX], box_[XX]);
+    gmx_pme_t *pmeNewBox = initPme(numThreads_);
+    runPme(pmeNewBox, flags, virRef, &energyRef);
+    fRef = f_;
+    runPme(pme, flags, vir, &energy);
+    {
+        SCOPED_TRACE("After changing the box");
+        compareWithReference(energyRef, virRef, fRef, energy, vir);
+    }
+
+    gmx_pme_destroy(NULL, &pmeNewBox);
+    gmx_pme_destroy(NULL, &pme);
+}
+
+TEST_F(PmeTest, ForcesInVirialSumCorrectTheMeshVirial)
+{
+    const int  flags = (GMX_PME_SPREAD | GMX_PME_SOLVE | GMX_PME_CALC_F |
+                        GMX_PME_CALC_ENER_VIR | GMX_PME_DO_COULOMB);
+    gmx_pme_t *pme   = initPme(numThreads_);
+    matrix     virRef, vir;
+    real       energyRef, energy;
+
+    runPme(pme, flags, virRef, &energyRef);
+    std::vector<gmx::RVec> fRef(f_);
+
+    runPme(pme, flags | GMX_PME_F_IN_VIRSUM, vir, &energy);
+
+    /* The single sum virial will subtract 0.5 x f of the mesh forces,
+     * which should have been added to the returned mesh virial.
+     */
+    for (int d1 = 0; d1 < DIM; d1++)
+    {
+        for (int d2 = 0; d2 < DIM; d2++)
+        {
+            double xf = 0;
+
+            for (int i = 0; i < numAtoms_; i++)
+            {
+                xf += x_[i][d1]*fRef[i][d2];
+            }
+            virRef[d1][d2] += 0.5*xf;
+        }
+    }
+    /* The correction is summed in a different order */
+    compareWithReference(energyRef, virRef, fRef, energy, vir,
+                         gmx::test::relativeToleranceAsFloatingPoint(1000, 5e-6));
+
+    gmx_pme_destroy(NULL, &pme);
+}
+
+} // namespace
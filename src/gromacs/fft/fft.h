@@ -55,6 +55,7 @@
 #include <stdio.h>
 
 #include "gromacs/math/gmxcomplex.h"
+#include "gromacs/utility/basedefinitions.h"
 #include "gromacs/utility/real.h"
 
 #ifdef __cplusplus
@@ -417,6 +418,29 @@ gmx_fft_transpose_2d   (t_complex *       in_data,
  */
 void gmx_fft_cleanup();
 
+/*! \brief Import FFT planning data from file, once per process
+ *
+ *  With FFTW this imports wisdom, so plans for problems that were
+ *  measured in earlier runs, with the same sizes, strides and number
+ *  of threads, are created without measuring. Only the first call
+ *  in a process imports, so this can be called from all threads
+ *  that start a simulation. Does nothing with other FFT libraries.
+ *
+ *  \param fn  Name of the file to read
+ *  \return TRUE if planning data was imported by this call.
+ */
+gmx_bool gmx_fft_wisdom_import(const char *fn);
+
+/*! \brief Export the FFT planning data accumulated in this process to file
+ *
+ *  Should be called when no FFT plans are being created.
+ *  Does nothing with FFT libraries that do not support this.
+ *
+ *  \param fn  Name of the file to write
+ *  \return FALSE if the file could not be written.
+ */
+gmx_bool gmx_fft_wisdom_export(const char *fn);
+
 /*! \brief Return string describing the underlying FFT implementation.
  *
  * Used to print out information about the used FFT library where needed.
@@ -168,6 +168,94 @@ static int vmax(int* a, int s)
  * lin is allocated by fft5d because size of array is only known after planning phase
  * rlout2 is only used as intermediate buffer - only returned after allocation to reuse for back transform - should not be used by caller
  */
+#if defined GMX_MPI && !defined FFT5D_MPI_TRANSPOSE
+/* Returns in l0 and l1 the range of local lines to transform by thread
+ * for chunk c of the pipelined FFT step s. The chunks are formed by
+ * the z-planes, so the data for each destination rank is contiguous.
+ */
+static void fft5d_pipeline_lines(const fft5d_plan plan, int s, int c, int thread,
+                                 int *l0, int *l1)
+{
+    int z0, z1, nline;
+
+    z0    = ( c   *plan->pK[s])/plan->npipe;
+    z1    = ((c+1)*plan->pK[s])/plan->npipe;
+    nline = (z1 - z0)*plan->pM[s];
+
+    *l0 = z0*plan->pM[s] + ( thread   *nline)/plan->nthreads;
+    *l1 = z0*plan->pM[s] + ((thread+1)*nline)/plan->nthreads;
+}
+#endif
+
+/* Sets up pipelining of the first two transposes when requested
+ * with the environment variable GMX_FFT5D_PIPELINE, which sets the number
+ * of chunks. Each transpose is then split into chunks of z-planes which
+ * are communicated with non-blocking calls while the FFTs of the next
+ * chunks are computed.
+ */
+static void fft5d_init_pipeline(fft5d_plan plan, int lsize)
+{
+    plan->npipe = 0;
+#if defined GMX_MPI && !defined FFT5D_MPI_TRANSPOSE
+    char *env;
+    int   s, c, t, l0, l1;
+
+    env = getenv("GMX_FFT5D_PIPELINE");
+    if (env == NULL || !GMX_PARALLEL_ENV_INITIALIZED ||
+        (plan->P[0] <= 1 && plan->P[1] <= 1))
+    {
+        return;
+    }
+    plan->npipe = strtol(env, NULL, 10);
+    if (plan->npipe <= 1)
+    {
+        plan->npipe = 0;
+        return;
+    }
+    if (debug)
+    {
+        fprintf(debug, "FFT5D: pipelining the transposes in %d chunks\n",
+                plan->npipe);
+    }
+
+    snew_aligned(plan->pipe_sbuf, lsize, 32);
+    snew_aligned(plan->pipe_rbuf, lsize, 32);
+    snew(plan->pipe_req, 2*std::max(plan->P[0], plan->P[1])*plan->npipe);
+
+    for (s = 0; s < 2; s++)
+    {
+        if (plan->P[s] <= 1)
+        {
+            continue;
+        }
+        plan->p1d_pipe[s] = (gmx_fft_t*)malloc(sizeof(gmx_fft_t)*plan->npipe*plan->nthreads);
+        for (c = 0; c < plan->npipe; c++)
+        {
+            for (t = 0; t < plan->nthreads; t++)
+            {
+                gmx_fft_t *p1d = &plan->p1d_pipe[s][c*plan->nthreads + t];
+
+                fft5d_pipeline_lines(plan, s, c, t, &l0, &l1);
+                if (l1 == l0)
+                {
+                    *p1d = NULL;
+                }
+                else if ((plan->flags&FFT5D_REALCOMPLEX) && !(plan->flags&FFT5D_BACKWARD) && s == 0)
+                {
+                    gmx_fft_init_many_1d_real(p1d, plan->rC[s], l1 - l0, (plan->flags&FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0);
+                }
+                else
+                {
+                    gmx_fft_init_many_1d     (p1d,  plan->C[s], l1 - l0, (plan->flags&FFT5D_NOMEASURE) ? GMX_FFT_FLAG_CONSERVATIVE : 0);
+                }
+            }
+        }
+    }
+#else
+    GMX_UNUSED_VALUE(lsize);
+#endif
+}
+
 fft5d_plan fft5d_plan_3d(int NG, int MG, int KG, MPI_Comm comm[2], int flags, t_complex** rlin, t_complex** rlout, t_complex** rlout2, t_complex** rlout3, int nthreads)
 {
 
@@ -661,6 +749,7 @@ fft5d_plan fft5d_plan_3d(int NG, int MG, int KG, MPI_Comm comm[2], int flags, t_
  */
     plan->flags    = flags;
     plan->nthreads = nthreads;
+    fft5d_init_pipeline(plan, lsize);
     *rlin          = lin;
     *rlout         = lout;
     *rlout2        = lout2;
@@ -956,6 +1045,91 @@ static void print_localdata(const t_complex* lin, const char* txt, int s, fft5d_
     }
 }
 
+#if defined GMX_MPI && !defined FFT5D_MPI_TRANSPOSE
+/* Performs FFT step s and the following transpose in chunks.
+ * The communication of each chunk is started as soon as all threads
+ * have transformed and split their part of the chunk, so it overlaps
+ * with the FFTs of the next chunks. The result ends up in plan->pipe_rbuf.
+ * Must be called by all threads.
+ */
+static void fft5d_fft_transpose_pipelined(fft5d_plan plan, int s, int thread, fft5d_time times)
+{
+    int     *N  = plan->N, *M = plan->M, *K = plan->K, *pM = plan->pM, *pK = plan->pK, *C = plan->C, *P = plan->P;
+    int      b13, nblock, plane_s, plane_r, nz, z0, z1, c, i, l0, l1, nreq;
+    gmx_fft_t p1d;
+
+    /* The block and plane sizes should match those of the MPI_Alltoall
+     * calls and the join functions in fft5d_execute.
+     */
+    b13 = ((s == 0 && !(plan->flags&FFT5D_ORDER_YZ)) || (s == 1 && (plan->flags&FFT5D_ORDER_YZ)));
+    if (b13)
+    {
+        nblock  = N[s]*pM[s]*K[s];
+        plane_r = N[s]*pM[s];
+    }
+    else
+    {
+        nblock  = N[s]*M[s]*pK[s];
+        plane_r = N[s]*M[s];
+    }
+    plane_s = N[s]*M[s];
+
+    nreq = 0;
+    for (c = 0; c < plan->npipe; c++)
+    {
+        fft5d_pipeline_lines(plan, s, c, thread, &l0, &l1);
+        p1d = plan->p1d_pipe[s][c*plan->nthreads + thread];
+        if (l1 > l0)
+        {
+            if ((plan->flags&FFT5D_REALCOMPLEX) && !(plan->flags&FFT5D_BACKWARD) && s == 0)
+            {
+                gmx_fft_many_1d_real(p1d, GMX_FFT_REAL_TO_COMPLEX, plan->lin+l0*C[s], plan->lout+l0*C[s]);
+            }
+            else
+            {
+                gmx_fft_many_1d(     p1d, (plan->flags&FFT5D_BACKWARD) ? GMX_FFT_BACKWARD : GMX_FFT_FORWARD, plan->lin+l0*C[s], plan->lout+l0*C[s]);
+            }
+            splitaxes(plan->pipe_sbuf, plan->lout, N[s], M[s], K[s], pM[s], P[s], C[s], plan->iNout[s], plan->oNout[s], l0%pM[s], l0/pM[s], l1%pM[s], l1/pM[s]);
+        }
+#pragma omp barrier /*all parts of this chunk have to be in the send buffer*/
+
+        if (thread == 0)
+        {
+            for (i = 0; i < P[s]; i++)
+            {
+                /* Chunk c of the block from rank i, its number of planes is
+                 * what we receive from i in a non-pipelined transpose.
+                 */
+                nz = (b13 ? plan->iNin[s+1][i] : pK[s]);
+                z0 = ( c   *nz)/plan->npipe;
+                z1 = ((c+1)*nz)/plan->npipe;
+                if (z1 > z0)
+                {
+                    MPI_Irecv((real *)(plan->pipe_rbuf + i*nblock + z0*plane_r), (z1 - z0)*plane_r*sizeof(t_complex)/sizeof(real), GMX_MPI_REAL, i, c, plan->cart[s], &plan->pipe_req[nreq++]);
+                }
+                z0 = ( c   *pK[s])/plan->npipe;
+                z1 = ((c+1)*pK[s])/plan->npipe;
+                if (z1 > z0)
+                {
+                    MPI_Isend((real *)(plan->pipe_sbuf + i*nblock + z0*plane_s), (z1 - z0)*plane_s*sizeof(t_complex)/sizeof(real), GMX_MPI_REAL, i, c, plan->cart[s], &plan->pipe_req[nreq++]);
+                }
+            }
+        }
+    }
+
+    if (thread == 0)
+    {
+#ifndef NOGMX
+        wallcycle_start(times, ewcPME_FFTCOMM);
+#endif
+        MPI_Waitall(nreq, plan->pipe_req, MPI_STATUSES_IGNORE);
+#ifndef NOGMX
+        wallcycle_stop(times, ewcPME_FFTCOMM);
+#endif
+    }
+}
+#endif
+
 void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
 {
     t_complex  *lin   = plan->lin;
@@ -976,7 +1150,7 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
 #endif
     int   *N = plan->N, *M = plan->M, *K = plan->K, *pN = plan->pN, *pM = plan->pM, *pK = plan->pK,
     *C       = plan->C, *P = plan->P, **iNin = plan->iNin, **oNin = plan->oNin, **iNout = plan->iNout, **oNout = plan->oNout;
-    int    s = 0, tstart, tend, bParallelDim;
+    int    s = 0, tstart, tend, bParallelDim, bPipelined;
 
 
 #ifdef GMX_FFT_FFTW3
@@ -1023,6 +1197,7 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         {
             bParallelDim = 0;
         }
+        bPipelined = (bParallelDim && plan->p1d_pipe[s] != NULL);
 
         /* ---------- START FFT ------------ */
 #ifdef NOGMX
@@ -1049,7 +1224,14 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         }
 
         tstart = (thread*pM[s]*pK[s]/plan->nthreads)*C[s];
-        if ((plan->flags&FFT5D_REALCOMPLEX) && !(plan->flags&FFT5D_BACKWARD) && s == 0)
+        if (bPipelined)
+        {
+#if defined GMX_MPI && !defined FFT5D_MPI_TRANSPOSE
+            /* The FFT is done in chunks, overlapped with the transpose */
+            fft5d_fft_transpose_pipelined(plan, s, thread, times);
+#endif
+        }
+        else if ((plan->flags&FFT5D_REALCOMPLEX) && !(plan->flags&FFT5D_BACKWARD) && s == 0)
         {
             gmx_fft_many_1d_real(p1d[s][thread], (plan->flags&FFT5D_BACKWARD) ? GMX_FFT_COMPLEX_TO_REAL : GMX_FFT_REAL_TO_COMPLEX, lin+tstart, fftout+tstart);
         }
@@ -1072,7 +1254,7 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         /* ---------- END FFT ------------ */
 
         /* ---------- START SPLIT + TRANSPOSE------------ (if parallel in in this dimension)*/
-        if (bParallelDim)
+        if (bParallelDim && !bPipelined)
         {
 #ifdef NOGMX
             if (times != NULL && thread == 0)
@@ -1148,7 +1330,11 @@ void fft5d_execute(fft5d_plan plan, int thread, fft5d_time times)
         }
 #endif
 
-        if (bParallelDim)
+        if (bPipelined)
+        {
+            joinin = plan->pipe_rbuf;
+        }
+        else if (bParallelDim)
         {
             joinin = lout3;
         }
@@ -1271,6 +1457,23 @@ void fft5d_destroy(fft5d_plan plan)
             plan->oNout[s] = 0;
         }
     }
+    for (s = 0; s < 2; s++)
+    {
+        if (plan->p1d_pipe[s])
+        {
+            for (t = 0; t < plan->npipe*plan->nthreads; t++)
+            {
+                gmx_many_fft_destroy(plan->p1d_pipe[s][t]);
+            }
+            free(plan->p1d_pipe[s]);
+        }
+    }
+    if (plan->npipe > 1)
+    {
+        sfree_aligned(plan->pipe_sbuf);
+        sfree_aligned(plan->pipe_rbuf);
+        sfree(plan->pipe_req);
+    }
 #ifdef GMX_FFT_FFTW3
     FFTW_LOCK;
 #ifdef FFT5D_MPI_TRANSPOS
@@ -117,6 +117,12 @@ struct fft5d_plan_t {
     /*int P[2];*/
     int coor[2];
     int nthreads;
+    /* Pipelined transposes, only used when npipe > 1 */
+    int          npipe;           /*number of chunks the transposes are split into*/
+    gmx_fft_t   *p1d_pipe[2];     /*1D plans for each chunk and thread, for the first two FFT steps*/
+    t_complex   *pipe_sbuf;       /*send buffer for pipelined transposes*/
+    t_complex   *pipe_rbuf;       /*receive buffer for pipelined transposes*/
+    MPI_Request *pipe_req;        /*requests for pipelined transposes*/
 };
 
 typedef struct fft5d_plan_t *fft5d_plan;
@@ -495,6 +495,16 @@ void gmx_fft_cleanup()
 {
 }
 
+gmx_bool gmx_fft_wisdom_import(const char gmx_unused *fn)
+{
+    return FALSE;
+}
+
+gmx_bool gmx_fft_wisdom_export(const char gmx_unused *fn)
+{
+    return TRUE;
+}
+
 const char *gmx_fft_get_version_info()
 {
     return "fftpack (built-in)";
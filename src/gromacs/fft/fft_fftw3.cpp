@@ -38,6 +38,7 @@
 #include "config.h"
 
 #include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include <fftw3.h>
@@ -588,6 +589,44 @@ void gmx_fft_cleanup()
     FFTWPREFIX(cleanup)();
 }
 
+gmx_bool gmx_fft_wisdom_import(const char *fn)
+{
+    static gmx_bool bImported = FALSE;
+    FILE           *fp;
+    int             ret = 0;
+
+    FFTW_LOCK;
+    if (!bImported)
+    {
+        bImported = TRUE;
+        fp        = fopen(fn, "r");
+        if (fp != NULL)
+        {
+            ret = FFTWPREFIX(import_wisdom_from_file)(fp);
+            fclose(fp);
+        }
+    }
+    FFTW_UNLOCK;
+
+    return (ret != 0);
+}
+
+gmx_bool gmx_fft_wisdom_export(const char *fn)
+{
+    FILE *fp;
+
+    FFTW_LOCK;
+    fp = fopen(fn, "w");
+    if (fp != NULL)
+    {
+        FFTWPREFIX(export_wisdom_to_file)(fp);
+        fclose(fp);
+    }
+    FFTW_UNLOCK;
+
+    return (fp != NULL);
+}
+
 const char *gmx_fft_get_version_info()
 {
 #ifdef GMX_NATIVE_WINDOWS
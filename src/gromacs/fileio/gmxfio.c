@@ -42,6 +42,7 @@
 
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #ifdef HAVE_IO_H
@@ -50,6 +51,12 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if defined HAVE_SYS_MMAN_H && defined HAVE_MMAP && defined HAVE_FMEMOPEN
+#define GMX_FIO_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include "thread_mpi/threads.h"
 
@@ -395,6 +402,74 @@ static void gmx_fio_stop_getting_next(t_fileio *fio)
  *                     EXPORTED SECTION
  *
  *****************************************************************/
+/* Trajectories that are only read can be accessed through a memory
+ * mapping of the file, which is enabled with GMX_TRAJ_MMAP. Reading then
+ * copies from the page cache without a read system call for every stdio
+ * buffer, and the kernel is told to read ahead sequentially.
+ * The stream is opened in binary mode, as with text mode older glibc
+ * versions seek relative to the first zero byte for SEEK_END.
+ * Truncating the file while it is mapped, e.g. by an appending mdrun,
+ * makes accesses beyond the new end fail with SIGBUS.
+ * Returns NULL when the file should be opened normally.
+ */
+static FILE *gmx_fio_mmap_open(t_fileio *fio)
+{
+#ifdef GMX_FIO_MMAP
+    struct stat st;
+    int         fd;
+    void       *addr;
+    FILE       *fp;
+
+    if ((fio->iFTP != efTRR && fio->iFTP != efXTC) ||
+        getenv("GMX_TRAJ_MMAP") == NULL)
+    {
+        return NULL;
+    }
+
+    /* Compressed files, which gmx_ffopen reads through a pipe, and files
+     * that do not fit in the address space are not mapped.
+     */
+    fd = open(fio->fn, O_RDONLY);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+        (gmx_off_t)(size_t)st.st_size != st.st_size)
+    {
+        close(fd);
+        return NULL;
+    }
+    addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        return NULL;
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise(addr, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+    fp = fmemopen(addr, st.st_size, "rb");
+    if (fp == NULL)
+    {
+        munmap(addr, st.st_size);
+        return NULL;
+    }
+    fio->mmap_addr = addr;
+    fio->mmap_size = st.st_size;
+    if (debug)
+    {
+        fprintf(debug, "Reading %s through a memory mapping\n", fio->fn);
+    }
+
+    return fp;
+#else
+    GMX_UNUSED_VALUE(fio);
+    return NULL;
+#endif
+}
+
 t_fileio *gmx_fio_open(const char *fn, const char *mode)
 {
     t_fileio *fio = NULL;
@@ -481,7 +556,14 @@ t_fileio *gmx_fio_open(const char *fn, const char *mode)
                 gmx_incons("gmx_fio_open may not be used to open TNG files");
             }
             /* Open the file */
-            fio->fp = gmx_ffopen(fn, newmode);
+            if (bRead)
+            {
+                fio->fp = gmx_fio_mmap_open(fio);
+            }
+            if (fio->fp == NULL)
+            {
+                fio->fp = gmx_ffopen(fn, newmode);
+            }
 
             /* determine the XDR direction */
             if (newmode[0] == 'w' || newmode[0] == 'a')
@@ -544,6 +626,13 @@ static int gmx_fio_close_locked(t_fileio *fio)
         rc = gmx_ffclose(fio->fp); /* fclose returns 0 if happy */
 
     }
+#ifdef GMX_FIO_MMAP
+    if (fio->mmap_addr != NULL)
+    {
+        munmap(fio->mmap_addr, fio->mmap_size);
+        fio->mmap_addr = NULL;
+    }
+#endif
     fio->bOpen = FALSE;
 
     return rc;
@@ -90,6 +90,8 @@ struct t_fileio
     XDR         *xdr;                  /* the xdr data pointer */
     enum xdr_op  xdrmode;              /* the xdr mode */
     int          iFTP;                 /* the file type identifier */
+    void        *mmap_addr;            /* the file mapping when fp reads from it */
+    size_t       mmap_size;            /* the size of the file mapping */
 
     const char  *comment;              /* a comment string for debugging */
 
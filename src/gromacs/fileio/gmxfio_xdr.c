@@ -39,6 +39,7 @@
 #include "config.h"
 
 #include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -70,6 +71,66 @@ const t_iotype xdr_iotype = {do_xdrread, do_xdrwrite};
 
 #ifdef USE_XDR
 
+/* With IEEE floating point in a uniform byte and word order, the XDR
+ * representation of a real differs from the in-memory one only by byte
+ * order, so blocks of rvecs can be read in one go.
+ */
+#if defined GMX_FLOAT_FORMAT_IEEE754 && \
+    (defined GMX_IEEE754_BIG_ENDIAN_BYTE_ORDER) == (defined GMX_IEEE754_BIG_ENDIAN_WORD_ORDER)
+#define GMX_XDR_BLOCK_RVEC
+#endif
+
+#ifdef GMX_XDR_BLOCK_RVEC
+/* Reads nitem rvecs stored in the precision of real directly into v
+ * and converts them from XDR byte order in place.
+ */
+static bool_t do_xdr_read_rvec_block(t_fileio *fio, rvec *v, int nitem)
+{
+    unsigned int   nbytes = nitem*DIM*sizeof(real);
+#ifndef GMX_IEEE754_BIG_ENDIAN_BYTE_ORDER
+    real          *r      = v[0];
+#ifdef GMX_DOUBLE
+    gmx_uint64_t   w;
+#else
+    gmx_uint32_t   w;
+#endif
+    int            i;
+#endif
+
+    if (!xdr_opaque(fio->xdr, (char *)v, nbytes))
+    {
+        return FALSE;
+    }
+#ifndef GMX_IEEE754_BIG_ENDIAN_BYTE_ORDER
+    /* We swap through an integer copy, as accessing the reals through
+     * an integer pointer would break strict aliasing.
+     */
+    for (i = 0; i < nitem*DIM; i++)
+    {
+        memcpy(&w, &r[i], sizeof(w));
+#ifdef GMX_DOUBLE
+        w = (((w & 0x00000000000000ffULL) << 56) |
+             ((w & 0x000000000000ff00ULL) << 40) |
+             ((w & 0x0000000000ff0000ULL) << 24) |
+             ((w & 0x00000000ff000000ULL) <<  8) |
+             ((w & 0x000000ff00000000ULL) >>  8) |
+             ((w & 0x0000ff0000000000ULL) >> 24) |
+             ((w & 0x00ff000000000000ULL) >> 40) |
+             ((w & 0xff00000000000000ULL) >> 56));
+#else
+        w = (((w & 0x000000ffU) << 24) |
+             ((w & 0x0000ff00U) <<  8) |
+             ((w & 0x00ff0000U) >>  8) |
+             ((w & 0xff000000U) >> 24));
+#endif
+        memcpy(&r[i], &w, sizeof(w));
+    }
+#endif
+
+    return TRUE;
+}
+#endif
+
 static gmx_bool do_xdr(t_fileio *fio, void *item, int nitem, int eio,
                        const char *desc, const char *srcfile, int line)
 {
@@ -230,6 +291,18 @@ static gmx_bool do_xdr(t_fileio *fio, void *item, int nitem, int eio,
             }
             break;
         case eioNRVEC:
+#ifdef GMX_XDR_BLOCK_RVEC
+            /* Reading a (trajectory) coordinate block without conversion
+             * of the precision is the common case that is worth a fast path.
+             */
+            if (item && fio->xdrmode == XDR_DECODE &&
+                fio->bDouble == (sizeof(real) == sizeof(double)) &&
+                nitem > 0 && nitem <= (int)(INT_MAX/(DIM*sizeof(double))))
+            {
+                res = do_xdr_read_rvec_block(fio, (rvec *) item, nitem);
+                break;
+            }
+#endif
             ptr = NULL;
             res = 1;
             for (j = 0; (j < nitem) && res; j++)
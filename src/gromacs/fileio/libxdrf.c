@@ -44,8 +44,16 @@
 
 #include "gromacs/fileio/xdr_datatype.h"
 #include "gromacs/fileio/xdrf.h"
+#include "gromacs/simd/simd.h"
 #include "gromacs/utility/futil.h"
 
+#if defined GMX_SIMD_HAVE_FLOAT && defined GMX_SIMD_HAVE_FINT32 && \
+    defined GMX_SIMD_HAVE_LOGICAL && \
+    defined GMX_SIMD_HAVE_LOADU && defined GMX_SIMD_HAVE_STOREU
+/* Use SIMD for converting between floating point and integer coordinates */
+#define XDR_SIMD
+#endif
+
 /* This is just for clarity - it can never be anything but 4! */
 #define XDR_INT_SIZE 4
 
@@ -231,6 +239,34 @@ static void sendints(int buf[], const int num_of_ints, const int num_of_bits,
     int          i, num_of_bytes, bytecnt;
     unsigned int bytes[32], tmp;
 
+    if (num_of_bits <= 64)
+    {
+        /* The combined integer fits in 64 bits, so we can avoid
+         * the byte-wise multiplication below.
+         */
+        gmx_uint64_t v = nums[0];
+
+        for (i = 1; i < num_of_ints; i++)
+        {
+            if (nums[i] >= sizes[i])
+            {
+                fprintf(stderr, "major breakdown in sendints num %u doesn't "
+                        "match size %u\n", nums[i], sizes[i]);
+                exit(1);
+            }
+            v = v * sizes[i] + nums[i];
+        }
+        for (i = 0; i + 8 <= num_of_bits; i += 8)
+        {
+            sendbits(buf, 8, (int)((v >> i) & 0xff));
+        }
+        if (i < num_of_bits)
+        {
+            sendbits(buf, num_of_bits - i, (int)((v >> i) & 0xff));
+        }
+        return;
+    }
+
     tmp          = nums[0];
     num_of_bytes = 0;
     do
@@ -356,6 +392,25 @@ static void receiveints(int buf[], const int num_of_ints, int num_of_bits,
     {
         bytes[num_of_bytes++] = receivebits(buf, num_of_bits);
     }
+    if (num_of_bytes <= 8)
+    {
+        /* The combined integer fits in 64 bits, so we can avoid
+         * the byte-wise division below.
+         */
+        gmx_uint64_t v = 0;
+
+        for (j = num_of_bytes-1; j >= 0; j--)
+        {
+            v = (v << 8) | (unsigned int)bytes[j];
+        }
+        for (i = num_of_ints-1; i > 0; i--)
+        {
+            nums[i] = (int)(v % sizes[i]);
+            v      /= sizes[i];
+        }
+        nums[0] = (int)v;
+        return;
+    }
     for (i = num_of_ints-1; i > 0; i--)
     {
         num = 0;
@@ -371,6 +426,176 @@ static void receiveints(int buf[], const int num_of_ints, int num_of_bits,
     nums[0] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (bytes[3] << 24);
 }
 
+/*____________________________________________________________________________
+ |
+ | quantize_coords - convert coordinates to integers
+ |
+ | multiplies the size3 floats in fp by precision, rounds to the nearest
+ | integer and stores the result in ip. The minimum and maximum integers
+ | for each dimension are returned in minint and maxint. Returns 0 when
+ | scaling would cause integer overflow, 1 otherwise.
+ | Since truncation is monotonic, we can determine the extremes using
+ | the rounded floats, which is convenient with SIMD. This does not hold
+ | for values that overflow, then the extremes are taken from the integers,
+ | which the encoder uses, as the frame is still written.
+ |
+ */
+
+static int quantize_coords(const float *fp, int *ip, int size3,
+                           float precision, int minint[3], int maxint[3])
+{
+    float lf, minf[3], maxf[3];
+    int   i, d, errval = 1;
+
+    minf[0] = minf[1] = minf[2] = INT_MAX;
+    maxf[0] = maxf[1] = maxf[2] = INT_MIN;
+    i       = 0;
+#ifdef XDR_SIMD
+    /* With negative precision the sign of x*precision differs from x */
+    if (precision > 0)
+    {
+        /* We process GMX_SIMD_FLOAT_WIDTH atoms with three SIMD
+         * registers, so each element of a register always holds
+         * the same dimension.
+         */
+        float            mem[4*GMX_SIMD_FLOAT_WIDTH], *buf;
+        gmx_simd_float_t prec_S, half_S, sign_S, zero_S, maxabs_S;
+        gmx_simd_float_t lf_S, min_S[3], max_S[3];
+        gmx_simd_fbool_t overflow_S;
+        int              v, e;
+
+        prec_S     = gmx_simd_set1_f(precision);
+        half_S     = gmx_simd_set1_f(0.5f);
+        sign_S     = gmx_simd_set1_f(GMX_FLOAT_NEGZERO);
+        zero_S     = gmx_simd_setzero_f();
+        /* All floats below MAXABS are also below 2^31 */
+        maxabs_S   = gmx_simd_set1_f(2147483648.0f);
+        overflow_S = gmx_simd_cmplt_f(zero_S, zero_S);
+        for (v = 0; v < 3; v++)
+        {
+            min_S[v] = gmx_simd_set1_f(INT_MAX);
+            max_S[v] = gmx_simd_set1_f(INT_MIN);
+        }
+        for (; i + 3*GMX_SIMD_FLOAT_WIDTH <= size3; i += 3*GMX_SIMD_FLOAT_WIDTH)
+        {
+            for (v = 0; v < 3; v++)
+            {
+                /* find nearest integer. We add 0.5 to the absolute value
+                 * and restore the sign afterwards, which gives the same
+                 * result as the scalar code and, in contrast to adding
+                 * +-0.5 directly, can not be contracted to an FMA.
+                 */
+                lf_S       = gmx_simd_mul_f(gmx_simd_loadu_f(fp + i + v*GMX_SIMD_FLOAT_WIDTH), prec_S);
+                lf_S       = gmx_simd_xor_f(gmx_simd_add_f(gmx_simd_fabs_f(lf_S), half_S),
+                                            gmx_simd_and_f(lf_S, sign_S));
+                overflow_S = gmx_simd_or_fb(overflow_S,
+                                            gmx_simd_cmple_f(maxabs_S, gmx_simd_fabs_f(lf_S)));
+                min_S[v]   = gmx_simd_min_f(min_S[v], lf_S);
+                max_S[v]   = gmx_simd_max_f(max_S[v], lf_S);
+                gmx_simd_storeu_fi(ip + i + v*GMX_SIMD_FLOAT_WIDTH,
+                                   gmx_simd_cvtt_f2i(lf_S));
+            }
+        }
+        if (gmx_simd_anytrue_fb(overflow_S))
+        {
+            /* scaling would cause overflow */
+            errval = 0;
+        }
+
+        buf = gmx_simd_align_f(mem);
+        for (v = 0; v < 3; v++)
+        {
+            gmx_simd_store_f(buf, min_S[v]);
+            for (e = 0; e < GMX_SIMD_FLOAT_WIDTH; e++)
+            {
+                d       = (v*GMX_SIMD_FLOAT_WIDTH + e) % 3;
+                minf[d] = MIN(minf[d], buf[e]);
+            }
+            gmx_simd_store_f(buf, max_S[v]);
+            for (e = 0; e < GMX_SIMD_FLOAT_WIDTH; e++)
+            {
+                d       = (v*GMX_SIMD_FLOAT_WIDTH + e) % 3;
+                maxf[d] = MAX(maxf[d], buf[e]);
+            }
+        }
+    }
+#endif
+    for (; i < size3; i++)
+    {
+        /* find nearest integer */
+        if (fp[i] >= 0.0)
+        {
+            lf = fp[i] * precision + 0.5;
+        }
+        else
+        {
+            lf = fp[i] * precision - 0.5;
+        }
+        if (fabs(lf) > MAXABS)
+        {
+            /* scaling would cause overflow */
+            errval = 0;
+        }
+        d       = i % 3;
+        minf[d] = MIN(minf[d], lf);
+        maxf[d] = MAX(maxf[d], lf);
+        ip[i]   = lf;
+    }
+    if (errval)
+    {
+        for (d = 0; d < 3; d++)
+        {
+            minint[d] = minf[d];
+            maxint[d] = maxf[d];
+        }
+    }
+    else
+    {
+        minint[0] = minint[1] = minint[2] = INT_MAX;
+        maxint[0] = maxint[1] = maxint[2] = INT_MIN;
+        for (i = 0; i < size3; i++)
+        {
+            d         = i % 3;
+            minint[d] = MIN(minint[d], ip[i]);
+            maxint[d] = MAX(maxint[d], ip[i]);
+        }
+    }
+
+    return errval;
+}
+
+/*____________________________________________________________________________
+ |
+ | dequantize_coords - convert integer coordinates to floats
+ |
+ | multiplies the size3 integers in ip by inv_precision and stores
+ | the result in fp.
+ |
+ */
+
+static void dequantize_coords(const int *ip, float *fp, int size3,
+                              float inv_precision)
+{
+    int i = 0;
+
+#ifdef XDR_SIMD
+    {
+        gmx_simd_float_t inv_prec_S = gmx_simd_set1_f(inv_precision);
+
+        for (; i + GMX_SIMD_FLOAT_WIDTH <= size3; i += GMX_SIMD_FLOAT_WIDTH)
+        {
+            gmx_simd_storeu_f(fp + i,
+                              gmx_simd_mul_f(gmx_simd_cvt_i2f(gmx_simd_loadu_fi(ip + i)),
+                                             inv_prec_S));
+        }
+    }
+#endif
+    for (; i < size3; i++)
+    {
+        fp[i] = ip[i] * inv_precision;
+    }
+}
+
 /*____________________________________________________________________________
  |
  | xdr3dfcoord - read or write compressed 3d coordinates to xdr file.
@@ -411,12 +636,11 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
     int          we_should_free = 0;
 
     int          minint[3], maxint[3], mindiff, *lip, diff;
-    int          lint1, lint2, lint3, oldlint1, oldlint2, oldlint3, smallidx;
+    int          smallidx;
     int          minidx, maxidx;
     unsigned     sizeint[3], sizesmall[3], bitsizeint[3], size3, *luip;
     int          flag, k;
     int          smallnum, smaller, larger, i, is_small, is_smaller, run, prevrun;
-    float       *lfp, lf;
     int          tmp, *thiscoord,  prevcoord[3];
     unsigned int tmpcoord[30];
 
@@ -472,96 +696,16 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
         }
         /* buf[0-2] are special and do not contain actual data */
         buf[0]    = buf[1] = buf[2] = 0;
-        minint[0] = minint[1] = minint[2] = INT_MAX;
-        maxint[0] = maxint[1] = maxint[2] = INT_MIN;
         prevrun   = -1;
-        lfp       = fp;
-        lip       = ip;
+        errval    = quantize_coords(fp, ip, size3, *precision, minint, maxint);
         mindiff   = INT_MAX;
-        oldlint1  = oldlint2 = oldlint3 = 0;
-        while (lfp < fp + size3)
+        for (lip = ip + 3; lip < ip + size3; lip += 3)
         {
-            /* find nearest integer */
-            if (*lfp >= 0.0)
-            {
-                lf = *lfp * *precision + 0.5;
-            }
-            else
-            {
-                lf = *lfp * *precision - 0.5;
-            }
-            if (fabs(lf) > MAXABS)
-            {
-                /* scaling would cause overflow */
-                errval = 0;
-            }
-            lint1 = lf;
-            if (lint1 < minint[0])
-            {
-                minint[0] = lint1;
-            }
-            if (lint1 > maxint[0])
-            {
-                maxint[0] = lint1;
-            }
-            *lip++ = lint1;
-            lfp++;
-            if (*lfp >= 0.0)
-            {
-                lf = *lfp * *precision + 0.5;
-            }
-            else
-            {
-                lf = *lfp * *precision - 0.5;
-            }
-            if (fabs(lf) > MAXABS)
-            {
-                /* scaling would cause overflow */
-                errval = 0;
-            }
-            lint2 = lf;
-            if (lint2 < minint[1])
-            {
-                minint[1] = lint2;
-            }
-            if (lint2 > maxint[1])
-            {
-                maxint[1] = lint2;
-            }
-            *lip++ = lint2;
-            lfp++;
-            if (*lfp >= 0.0)
-            {
-                lf = *lfp * *precision + 0.5;
-            }
-            else
-            {
-                lf = *lfp * *precision - 0.5;
-            }
-            if (fabs(lf) > MAXABS)
-            {
-                /* scaling would cause overflow */
-                errval = 0;
-            }
-            lint3 = lf;
-            if (lint3 < minint[2])
-            {
-                minint[2] = lint3;
-            }
-            if (lint3 > maxint[2])
-            {
-                maxint[2] = lint3;
-            }
-            *lip++ = lint3;
-            lfp++;
-            diff = abs(oldlint1-lint1)+abs(oldlint2-lint2)+abs(oldlint3-lint3);
-            if (diff < mindiff && lfp > fp + 3)
+            diff = abs(lip[-3]-lip[0])+abs(lip[-2]-lip[1])+abs(lip[-1]-lip[2]);
+            if (diff < mindiff)
             {
                 mindiff = diff;
             }
-            oldlint1 = lint1;
-            oldlint2 = lint2;
-            oldlint3 = lint3;
         }
         if ( (xdr_int(xdrs, &(minint[0])) == 0) ||
              (xdr_int(xdrs, &(minint[1])) == 0) ||
@@ -896,7 +1040,6 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
 
         buf[0] = buf[1] = buf[2] = 0;
 
-        lfp           = fp;
         inv_precision = 1.0 / *precision;
         run           = 0;
         i             = 0;
@@ -956,9 +1099,10 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
                         prevcoord[1] = tmp;
                         tmp          = thiscoord[2]; thiscoord[2] = prevcoord[2];
                         prevcoord[2] = tmp;
-                        *lfp++       = prevcoord[0] * inv_precision;
-                        *lfp++       = prevcoord[1] * inv_precision;
-                        *lfp++       = prevcoord[2] * inv_precision;
+                        /* store the first atom in its original place */
+                        thiscoord[-3] = prevcoord[0];
+                        thiscoord[-2] = prevcoord[1];
+                        thiscoord[-1] = prevcoord[2];
                     }
                     else
                     {
@@ -966,17 +1110,9 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
                         prevcoord[1] = thiscoord[1];
                         prevcoord[2] = thiscoord[2];
                     }
-                    *lfp++ = thiscoord[0] * inv_precision;
-                    *lfp++ = thiscoord[1] * inv_precision;
-                    *lfp++ = thiscoord[2] * inv_precision;
+                    thiscoord += 3;
                 }
             }
-            else
-            {
-                *lfp++ = thiscoord[0] * inv_precision;
-                *lfp++ = thiscoord[1] * inv_precision;
-                *lfp++ = thiscoord[2] * inv_precision;
-            }
             smallidx += is_smaller;
             if (is_smaller < 0)
             {
@@ -997,6 +1133,8 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
             }
             sizesmall[0] = sizesmall[1] = sizesmall[2] = magicints[smallidx];
         }
+
+        dequantize_coords(ip, fp, size3, inv_precision);
     }
     if (we_should_free)
     {
@@ -1658,3 +1796,58 @@ xdr_xtc_get_last_frame_number(FILE *fp, XDR *xdrs, int natoms, gmx_bool * bOK)
 
     return frame;
 }
+
+
+int xdr_xtc_skip_frame(FILE *fp, XDR *xdrs, int *natoms, int *step, float *time)
+{
+    gmx_off_t off, skip;
+    int       magic, natoms_x, nbytes, i, idum;
+    float     fdum;
+
+    if ((off = gmx_ftell(fp)) < 0)
+    {
+        return -1;
+    }
+    /* The header check needs the number of atoms */
+    if (!xdr_int(xdrs, &magic) || !xdr_int(xdrs, natoms))
+    {
+        return 0;
+    }
+    if (gmx_fseek(fp, off, SEEK_SET) ||
+        xtc_at_header_start(fp, xdrs, *natoms, step, time) != 1)
+    {
+        return -1;
+    }
+    /* Skip the rest of the header and the box */
+    if (gmx_fseek(fp, off + header_size + 9*XDR_INT_SIZE, SEEK_SET) ||
+        !xdr_int(xdrs, &natoms_x))
+    {
+        return -1;
+    }
+    if (natoms_x <= 9)
+    {
+        /* Small systems are stored uncompressed */
+        skip = natoms_x*3*XDR_INT_SIZE;
+    }
+    else
+    {
+        /* precision, minint[3], maxint[3] and smallidx */
+        xdr_float(xdrs, &fdum);
+        for (i = 0; i < 7; i++)
+        {
+            xdr_int(xdrs, &idum);
+        }
+        if (!xdr_int(xdrs, &nbytes))
+        {
+            return -1;
+        }
+        /* XDR opaque data is padded to a multiple of 4 bytes */
+        skip = ((nbytes + 3)/4)*4;
+    }
+    if (gmx_fseek(fp, skip, SEEK_CUR))
+    {
+        return -1;
+    }
+
+    return 1;
+}
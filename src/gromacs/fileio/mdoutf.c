@@ -36,14 +36,20 @@
 
 #include "mdoutf.h"
 
+#include <stdlib.h>
+
+#include "thread_mpi/threads.h"
+
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/fileio/tngio.h"
 #include "gromacs/fileio/trajectory_writing.h"
 #include "gromacs/fileio/trnio.h"
+#include "gromacs/fileio/trxindex.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/fileio/xvgr.h"
 #include "gromacs/legacyheaders/checkpoint.h"
 #include "gromacs/legacyheaders/copyrite.h"
+#include "gromacs/legacyheaders/md_logging.h"
 #include "gromacs/legacyheaders/mdrun.h"
 #include "gromacs/legacyheaders/types/commrec.h"
 #include "gromacs/math/vec.h"
@@ -51,9 +57,31 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/smalloc.h"
 
+/* The number of frames that can be queued for the writer thread.
+ * With two frames the MD loop can fill one buffer while the writer
+ * thread writes the other. When all buffers are queued, the MD loop
+ * waits for the writer thread.
+ */
+#define MDOUTF_NFRAME 2
+
+/* A trn and/or xtc frame queued for writing */
+typedef struct {
+    int          flags;  /* The MDOF_ flags of the data in this frame */
+    gmx_int64_t  step;
+    double       t;
+    real         lambda;
+    matrix       box;
+    rvec        *x;      /* Full precision data, natoms_global */
+    rvec        *v;
+    rvec        *f;
+    rvec        *xxtc;   /* Compressed coordinates, natoms_x_compressed */
+} mdoutf_frame_t;
+
 struct gmx_mdoutf {
     t_fileio         *fp_trn;
     t_fileio         *fp_xtc;
+    gmx_trxindex_t    trn_index; /* Frame index for fp_trn, can be NULL */
+    gmx_trxindex_t    xtc_index; /* Frame index for fp_xtc, can be NULL */
     tng_trajectory_t  tng;
     tng_trajectory_t  tng_low_prec;
     int               x_compression_precision; /* only used by XTC output */
@@ -70,8 +98,184 @@ struct gmx_mdoutf {
     int               natoms_x_compressed;
     gmx_groups_t     *groups; /* for compressed position writing */
     gmx_wallcycle_t   wcycle;
+
+    /* Asynchronous writing of trn and xtc frames on the master rank */
+    gmx_bool             bAsync;         /* Do we use a writer thread?       */
+    tMPI_Thread_t        writer;         /* The writer thread                */
+    tMPI_Thread_mutex_t  writer_mutex;   /* Protects the queue below         */
+    tMPI_Thread_cond_t   writer_cond;    /* Signals changes in the queue     */
+    mdoutf_frame_t       frame[MDOUTF_NFRAME]; /* Frame buffers              */
+    int                  frame_first;    /* Index of the first queued frame  */
+    int                  nframe_queued;  /* Number of queued frames          */
+    gmx_bool             bWriterFinish;  /* Tells the writer thread to stop  */
 };
 
+/* Writes a frame to the trn and/or xtc file, as set by mdof_flags */
+static void write_trn_xtc_frame(gmx_mdoutf_t of, int mdof_flags,
+                                gmx_int64_t step, double t, real lambda,
+                                matrix box, rvec *x, rvec *v, rvec *f,
+                                rvec *xxtc)
+{
+    if ((mdof_flags & (MDOF_X | MDOF_V | MDOF_F)) && of->fp_trn)
+    {
+        if (of->trn_index)
+        {
+            trxindex_add_frame(of->trn_index, gmx_fio_ftell(of->fp_trn), step, (real)t);
+        }
+        fwrite_trn(of->fp_trn, step, t, lambda,
+                   box, of->natoms_global,
+                   (mdof_flags & MDOF_X) ? x : NULL,
+                   (mdof_flags & MDOF_V) ? v : NULL,
+                   (mdof_flags & MDOF_F) ? f : NULL);
+        if (gmx_fio_flush(of->fp_trn) != 0)
+        {
+            gmx_file("Cannot write trajectory; maybe you are out of disk space?");
+        }
+    }
+    if (mdof_flags & MDOF_X_COMPRESSED)
+    {
+        if (of->xtc_index)
+        {
+            trxindex_add_frame(of->xtc_index, gmx_fio_ftell(of->fp_xtc), step, (float)t);
+        }
+        if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t,
+                      box, xxtc, of->x_compression_precision) == 0)
+        {
+            gmx_fatal(FARGS, "XTC error - maybe you are out of disk space?");
+        }
+    }
+}
+
+/* The writer thread, writes the queued frames in order */
+static void *mdoutf_writer(void *arg)
+{
+    gmx_mdoutf_t    of = (gmx_mdoutf_t)arg;
+    mdoutf_frame_t *fr;
+
+    tMPI_Thread_mutex_lock(&of->writer_mutex);
+    for (;; )
+    {
+        while (of->nframe_queued == 0 && !of->bWriterFinish)
+        {
+            tMPI_Thread_cond_wait(&of->writer_cond, &of->writer_mutex);
+        }
+        if (of->nframe_queued == 0)
+        {
+            break;
+        }
+        fr = &of->frame[of->frame_first];
+        tMPI_Thread_mutex_unlock(&of->writer_mutex);
+
+        /* The MD loop does not touch queued frames, so we can write
+         * without holding the lock.
+         */
+        write_trn_xtc_frame(of, fr->flags, fr->step, fr->t, fr->lambda,
+                            fr->box, fr->x, fr->v, fr->f, fr->xxtc);
+
+        tMPI_Thread_mutex_lock(&of->writer_mutex);
+        of->frame_first = (of->frame_first + 1) % MDOUTF_NFRAME;
+        of->nframe_queued--;
+        tMPI_Thread_cond_broadcast(&of->writer_cond);
+    }
+    tMPI_Thread_mutex_unlock(&of->writer_mutex);
+
+    return NULL;
+}
+
+/* Waits until at most nframe_max frames are queued */
+static void mdoutf_wait_for_writer(gmx_mdoutf_t of, int nframe_max)
+{
+    if (!of->bAsync)
+    {
+        return;
+    }
+
+    tMPI_Thread_mutex_lock(&of->writer_mutex);
+    while (of->nframe_queued > nframe_max)
+    {
+        tMPI_Thread_cond_wait(&of->writer_cond, &of->writer_mutex);
+    }
+    tMPI_Thread_mutex_unlock(&of->writer_mutex);
+}
+
+/* Returns a free frame buffer, waits for the writer when all are queued */
+static mdoutf_frame_t *mdoutf_get_free_frame(gmx_mdoutf_t of)
+{
+    mdoutf_frame_t *fr;
+
+    mdoutf_wait_for_writer(of, MDOUTF_NFRAME - 1);
+
+    /* Only the writer thread changes the queue, by removing frames,
+     * so the free frame can not change after waiting.
+     */
+    tMPI_Thread_mutex_lock(&of->writer_mutex);
+    fr = &of->frame[(of->frame_first + of->nframe_queued) % MDOUTF_NFRAME];
+    tMPI_Thread_mutex_unlock(&of->writer_mutex);
+
+    return fr;
+}
+
+/* Hands the frame returned by mdoutf_get_free_frame to the writer thread */
+static void mdoutf_queue_frame(gmx_mdoutf_t of)
+{
+    tMPI_Thread_mutex_lock(&of->writer_mutex);
+    of->nframe_queued++;
+    tMPI_Thread_cond_broadcast(&of->writer_cond);
+    tMPI_Thread_mutex_unlock(&of->writer_mutex);
+}
+
+/* Writes all queued frames and stops the writer thread */
+static void mdoutf_stop_writer(gmx_mdoutf_t of)
+{
+    int i;
+
+    if (!of->bAsync)
+    {
+        return;
+    }
+
+    tMPI_Thread_mutex_lock(&of->writer_mutex);
+    of->bWriterFinish = TRUE;
+    tMPI_Thread_cond_broadcast(&of->writer_cond);
+    tMPI_Thread_mutex_unlock(&of->writer_mutex);
+
+    tMPI_Thread_join(of->writer, NULL);
+    tMPI_Thread_cond_destroy(&of->writer_cond);
+    tMPI_Thread_mutex_destroy(&of->writer_mutex);
+
+    for (i = 0; i < MDOUTF_NFRAME; i++)
+    {
+        sfree(of->frame[i].x);
+        sfree(of->frame[i].v);
+        sfree(of->frame[i].f);
+        sfree(of->frame[i].xxtc);
+    }
+
+    of->bAsync = FALSE;
+}
+
+
+/* Opens the frame index for trajectory file fio */
+static gmx_trxindex_t open_mdoutf_index(FILE *fplog, t_fileio *fio,
+                                        int natoms, gmx_bool bAppendFiles)
+{
+    gmx_trxindex_t idx;
+
+    /* When appending, the file position is at the end of the
+     * trajectory, which has been truncated to the checkpoint state.
+     */
+    idx = open_trxindex(gmx_fio_getname(fio), natoms, bAppendFiles,
+                        gmx_fio_ftell(fio));
+    if (idx == NULL)
+    {
+        md_print_warn(NULL, fplog,
+                      "NOTE: Can not append to the frame index of %s,\n"
+                      "      no frame index will be written\n",
+                      gmx_fio_getname(fio));
+    }
+
+    return idx;
+}
 
 gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
                          int mdrun_flags, const t_commrec *cr,
@@ -99,6 +303,7 @@ gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
     of->simulation_part         = ir->simulation_part;
     of->x_compression_precision = ir->x_compression_precision;
     of->wcycle                  = wcycle;
+    of->bAsync                  = FALSE;
 
     if (MASTER(cr))
     {
@@ -210,6 +415,44 @@ gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
                 of->natoms_x_compressed++;
             }
         }
+
+        if (mdrun_flags & MD_TRJINDEX)
+        {
+            if (of->fp_trn)
+            {
+                of->trn_index = open_mdoutf_index(fplog, of->fp_trn,
+                                                  of->natoms_global, bAppendFiles);
+            }
+            if (of->fp_xtc)
+            {
+                of->xtc_index = open_mdoutf_index(fplog, of->fp_xtc,
+                                                  of->natoms_x_compressed, bAppendFiles);
+            }
+        }
+
+        /* Compressing and writing frames takes significant time with
+         * large systems, so we do this in a separate thread, which
+         * overlaps with the MD steps. Set GMX_NO_ASYNC_TRAJ to disable.
+         */
+        if ((of->fp_trn || of->fp_xtc) &&
+            tMPI_Thread_support() == TMPI_THREAD_SUPPORT_YES &&
+            getenv("GMX_NO_ASYNC_TRAJ") == NULL)
+        {
+            tMPI_Thread_mutex_init(&of->writer_mutex);
+            tMPI_Thread_cond_init(&of->writer_cond);
+            of->frame_first   = 0;
+            of->nframe_queued = 0;
+            of->bWriterFinish = FALSE;
+            if (tMPI_Thread_create(&of->writer, mdoutf_writer, of) == 0)
+            {
+                of->bAsync = TRUE;
+            }
+            else
+            {
+                tMPI_Thread_cond_destroy(&of->writer_cond);
+                tMPI_Thread_mutex_destroy(&of->writer_mutex);
+            }
+        }
     }
 
     if (bCiteTng)
@@ -301,8 +544,18 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
 
     if (MASTER(cr))
     {
+        mdoutf_frame_t *fr        = NULL;
+        rvec           *xxtc      = NULL;
+        gmx_bool        bFreeXxtc = FALSE;
+
         if (mdof_flags & MDOF_CPT)
         {
+            /* The checkpoint stores the positions in the output files,
+             * so all queued frames need to be written first.
+             */
+            mdoutf_wait_for_writer(of, 0);
+            trxindex_flush(of->trn_index);
+            trxindex_flush(of->xtc_index);
             fflush_tng(of->tng);
             fflush_tng(of->tng_low_prec);
             write_checkpoint(of->fn_cpt, of->bKeepAndNumCPT,
@@ -310,33 +563,57 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
                              of->bExpanded, of->elamstats, step, t, state_global);
         }
 
-        if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
+        if (of->bAsync &&
+            (((mdof_flags & (MDOF_X | MDOF_V | MDOF_F)) && of->fp_trn) ||
+             ((mdof_flags & MDOF_X_COMPRESSED) && of->fp_xtc)))
         {
-            if (of->fp_trn)
+            /* Copy the frame to a buffer and let the writer thread
+             * write it, so we can continue with the MD steps.
+             */
+            fr         = mdoutf_get_free_frame(of);
+            fr->flags  = (of->fp_trn ? (mdof_flags & (MDOF_X | MDOF_V | MDOF_F)) : 0);
+            fr->flags |= (of->fp_xtc ? (mdof_flags & MDOF_X_COMPRESSED) : 0);
+            fr->step   = step;
+            fr->t      = t;
+            fr->lambda = state_local->lambda[efptFEP];
+            copy_mat(state_local->box, fr->box);
+            if (fr->flags & MDOF_X)
             {
-                fwrite_trn(of->fp_trn, step, t, state_local->lambda[efptFEP],
-                           state_local->box, top_global->natoms,
-                           (mdof_flags & MDOF_X) ? state_global->x : NULL,
-                           (mdof_flags & MDOF_V) ? global_v : NULL,
-                           (mdof_flags & MDOF_F) ? f_global : NULL);
-                if (gmx_fio_flush(of->fp_trn) != 0)
+                if (fr->x == NULL)
                 {
-                    gmx_file("Cannot write trajectory; maybe you are out of disk space?");
+                    snew(fr->x, of->natoms_global);
                 }
+                copy_rvecn(state_global->x, fr->x, 0, of->natoms_global);
+            }
+            if (fr->flags & MDOF_V)
+            {
+                if (fr->v == NULL)
+                {
+                    snew(fr->v, of->natoms_global);
+                }
+                copy_rvecn(global_v, fr->v, 0, of->natoms_global);
+            }
+            if (fr->flags & MDOF_F)
+            {
+                if (fr->f == NULL)
+                {
+                    snew(fr->f, of->natoms_global);
+                }
+                copy_rvecn(f_global, fr->f, 0, of->natoms_global);
+            }
+            if (fr->flags & MDOF_X_COMPRESSED)
+            {
+                if (fr->xxtc == NULL)
+                {
+                    snew(fr->xxtc, of->natoms_x_compressed);
+                }
+                xxtc = fr->xxtc;
             }
-
-            gmx_fwrite_tng(of->tng, FALSE, step, t, state_local->lambda[efptFEP],
-                           (const rvec *) state_local->box,
-                           top_global->natoms,
-                           (mdof_flags & MDOF_X) ? (const rvec *) state_global->x : NULL,
-                           (mdof_flags & MDOF_V) ? (const rvec *) global_v : NULL,
-                           (mdof_flags & MDOF_F) ? (const rvec *) f_global : NULL);
         }
+
         if (mdof_flags & MDOF_X_COMPRESSED)
         {
-            rvec *xxtc = NULL;
-
-            if (of->natoms_x_compressed == of->natoms_global)
+            if (xxtc == NULL && of->natoms_x_compressed == of->natoms_global)
             {
                 /* We are writing the positions of all of the atoms to
                    the compressed output */
@@ -345,24 +622,49 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
             else
             {
                 /* We are writing the positions of only a subset of
-                   the atoms to the compressed output, so we have to
-                   make a copy of the subset of coordinates. */
+                   the atoms to the compressed output, or the positions
+                   are queued for the writer thread, so we have to
+                   make a copy of the (subset of) coordinates. */
                 int i, j;
 
-                snew(xxtc, of->natoms_x_compressed);
+                if (xxtc == NULL)
+                {
+                    snew(xxtc, of->natoms_x_compressed);
+                    bFreeXxtc = TRUE;
+                }
                 for (i = 0, j = 0; (i < of->natoms_global); i++)
                 {
-                    if (ggrpnr(of->groups, egcCompressedX, i) == 0)
+                    if (of->natoms_x_compressed == of->natoms_global ||
+                        ggrpnr(of->groups, egcCompressedX, i) == 0)
                     {
                         copy_rvec(state_global->x[i], xxtc[j++]);
                     }
                 }
             }
-            if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t,
-                          state_local->box, xxtc, of->x_compression_precision) == 0)
-            {
-                gmx_fatal(FARGS, "XTC error - maybe you are out of disk space?");
-            }
+        }
+
+        if (fr != NULL)
+        {
+            mdoutf_queue_frame(of);
+        }
+        else
+        {
+            write_trn_xtc_frame(of, mdof_flags, step, t,
+                                state_local->lambda[efptFEP], state_local->box,
+                                state_global->x, global_v, f_global, xxtc);
+        }
+
+        if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
+        {
+            gmx_fwrite_tng(of->tng, FALSE, step, t, state_local->lambda[efptFEP],
+                           (const rvec *) state_local->box,
+                           top_global->natoms,
+                           (mdof_flags & MDOF_X) ? (const rvec *) state_global->x : NULL,
+                           (mdof_flags & MDOF_V) ? (const rvec *) global_v : NULL,
+                           (mdof_flags & MDOF_F) ? (const rvec *) f_global : NULL);
+        }
+        if (mdof_flags & MDOF_X_COMPRESSED)
+        {
             gmx_fwrite_tng(of->tng_low_prec,
                            TRUE,
                            step,
@@ -373,16 +675,18 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
                            (const rvec *) xxtc,
                            NULL,
                            NULL);
-            if (of->natoms_x_compressed != of->natoms_global)
-            {
-                sfree(xxtc);
-            }
+        }
+        if (bFreeXxtc)
+        {
+            sfree(xxtc);
         }
     }
 }
 
 void mdoutf_tng_close(gmx_mdoutf_t of)
 {
+    mdoutf_stop_writer(of);
+
     if (of->tng || of->tng_low_prec)
     {
         wallcycle_start(of->wcycle, ewcTRAJ);
@@ -394,6 +698,11 @@ void mdoutf_tng_close(gmx_mdoutf_t of)
 
 void done_mdoutf(gmx_mdoutf_t of)
 {
+    mdoutf_stop_writer(of);
+
+    close_trxindex(of->trn_index);
+    close_trxindex(of->xtc_index);
+
     if (of->fp_ene != NULL)
     {
         close_enx(of->fp_ene);
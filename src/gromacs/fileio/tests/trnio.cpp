@@ -0,0 +1,193 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for reading and writing trr trajectory frames.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/trnio.h"
+
+#include "config.h"
+
+#include <cstdlib>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/real.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+//! Number of atoms in the written frames
+const int c_numAtoms = 37;
+
+//! Returns values that use all bytes of the floating-point representation
+std::vector<gmx::RVec> frameValues(int frame, int offset)
+{
+    std::vector<gmx::RVec> v(c_numAtoms);
+
+    for (int i = 0; i < c_numAtoms; i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            int k = (i*DIM + d)*(2*frame + 1) + offset;
+            v[i][d] = (k % 2 == 0 ? 1 : -1)*(k + 0.1234567)/(k % 7 + 1.3);
+        }
+    }
+    return v;
+}
+
+//! Test fixture for trr frames
+class TrnIOTest : public ::testing::Test
+{
+    public:
+        TrnIOTest() : fileName_(fileManager_.getTemporaryFilePath(".trr"))
+        {
+        }
+
+        //! Writes frames with all, only x, and only v and f
+        void writeFrames(int numFrames)
+        {
+            t_fileio *fio = open_trn(fileName_.c_str(), "w");
+            for (int frame = 0; frame < numFrames; frame++)
+            {
+                matrix                 box = {{1.5, 0, 0}, {0.25, 2.5, 0}, {-0.5, 0.75, 3.5}};
+                std::vector<gmx::RVec> x   = frameValues(frame, 0);
+                std::vector<gmx::RVec> v   = frameValues(frame, 1);
+                std::vector<gmx::RVec> f   = frameValues(frame, 2);
+                box[XX][XX] += frame;
+                fwrite_trn(fio, 10*frame, 0.5*frame, 0.125*frame, box, c_numAtoms,
+                           frame % 3 != 2 ? as_rvec_array(&x[0]) : NULL,
+                           frame % 3 != 1 ? as_rvec_array(&v[0]) : NULL,
+                           frame % 3 != 1 ? as_rvec_array(&f[0]) : NULL);
+            }
+            close_trn(fio);
+        }
+
+        //! Reads the frames back and checks they are identical to the written ones
+        void readFrames(int numFrames)
+        {
+            t_fileio   *fio = open_trn(fileName_.c_str(), "r");
+            t_trnheader sh;
+            gmx_bool    bOK;
+            int         frame;
+
+            for (frame = 0; fread_trnheader(fio, &sh, &bOK); frame++)
+            {
+                ASSERT_TRUE(bOK);
+                ASSERT_LT(frame, numFrames);
+                EXPECT_EQ(c_numAtoms, sh.natoms);
+                EXPECT_EQ(10*frame, sh.step);
+                EXPECT_EQ(static_cast<real>(0.5*frame), sh.t);
+                EXPECT_EQ(static_cast<real>(0.125*frame), sh.lambda);
+                EXPECT_EQ(frame % 3 != 2, sh.x_size > 0);
+                EXPECT_EQ(frame % 3 != 1, sh.v_size > 0);
+                EXPECT_EQ(frame % 3 != 1, sh.f_size > 0);
+
+                matrix                 box;
+                std::vector<gmx::RVec> x(c_numAtoms), v(c_numAtoms), f(c_numAtoms);
+                ASSERT_TRUE(fread_htrn(fio, &sh, box, as_rvec_array(&x[0]),
+                                       as_rvec_array(&v[0]), as_rvec_array(&f[0])));
+                EXPECT_EQ(static_cast<real>(1.5 + frame), box[XX][XX]);
+                EXPECT_EQ(static_cast<real>(0.75), box[ZZ][YY]);
+                checkValues(sh.x_size > 0, frameValues(frame, 0), x);
+                checkValues(sh.v_size > 0, frameValues(frame, 1), v);
+                checkValues(sh.f_size > 0, frameValues(frame, 2), f);
+            }
+            EXPECT_EQ(numFrames, frame);
+            close_trn(fio);
+        }
+
+        //! Checks that \p actual is identical to \p expected when \p bPresent is set
+        void checkValues(bool                          bPresent,
+                         const std::vector<gmx::RVec> &expected,
+                         const std::vector<gmx::RVec> &actual)
+        {
+            for (int i = 0; bPresent && i < c_numAtoms; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_EQ(expected[i][d], actual[i][d])
+                    << "for atom " << i << " dimension " << d;
+                }
+            }
+        }
+
+        gmx::test::TestFileManager  fileManager_;
+        std::string                 fileName_;
+};
+
+TEST_F(TrnIOTest, RoundTrips)
+{
+    writeFrames(7);
+    readFrames(7);
+}
+
+TEST_F(TrnIOTest, ReadsSingleFrame)
+{
+    std::vector<gmx::RVec> x = frameValues(0, 0);
+    std::vector<gmx::RVec> y(c_numAtoms);
+    matrix                 box = {{2, 0, 0}, {0, 3, 0}, {0, 0, 4}};
+    int                    step, natoms;
+    real                   t, lambda;
+
+    write_trn(fileName_.c_str(), 5, 2.5, 0.5, box, c_numAtoms, as_rvec_array(&x[0]), NULL, NULL);
+    read_trn(fileName_.c_str(), &step, &t, &lambda, box, &natoms, as_rvec_array(&y[0]), NULL, NULL);
+    EXPECT_EQ(5, step);
+    EXPECT_EQ(2.5, t);
+    EXPECT_EQ(c_numAtoms, natoms);
+    checkValues(true, x, y);
+}
+
+#if defined HAVE_MMAP && defined HAVE_FMEMOPEN && defined HAVE_SYS_MMAN_H
+TEST_F(TrnIOTest, RoundTripsThroughMemoryMapping)
+{
+    writeFrames(7);
+    setenv("GMX_TRAJ_MMAP", "1", 1);
+    readFrames(7);
+    unsetenv("GMX_TRAJ_MMAP");
+}
+#endif
+
+} // namespace
@@ -0,0 +1,264 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the frame index of trr and xtc trajectories.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/trxindex.h"
+
+#include <cstdio>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/filenm.h"
+#include "gromacs/fileio/trnio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/real.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+//! Number of atoms in the test trajectories
+const int c_numAtoms = 20;
+//! Number of frames in the test trajectories
+const int c_numFrames = 12;
+
+//! Returns the time of frame, as mdrun computes it
+double frameTime(int frame)
+{
+    return 0.1*frame;
+}
+
+//! Returns the contents of file \p fn
+std::string fileContents(const std::string &fn)
+{
+    std::string contents;
+    FILE       *fp = std::fopen(fn.c_str(), "rb");
+    int         c;
+
+    while (fp != NULL && (c = std::fgetc(fp)) != EOF)
+    {
+        contents += static_cast<char>(c);
+    }
+    if (fp != NULL)
+    {
+        std::fclose(fp);
+    }
+    return contents;
+}
+
+/*! \brief
+ * Test fixture for trajectory indices.
+ *
+ * The parameter is the extension of the trajectory file.
+ */
+class TrxIndexTest : public ::testing::TestWithParam<const char *>
+{
+    public:
+        TrxIndexTest()
+            : fileName_(fileManager_.getTemporaryFilePath(GetParam())),
+              indexName_(fileManager_.getTemporaryFilePath(std::string(GetParam()) + ".idx")),
+              bXtc_(fn2ftp(fileName_.c_str()) == efXTC)
+        {
+        }
+
+        /*! \brief
+         * Writes the test trajectory and stores the frame offsets.
+         *
+         * With \p bWriteIndex the index is written along with the frames,
+         * as mdrun does. The steps are increased by \p stepShift.
+         */
+        void writeTrajectory(int stepShift, bool bWriteIndex)
+        {
+            t_fileio              *fio = (bXtc_ ? open_xtc(fileName_.c_str(), "w") :
+                                          open_trn(fileName_.c_str(), "w"));
+            gmx_trxindex_t         idx = NULL;
+            std::vector<gmx::RVec> x(c_numAtoms);
+            matrix                 box = {{3, 0, 0}, {0, 3, 0}, {0, 0, 3}};
+
+            if (bWriteIndex)
+            {
+                idx = open_trxindex(fileName_.c_str(), c_numAtoms, FALSE, 0);
+            }
+            offsets_.clear();
+            for (int frame = 0; frame < c_numFrames; frame++)
+            {
+                const int    step = 100*frame + stepShift;
+                const double t    = frameTime(frame);
+                for (int i = 0; i < c_numAtoms; i++)
+                {
+                    x[i][XX] = 0.1*i;
+                    x[i][YY] = 0.01*frame;
+                    x[i][ZZ] = 1;
+                }
+                offsets_.push_back(gmx_fio_ftell(fio));
+                if (bXtc_)
+                {
+                    if (idx != NULL)
+                    {
+                        trxindex_add_frame(idx, offsets_.back(), step, (float)t);
+                    }
+                    write_xtc(fio, c_numAtoms, step, t, box, as_rvec_array(&x[0]), 1000);
+                }
+                else
+                {
+                    if (idx != NULL)
+                    {
+                        trxindex_add_frame(idx, offsets_.back(), step, (real)t);
+                    }
+                    fwrite_trn(fio, step, t, 0, box, c_numAtoms, as_rvec_array(&x[0]), NULL, NULL);
+                }
+            }
+            gmx_fio_close(fio);
+            close_trxindex(idx);
+        }
+
+        gmx::test::TestFileManager  fileManager_;
+        std::string                 fileName_;
+        std::string                 indexName_;
+        bool                        bXtc_;
+        std::vector<gmx_off_t>      offsets_;
+};
+
+TEST_P(TrxIndexTest, BuildsSameIndexAsWriter)
+{
+    writeTrajectory(0, true);
+    std::string written = fileContents(indexName_);
+    std::remove(indexName_.c_str());
+
+    EXPECT_EQ(c_numFrames, build_trxindex(fileName_.c_str()));
+    std::string built = fileContents(indexName_);
+    EXPECT_FALSE(written.empty());
+    EXPECT_TRUE(written == built);
+}
+
+TEST_P(TrxIndexTest, ReadsFramesAndFindsTimes)
+{
+    writeTrajectory(3, false);
+    build_trxindex(fileName_.c_str());
+
+    EXPECT_TRUE(read_trxindex(fileName_.c_str(), c_numAtoms + 1) == NULL);
+    gmx_trxindex_t idx = read_trxindex(fileName_.c_str(), c_numAtoms);
+    ASSERT_TRUE(idx != NULL);
+    ASSERT_EQ(c_numFrames, trxindex_nframes(idx));
+    for (int frame = 0; frame < c_numFrames; frame++)
+    {
+        gmx_int64_t step;
+        double      t;
+        EXPECT_EQ(offsets_[frame], trxindex_get_frame(idx, frame, &step, &t));
+        EXPECT_EQ(100*frame + 3, step);
+        EXPECT_EQ(bXtc_ ? (float)frameTime(frame) : (real)frameTime(frame), t);
+        EXPECT_EQ(frame, trxindex_find_time(idx, t));
+        EXPECT_EQ(frame + 1, trxindex_find_time(idx, t + 0.05));
+    }
+    EXPECT_EQ(-1, trxindex_get_frame(idx, c_numFrames, NULL, NULL));
+    EXPECT_EQ(0, trxindex_find_time(idx, -1));
+    EXPECT_EQ(c_numFrames, trxindex_find_time(idx, 100));
+    close_trxindex(idx);
+}
+
+TEST_P(TrxIndexTest, SeeksToFrameBeforeTime)
+{
+    writeTrajectory(0, true);
+
+    t_fileio *fio = gmx_fio_open(fileName_.c_str(), "r");
+    EXPECT_EQ(0, trxindex_seek_time(fio, frameTime(5), c_numAtoms, FALSE));
+    EXPECT_EQ(offsets_[4], gmx_fio_ftell(fio));
+    // Seeking forward only does not go back to an earlier frame
+    EXPECT_EQ(0, trxindex_seek_time(fio, frameTime(2), c_numAtoms, TRUE));
+    EXPECT_EQ(offsets_[4], gmx_fio_ftell(fio));
+    EXPECT_EQ(0, trxindex_seek_time(fio, frameTime(2), c_numAtoms, FALSE));
+    EXPECT_EQ(offsets_[1], gmx_fio_ftell(fio));
+    EXPECT_EQ(0, trxindex_seek_time(fio, 100, c_numAtoms, FALSE));
+    EXPECT_EQ(offsets_[c_numFrames - 1], gmx_fio_ftell(fio));
+    gmx_fio_close(fio);
+
+    std::remove(indexName_.c_str());
+    fio = gmx_fio_open(fileName_.c_str(), "r");
+    EXPECT_EQ(-1, trxindex_seek_time(fio, frameTime(5), c_numAtoms, FALSE));
+    EXPECT_EQ(0, gmx_fio_ftell(fio));
+    gmx_fio_close(fio);
+}
+
+TEST_P(TrxIndexTest, RejectsIndexOfOtherTrajectory)
+{
+    writeTrajectory(0, true);
+    gmx_trxindex_t idx = read_trxindex(fileName_.c_str(), c_numAtoms);
+    ASSERT_TRUE(idx != NULL);
+    close_trxindex(idx);
+
+    // Same frame sizes and offsets, but different steps
+    std::string index = fileContents(indexName_);
+    writeTrajectory(1, false);
+    ASSERT_TRUE(index == fileContents(indexName_));
+    EXPECT_TRUE(read_trxindex(fileName_.c_str(), c_numAtoms) == NULL);
+}
+
+TEST_P(TrxIndexTest, AppendingRemovesLostFrames)
+{
+    writeTrajectory(0, true);
+
+    // The trajectory was truncated at the start of frame 7
+    gmx_trxindex_t idx = open_trxindex(fileName_.c_str(), c_numAtoms, TRUE, offsets_[7]);
+    ASSERT_TRUE(idx != NULL);
+    EXPECT_EQ(7, trxindex_nframes(idx));
+    trxindex_add_frame(idx, offsets_[7], 700, bXtc_ ? (float)frameTime(7) : (real)frameTime(7));
+    close_trxindex(idx);
+
+    idx = read_trxindex(fileName_.c_str(), c_numAtoms);
+    ASSERT_TRUE(idx != NULL);
+    EXPECT_EQ(8, trxindex_nframes(idx));
+    for (int frame = 0; frame < 8; frame++)
+    {
+        EXPECT_EQ(offsets_[frame], trxindex_get_frame(idx, frame, NULL, NULL));
+    }
+    close_trxindex(idx);
+
+    EXPECT_TRUE(open_trxindex(fileName_.c_str(), c_numAtoms + 1, TRUE, offsets_[7]) == NULL);
+}
+
+INSTANTIATE_TEST_CASE_P(Formats, TrxIndexTest, ::testing::Values(".xtc", ".trr"));
+
+} // namespace
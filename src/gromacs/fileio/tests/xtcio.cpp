@@ -0,0 +1,229 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the XTC coordinate compression.
+ *
+ * The compressed bytes are compared against reference data, so any change
+ * in the encoder that would change the file format is detected.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+#include <cstdio>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/xdrf.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/real.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/refdata.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+/*! \brief
+ * Returns coordinates of water-like triplets of atoms.
+ *
+ * The hydrogens are close to the oxygen, which is what the run-length
+ * encoding of the compression is optimized for. When \p numAtoms is not
+ * a multiple of three, the last molecule is incomplete. The coordinates
+ * are integer multiples of 2^-13 nm, so they do not depend on how
+ * the compiler evaluates floating-point expressions.
+ */
+std::vector<float> waterCoordinates(int numAtoms)
+{
+    std::vector<float> x(numAtoms*DIM);
+
+    for (int i = 0; i < numAtoms; i++)
+    {
+        const int m = i/3;
+        for (int d = 0; d < DIM; d++)
+        {
+            // The oxygens are spread over a box of about 3 nm
+            int pos = ((m*(7 + 4*d) + 3*d) % 31)*800 - 4000 + 113*m*(d + 1);
+            if (i % 3 != 0)
+            {
+                // Hydrogens are within 0.1 nm in varying directions
+                pos += ((m + i + d) % 4)*330 - 500;
+            }
+            x[i*DIM + d] = pos/8192.0f;
+        }
+    }
+
+    return x;
+}
+
+//! Test fixture for the XTC coordinate compression
+class XtcCodecTest : public ::testing::Test
+{
+    public:
+        XtcCodecTest() : fileName_(fileManager_.getTemporaryFilePath(".xtc"))
+        {
+        }
+
+        //! Compresses \p x to the test file and returns the result of xdr3dfcoord
+        int encode(std::vector<float> *x, float precision)
+        {
+            t_fileio *fio    = gmx_fio_open(fileName_.c_str(), "w");
+            int       natoms = x->size()/DIM;
+            int       ret    = xdr3dfcoord(gmx_fio_getxdr(fio), &(*x)[0], &natoms, &precision);
+            gmx_fio_close(fio);
+            return ret;
+        }
+
+        //! Decompresses natoms coordinates from the test file
+        std::vector<float> decode(int natoms, float *precision)
+        {
+            std::vector<float> x(natoms*DIM);
+            t_fileio          *fio = gmx_fio_open(fileName_.c_str(), "r");
+            int                n   = natoms;
+            EXPECT_NE(0, xdr3dfcoord(gmx_fio_getxdr(fio), &x[0], &n, precision));
+            EXPECT_EQ(natoms, n);
+            gmx_fio_close(fio);
+            return x;
+        }
+
+        //! Returns the contents of the test file in hexadecimal, 32 bytes per line
+        std::string encodedBytes()
+        {
+            std::string   hex;
+            FILE         *fp = std::fopen(fileName_.c_str(), "rb");
+            int           c, n = 0;
+
+            while ((c = std::fgetc(fp)) != EOF)
+            {
+                hex += gmx::formatString("%02x", c);
+                if (++n % 32 == 0)
+                {
+                    hex += "\n";
+                }
+            }
+            std::fclose(fp);
+            return hex;
+        }
+
+        //! Checks that \p x survives compression within the precision
+        void testRoundTrip(std::vector<float> x, float precision)
+        {
+            const int natoms = x.size()/DIM;
+
+            ASSERT_NE(0, encode(&x, precision));
+            float              precisionRead = 0;
+            std::vector<float> y             = decode(natoms, &precisionRead);
+            EXPECT_EQ(precision, precisionRead);
+            for (size_t i = 0; i < x.size(); i++)
+            {
+                // Rounding to the precision plus the error of the scaling
+                EXPECT_NEAR(x[i], y[i], 0.5f/precision + 4*GMX_FLOAT_EPS*std::abs(x[i]))
+                << "for coordinate " << i;
+            }
+        }
+
+        gmx::test::TestFileManager  fileManager_;
+        std::string                 fileName_;
+};
+
+TEST_F(XtcCodecTest, EncodesAsReference)
+{
+    gmx::test::TestReferenceData    data;
+    gmx::test::TestReferenceChecker checker(data.rootChecker());
+    std::vector<float>              x = waterCoordinates(151);
+
+    ASSERT_NE(0, encode(&x, 1000));
+    checker.checkStringBlock(encodedBytes(), "Bytes");
+}
+
+TEST_F(XtcCodecTest, RoundTrips)
+{
+    testRoundTrip(waterCoordinates(3001), 1000);
+}
+
+TEST_F(XtcCodecTest, RoundTripsWithLowPrecision)
+{
+    testRoundTrip(waterCoordinates(301), 10);
+}
+
+TEST_F(XtcCodecTest, RoundTripsNegativeAndLargeCoordinates)
+{
+    std::vector<float> x = waterCoordinates(300);
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        x[i] = (i % 2 == 0 ? -1 : 1)*(x[i] + 1000);
+    }
+    testRoundTrip(x, 1000);
+}
+
+TEST_F(XtcCodecTest, StoresSmallFramesUncompressed)
+{
+    gmx::test::TestReferenceData    data;
+    gmx::test::TestReferenceChecker checker(data.rootChecker());
+    std::vector<float>              x = waterCoordinates(9);
+
+    ASSERT_NE(0, encode(&x, 1000));
+    checker.checkStringBlock(encodedBytes(), "Bytes");
+
+    float              precision = 0;
+    std::vector<float> y         = decode(x.size()/DIM, &precision);
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        EXPECT_EQ(x[i], y[i]) << "for coordinate " << i;
+    }
+}
+
+TEST_F(XtcCodecTest, ReturnsErrorOnOverflow)
+{
+    const float hugeValues[] = { 1e7f, -1e7f, 3e9f, 1e10f };
+
+    for (size_t v = 0; v < sizeof(hugeValues)/sizeof(hugeValues[0]); v++)
+    {
+        // Large enough to use compression and SIMD
+        std::vector<float> x = waterCoordinates(60);
+        x[25] = hugeValues[v];
+        EXPECT_EQ(0, encode(&x, 1000)) << "for value " << hugeValues[v];
+    }
+}
+
+} // namespace
@@ -92,7 +92,8 @@ enum tpxv {
     tpxv_InteractiveMolecularDynamics,                       /**< interactive molecular dynamics (IMD) */
     tpxv_RemoveObsoleteParameters1,                          /**< remove optimize_fft, dihre_fc, nstcheckpoint */
     tpxv_PullCoordTypeGeom,                                  /**< add pull type and geometry per group and flat-bottom */
-    tpxv_PullGeomDirRel                                      /**< add pull geometry direction-relative */
+    tpxv_PullGeomDirRel,                                     /**< add pull geometry direction-relative */
+    tpxv_MultipleTimeStepping                                /**< add nstcalcslow and slow-listed */
 };
 
 /*! \brief Version number of the file format written to run input
@@ -106,7 +107,7 @@ enum tpxv {
  *
  * When developing a feature branch that needs to change the run input
  * file format, change tpx_tag instead. */
-static const int tpx_version = tpxv_PullGeomDirRel;
+static const int tpx_version = tpxv_MultipleTimeStepping;
 
 
 /* This number should only be increased when you edit the TOPOLOGY section
@@ -1028,6 +1029,16 @@ static void do_inputrec(t_fileio *fio, t_inputrec *ir, gmx_bool bRead,
         /* Calculate at NS steps */
         ir->nstcalclr = ir->nstlist;
     }
+    if (file_version >= tpxv_MultipleTimeStepping)
+    {
+        gmx_fio_do_int(fio, ir->nstcalcslow);
+        gmx_fio_do_int(fio, ir->eSlowListed);
+    }
+    else
+    {
+        ir->nstcalcslow = 1;
+        ir->eSlowListed = eslowlistedNO;
+    }
     gmx_fio_do_int(fio, ir->coulombtype);
     if (file_version < 32 && ir->coulombtype == eelRF)
     {
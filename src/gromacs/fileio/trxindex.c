@@ -0,0 +1,458 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#include "gmxpre.h"
+
+#include "trxindex.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "gromacs/fileio/filenm.h"
+#include "gromacs/fileio/trnio.h"
+#include "gromacs/fileio/xdrf.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/smalloc.h"
+
+#define TRXINDEX_MAGIC   1997
+#define TRXINDEX_VERSION 1
+
+/* The header contains the magic number, version and number of atoms */
+#define TRXINDEX_HEADER_SIZE (3*4)
+/* A record contains the offset and step (64-bit) and the time (double) */
+#define TRXINDEX_RECORD_SIZE (3*8)
+
+struct gmx_trxindex
+{
+    FILE *fp;      /* The index file                          */
+    XDR   xdr;     /* XDR stream on fp                        */
+    int   natoms;  /* The number of atoms in the trajectory   */
+    int   nframes; /* The number of frames in the index       */
+};
+
+static char *trxindex_filename(const char *fn)
+{
+    char *idxfn;
+
+    snew(idxfn, strlen(fn) + 5);
+    sprintf(idxfn, "%s.idx", fn);
+
+    return idxfn;
+}
+
+static gmx_bool do_trxindex_header(XDR *xdr, int *natoms)
+{
+    int magic   = TRXINDEX_MAGIC;
+    int version = TRXINDEX_VERSION;
+
+    return (xdr_int(xdr, &magic) && xdr_int(xdr, &version) &&
+            xdr_int(xdr, natoms) &&
+            magic == TRXINDEX_MAGIC && version == TRXINDEX_VERSION);
+}
+
+static gmx_bool do_trxindex_record(XDR *xdr, gmx_off_t *offset,
+                                   gmx_int64_t *step, double *t)
+{
+    gmx_int64_t off64 = *offset;
+    gmx_bool    bOK;
+
+    bOK     = (xdr_int64(xdr, &off64) && xdr_int64(xdr, step) &&
+               xdr_double(xdr, t));
+    *offset = off64;
+
+    return bOK;
+}
+
+/* Opens index file idxfn for reading, returns NULL on failure */
+static gmx_trxindex_t open_trxindex_read(const char *idxfn)
+{
+    gmx_trxindex_t idx;
+    gmx_off_t      size;
+
+    if (!gmx_fexist(idxfn))
+    {
+        return NULL;
+    }
+
+    snew(idx, 1);
+    idx->fp = gmx_ffopen(idxfn, "rb");
+    xdrstdio_create(&idx->xdr, idx->fp, XDR_DECODE);
+    if (!do_trxindex_header(&idx->xdr, &idx->natoms) ||
+        gmx_fseek(idx->fp, 0, SEEK_END) != 0 ||
+        (size = gmx_ftell(idx->fp)) < TRXINDEX_HEADER_SIZE)
+    {
+        close_trxindex(idx);
+        return NULL;
+    }
+    /* An incomplete last record, e.g. due to a crash, is ignored */
+    idx->nframes = (size - TRXINDEX_HEADER_SIZE)/TRXINDEX_RECORD_SIZE;
+
+    return idx;
+}
+
+/* Checks that trajectory fn contains a frame with step at offset */
+static gmx_bool trajectory_has_frame(const char *fn, gmx_off_t offset,
+                                     gmx_int64_t step)
+{
+    t_fileio   *fio;
+    t_trnheader sh;
+    int         natoms, istep;
+    float       ft;
+    gmx_bool    bOK, bHeaderOK;
+
+    fio = gmx_fio_open(fn, "r");
+    bOK = (gmx_fio_seek(fio, offset) == 0);
+    switch (fn2ftp(fn))
+    {
+        case efXTC:
+            bOK = (bOK && xdr_xtc_skip_frame(gmx_fio_getfp(fio), gmx_fio_getxdr(fio),
+                                             &natoms, &istep, &ft) == 1 &&
+                   istep == (int)step);
+            break;
+        case efTRR:
+            bOK = (bOK && fread_trnheader(fio, &sh, &bHeaderOK) && bHeaderOK &&
+                   sh.step == (int)step);
+            break;
+        default:
+            bOK = FALSE;
+    }
+    gmx_fio_close(fio);
+
+    return bOK;
+}
+
+gmx_trxindex_t open_trxindex(const char *fn, int natoms,
+                             gmx_bool bAppend, gmx_off_t traj_size)
+{
+    gmx_trxindex_t idx;
+    char          *idxfn;
+    gmx_int64_t    step;
+    double         t;
+    int            nkeep;
+
+    idxfn = trxindex_filename(fn);
+
+    if (bAppend)
+    {
+        /* Remove the entries of frames that are no longer present,
+         * since the trajectory is truncated to the checkpoint state.
+         */
+        idx = open_trxindex_read(idxfn);
+        if (idx == NULL || idx->natoms != natoms)
+        {
+            close_trxindex(idx);
+            sfree(idxfn);
+            return NULL;
+        }
+        nkeep = idx->nframes;
+        while (nkeep > 0 &&
+               (trxindex_get_frame(idx, nkeep - 1, &step, &t) >= traj_size))
+        {
+            nkeep--;
+        }
+        close_trxindex(idx);
+
+        if (gmx_truncate(idxfn, TRXINDEX_HEADER_SIZE + nkeep*(gmx_off_t)TRXINDEX_RECORD_SIZE) != 0)
+        {
+            sfree(idxfn);
+            return NULL;
+        }
+
+        snew(idx, 1);
+        idx->fp = gmx_ffopen(idxfn, "ab");
+        xdrstdio_create(&idx->xdr, idx->fp, XDR_ENCODE);
+        idx->natoms  = natoms;
+        idx->nframes = nkeep;
+    }
+    else
+    {
+        make_backup(idxfn);
+        snew(idx, 1);
+        idx->fp = gmx_ffopen(idxfn, "wb");
+        xdrstdio_create(&idx->xdr, idx->fp, XDR_ENCODE);
+        idx->natoms  = natoms;
+        idx->nframes = 0;
+        if (!do_trxindex_header(&idx->xdr, &idx->natoms))
+        {
+            gmx_file(idxfn);
+        }
+    }
+    sfree(idxfn);
+
+    return idx;
+}
+
+void trxindex_add_frame(gmx_trxindex_t idx, gmx_off_t offset,
+                        gmx_int64_t step, double t)
+{
+    if (!do_trxindex_record(&idx->xdr, &offset, &step, &t))
+    {
+        gmx_file("Cannot write trajectory index; maybe you are out of disk space?");
+    }
+    idx->nframes++;
+}
+
+void trxindex_flush(gmx_trxindex_t idx)
+{
+    if (idx != NULL)
+    {
+        fflush(idx->fp);
+    }
+}
+
+void close_trxindex(gmx_trxindex_t idx)
+{
+    if (idx != NULL)
+    {
+        xdr_destroy(&idx->xdr);
+        gmx_ffclose(idx->fp);
+        sfree(idx);
+    }
+}
+
+gmx_trxindex_t read_trxindex(const char *fn, int natoms)
+{
+    gmx_trxindex_t idx;
+    char          *idxfn;
+    gmx_off_t      offset;
+    gmx_int64_t    step;
+    double         t;
+
+    idxfn = trxindex_filename(fn);
+    idx   = open_trxindex_read(idxfn);
+    sfree(idxfn);
+
+    if (idx == NULL)
+    {
+        return NULL;
+    }
+    /* The index could be outdated, e.g. when the trajectory was
+     * overwritten or truncated. Check that the last frame is present.
+     */
+    if ((natoms >= 0 && idx->natoms != natoms) ||
+        idx->nframes == 0 ||
+        (offset = trxindex_get_frame(idx, idx->nframes - 1, &step, &t)) < 0 ||
+        !trajectory_has_frame(fn, offset, step))
+    {
+        close_trxindex(idx);
+        return NULL;
+    }
+
+    return idx;
+}
+
+int trxindex_nframes(gmx_trxindex_t idx)
+{
+    return idx->nframes;
+}
+
+gmx_off_t trxindex_get_frame(gmx_trxindex_t idx, int frame,
+                             gmx_int64_t *step, double *t)
+{
+    gmx_off_t   offset = 0;
+    gmx_int64_t step_frame;
+    double      t_frame;
+
+    if (frame < 0 || frame >= idx->nframes ||
+        gmx_fseek(idx->fp, TRXINDEX_HEADER_SIZE + frame*(gmx_off_t)TRXINDEX_RECORD_SIZE, SEEK_SET) != 0 ||
+        !do_trxindex_record(&idx->xdr, &offset, &step_frame, &t_frame))
+    {
+        return -1;
+    }
+    if (step != NULL)
+    {
+        *step = step_frame;
+    }
+    if (t != NULL)
+    {
+        *t = t_frame;
+    }
+
+    return offset;
+}
+
+int trxindex_find_time(gmx_trxindex_t idx, double t)
+{
+    int    low, high, mid;
+    double t_mid;
+
+    /* Bisection for the first frame with time >= t */
+    low  = 0;
+    high = idx->nframes;
+    while (low < high)
+    {
+        mid = low + (high - low)/2;
+        if (trxindex_get_frame(idx, mid, NULL, &t_mid) < 0)
+        {
+            return idx->nframes;
+        }
+        if (t_mid < t)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+int trxindex_seek_time(t_fileio *fio, real t, int natoms,
+                       gmx_bool bSeekForwardOnly)
+{
+    gmx_trxindex_t idx;
+    int            frame;
+    gmx_off_t      offset;
+
+    idx = read_trxindex(gmx_fio_getname(fio), natoms);
+    if (idx == NULL)
+    {
+        return -1;
+    }
+    /* We position at the frame before the requested time, so we do
+     * not skip frames due to rounding of t; the reader checks the times.
+     */
+    frame  = trxindex_find_time(idx, t);
+    frame  = (frame > 0 ? frame - 1 : 0);
+    offset = trxindex_get_frame(idx, frame, NULL, NULL);
+    close_trxindex(idx);
+
+    if (offset < 0)
+    {
+        return -1;
+    }
+    if (!bSeekForwardOnly || offset > gmx_fio_ftell(fio))
+    {
+        if (gmx_fio_seek(fio, offset) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* Reads the header of an xtc frame and skips the coordinates.
+ * Returns FALSE at the end of the file.
+ */
+static gmx_bool xtc_skip_frame(t_fileio *fio, int *natoms,
+                               gmx_int64_t *step, double *t)
+{
+    int   istep, ret;
+    float ft;
+
+    ret = xdr_xtc_skip_frame(gmx_fio_getfp(fio), gmx_fio_getxdr(fio),
+                             natoms, &istep, &ft);
+    if (ret < 0)
+    {
+        gmx_fatal(FARGS, "Corrupt frame in %s", gmx_fio_getname(fio));
+    }
+    *step = istep;
+    *t    = ft;
+
+    return (ret == 1);
+}
+
+/* Reads the header of a trr frame and skips the data.
+ * Returns FALSE at the end of the file.
+ */
+static gmx_bool trn_skip_frame(t_fileio *fio, int *natoms,
+                               gmx_int64_t *step, double *t)
+{
+    t_trnheader sh;
+    gmx_bool    bOK;
+    gmx_off_t   skip;
+
+    if (!fread_trnheader(fio, &sh, &bOK))
+    {
+        return FALSE;
+    }
+    skip    = (sh.box_size + sh.vir_size + sh.pres_size +
+               sh.x_size + sh.v_size + sh.f_size);
+    *natoms = sh.natoms;
+    *step   = sh.step;
+    *t      = sh.t;
+
+    return (bOK && gmx_fio_seek(fio, gmx_fio_ftell(fio) + skip) == 0);
+}
+
+int build_trxindex(const char *fn)
+{
+    t_fileio       *fio;
+    gmx_trxindex_t  idx = NULL;
+    gmx_off_t       offset;
+    gmx_int64_t     step;
+    double          t;
+    int             ftp, natoms;
+    gmx_bool        bFrame;
+    int             nframes = 0;
+
+    ftp = fn2ftp(fn);
+    if (ftp != efXTC && ftp != efTRR)
+    {
+        gmx_fatal(FARGS, "Can only index trr and xtc files, not '%s'", fn);
+    }
+
+    fio = gmx_fio_open(fn, "r");
+    do
+    {
+        offset = gmx_fio_ftell(fio);
+        if (ftp == efXTC)
+        {
+            bFrame = xtc_skip_frame(fio, &natoms, &step, &t);
+        }
+        else
+        {
+            bFrame = trn_skip_frame(fio, &natoms, &step, &t);
+        }
+        if (bFrame)
+        {
+            if (idx == NULL)
+            {
+                idx = open_trxindex(fn, natoms, FALSE, 0);
+            }
+            trxindex_add_frame(idx, offset, step, t);
+            nframes++;
+        }
+    }
+    while (bFrame);
+    gmx_fio_close(fio);
+    close_trxindex(idx);
+
+    return nframes;
+}
@@ -0,0 +1,116 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+#ifndef GMX_FILEIO_TRXINDEX_H
+#define GMX_FILEIO_TRXINDEX_H
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/real.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Frame index files for trr and xtc trajectories.
+ *
+ * The index of trajectory traj.xtc is stored in traj.xtc.idx and
+ * contains the file offset, step and time of each frame. All records
+ * have the same size, so frames can be looked up without scanning
+ * the trajectory. An index is only used when it is consistent with
+ * the trajectory, otherwise the normal (slow) seeking is used.
+ */
+
+typedef struct gmx_trxindex *gmx_trxindex_t;
+
+gmx_trxindex_t open_trxindex(const char *fn, int natoms,
+                             gmx_bool bAppend, gmx_off_t traj_size);
+/* Open the index of trajectory fn for writing. When appending, the index
+ * should exist and match natoms. Entries of frames at or beyond
+ * traj_size, which were lost from the trajectory, are removed.
+ * Returns NULL when the index can not be appended to.
+ */
+
+void trxindex_add_frame(gmx_trxindex_t idx, gmx_off_t offset,
+                        gmx_int64_t step, double t);
+/* Add a frame that starts at offset in the trajectory. t should be the time
+ * as stored in the trajectory, i.e. in float precision for xtc, so the index
+ * written during the run is identical to the one of build_trxindex.
+ */
+
+void trxindex_flush(gmx_trxindex_t idx);
+/* Flush the index to disk, idx may be NULL */
+
+void close_trxindex(gmx_trxindex_t idx);
+/* Close the index, idx may be NULL */
+
+gmx_trxindex_t read_trxindex(const char *fn, int natoms);
+/* Open the index of trajectory fn for reading. Returns NULL when there is
+ * no index or the index does not match the trajectory or natoms.
+ * natoms=-1 accepts any number of atoms.
+ */
+
+int trxindex_nframes(gmx_trxindex_t idx);
+/* Returns the number of frames in the index */
+
+gmx_off_t trxindex_get_frame(gmx_trxindex_t idx, int frame,
+                             gmx_int64_t *step, double *t);
+/* Returns the offset of frame and sets step and t when not NULL.
+ * Returns -1 on error.
+ */
+
+int trxindex_find_time(gmx_trxindex_t idx, double t);
+/* Returns the first frame with time >= t, assuming increasing times.
+ * Returns the number of frames when all times are smaller than t.
+ */
+
+int trxindex_seek_time(t_fileio *fio, real t, int natoms,
+                       gmx_bool bSeekForwardOnly);
+/* Positions the trr or xtc file fio at the frame before the first frame
+ * with time >= t, using the index of the file.
+ * Returns 0 on success, -1 when there is no usable index.
+ */
+
+int build_trxindex(const char *fn);
+/* Scans the frame headers of trr or xtc file fn and writes its index.
+ * Returns the number of frames.
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
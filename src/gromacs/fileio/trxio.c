@@ -52,6 +52,7 @@
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trnio.h"
 #include "gromacs/fileio/trx.h"
+#include "gromacs/fileio/trxindex.h"
 #include "gromacs/fileio/xdrf.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/legacyheaders/checkpoint.h"
@@ -82,6 +83,8 @@ struct t_trxstatus
     double                  DT, BOX[3];
     gmx_bool                bReadBox;
     char                   *persistent_line; /* Persistent line for reading g96 trajectories */
+    gmx_bool                bIndexSeekTried; /* Did we try to seek -b with the frame index */
+    int                     indexSeekResult; /* The result of that seek                     */
 };
 
 /* utility functions */
@@ -159,6 +162,8 @@ static void status_init(t_trxstatus *status)
     status->__frame         = -1;
     status->persistent_line = NULL;
     status->tng             = NULL;
+    status->bIndexSeekTried = FALSE;
+    status->indexSeekResult = -1;
 }
 
 
@@ -778,6 +783,22 @@ static int pdb_first_x(t_trxstatus *status, FILE *fp, t_trxframe *fr)
     return fr->natoms;
 }
 
+/* Positions the trajectory at the -b time using its frame index.
+ * Reading and checking the index is only done once per status, not for
+ * every frame before -b. Returns 0 on success, -1 without usable index.
+ */
+static int trxindex_seek_begin(t_trxstatus *status, int natoms)
+{
+    if (!status->bIndexSeekTried)
+    {
+        status->indexSeekResult = trxindex_seek_time(status->fio, rTimeValue(TBEGIN),
+                                                     natoms, TRUE);
+        status->bIndexSeekTried = TRUE;
+    }
+
+    return status->indexSeekResult;
+}
+
 gmx_bool read_next_frame(const output_env_t oenv, t_trxstatus *status, t_trxframe *fr)
 {
     real     pt;
@@ -807,6 +828,12 @@ gmx_bool read_next_frame(const output_env_t oenv, t_trxstatus *status, t_trxfram
         switch (ftp)
         {
             case efTRR:
+                /* Without a frame index we read all frames before -b */
+                if (bTimeSet(TBEGIN) && (fr->tf < rTimeValue(TBEGIN)) &&
+                    trxindex_seek_begin(status, fr->natoms) == 0)
+                {
+                    initcount(status);
+                }
                 bRet = gmx_next_frame(status, fr);
                 break;
             case efCPT:
@@ -827,7 +854,11 @@ gmx_bool read_next_frame(const output_env_t oenv, t_trxstatus *status, t_trxfram
                  */
                 if (bTimeSet(TBEGIN) && (fr->tf < rTimeValue(TBEGIN)))
                 {
-                    if (xtc_seek_time(status->fio, rTimeValue(TBEGIN), fr->natoms, TRUE))
+                    /* Use the frame index when present, it avoids
+                     * the bisection on the frame headers.
+                     */
+                    if (trxindex_seek_begin(status, fr->natoms) != 0 &&
+                        xtc_seek_time(status->fio, rTimeValue(TBEGIN), fr->natoms, TRUE))
                     {
                         gmx_fatal(FARGS, "Specified frame (time %f) doesn't exist or file corrupt/inconsistent.",
                                   rTimeValue(TBEGIN));
@@ -1109,6 +1140,7 @@ void close_trj(t_trxstatus *status)
 void rewind_trj(t_trxstatus *status)
 {
     initcount(status);
+    status->bIndexSeekTried = FALSE;
 
     gmx_fio_rewind(status->fio);
 }
@@ -93,6 +93,14 @@ float xdr_xtc_get_last_frame_time(FILE *fp, XDR *xdrs, int natoms, gmx_bool * bO
 int xdr_xtc_get_last_frame_number(FILE *fp, XDR *xdrs, int natoms, gmx_bool * bOK);
 
 
+int xdr_xtc_skip_frame(FILE *fp, XDR *xdrs, int *natoms, int *step, float *time);
+/* Reads natoms, step and time from the header of the xtc frame at the
+ * current position and positions fp at the start of the next frame,
+ * without reading the coordinates.
+ * Returns 1 on success, 0 at the end of the file and -1 on a corrupt frame.
+ */
+
+
 /* Defined in gmxfio.c.
  * TODO: It would be nice to decouple this header from t_fileio completely,
  * and not need the XDR struct in gmxfio.h, but that would require some
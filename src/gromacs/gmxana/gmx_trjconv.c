@@ -45,8 +45,10 @@
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/pdbio.h"
 #include "gromacs/fileio/tngio_for_tools.h"
+#include "gromacs/fileio/timecontrol.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trnio.h"
+#include "gromacs/fileio/trxindex.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/fileio/xvgr.h"
@@ -1277,6 +1279,27 @@ int gmx_trjconv(int argc, char *argv[])
             flags = flags | TRX_READ_F;
         }
 
+        if (bTDump && !bTimeSet(TBEGIN))
+        {
+            gmx_trxindex_t trxidx;
+
+            /* With a frame index we can start reading just before the
+             * frame to dump. We need two frames to determine the time step.
+             */
+            trxidx = read_trxindex(in_file, -1);
+            if (trxidx != NULL)
+            {
+                double tidx;
+
+                i = trxindex_find_time(trxidx, tdump) - 2;
+                if (i > 0 && trxindex_get_frame(trxidx, i, NULL, &tidx) >= 0)
+                {
+                    setTimeValue(TBEGIN, tidx);
+                }
+                close_trxindex(trxidx);
+            }
+        }
+
         /* open trx file for reading */
         bHaveFirstFrame = read_first_frame(oenv, &trxin, in_file, &fr, flags);
         if (fr.bPrec)
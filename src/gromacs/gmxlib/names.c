@@ -75,6 +75,10 @@ const char *ecutscheme_names[ecutsNR+1] = {
     "Verlet", "Group", NULL
 };
 
+const char *eslowlisted_names[eslowlistedNR+1] = {
+    "no", "dihedrals", "dihedrals-pairs", NULL
+};
+
 const char *eel_names[eelNR+1] = {
     "Cut-off", "Reaction-Field", "Generalized-Reaction-Field",
     "PME", "Ewald", "P3M-AD", "Poisson", "Switch", "Shift", "User",
@@ -920,6 +920,8 @@ void pr_inputrec(FILE *fp, int indent, const char *title, t_inputrec *ir,
         PR("rlist", ir->rlist);
         PR("rlistlong", ir->rlistlong);
         PR("nstcalclr", ir->nstcalclr);
+        PI("nstcalcslow", ir->nstcalcslow);
+        PS("slow-listed", ESLOWLISTED(ir->eSlowListed));
 
         /* Options for electrostatics and VdW */
         PS("coulombtype", EELTYPE(ir->coulombtype));
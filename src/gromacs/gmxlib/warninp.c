@@ -155,6 +155,11 @@ void warning_error(warninp_t wi, const char *s)
     low_warning(wi, "ERROR", wi->nwarn_error, s);
 }
 
+gmx_bool warning_errors_exist(warninp_t wi)
+{
+    return (wi->nwarn_error > 0);
+}
+
 static void print_warn_count(const char *type, int n)
 {
     if (n > 0)
@@ -462,6 +462,25 @@ void check_ir(const char *mdparin, t_inputrec *ir, t_gromppopts *opts,
         warning_error(wi, "When used with PME, the long-range component of twin-range interactions must be updated every step (nstcalclr)");
     }
 
+    /* MULTIPLE TIME STEPPING */
+    if (ir->nstcalcslow < 1)
+    {
+        warning_error(wi, "nstcalcslow should be 1 or larger");
+    }
+    if (ir->nstcalcslow > 1)
+    {
+        sprintf(err_buf, "Multiple time stepping (nstcalcslow > 1) is only supported with integrator %s", ei_names[eiMD]);
+        CHECK(ir->eI != eiMD);
+        sprintf(err_buf, "Multiple time stepping (nstcalcslow > 1) is only supported with cutoff-scheme = %s", ecutscheme_names[ecutsVERLET]);
+        CHECK(ir->cutoff_scheme != ecutsVERLET);
+
+        if (!(EEL_FULL(ir->coulombtype) || EVDW_PME(ir->vdwtype)) &&
+            ir->eSlowListed == eslowlistedNO)
+        {
+            warning_note(wi, "With nstcalcslow > 1 you have no slow forces, the mesh part of PME or slow-listed interactions, multiple time stepping will have no effect");
+        }
+    }
+
     /* GENERAL INTEGRATOR STUFF */
     if (!(ir->eI == eiMD || EI_VV(ir->eI)))
     {
@@ -539,6 +558,23 @@ void check_ir(const char *mdparin, t_inputrec *ir, t_gromppopts *opts,
             }
         }
 
+        if (ir->nstcalcslow > 1)
+        {
+            /* Energies and the virial at other than slow steps require
+             * an extra evaluation of the slow forces.
+             * The output forces are only complete at the slow steps.
+             */
+            check_nst("nstcalcslow", ir->nstcalcslow,
+                      "nstcalcenergy", &ir->nstcalcenergy, wi);
+            if (ir->epc != epcNO)
+            {
+                check_nst("nstcalcslow", ir->nstcalcslow,
+                          "nstpcouple", &ir->nstpcouple, wi);
+            }
+            check_nst("nstcalcslow", ir->nstcalcslow,
+                      "nstfout", &ir->nstfout, wi);
+        }
+
         if (ir->nstcalcenergy > 0)
         {
             if (ir->efep != efepNO)
@@ -1861,6 +1897,10 @@ void get_ir(const char *mdparin, const char *mdparout,
     ITYPE ("nstcomm", ir->nstcomm,    100);
     CTYPE ("group(s) for center of mass motion removal");
     STYPE ("comm-grps",   is->vcm,            NULL);
+    CTYPE ("multiple time stepping: number of steps between evaluating the slow forces");
+    ITYPE ("nstcalcslow", ir->nstcalcslow, 1);
+    CTYPE ("listed interactions that are slow forces: no, dihedrals or dihedrals-pairs");
+    EETYPE("slow-listed", ir->eSlowListed, eslowlisted_names);
 
     CCTYPE ("LANGEVIN DYNAMICS OPTIONS");
     CTYPE ("Friction coefficient (amu/ps) and random seed");
@@ -0,0 +1,154 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the mdp option processing in readir.
+ *
+ * \ingroup module_gmxpreprocess
+ */
+#include "gmxpre.h"
+
+#include "gromacs/gmxpreprocess/readir.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/legacyheaders/warninp.h"
+#include "gromacs/legacyheaders/types/enums.h"
+#include "gromacs/legacyheaders/types/inputrec.h"
+#include "gromacs/utility/file.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+//! Test fixture for reading and checking mdp options
+class GetIrTest : public ::testing::Test
+{
+    public:
+        GetIrTest() : wi_(init_warning(TRUE, 0))
+        {
+            snew(ir_, 1);
+            snew(opts_, 1);
+            init_ir(ir_, opts_);
+        }
+
+        ~GetIrTest()
+        {
+            done_inputrec_strings();
+            sfree(wi_);
+            sfree(opts_);
+            sfree(ir_);
+        }
+
+        //! Reads and checks the mdp options in \p mdpString
+        void runTest(const std::string &mdpString)
+        {
+            std::string inputMdpFileName  = fileManager_.getTemporaryFilePath("input.mdp");
+            std::string outputMdpFileName = fileManager_.getTemporaryFilePath("output.mdp");
+
+            gmx::File::writeFileFromString(inputMdpFileName, mdpString);
+            get_ir(inputMdpFileName.c_str(), outputMdpFileName.c_str(),
+                   ir_, opts_, wi_);
+            check_ir(inputMdpFileName.c_str(), ir_, opts_, wi_);
+        }
+
+        gmx::test::TestFileManager fileManager_;
+        t_inputrec                *ir_;
+        t_gromppopts              *opts_;
+        warninp_t                  wi_;
+};
+
+TEST_F(GetIrTest, AcceptsMultipleTimeStepping)
+{
+    runTest("integrator = md\n"
+            "cutoff-scheme = Verlet\n"
+            "coulombtype = PME\n"
+            "nstcalcslow = 2\n"
+            "slow-listed = dihedrals-pairs\n"
+            "nstcalcenergy = 3\n"
+            "nstfout = 5\n");
+    EXPECT_FALSE(warning_errors_exist(wi_));
+    EXPECT_EQ(2, ir_->nstcalcslow);
+    EXPECT_EQ(eslowlistedDIHEDRALS_PAIRS, ir_->eSlowListed);
+    /* Intervals that are not multiples of nstcalcslow are rounded up */
+    EXPECT_EQ(4, ir_->nstcalcenergy);
+    EXPECT_EQ(6, ir_->nstfout);
+}
+
+TEST_F(GetIrTest, DefaultsToNoMultipleTimeStepping)
+{
+    runTest("integrator = md\n"
+            "cutoff-scheme = Verlet\n"
+            "coulombtype = PME\n");
+    EXPECT_FALSE(warning_errors_exist(wi_));
+    EXPECT_EQ(1, ir_->nstcalcslow);
+    EXPECT_EQ(eslowlistedNO, ir_->eSlowListed);
+}
+
+TEST_F(GetIrTest, RejectsNstcalcslowBelowOne)
+{
+    runTest("integrator = md\n"
+            "cutoff-scheme = Verlet\n"
+            "coulombtype = PME\n"
+            "nstcalcslow = 0\n");
+    EXPECT_TRUE(warning_errors_exist(wi_));
+}
+
+TEST_F(GetIrTest, RejectsMultipleTimeSteppingWithOtherIntegrators)
+{
+    runTest("integrator = sd\n"
+            "cutoff-scheme = Verlet\n"
+            "coulombtype = PME\n"
+            "tc-grps = System\n"
+            "tau-t = 1\n"
+            "ref-t = 298\n"
+            "nstcalcslow = 2\n");
+    EXPECT_TRUE(warning_errors_exist(wi_));
+}
+
+TEST_F(GetIrTest, RejectsMultipleTimeSteppingWithGroupScheme)
+{
+    runTest("integrator = md\n"
+            "cutoff-scheme = group\n"
+            "coulombtype = PME\n"
+            "nstcalcslow = 2\n");
+    EXPECT_TRUE(warning_errors_exist(wi_));
+}
+
+} // namespace
@@ -55,6 +55,7 @@ extern const char *epcoupl_names[epcNR+1];
 extern const char *epcoupltype_names[epctNR+1];
 extern const char *erefscaling_names[erscNR+1];
 extern const char *ecutscheme_names[ecutsNR+1];
+extern const char *eslowlisted_names[eslowlistedNR+1];
 extern const char *ens_names[ensNR+1];
 extern const char *ei_names[eiNR+1];
 extern const char *yesno_names[BOOL_NR+1];
@@ -112,6 +113,7 @@ extern const char *gmx_nbkernel_vdw_names[GMX_NBKERNEL_VDW_NR+1];
 
 #define EBOOL(e)       ENUM_NAME(e, BOOL_NR, bool_names)
 #define ECUTSCHEME(e)  ENUM_NAME(e, ecutsNR, ecutscheme_names)
+#define ESLOWLISTED(e) ENUM_NAME(e, eslowlistedNR, eslowlisted_names)
 #define ENS(e)         ENUM_NAME(e, ensNR, ens_names)
 #define EI(e)          ENUM_NAME(e, eiNR, ei_names)
 #define EPBC(e)        ENUM_NAME(e, epbcNR, epbc_names)
@@ -85,6 +85,12 @@ enum {
     ecutsVERLET, ecutsGROUP, ecutsNR
 };
 
+/* Listed interactions that are only evaluated at the slow steps
+ * with multiple time stepping */
+enum {
+    eslowlistedNO, eslowlistedDIHEDRALS, eslowlistedDIHEDRALS_PAIRS, eslowlistedNR
+};
+
 /* Coulomb / VdW interaction modifiers.
  * grompp replaces eintmodPOTSHIFT_VERLET by eintmodPOTSHIFT or eintmodNONE.
  * Exactcutoff is only used by Reaction-field-zero, and is not user-selectable.
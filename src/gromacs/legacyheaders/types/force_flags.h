@@ -70,6 +70,8 @@ extern "C" {
 #define GMX_FORCE_DHDL         (1<<10)
 /* Calculate long-range energies/forces */
 #define GMX_FORCE_DO_LR        (1<<11)
+/* Skip the slow forces with multiple time stepping */
+#define GMX_FORCE_NOSLOW       (1<<12)
 
 /* Normally one want all energy terms and forces */
 #define GMX_FORCE_ALLFORCES    (GMX_FORCE_LISTED | GMX_FORCE_NONBONDED | GMX_FORCE_FORCES)
@@ -333,6 +333,11 @@ typedef struct {
     gmx_bool bTwinRange;
     int      nlr;
     rvec    *f_twin;
+    /* Multiple time stepping: the slow forces are computed every nstcalcslow
+     * steps and then stored in f_twin, as the twin-range forces
+     */
+    int      nstcalcslow;
+    int      eSlowListed;
     /* Constraint virial correction for multiple time stepping */
     tensor   vir_twin_constr;
 
@@ -347,6 +352,11 @@ typedef struct {
      * points to the normal force vectors wen pressure is not requested.
      */
     rvec *f_novirsum;
+    /* When only PME mesh forces go into f_novirsum and we run on a single
+     * rank, the mesh forces can be gathered directly into f at virial steps.
+     * The mesh virial is then corrected for the single sum virial.
+     */
+    gmx_bool bF_NoVirSumInF;
 
     /* Long-range forces and virial for PPPM/PME/Ewald */
     struct gmx_pme_t *pmedata;
@@ -395,6 +395,8 @@ typedef struct {
     real            rlist;                   /* short range pairlist cut-off (nm)		*/
     real            rlistlong;               /* long range pairlist cut-off (nm)		*/
     int             nstcalclr;               /* Frequency of evaluating direct space long-range interactions */
+    int             nstcalcslow;             /* Frequency of evaluating the slow forces with multiple time stepping */
+    int             eSlowListed;             /* Listed interactions that are slow forces     */
     real            rtpi;                    /* Radius for test particle insertion           */
     int             coulombtype;             /* Type of electrostatics treatment             */
     int             coulomb_modifier;        /* Modify the Coulomb interaction              */
@@ -64,6 +64,8 @@ typedef struct {
     gmx_vsite_thread_t *tdata;                /* Thread local vsites and work structs    */
     int                *th_ind;               /* Work array                              */
     int                 th_ind_nalloc;        /* Size of th_ind                          */
+    /* Can the vsites of each type be processed in SIMD batches?          */
+    gmx_bool            bSimd[F_VSITEN-F_VSITE2+1];
 } gmx_vsite_t;
 
 struct t_graph;
@@ -101,6 +101,10 @@ warning_error(warninp_t wi, const char *s);
  * are printed, nwarn_error (local) is incremented.
  */
 
+gmx_bool
+warning_errors_exist(warninp_t wi);
+/* Return whether any errors have been issued with warning_error. */
+
 void
 check_warning_error(warninp_t wi, int f_errno, const char *file, int line);
 /* When warning_error has been called at least once gmx_fatal is called,
@@ -61,6 +61,7 @@
 #include "gromacs/pbcutil/mshift.h"
 #include "gromacs/pbcutil/pbc-simd.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/gather_scatter_rvec.h"
 #include "gromacs/simd/simd.h"
 #include "gromacs/simd/simd_math.h"
 #include "gromacs/simd/vector_operations.h"
@@ -72,163 +73,6 @@
 #include "restcbt.h"
 
 
-#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
-
-// This was originally work-in-progress for augmenting the SIMD module with
-// masked load/store operations. Instead, that turned into and extended SIMD
-// interface that supports gather/scatter in all platforms, which will be
-// part of a future Gromacs version. However, since the code for bonded
-// interactions and LINCS was already written it would be a pity not to get
-// the performance gains in Gromacs-5.1. For this reason we have added it as
-// a bit of a hack in the two files that use it. It will be replaced with the
-// new generic functionality after version 5.1
-
-#    ifdef GMX_DOUBLE
-static gmx_inline void gmx_simdcall
-gmx_hack_simd_transpose4_r(gmx_simd_double_t *row0,
-                           gmx_simd_double_t *row1,
-                           gmx_simd_double_t *row2,
-                           gmx_simd_double_t *row3)
-{
-    __m256d tmp0, tmp1, tmp2, tmp3;
-
-    tmp0  = _mm256_unpacklo_pd(*row0, *row1);
-    tmp2  = _mm256_unpacklo_pd(*row2, *row3);
-    tmp1  = _mm256_unpackhi_pd(*row0, *row1);
-    tmp3  = _mm256_unpackhi_pd(*row2, *row3);
-    *row0 = _mm256_permute2f128_pd(tmp0, tmp2, 0b00100000);
-    *row1 = _mm256_permute2f128_pd(tmp1, tmp3, 0b00100000);
-    *row2 = _mm256_permute2f128_pd(tmp0, tmp2, 0b00110001);
-    *row3 = _mm256_permute2f128_pd(tmp1, tmp3, 0b00110001);
-}
-
-static gmx_inline void gmx_simdcall
-gmx_hack_simd4_transpose_to_simd_r(const gmx_simd4_double_t *a,
-                                   gmx_simd_double_t        *row0,
-                                   gmx_simd_double_t        *row1,
-                                   gmx_simd_double_t        *row2,
-                                   gmx_simd_double_t        *row3)
-{
-    *row0 = a[0];
-    *row1 = a[1];
-    *row2 = a[2];
-    *row3 = a[3];
-
-    gmx_hack_simd_transpose4_r(row0, row1, row2, row3);
-}
-
-#    ifdef GMX_SIMD_X86_AVX_GCC_MASKLOAD_BUG
-#        define gmx_hack_simd4_load3_r(mem)    _mm256_maskload_pd((mem), _mm_castsi128_ps(_mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1)))
-#    else
-#        define gmx_hack_simd4_load3_r(mem)    _mm256_maskload_pd((mem), _mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1))
-#    endif
-
-#    else /* single instead of double */
-static gmx_inline void gmx_simdcall
-gmx_hack_simd_transpose4_r(gmx_simd_float_t *row0,
-                           gmx_simd_float_t *row1,
-                           gmx_simd_float_t *row2,
-                           gmx_simd_float_t *row3)
-{
-    __m256 tmp0, tmp1, tmp2, tmp3;
-
-    tmp0  = _mm256_unpacklo_ps(*row0, *row1);
-    tmp2  = _mm256_unpacklo_ps(*row2, *row3);
-    tmp1  = _mm256_unpackhi_ps(*row0, *row1);
-    tmp3  = _mm256_unpackhi_ps(*row2, *row3);
-    *row0 = _mm256_shuffle_ps(tmp0, tmp2, 0b0100010001000100);
-    *row1 = _mm256_shuffle_ps(tmp0, tmp2, 0b1110111011101110);
-    *row2 = _mm256_shuffle_ps(tmp1, tmp3, 0b0100010001000100);
-    *row3 = _mm256_shuffle_ps(tmp1, tmp3, 0b1110111011101110);
-}
-
-static gmx_inline void gmx_simdcall
-gmx_hack_simd4_transpose_to_simd_r(const gmx_simd4_float_t *a,
-                                   gmx_simd_float_t        *row0,
-                                   gmx_simd_float_t        *row1,
-                                   gmx_simd_float_t        *row2,
-                                   gmx_simd_float_t        *row3)
-{
-    *row0 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[0]), a[4], 1);
-    *row1 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[1]), a[5], 1);
-    *row2 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[2]), a[6], 1);
-    *row3 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[3]), a[7], 1);
-
-    gmx_hack_simd_transpose4_r(row0, row1, row2, row3);
-}
-#ifdef GMX_SIMD_X86_AVX_GCC_MASKLOAD_BUG
-#        define gmx_hack_simd4_load3_r(mem)    _mm_maskload_ps((mem), _mm_castsi256_pd(_mm_set_epi32(0, -1, -1, -1)))
-#else
-#        define gmx_hack_simd4_load3_r(mem)    _mm_maskload_ps((mem), _mm_set_epi32(0, -1, -1, -1))
-#endif
-
-#endif
-
-#endif /* AVX */
-
-
-
-#ifdef GMX_SIMD_HAVE_REAL
-/*! \brief Store differences between indexed rvecs in SIMD registers.
- *
- * Returns SIMD register with the difference vectors:
- *     v[index0[i]] - v[index1[i]]
- *
- * \param[in]     v           Array of rvecs
- * \param[in]     index0      Index into the vector array
- * \param[in]     index1      Index into the vector array
- * \param[in,out] buf         Aligned tmp buffer of size 3*GMX_SIMD_REAL_WIDTH
- * \param[out]    dx          SIMD register with x difference
- * \param[out]    dy          SIMD register with y difference
- * \param[out]    dz          SIMD register with z difference
- */
-static gmx_inline void gmx_simdcall
-gmx_hack_simd_gather_rvec_dist_two_index(const rvec      *v,
-                                         const int       *index0,
-                                         const int       *index1,
-                                         real gmx_unused *buf,
-                                         gmx_simd_real_t *dx,
-                                         gmx_simd_real_t *dy,
-                                         gmx_simd_real_t *dz)
-{
-#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
-    int              i;
-    gmx_simd4_real_t d[GMX_SIMD_REAL_WIDTH];
-    gmx_simd_real_t  tmp;
-
-    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
-    {
-        d[i] = gmx_simd4_sub_r(gmx_hack_simd4_load3_r(&(v[index0[i]][0])),
-                               gmx_hack_simd4_load3_r(&(v[index1[i]][0])));
-
-    }
-    gmx_hack_simd4_transpose_to_simd_r(d, dx, dy, dz, &tmp);
-#else /* generic SIMD */
-#if GMX_ALIGNMENT
-    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) buf_aligned[3*GMX_SIMD_REAL_WIDTH];
-#else
-    real* buf_aligned = buf;
-#endif
-
-    int i, m;
-
-    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
-    {
-        /* Store the distances packed and aligned */
-        for (m = 0; m < DIM; m++)
-        {
-            buf_aligned[m*GMX_SIMD_REAL_WIDTH + i] =
-                v[index0[i]][m] - v[index1[i]][m];
-        }
-    }
-    *dx = gmx_simd_load_r(buf_aligned + 0*GMX_SIMD_REAL_WIDTH);
-    *dy = gmx_simd_load_r(buf_aligned + 1*GMX_SIMD_REAL_WIDTH);
-    *dz = gmx_simd_load_r(buf_aligned + 2*GMX_SIMD_REAL_WIDTH);
-#endif
-}
-#endif /* GMX_SIMD_HAVE_REAL */
-
-
 /*! \brief Mysterious CMAP coefficient matrix */
 const int cmap_coeff_matrix[] = {
     1, 0, -3,  2, 0, 0,  0,  0, -3,  0,  9, -6,  2,  0, -6,  4,
@@ -510,13 +354,17 @@ real harmonic(real kA, real kB, real xA, real xB, real x, real lambda,
 }
 
 
-real bonds(int nbonds,
+/*! \brief Harmonic bonds, templated on computing energies and shift forces
+ *
+ * With bCalcEnerVir=FALSE only the forces for the A state are computed.
+ */
+template <gmx_bool bCalcEnerVir>
+static real
+bonds_impl(int nbonds,
            const t_iatom forceatoms[], const t_iparams forceparams[],
            const rvec x[], rvec f[], rvec fshift[],
            const t_pbc *pbc, const t_graph *g,
-           real lambda, real *dvdlambda,
-           const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-           int gmx_unused *global_atom_index)
+           real lambda, real *dvdlambda)
 {
     int  i, m, ki, ai, aj, type;
     real dr, dr2, fbond, vbond, fij, vtot;
@@ -534,19 +382,28 @@ real bonds(int nbonds,
         dr2  = iprod(dx, dx);                       /*   5		*/
         dr   = dr2*gmx_invsqrt(dr2);                /*  10		*/
 
-        *dvdlambda += harmonic(forceparams[type].harmonic.krA,
-                               forceparams[type].harmonic.krB,
-                               forceparams[type].harmonic.rA,
-                               forceparams[type].harmonic.rB,
-                               dr, lambda, &vbond, &fbond); /*  19  */
+        if (bCalcEnerVir)
+        {
+            *dvdlambda += harmonic(forceparams[type].harmonic.krA,
+                                   forceparams[type].harmonic.krB,
+                                   forceparams[type].harmonic.rA,
+                                   forceparams[type].harmonic.rB,
+                                   dr, lambda, &vbond, &fbond); /*  19  */
+        }
+        else
+        {
+            fbond = -forceparams[type].harmonic.krA*(dr - forceparams[type].harmonic.rA);
+        }
 
         if (dr2 == 0.0)
         {
             continue;
         }
 
-
-        vtot  += vbond;            /* 1*/
+        if (bCalcEnerVir)
+        {
+            vtot  += vbond;        /* 1*/
+        }
         fbond *= gmx_invsqrt(dr2); /*   6		*/
 #ifdef DEBUG
         if (debug)
@@ -555,7 +412,7 @@ real bonds(int nbonds,
                     dr, vbond, fbond);
         }
 #endif
-        if (g)
+        if (bCalcEnerVir && g)
         {
             ivec_sub(SHIFT_IVEC(g, ai), SHIFT_IVEC(g, aj), dt);
             ki = IVEC2IS(dt);
@@ -565,13 +422,40 @@ real bonds(int nbonds,
             fij                 = fbond*dx[m];
             f[ai][m]           += fij;
             f[aj][m]           -= fij;
-            fshift[ki][m]      += fij;
-            fshift[CENTRAL][m] -= fij;
+            if (bCalcEnerVir)
+            {
+                fshift[ki][m]      += fij;
+                fshift[CENTRAL][m] -= fij;
+            }
         }
     }               /* 59 TOTAL	*/
     return vtot;
 }
 
+real bonds(int nbonds,
+           const t_iatom forceatoms[], const t_iparams forceparams[],
+           const rvec x[], rvec f[], rvec fshift[],
+           const t_pbc *pbc, const t_graph *g,
+           real lambda, real *dvdlambda,
+           const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+           int gmx_unused *global_atom_index)
+{
+    return bonds_impl<TRUE>(nbonds, forceatoms, forceparams, x, f, fshift,
+                            pbc, g, lambda, dvdlambda);
+}
+
+void bonds_noener(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec f[],
+                  const t_pbc *pbc, const t_graph *g,
+                  real lambda,
+                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                  int gmx_unused *global_atom_index)
+{
+    bonds_impl<FALSE>(nbonds, forceatoms, forceparams, x, f, NULL,
+                      pbc, g, lambda, NULL);
+}
+
 real restraint_bonds(int nbonds,
                      const t_iatom forceatoms[], const t_iparams forceparams[],
                      const rvec x[], rvec f[], rvec fshift[],
@@ -1032,13 +916,17 @@ real bond_angle(const rvec xi, const rvec xj, const rvec xk, const t_pbc *pbc,
     return th;
 }
 
-real angles(int nbonds,
+/*! \brief Harmonic angles, templated on computing energies and shift forces
+ *
+ * With bCalcEnerVir=FALSE only the forces for the A state are computed.
+ */
+template <gmx_bool bCalcEnerVir>
+static real
+angles_impl(int nbonds,
             const t_iatom forceatoms[], const t_iparams forceparams[],
             const rvec x[], rvec f[], rvec fshift[],
             const t_pbc *pbc, const t_graph *g,
-            real lambda, real *dvdlambda,
-            const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-            int gmx_unused *global_atom_index)
+            real lambda, real *dvdlambda)
 {
     int  i, ai, aj, ak, t1, t2, type;
     rvec r_ij, r_kj;
@@ -1056,12 +944,19 @@ real angles(int nbonds,
         theta  = bond_angle(x[ai], x[aj], x[ak], pbc,
                             r_ij, r_kj, &cos_theta, &t1, &t2);  /*  41		*/
 
-        *dvdlambda += harmonic(forceparams[type].harmonic.krA,
-                               forceparams[type].harmonic.krB,
-                               forceparams[type].harmonic.rA*DEG2RAD,
-                               forceparams[type].harmonic.rB*DEG2RAD,
-                               theta, lambda, &va, &dVdt);  /*  21  */
-        vtot += va;
+        if (bCalcEnerVir)
+        {
+            *dvdlambda += harmonic(forceparams[type].harmonic.krA,
+                                   forceparams[type].harmonic.krB,
+                                   forceparams[type].harmonic.rA*DEG2RAD,
+                                   forceparams[type].harmonic.rB*DEG2RAD,
+                                   theta, lambda, &va, &dVdt);  /*  21  */
+            vtot += va;
+        }
+        else
+        {
+            dVdt = -forceparams[type].harmonic.krA*(theta - forceparams[type].harmonic.rA*DEG2RAD);
+        }
 
         cos_theta2 = sqr(cos_theta);
         if (cos_theta2 < 1)
@@ -1101,24 +996,51 @@ real angles(int nbonds,
                 f[aj][m] += f_j[m];
                 f[ak][m] += f_k[m];
             }
-            if (g != NULL)
+            if (bCalcEnerVir)
             {
-                copy_ivec(SHIFT_IVEC(g, aj), jt);
+                if (g != NULL)
+                {
+                    copy_ivec(SHIFT_IVEC(g, aj), jt);
 
-                ivec_sub(SHIFT_IVEC(g, ai), jt, dt_ij);
-                ivec_sub(SHIFT_IVEC(g, ak), jt, dt_kj);
-                t1 = IVEC2IS(dt_ij);
-                t2 = IVEC2IS(dt_kj);
+                    ivec_sub(SHIFT_IVEC(g, ai), jt, dt_ij);
+                    ivec_sub(SHIFT_IVEC(g, ak), jt, dt_kj);
+                    t1 = IVEC2IS(dt_ij);
+                    t2 = IVEC2IS(dt_kj);
+                }
+                rvec_inc(fshift[t1], f_i);
+                rvec_inc(fshift[CENTRAL], f_j);
+                rvec_inc(fshift[t2], f_k);
             }
-            rvec_inc(fshift[t1], f_i);
-            rvec_inc(fshift[CENTRAL], f_j);
-            rvec_inc(fshift[t2], f_k);
         }                                           /* 161 TOTAL	*/
     }
 
     return vtot;
 }
 
+real angles(int nbonds,
+            const t_iatom forceatoms[], const t_iparams forceparams[],
+            const rvec x[], rvec f[], rvec fshift[],
+            const t_pbc *pbc, const t_graph *g,
+            real lambda, real *dvdlambda,
+            const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+            int gmx_unused *global_atom_index)
+{
+    return angles_impl<TRUE>(nbonds, forceatoms, forceparams, x, f, fshift,
+                             pbc, g, lambda, dvdlambda);
+}
+
+void angles_noener(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const rvec x[], rvec f[],
+                   const t_pbc *pbc, const t_graph *g,
+                   real lambda,
+                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                   int gmx_unused *global_atom_index)
+{
+    angles_impl<FALSE>(nbonds, forceatoms, forceparams, x, f, NULL,
+                       pbc, g, lambda, NULL);
+}
+
 #ifdef GMX_SIMD_HAVE_REAL
 
 /* As angles, but using SIMD to calculate many angles at once.
@@ -1345,13 +1267,17 @@ real linear_angles(int nbonds,
     return vtot;
 }
 
-real urey_bradley(int nbonds,
+/*! \brief Urey-Bradley angles, templated on computing energies and shift forces
+ *
+ * With bCalcEnerVir=FALSE only the forces for the A state are computed.
+ */
+template <gmx_bool bCalcEnerVir>
+static real
+urey_bradley_impl(int nbonds,
                   const t_iatom forceatoms[], const t_iparams forceparams[],
                   const rvec x[], rvec f[], rvec fshift[],
                   const t_pbc *pbc, const t_graph *g,
-                  real lambda, real *dvdlambda,
-                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                  int gmx_unused *global_atom_index)
+                  real lambda, real *dvdlambda)
 {
     int  i, m, ai, aj, ak, t1, t2, type, ki;
     rvec r_ij, r_kj, r_ik;
@@ -1379,14 +1305,28 @@ real urey_bradley(int nbonds,
         theta  = bond_angle(x[ai], x[aj], x[ak], pbc,
                             r_ij, r_kj, &cos_theta, &t1, &t2);                     /*  41		*/
 
-        *dvdlambda += harmonic(kthA, kthB, th0A, th0B, theta, lambda, &va, &dVdt); /*  21  */
-        vtot       += va;
+        if (bCalcEnerVir)
+        {
+            *dvdlambda += harmonic(kthA, kthB, th0A, th0B, theta, lambda, &va, &dVdt); /*  21  */
+            vtot       += va;
+        }
+        else
+        {
+            dVdt = -kthA*(theta - th0A);
+        }
 
         ki   = pbc_rvec_sub(pbc, x[ai], x[ak], r_ik);                               /*   3      */
         dr2  = iprod(r_ik, r_ik);                                                   /*   5		*/
         dr   = dr2*gmx_invsqrt(dr2);                                                /*  10		*/
 
-        *dvdlambda += harmonic(kUBA, kUBB, r13A, r13B, dr, lambda, &vbond, &fbond); /*  19  */
+        if (bCalcEnerVir)
+        {
+            *dvdlambda += harmonic(kUBA, kUBB, r13A, r13B, dr, lambda, &vbond, &fbond); /*  19  */
+        }
+        else
+        {
+            fbond = -kUBA*(dr - r13A);
+        }
 
         cos_theta2 = sqr(cos_theta);                                                /*   1		*/
         if (cos_theta2 < 1)
@@ -1421,18 +1361,21 @@ real urey_bradley(int nbonds,
                 f[aj][m] += f_j[m];
                 f[ak][m] += f_k[m];
             }
-            if (g)
+            if (bCalcEnerVir)
             {
-                copy_ivec(SHIFT_IVEC(g, aj), jt);
+                if (g)
+                {
+                    copy_ivec(SHIFT_IVEC(g, aj), jt);
 
-                ivec_sub(SHIFT_IVEC(g, ai), jt, dt_ij);
-                ivec_sub(SHIFT_IVEC(g, ak), jt, dt_kj);
-                t1 = IVEC2IS(dt_ij);
-                t2 = IVEC2IS(dt_kj);
+                    ivec_sub(SHIFT_IVEC(g, ai), jt, dt_ij);
+                    ivec_sub(SHIFT_IVEC(g, ak), jt, dt_kj);
+                    t1 = IVEC2IS(dt_ij);
+                    t2 = IVEC2IS(dt_kj);
+                }
+                rvec_inc(fshift[t1], f_i);
+                rvec_inc(fshift[CENTRAL], f_j);
+                rvec_inc(fshift[t2], f_k);
             }
-            rvec_inc(fshift[t1], f_i);
-            rvec_inc(fshift[CENTRAL], f_j);
-            rvec_inc(fshift[t2], f_k);
         }                                       /* 161 TOTAL	*/
         /* Time for the bond calculations */
         if (dr2 == 0.0)
@@ -1440,10 +1383,13 @@ real urey_bradley(int nbonds,
             continue;
         }
 
-        vtot  += vbond;            /* 1*/
+        if (bCalcEnerVir)
+        {
+            vtot  += vbond;        /* 1*/
+        }
         fbond *= gmx_invsqrt(dr2); /*   6		*/
 
-        if (g)
+        if (bCalcEnerVir && g)
         {
             ivec_sub(SHIFT_IVEC(g, ai), SHIFT_IVEC(g, ak), dt_ik);
             ki = IVEC2IS(dt_ik);
@@ -1453,73 +1399,280 @@ real urey_bradley(int nbonds,
             fik                 = fbond*r_ik[m];
             f[ai][m]           += fik;
             f[ak][m]           -= fik;
-            fshift[ki][m]      += fik;
-            fshift[CENTRAL][m] -= fik;
+            if (bCalcEnerVir)
+            {
+                fshift[ki][m]      += fik;
+                fshift[CENTRAL][m] -= fik;
+            }
         }
     }
     return vtot;
 }
 
-real quartic_angles(int nbonds,
-                    const t_iatom forceatoms[], const t_iparams forceparams[],
-                    const rvec x[], rvec f[], rvec fshift[],
-                    const t_pbc *pbc, const t_graph *g,
-                    real gmx_unused lambda, real gmx_unused *dvdlambda,
-                    const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                    int gmx_unused *global_atom_index)
+real urey_bradley(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec f[], rvec fshift[],
+                  const t_pbc *pbc, const t_graph *g,
+                  real lambda, real *dvdlambda,
+                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                  int gmx_unused *global_atom_index)
 {
-    int  i, j, ai, aj, ak, t1, t2, type;
-    rvec r_ij, r_kj;
-    real cos_theta, cos_theta2, theta, dt, dVdt, va, dtp, c, vtot;
-    ivec jt, dt_ij, dt_kj;
+    return urey_bradley_impl<TRUE>(nbonds, forceatoms, forceparams, x, f, fshift,
+                                   pbc, g, lambda, dvdlambda);
+}
 
-    vtot = 0.0;
-    for (i = 0; (i < nbonds); )
-    {
-        type = forceatoms[i++];
-        ai   = forceatoms[i++];
-        aj   = forceatoms[i++];
-        ak   = forceatoms[i++];
+void urey_bradley_noener(int nbonds,
+                         const t_iatom forceatoms[], const t_iparams forceparams[],
+                         const rvec x[], rvec f[],
+                         const t_pbc *pbc, const t_graph *g,
+                         real lambda,
+                         const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                         int gmx_unused *global_atom_index)
+{
+    urey_bradley_impl<FALSE>(nbonds, forceatoms, forceparams, x, f, NULL,
+                             pbc, g, lambda, NULL);
+}
 
-        theta  = bond_angle(x[ai], x[aj], x[ak], pbc,
-                            r_ij, r_kj, &cos_theta, &t1, &t2); /*  41		*/
+#ifdef GMX_SIMD_HAVE_REAL
 
-        dt = theta - forceparams[type].qangle.theta*DEG2RAD;   /* 2          */
+/* As urey_bradley, but using SIMD to calculate many potentials at once.
+ * This routines does not calculate energies and shift forces.
+ */
+void
+urey_bradley_noener_simd(int nbonds,
+                         const t_iatom forceatoms[], const t_iparams forceparams[],
+                         const rvec x[], rvec f[],
+                         const t_pbc *pbc, const t_graph gmx_unused *g,
+                         real gmx_unused lambda,
+                         const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                         int gmx_unused *global_atom_index)
+{
+    const int            nfa1 = 4;
+    int                  i, iu, s, m;
+    int                  type, ai[GMX_SIMD_REAL_WIDTH], aj[GMX_SIMD_REAL_WIDTH];
+    int                  ak[GMX_SIMD_REAL_WIDTH];
+    real                 coeff_array[4*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *coeff;
+    real                 dr_array[3*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *dr;
+    real                 f_buf_array[6*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *f_buf;
+    gmx_simd_real_t      k_S, theta0_S, kUB_S, r13_S;
+    gmx_simd_real_t      rijx_S, rijy_S, rijz_S;
+    gmx_simd_real_t      rkjx_S, rkjy_S, rkjz_S;
+    gmx_simd_real_t      rikx_S, riky_S, rikz_S;
+    gmx_simd_real_t      one_S;
+    gmx_simd_real_t      min_one_plus_eps_S;
+    gmx_simd_real_t      real_min_S;
+    gmx_simd_real_t      rij_rkj_S;
+    gmx_simd_real_t      nrij2_S, nrij_1_S;
+    gmx_simd_real_t      nrkj2_S, nrkj_1_S;
+    gmx_simd_real_t      nrik2_S, nrik_1_S;
+    gmx_simd_real_t      cos_S, invsin_S;
+    gmx_simd_real_t      theta_S;
+    gmx_simd_real_t      st_S, sth_S;
+    gmx_simd_real_t      cik_S, cii_S, ckk_S;
+    gmx_simd_real_t      fbond_S;
+    gmx_simd_real_t      f_ix_S, f_iy_S, f_iz_S;
+    gmx_simd_real_t      f_kx_S, f_ky_S, f_kz_S;
+    pbc_simd_t           pbc_simd;
 
-        dVdt = 0;
-        va   = forceparams[type].qangle.c[0];
-        dtp  = 1.0;
-        for (j = 1; j <= 4; j++)
-        {
-            c     = forceparams[type].qangle.c[j];
-            dVdt -= j*c*dtp;
-            dtp  *= dt;
-            va   += c*dtp;
-        }
-        /* 20 */
+    /* Ensure register memory alignment */
+    coeff = gmx_simd_align_r(coeff_array);
+    dr    = gmx_simd_align_r(dr_array);
+    f_buf = gmx_simd_align_r(f_buf_array);
 
-        vtot += va;
+    set_pbc_simd(pbc, &pbc_simd);
 
-        cos_theta2 = sqr(cos_theta);            /*   1		*/
-        if (cos_theta2 < 1)
-        {
-            int  m;
-            real st, sth;
-            real cik, cii, ckk;
-            real nrkj2, nrij2;
-            rvec f_i, f_j, f_k;
+    one_S = gmx_simd_set1_r(1.0);
 
-            st  = dVdt*gmx_invsqrt(1 - cos_theta2); /*  12		*/
-            sth = st*cos_theta;                     /*   1		*/
-#ifdef DEBUG
-            if (debug)
-            {
-                fprintf(debug, "ANGLES: theta = %10g  vth = %10g  dV/dtheta = %10g\n",
-                        theta*RAD2DEG, va, dVdt);
-            }
-#endif
-            nrkj2 = iprod(r_kj, r_kj);  /*   5		*/
-            nrij2 = iprod(r_ij, r_ij);
+    /* The smallest number > -1 */
+    min_one_plus_eps_S = gmx_simd_set1_r(-1.0 + 2*GMX_REAL_EPS);
+
+    /* Used to avoid division by zero for the 1-3 distance */
+    real_min_S = gmx_simd_set1_r(GMX_REAL_MIN);
+
+    /* nbonds is the number of angles times nfa1, here we step GMX_SIMD_REAL_WIDTH angles */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms for GMX_SIMD_REAL_WIDTH angles.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+
+            coeff[s]                       = forceparams[type].u_b.kthetaA;
+            coeff[GMX_SIMD_REAL_WIDTH+s]   = forceparams[type].u_b.thetaA*DEG2RAD;
+            coeff[2*GMX_SIMD_REAL_WIDTH+s] = forceparams[type].u_b.kUBA;
+            coeff[3*GMX_SIMD_REAL_WIDTH+s] = forceparams[type].u_b.r13A;
+
+            /* At the end fill the arrays with identical entries */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+
+        /* Store the non PBC corrected distances packed and aligned */
+        gmx_hack_simd_gather_rvec_dist_two_index(x, ai, aj, dr,
+                                                 &rijx_S, &rijy_S, &rijz_S);
+        gmx_hack_simd_gather_rvec_dist_two_index(x, ak, aj, dr + 3*GMX_SIMD_REAL_WIDTH,
+                                                 &rkjx_S, &rkjy_S, &rkjz_S);
+        gmx_hack_simd_gather_rvec_dist_two_index(x, ai, ak, dr + 6*GMX_SIMD_REAL_WIDTH,
+                                                 &rikx_S, &riky_S, &rikz_S);
+
+        k_S       = gmx_simd_load_r(coeff);
+        theta0_S  = gmx_simd_load_r(coeff+GMX_SIMD_REAL_WIDTH);
+        kUB_S     = gmx_simd_load_r(coeff+2*GMX_SIMD_REAL_WIDTH);
+        r13_S     = gmx_simd_load_r(coeff+3*GMX_SIMD_REAL_WIDTH);
+
+        pbc_correct_dx_simd(&rijx_S, &rijy_S, &rijz_S, &pbc_simd);
+        pbc_correct_dx_simd(&rkjx_S, &rkjy_S, &rkjz_S, &pbc_simd);
+        pbc_correct_dx_simd(&rikx_S, &riky_S, &rikz_S, &pbc_simd);
+
+        rij_rkj_S = gmx_simd_iprod_r(rijx_S, rijy_S, rijz_S,
+                                     rkjx_S, rkjy_S, rkjz_S);
+
+        nrij2_S   = gmx_simd_norm2_r(rijx_S, rijy_S, rijz_S);
+        nrkj2_S   = gmx_simd_norm2_r(rkjx_S, rkjy_S, rkjz_S);
+
+        nrij_1_S  = gmx_simd_invsqrt_r(nrij2_S);
+        nrkj_1_S  = gmx_simd_invsqrt_r(nrkj2_S);
+
+        cos_S     = gmx_simd_mul_r(rij_rkj_S, gmx_simd_mul_r(nrij_1_S, nrkj_1_S));
+
+        /* As in angles_noener_simd, we take the max of cos and -1 + 1bit */
+        cos_S     = gmx_simd_max_r(cos_S, min_one_plus_eps_S);
+
+        theta_S   = gmx_simd_acos_r(cos_S);
+
+        invsin_S  = gmx_simd_invsqrt_r(gmx_simd_sub_r(one_S, gmx_simd_mul_r(cos_S, cos_S)));
+
+        st_S      = gmx_simd_mul_r(gmx_simd_mul_r(k_S, gmx_simd_sub_r(theta0_S, theta_S)),
+                                   invsin_S);
+        sth_S     = gmx_simd_mul_r(st_S, cos_S);
+
+        cik_S     = gmx_simd_mul_r(st_S,  gmx_simd_mul_r(nrij_1_S, nrkj_1_S));
+        cii_S     = gmx_simd_mul_r(sth_S, gmx_simd_mul_r(nrij_1_S, nrij_1_S));
+        ckk_S     = gmx_simd_mul_r(sth_S, gmx_simd_mul_r(nrkj_1_S, nrkj_1_S));
+
+        /* The Urey-Bradley 1-3 bond, the max avoids division by zero
+         * for overlapping atoms, where r_ik=0 sets the force to zero.
+         */
+        nrik2_S   = gmx_simd_max_r(gmx_simd_norm2_r(rikx_S, riky_S, rikz_S), real_min_S);
+        nrik_1_S  = gmx_simd_invsqrt_r(nrik2_S);
+        fbond_S   = gmx_simd_mul_r(kUB_S, gmx_simd_fnmadd_r(nrik2_S, nrik_1_S, r13_S));
+        fbond_S   = gmx_simd_mul_r(fbond_S, nrik_1_S);
+
+        f_ix_S    = gmx_simd_mul_r(cii_S, rijx_S);
+        f_ix_S    = gmx_simd_fnmadd_r(cik_S, rkjx_S, f_ix_S);
+        f_iy_S    = gmx_simd_mul_r(cii_S, rijy_S);
+        f_iy_S    = gmx_simd_fnmadd_r(cik_S, rkjy_S, f_iy_S);
+        f_iz_S    = gmx_simd_mul_r(cii_S, rijz_S);
+        f_iz_S    = gmx_simd_fnmadd_r(cik_S, rkjz_S, f_iz_S);
+        f_kx_S    = gmx_simd_mul_r(ckk_S, rkjx_S);
+        f_kx_S    = gmx_simd_fnmadd_r(cik_S, rijx_S, f_kx_S);
+        f_ky_S    = gmx_simd_mul_r(ckk_S, rkjy_S);
+        f_ky_S    = gmx_simd_fnmadd_r(cik_S, rijy_S, f_ky_S);
+        f_kz_S    = gmx_simd_mul_r(ckk_S, rkjz_S);
+        f_kz_S    = gmx_simd_fnmadd_r(cik_S, rijz_S, f_kz_S);
+
+        /* Add the bond force, which does not act on atom j */
+        f_ix_S    = gmx_simd_fmadd_r(fbond_S, rikx_S, f_ix_S);
+        f_iy_S    = gmx_simd_fmadd_r(fbond_S, riky_S, f_iy_S);
+        f_iz_S    = gmx_simd_fmadd_r(fbond_S, rikz_S, f_iz_S);
+        f_kx_S    = gmx_simd_fnmadd_r(fbond_S, rikx_S, f_kx_S);
+        f_ky_S    = gmx_simd_fnmadd_r(fbond_S, riky_S, f_ky_S);
+        f_kz_S    = gmx_simd_fnmadd_r(fbond_S, rikz_S, f_kz_S);
+
+        gmx_simd_store_r(f_buf + 0*GMX_SIMD_REAL_WIDTH, f_ix_S);
+        gmx_simd_store_r(f_buf + 1*GMX_SIMD_REAL_WIDTH, f_iy_S);
+        gmx_simd_store_r(f_buf + 2*GMX_SIMD_REAL_WIDTH, f_iz_S);
+        gmx_simd_store_r(f_buf + 3*GMX_SIMD_REAL_WIDTH, f_kx_S);
+        gmx_simd_store_r(f_buf + 4*GMX_SIMD_REAL_WIDTH, f_ky_S);
+        gmx_simd_store_r(f_buf + 5*GMX_SIMD_REAL_WIDTH, f_kz_S);
+
+        iu = i;
+        s  = 0;
+        do
+        {
+            for (m = 0; m < DIM; m++)
+            {
+                f[ai[s]][m] += f_buf[s + m*GMX_SIMD_REAL_WIDTH];
+                f[aj[s]][m] -= f_buf[s + m*GMX_SIMD_REAL_WIDTH] + f_buf[s + (DIM+m)*GMX_SIMD_REAL_WIDTH];
+                f[ak[s]][m] += f_buf[s + (DIM+m)*GMX_SIMD_REAL_WIDTH];
+            }
+            s++;
+            iu += nfa1;
+        }
+        while (s < GMX_SIMD_REAL_WIDTH && iu < nbonds);
+    }
+}
+
+#endif /* GMX_SIMD_HAVE_REAL */
+
+real quartic_angles(int nbonds,
+                    const t_iatom forceatoms[], const t_iparams forceparams[],
+                    const rvec x[], rvec f[], rvec fshift[],
+                    const t_pbc *pbc, const t_graph *g,
+                    real gmx_unused lambda, real gmx_unused *dvdlambda,
+                    const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                    int gmx_unused *global_atom_index)
+{
+    int  i, j, ai, aj, ak, t1, t2, type;
+    rvec r_ij, r_kj;
+    real cos_theta, cos_theta2, theta, dt, dVdt, va, dtp, c, vtot;
+    ivec jt, dt_ij, dt_kj;
+
+    vtot = 0.0;
+    for (i = 0; (i < nbonds); )
+    {
+        type = forceatoms[i++];
+        ai   = forceatoms[i++];
+        aj   = forceatoms[i++];
+        ak   = forceatoms[i++];
+
+        theta  = bond_angle(x[ai], x[aj], x[ak], pbc,
+                            r_ij, r_kj, &cos_theta, &t1, &t2); /*  41		*/
+
+        dt = theta - forceparams[type].qangle.theta*DEG2RAD;   /* 2          */
+
+        dVdt = 0;
+        va   = forceparams[type].qangle.c[0];
+        dtp  = 1.0;
+        for (j = 1; j <= 4; j++)
+        {
+            c     = forceparams[type].qangle.c[j];
+            dVdt -= j*c*dtp;
+            dtp  *= dt;
+            va   += c*dtp;
+        }
+        /* 20 */
+
+        vtot += va;
+
+        cos_theta2 = sqr(cos_theta);            /*   1		*/
+        if (cos_theta2 < 1)
+        {
+            int  m;
+            real st, sth;
+            real cik, cii, ckk;
+            real nrkj2, nrij2;
+            rvec f_i, f_j, f_k;
+
+            st  = dVdt*gmx_invsqrt(1 - cos_theta2); /*  12		*/
+            sth = st*cos_theta;                     /*   1		*/
+#ifdef DEBUG
+            if (debug)
+            {
+                fprintf(debug, "ANGLES: theta = %10g  vth = %10g  dV/dtheta = %10g\n",
+                        theta*RAD2DEG, va, dVdt);
+            }
+#endif
+            nrkj2 = iprod(r_kj, r_kj);  /*   5		*/
+            nrij2 = iprod(r_ij, r_ij);
 
             cik = st*gmx_invsqrt(nrkj2*nrij2); /*  12		*/
             cii = sth/nrij2;                   /*  10		*/
@@ -2295,13 +2448,18 @@ rbdihs_noener_simd(int nbonds,
 #endif /* GMX_SIMD_HAVE_REAL */
 
 
-real idihs(int nbonds,
+/*! \brief Harmonic improper dihedrals, templated on computing energies and shift forces
+ *
+ * With bCalcEnerVir=FALSE the energy and dvdl terms are not used,
+ * so the compiler can remove them.
+ */
+template <gmx_bool bCalcEnerVir>
+static real
+idihs_impl(int nbonds,
            const t_iatom forceatoms[], const t_iparams forceparams[],
            const rvec x[], rvec f[], rvec fshift[],
            const t_pbc *pbc, const t_graph *g,
-           real lambda, real *dvdlambda,
-           const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-           int gmx_unused *global_atom_index)
+           real lambda, real *dvdlambda)
 {
     int  i, type, ai, aj, ak, al;
     int  t1, t2, t3;
@@ -2350,8 +2508,15 @@ real idihs(int nbonds,
 
         dvdl_term += 0.5*(kB - kA)*dp2 - kk*dphi0*dp;
 
-        do_dih_fup(ai, aj, ak, al, -ddphi, r_ij, r_kj, r_kl, m, n,
-                   f, fshift, pbc, g, x, t1, t2, t3); /* 112		*/
+        if (bCalcEnerVir)
+        {
+            do_dih_fup(ai, aj, ak, al, -ddphi, r_ij, r_kj, r_kl, m, n,
+                       f, fshift, pbc, g, x, t1, t2, t3); /* 112		*/
+        }
+        else
+        {
+            do_dih_fup_noshiftf(ai, aj, ak, al, -ddphi, r_ij, r_kj, r_kl, m, n, f);
+        }
         /* 218 TOTAL	*/
 #ifdef DEBUG
         if (debug)
@@ -2362,56 +2527,215 @@ real idihs(int nbonds,
 #endif
     }
 
-    *dvdlambda += dvdl_term;
+    if (bCalcEnerVir)
+    {
+        *dvdlambda += dvdl_term;
+    }
     return vtot;
 }
 
-static real low_angres(int nbonds,
-                       const t_iatom forceatoms[], const t_iparams forceparams[],
-                       const rvec x[], rvec f[], rvec fshift[],
-                       const t_pbc *pbc, const t_graph *g,
-                       real lambda, real *dvdlambda,
-                       gmx_bool bZAxis)
+real idihs(int nbonds,
+           const t_iatom forceatoms[], const t_iparams forceparams[],
+           const rvec x[], rvec f[], rvec fshift[],
+           const t_pbc *pbc, const t_graph *g,
+           real lambda, real *dvdlambda,
+           const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+           int gmx_unused *global_atom_index)
 {
-    int  i, m, type, ai, aj, ak, al;
-    int  t1, t2;
-    real phi, cos_phi, cos_phi2, vid, vtot, dVdphi;
-    rvec r_ij, r_kl, f_i, f_k = {0, 0, 0};
-    real st, sth, nrij2, nrkl2, c, cij, ckl;
-
-    ivec dt;
-    t2 = 0; /* avoid warning with gcc-3.3. It is never used uninitialized */
+    return idihs_impl<TRUE>(nbonds, forceatoms, forceparams, x, f, fshift,
+                            pbc, g, lambda, dvdlambda);
+}
 
-    vtot = 0.0;
-    ak   = al = 0; /* to avoid warnings */
-    for (i = 0; i < nbonds; )
-    {
-        type = forceatoms[i++];
-        ai   = forceatoms[i++];
-        aj   = forceatoms[i++];
-        t1   = pbc_rvec_sub(pbc, x[aj], x[ai], r_ij);       /*  3		*/
-        if (!bZAxis)
-        {
-            ak   = forceatoms[i++];
-            al   = forceatoms[i++];
-            t2   = pbc_rvec_sub(pbc, x[al], x[ak], r_kl);  /*  3		*/
-        }
-        else
-        {
-            r_kl[XX] = 0;
-            r_kl[YY] = 0;
-            r_kl[ZZ] = 1;
-        }
+void idihs_noener(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec f[],
+                  const t_pbc *pbc, const t_graph *g,
+                  real lambda,
+                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                  int gmx_unused *global_atom_index)
+{
+    idihs_impl<FALSE>(nbonds, forceatoms, forceparams, x, f, NULL,
+                      pbc, g, lambda, NULL);
+}
 
-        cos_phi = cos_angle(r_ij, r_kl); /* 25		*/
-        phi     = acos(cos_phi);         /* 10           */
+#ifdef GMX_SIMD_HAVE_REAL
 
-        *dvdlambda += dopdihs_min(forceparams[type].pdihs.cpA,
-                                  forceparams[type].pdihs.cpB,
-                                  forceparams[type].pdihs.phiA,
-                                  forceparams[type].pdihs.phiB,
-                                  forceparams[type].pdihs.mult,
-                                  phi, lambda, &vid, &dVdphi); /*  40  */
+/* As idihs, but using SIMD to calculate many dihedrals at once.
+ * This routines does not calculate energies, shift forces and dvdl.
+ */
+void
+idihs_noener_simd(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec f[],
+                  const t_pbc *pbc, const t_graph gmx_unused *g,
+                  real gmx_unused lambda,
+                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                  int gmx_unused *global_atom_index)
+{
+    const int             nfa1 = 5;
+    int                   i, iu, s;
+    int                   type, ai[GMX_SIMD_REAL_WIDTH], aj[GMX_SIMD_REAL_WIDTH], ak[GMX_SIMD_REAL_WIDTH], al[GMX_SIMD_REAL_WIDTH];
+    real                  dr_array[3*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *dr;
+    real                  buf_array[4*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
+    real                 *kk, *phi0, *p, *q;
+    gmx_simd_real_t       phi0_S, phi_S;
+    gmx_simd_real_t       mx_S, my_S, mz_S;
+    gmx_simd_real_t       nx_S, ny_S, nz_S;
+    gmx_simd_real_t       nrkj_m2_S, nrkj_n2_S;
+    gmx_simd_real_t       kk_S, dp_S;
+    gmx_simd_real_t       mddphi_S;
+    gmx_simd_real_t       sf_i_S, msf_l_S;
+    gmx_simd_real_t       two_pi_S, inv_two_pi_S;
+    pbc_simd_t            pbc_simd;
+
+    /* Ensure SIMD register alignment */
+    dr  = gmx_simd_align_r(dr_array);
+    buf = gmx_simd_align_r(buf_array);
+
+    /* Extract aligned pointer for parameters and variables */
+    kk    = buf + 0*GMX_SIMD_REAL_WIDTH;
+    phi0  = buf + 1*GMX_SIMD_REAL_WIDTH;
+    p     = buf + 2*GMX_SIMD_REAL_WIDTH;
+    q     = buf + 3*GMX_SIMD_REAL_WIDTH;
+
+    two_pi_S     = gmx_simd_set1_r(2*M_PI);
+    inv_two_pi_S = gmx_simd_set1_r(1/(2*M_PI));
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms quadruplets for GMX_SIMD_REAL_WIDTH dihedrals.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+            al[s] = forceatoms[iu+4];
+
+            kk[s]   = forceparams[type].harmonic.krA;
+            phi0[s] = forceparams[type].harmonic.rA*DEG2RAD;
+
+            /* At the end fill the arrays with identical entries */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+
+        /* Caclulate GMX_SIMD_REAL_WIDTH dihedral angles at once */
+        dih_angle_simd(x, ai, aj, ak, al, &pbc_simd,
+                       dr,
+                       &phi_S,
+                       &mx_S, &my_S, &mz_S,
+                       &nx_S, &ny_S, &nz_S,
+                       &nrkj_m2_S,
+                       &nrkj_n2_S,
+                       p, q);
+
+        kk_S     = gmx_simd_load_r(kk);
+        phi0_S   = gmx_simd_load_r(phi0);
+
+        /* Put phi-phi0 in (-pi,pi), as make_dp_periodic does */
+        dp_S     = gmx_simd_sub_r(phi_S, phi0_S);
+        dp_S     = gmx_simd_fnmadd_r(two_pi_S,
+                                     gmx_simd_round_r(gmx_simd_mul_r(dp_S, inv_two_pi_S)),
+                                     dp_S);
+
+        mddphi_S = gmx_simd_mul_r(gmx_simd_fneg_r(kk_S), dp_S);
+        sf_i_S   = gmx_simd_mul_r(mddphi_S, nrkj_m2_S);
+        msf_l_S  = gmx_simd_mul_r(mddphi_S, nrkj_n2_S);
+
+        /* After this m?_S will contain f[i] */
+        mx_S     = gmx_simd_mul_r(sf_i_S, mx_S);
+        my_S     = gmx_simd_mul_r(sf_i_S, my_S);
+        mz_S     = gmx_simd_mul_r(sf_i_S, mz_S);
+
+        /* After this m?_S will contain -f[l] */
+        nx_S     = gmx_simd_mul_r(msf_l_S, nx_S);
+        ny_S     = gmx_simd_mul_r(msf_l_S, ny_S);
+        nz_S     = gmx_simd_mul_r(msf_l_S, nz_S);
+
+        gmx_simd_store_r(dr + 0*GMX_SIMD_REAL_WIDTH, mx_S);
+        gmx_simd_store_r(dr + 1*GMX_SIMD_REAL_WIDTH, my_S);
+        gmx_simd_store_r(dr + 2*GMX_SIMD_REAL_WIDTH, mz_S);
+        gmx_simd_store_r(dr + 3*GMX_SIMD_REAL_WIDTH, nx_S);
+        gmx_simd_store_r(dr + 4*GMX_SIMD_REAL_WIDTH, ny_S);
+        gmx_simd_store_r(dr + 5*GMX_SIMD_REAL_WIDTH, nz_S);
+
+        iu = i;
+        s  = 0;
+        do
+        {
+            do_dih_fup_noshiftf_precalc(ai[s], aj[s], ak[s], al[s],
+                                        p[s], q[s],
+                                        dr[     XX *GMX_SIMD_REAL_WIDTH+s],
+                                        dr[     YY *GMX_SIMD_REAL_WIDTH+s],
+                                        dr[     ZZ *GMX_SIMD_REAL_WIDTH+s],
+                                        dr[(DIM+XX)*GMX_SIMD_REAL_WIDTH+s],
+                                        dr[(DIM+YY)*GMX_SIMD_REAL_WIDTH+s],
+                                        dr[(DIM+ZZ)*GMX_SIMD_REAL_WIDTH+s],
+                                        f);
+            s++;
+            iu += nfa1;
+        }
+        while (s < GMX_SIMD_REAL_WIDTH && iu < nbonds);
+    }
+}
+
+#endif /* GMX_SIMD_HAVE_REAL */
+
+static real low_angres(int nbonds,
+                       const t_iatom forceatoms[], const t_iparams forceparams[],
+                       const rvec x[], rvec f[], rvec fshift[],
+                       const t_pbc *pbc, const t_graph *g,
+                       real lambda, real *dvdlambda,
+                       gmx_bool bZAxis)
+{
+    int  i, m, type, ai, aj, ak, al;
+    int  t1, t2;
+    real phi, cos_phi, cos_phi2, vid, vtot, dVdphi;
+    rvec r_ij, r_kl, f_i, f_k = {0, 0, 0};
+    real st, sth, nrij2, nrkl2, c, cij, ckl;
+
+    ivec dt;
+    t2 = 0; /* avoid warning with gcc-3.3. It is never used uninitialized */
+
+    vtot = 0.0;
+    ak   = al = 0; /* to avoid warnings */
+    for (i = 0; i < nbonds; )
+    {
+        type = forceatoms[i++];
+        ai   = forceatoms[i++];
+        aj   = forceatoms[i++];
+        t1   = pbc_rvec_sub(pbc, x[aj], x[ai], r_ij);       /*  3		*/
+        if (!bZAxis)
+        {
+            ak   = forceatoms[i++];
+            al   = forceatoms[i++];
+            t2   = pbc_rvec_sub(pbc, x[al], x[ak], r_kl);  /*  3		*/
+        }
+        else
+        {
+            r_kl[XX] = 0;
+            r_kl[YY] = 0;
+            r_kl[ZZ] = 1;
+        }
+
+        cos_phi = cos_angle(r_ij, r_kl); /* 25		*/
+        phi     = acos(cos_phi);         /* 10           */
+
+        *dvdlambda += dopdihs_min(forceparams[type].pdihs.cpA,
+                                  forceparams[type].pdihs.cpB,
+                                  forceparams[type].pdihs.phiA,
+                                  forceparams[type].pdihs.phiB,
+                                  forceparams[type].pdihs.mult,
+                                  phi, lambda, &vid, &dVdphi); /*  40  */
 
         vtot += vid;
 
@@ -2698,6 +3022,141 @@ real restrangles(int nbonds,
 }
 
 
+#ifdef GMX_SIMD_HAVE_REAL
+
+/* As restrangles, but using SIMD to calculate many angles at once.
+ * This routines does not calculate energies and shift forces.
+ */
+void
+restrangles_noener_simd(int nbonds,
+                        const t_iatom forceatoms[], const t_iparams forceparams[],
+                        const rvec x[], rvec f[],
+                        const t_pbc *pbc, const t_graph gmx_unused *g,
+                        real gmx_unused lambda,
+                        const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                        int gmx_unused *global_atom_index)
+{
+    const int            nfa1 = 4;
+    int                  i, iu, s, m;
+    int                  type, ai[GMX_SIMD_REAL_WIDTH], aj[GMX_SIMD_REAL_WIDTH];
+    int                  ak[GMX_SIMD_REAL_WIDTH];
+    real                 coeff_array[2*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *coeff;
+    real                 dr_array[2*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *dr;
+    real                 f_buf_array[6*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *f_buf;
+    gmx_simd_real_t      k_S, cos_eq_S;
+    gmx_simd_real_t      dax_S, day_S, daz_S;
+    gmx_simd_real_t      dpx_S, dpy_S, dpz_S;
+    gmx_simd_real_t      one_S;
+    gmx_simd_real_t      c_ante_S, c_cros_S, c_post_S;
+    gmx_simd_real_t      norm_S, cos_S, sin2_S;
+    gmx_simd_real_t      ratio_ante_S, ratio_post_S;
+    gmx_simd_real_t      prefactor_S;
+    gmx_simd_real_t      f_ix_S, f_iy_S, f_iz_S;
+    gmx_simd_real_t      f_kx_S, f_ky_S, f_kz_S;
+    pbc_simd_t           pbc_simd;
+
+    /* Ensure register memory alignment */
+    coeff = gmx_simd_align_r(coeff_array);
+    dr    = gmx_simd_align_r(dr_array);
+    f_buf = gmx_simd_align_r(f_buf_array);
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    one_S = gmx_simd_set1_r(1.0);
+
+    /* nbonds is the number of angles times nfa1, here we step GMX_SIMD_REAL_WIDTH angles */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms for GMX_SIMD_REAL_WIDTH angles.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+
+            /* As in compute_factors_restangles, the angle is measured
+             * between the two bond vectors, so we use the cosine of pi-theta0.
+             */
+            coeff[s]                     = forceparams[type].harmonic.krA;
+            coeff[GMX_SIMD_REAL_WIDTH+s] = cos(M_PI - forceparams[type].harmonic.rA*DEG2RAD);
+
+            /* At the end fill the arrays with identical entries */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+
+        /* Store the non PBC corrected distances packed and aligned */
+        gmx_hack_simd_gather_rvec_dist_two_index(x, aj, ai, dr,
+                                                 &dax_S, &day_S, &daz_S);
+        gmx_hack_simd_gather_rvec_dist_two_index(x, ak, aj, dr + 3*GMX_SIMD_REAL_WIDTH,
+                                                 &dpx_S, &dpy_S, &dpz_S);
+
+        k_S          = gmx_simd_load_r(coeff);
+        cos_eq_S     = gmx_simd_load_r(coeff+GMX_SIMD_REAL_WIDTH);
+
+        pbc_correct_dx_simd(&dax_S, &day_S, &daz_S, &pbc_simd);
+        pbc_correct_dx_simd(&dpx_S, &dpy_S, &dpz_S, &pbc_simd);
+
+        c_ante_S     = gmx_simd_norm2_r(dax_S, day_S, daz_S);
+        c_cros_S     = gmx_simd_iprod_r(dax_S, day_S, daz_S,
+                                        dpx_S, dpy_S, dpz_S);
+        c_post_S     = gmx_simd_norm2_r(dpx_S, dpy_S, dpz_S);
+
+        norm_S       = gmx_simd_invsqrt_r(gmx_simd_mul_r(c_ante_S, c_post_S));
+        cos_S        = gmx_simd_mul_r(c_cros_S, norm_S);
+        sin2_S       = gmx_simd_fnmadd_r(cos_S, cos_S, one_S);
+
+        ratio_ante_S = gmx_simd_mul_r(c_cros_S, gmx_simd_inv_r(c_ante_S));
+        ratio_post_S = gmx_simd_mul_r(c_cros_S, gmx_simd_inv_r(c_post_S));
+
+        /* -k (cos - cos_eq) norm (1 - cos cos_eq)/sin^4 */
+        prefactor_S  = gmx_simd_mul_r(gmx_simd_fneg_r(k_S),
+                                      gmx_simd_sub_r(cos_S, cos_eq_S));
+        prefactor_S  = gmx_simd_mul_r(prefactor_S,
+                                      gmx_simd_mul_r(norm_S,
+                                                     gmx_simd_fnmadd_r(cos_S, cos_eq_S, one_S)));
+        prefactor_S  = gmx_simd_mul_r(prefactor_S,
+                                      gmx_simd_inv_r(gmx_simd_mul_r(sin2_S, sin2_S)));
+
+        f_ix_S       = gmx_simd_mul_r(prefactor_S, gmx_simd_fmsub_r(ratio_ante_S, dax_S, dpx_S));
+        f_iy_S       = gmx_simd_mul_r(prefactor_S, gmx_simd_fmsub_r(ratio_ante_S, day_S, dpy_S));
+        f_iz_S       = gmx_simd_mul_r(prefactor_S, gmx_simd_fmsub_r(ratio_ante_S, daz_S, dpz_S));
+        f_kx_S       = gmx_simd_mul_r(prefactor_S, gmx_simd_fnmadd_r(ratio_post_S, dpx_S, dax_S));
+        f_ky_S       = gmx_simd_mul_r(prefactor_S, gmx_simd_fnmadd_r(ratio_post_S, dpy_S, day_S));
+        f_kz_S       = gmx_simd_mul_r(prefactor_S, gmx_simd_fnmadd_r(ratio_post_S, dpz_S, daz_S));
+
+        gmx_simd_store_r(f_buf + 0*GMX_SIMD_REAL_WIDTH, f_ix_S);
+        gmx_simd_store_r(f_buf + 1*GMX_SIMD_REAL_WIDTH, f_iy_S);
+        gmx_simd_store_r(f_buf + 2*GMX_SIMD_REAL_WIDTH, f_iz_S);
+        gmx_simd_store_r(f_buf + 3*GMX_SIMD_REAL_WIDTH, f_kx_S);
+        gmx_simd_store_r(f_buf + 4*GMX_SIMD_REAL_WIDTH, f_ky_S);
+        gmx_simd_store_r(f_buf + 5*GMX_SIMD_REAL_WIDTH, f_kz_S);
+
+        iu = i;
+        s  = 0;
+        do
+        {
+            for (m = 0; m < DIM; m++)
+            {
+                f[ai[s]][m] += f_buf[s + m*GMX_SIMD_REAL_WIDTH];
+                f[aj[s]][m] -= f_buf[s + m*GMX_SIMD_REAL_WIDTH] + f_buf[s + (DIM+m)*GMX_SIMD_REAL_WIDTH];
+                f[ak[s]][m] += f_buf[s + (DIM+m)*GMX_SIMD_REAL_WIDTH];
+            }
+            s++;
+            iu += nfa1;
+        }
+        while (s < GMX_SIMD_REAL_WIDTH && iu < nbonds);
+    }
+}
+
+#endif /* GMX_SIMD_HAVE_REAL */
+
 real restrdihs(int nbonds,
                const t_iatom forceatoms[], const t_iparams forceparams[],
                const rvec x[], rvec f[], rvec fshift[],
@@ -2914,13 +3373,442 @@ real cbtdihs(int nbonds,
     return vtot;
 }
 
-real rbdihs(int nbonds,
+#ifdef GMX_SIMD_HAVE_REAL
+
+/*! \brief Computes the dihedral terms shared by the restricted and CBT dihedrals
+ *
+ * The differences of the four positions are passed in \p da, \p dc and
+ * \p dp, as delta_ante, delta_crnt and delta_post in restcbt.cpp.
+ * Returns the scalar products needed for the bending angles of the CBT
+ * potential, the cosine of the dihedral and its normalization, and in
+ * \p fac the factors of the derivatives of phi, as in
+ * compute_factors_restrdihs, stored per atom as ante, crnt, post.
+ */
+static gmx_inline void gmx_simdcall
+restcbt_dihedral_factors_simd(gmx_simd_real_t  dax, gmx_simd_real_t day, gmx_simd_real_t daz,
+                              gmx_simd_real_t  dcx, gmx_simd_real_t dcy, gmx_simd_real_t dcz,
+                              gmx_simd_real_t  dpx, gmx_simd_real_t dpy, gmx_simd_real_t dpz,
+                              gmx_simd_real_t *c_self_ante, gmx_simd_real_t *c_self_crnt,
+                              gmx_simd_real_t *c_self_post,
+                              gmx_simd_real_t *c_cros_ante, gmx_simd_real_t *c_cros_post,
+                              gmx_simd_real_t *norm_phi, gmx_simd_real_t *cos_phi,
+                              gmx_simd_real_t  fac[4*DIM])
+{
+    const gmx_simd_real_t eps_S = gmx_simd_set1_r(GMX_REAL_EPS);
+    const gmx_simd_real_t two_S = gmx_simd_set1_r(2.0);
+    gmx_simd_real_t       c_cros_acrs, c_prod, d_ante, d_post;
+    gmx_simd_real_t       ratio_ante, ratio_post;
+
+    *c_self_ante = gmx_simd_norm2_r(dax, day, daz);
+    *c_self_crnt = gmx_simd_norm2_r(dcx, dcy, dcz);
+    *c_self_post = gmx_simd_norm2_r(dpx, dpy, dpz);
+    *c_cros_ante = gmx_simd_iprod_r(dax, day, daz, dcx, dcy, dcz);
+    c_cros_acrs  = gmx_simd_iprod_r(dax, day, daz, dpx, dpy, dpz);
+    *c_cros_post = gmx_simd_iprod_r(dcx, dcy, dcz, dpx, dpy, dpz);
+    c_prod       = gmx_simd_fmsub_r(*c_cros_ante, *c_cros_post,
+                                    gmx_simd_mul_r(*c_self_crnt, c_cros_acrs));
+    d_ante       = gmx_simd_fmsub_r(*c_self_ante, *c_self_crnt,
+                                    gmx_simd_mul_r(*c_cros_ante, *c_cros_ante));
+    d_post       = gmx_simd_fmsub_r(*c_self_post, *c_self_crnt,
+                                    gmx_simd_mul_r(*c_cros_post, *c_cros_post));
+
+    /* Clamp for aligned beads as the conditionals in restcbt.cpp do */
+    d_ante       = gmx_simd_max_r(d_ante, eps_S);
+    d_post       = gmx_simd_max_r(d_post, eps_S);
+
+    *norm_phi    = gmx_simd_invsqrt_r(gmx_simd_mul_r(d_ante, d_post));
+    *cos_phi     = gmx_simd_mul_r(c_prod, *norm_phi);
+
+    ratio_ante   = gmx_simd_mul_r(c_prod, gmx_simd_inv_r(d_ante));
+    ratio_post   = gmx_simd_mul_r(c_prod, gmx_simd_inv_r(d_post));
+
+    /* Atom ai */
+    fac[0]  = gmx_simd_mul_r(ratio_ante, *c_self_crnt);
+    fac[1]  = gmx_simd_fnmsub_r(ratio_ante, *c_cros_ante, *c_cros_post);
+    fac[2]  = *c_self_crnt;
+    /* Atom aj */
+    fac[3]  = gmx_simd_fnmsub_r(ratio_ante, gmx_simd_add_r(*c_self_crnt, *c_cros_ante),
+                                *c_cros_post);
+    fac[4]  = gmx_simd_fmadd_r(ratio_post, *c_self_post,
+                               gmx_simd_fmadd_r(ratio_ante, gmx_simd_add_r(*c_self_ante, *c_cros_ante),
+                                                gmx_simd_fmadd_r(two_S, c_cros_acrs, *c_cros_post)));
+    fac[5]  = gmx_simd_fnmsub_r(ratio_post, *c_cros_post,
+                                gmx_simd_add_r(*c_cros_ante, *c_self_crnt));
+    /* Atom ak */
+    fac[6]  = gmx_simd_fmadd_r(ratio_ante, *c_cros_ante,
+                               gmx_simd_add_r(*c_cros_post, *c_self_crnt));
+    fac[7]  = gmx_simd_fnmsub_r(ratio_post, gmx_simd_add_r(*c_self_post, *c_cros_post),
+                                gmx_simd_fmadd_r(ratio_ante, *c_self_ante,
+                                                 gmx_simd_fmadd_r(two_S, c_cros_acrs, *c_cros_ante)));
+    fac[8]  = gmx_simd_fmadd_r(ratio_post, gmx_simd_add_r(*c_self_crnt, *c_cros_post),
+                               *c_cros_ante);
+    /* Atom al */
+    fac[9]  = gmx_simd_fneg_r(*c_self_crnt);
+    fac[10] = gmx_simd_fmadd_r(ratio_post, *c_cros_post, *c_cros_ante);
+    fac[11] = gmx_simd_fneg_r(gmx_simd_mul_r(ratio_post, *c_self_crnt));
+}
+
+/*! \brief Stores the forces fac[ante]*da + fac[crnt]*dc + fac[post]*dp on four atoms
+ *
+ * The forces are stored in \p f_buf per atom and dimension, each with
+ * GMX_SIMD_REAL_WIDTH entries.
+ */
+static gmx_inline void gmx_simdcall
+restcbt_store_forces_simd(const gmx_simd_real_t fac[4*DIM],
+                          gmx_simd_real_t dax, gmx_simd_real_t day, gmx_simd_real_t daz,
+                          gmx_simd_real_t dcx, gmx_simd_real_t dcy, gmx_simd_real_t dcz,
+                          gmx_simd_real_t dpx, gmx_simd_real_t dpy, gmx_simd_real_t dpz,
+                          real *f_buf)
+{
+    int a;
+
+    for (a = 0; a < 4; a++)
+    {
+        const gmx_simd_real_t f_ante = fac[a*DIM + 0];
+        const gmx_simd_real_t f_crnt = fac[a*DIM + 1];
+        const gmx_simd_real_t f_post = fac[a*DIM + 2];
+
+        gmx_simd_store_r(f_buf + (a*DIM + XX)*GMX_SIMD_REAL_WIDTH,
+                         gmx_simd_fmadd_r(f_ante, dax, gmx_simd_fmadd_r(f_crnt, dcx, gmx_simd_mul_r(f_post, dpx))));
+        gmx_simd_store_r(f_buf + (a*DIM + YY)*GMX_SIMD_REAL_WIDTH,
+                         gmx_simd_fmadd_r(f_ante, day, gmx_simd_fmadd_r(f_crnt, dcy, gmx_simd_mul_r(f_post, dpy))));
+        gmx_simd_store_r(f_buf + (a*DIM + ZZ)*GMX_SIMD_REAL_WIDTH,
+                         gmx_simd_fmadd_r(f_ante, daz, gmx_simd_fmadd_r(f_crnt, dcz, gmx_simd_mul_r(f_post, dpz))));
+    }
+}
+
+/* As restrdihs, but using SIMD to calculate many dihedrals at once.
+ * This routines does not calculate energies and shift forces.
+ */
+void
+restrdihs_noener_simd(int nbonds,
+                      const t_iatom forceatoms[], const t_iparams forceparams[],
+                      const rvec x[], rvec f[],
+                      const t_pbc *pbc, const t_graph gmx_unused *g,
+                      real gmx_unused lambda,
+                      const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                      int gmx_unused *global_atom_index)
+{
+    const int            nfa1 = 5;
+    int                  i, iu, s, m, n;
+    int                  type, ai[GMX_SIMD_REAL_WIDTH], aj[GMX_SIMD_REAL_WIDTH];
+    int                  ak[GMX_SIMD_REAL_WIDTH], al[GMX_SIMD_REAL_WIDTH];
+    real                 coeff_array[2*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *coeff;
+    real                 dr_array[3*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *dr;
+    real                 f_buf_array[4*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *f_buf;
+    gmx_simd_real_t      k_S, cos_eq_S;
+    gmx_simd_real_t      dax_S, day_S, daz_S;
+    gmx_simd_real_t      dcx_S, dcy_S, dcz_S;
+    gmx_simd_real_t      dpx_S, dpy_S, dpz_S;
+    gmx_simd_real_t      zero_S, one_S;
+    gmx_simd_real_t      c_self_ante_S, c_self_crnt_S, c_self_post_S;
+    gmx_simd_real_t      c_cros_ante_S, c_cros_post_S;
+    gmx_simd_real_t      norm_phi_S, cos_phi_S, sin2_phi_S;
+    gmx_simd_real_t      prefactor_S;
+    gmx_simd_real_t      fac_S[4*DIM];
+    pbc_simd_t           pbc_simd;
+
+    /* Ensure register memory alignment */
+    coeff = gmx_simd_align_r(coeff_array);
+    dr    = gmx_simd_align_r(dr_array);
+    f_buf = gmx_simd_align_r(f_buf_array);
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    zero_S = gmx_simd_setzero_r();
+    one_S  = gmx_simd_set1_r(1.0);
+
+    /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms for GMX_SIMD_REAL_WIDTH dihedrals.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+            al[s] = forceatoms[iu+4];
+
+            coeff[s]                     = forceparams[type].pdihs.cpA;
+            coeff[GMX_SIMD_REAL_WIDTH+s] = cos(forceparams[type].pdihs.phiA*DEG2RAD);
+
+            /* At the end fill the arrays with identical entries */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+
+        /* Store the non PBC corrected distances packed and aligned */
+        gmx_hack_simd_gather_rvec_dist_two_index(x, aj, ai, dr,
+                                                 &dax_S, &day_S, &daz_S);
+        gmx_hack_simd_gather_rvec_dist_two_index(x, ak, aj, dr + 3*GMX_SIMD_REAL_WIDTH,
+                                                 &dcx_S, &dcy_S, &dcz_S);
+        gmx_hack_simd_gather_rvec_dist_two_index(x, al, ak, dr + 6*GMX_SIMD_REAL_WIDTH,
+                                                 &dpx_S, &dpy_S, &dpz_S);
+
+        k_S        = gmx_simd_load_r(coeff);
+        cos_eq_S   = gmx_simd_load_r(coeff+GMX_SIMD_REAL_WIDTH);
+
+        pbc_correct_dx_simd(&dax_S, &day_S, &daz_S, &pbc_simd);
+        pbc_correct_dx_simd(&dcx_S, &dcy_S, &dcz_S, &pbc_simd);
+        pbc_correct_dx_simd(&dpx_S, &dpy_S, &dpz_S, &pbc_simd);
+
+        restcbt_dihedral_factors_simd(dax_S, day_S, daz_S,
+                                      dcx_S, dcy_S, dcz_S,
+                                      dpx_S, dpy_S, dpz_S,
+                                      &c_self_ante_S, &c_self_crnt_S, &c_self_post_S,
+                                      &c_cros_ante_S, &c_cros_post_S,
+                                      &norm_phi_S, &cos_phi_S, fac_S);
+
+        /* cos(phi) can be slightly larger than 1 due to rounding */
+        sin2_phi_S  = gmx_simd_max_r(gmx_simd_fnmadd_r(cos_phi_S, cos_phi_S, one_S), zero_S);
+
+        /* -k (cos - cos_eq) norm (1 - cos cos_eq)/sin^4 */
+        prefactor_S = gmx_simd_mul_r(gmx_simd_fneg_r(k_S),
+                                     gmx_simd_sub_r(cos_phi_S, cos_eq_S));
+        prefactor_S = gmx_simd_mul_r(prefactor_S,
+                                     gmx_simd_mul_r(norm_phi_S,
+                                                    gmx_simd_fnmadd_r(cos_phi_S, cos_eq_S, one_S)));
+        prefactor_S = gmx_simd_mul_r(prefactor_S,
+                                     gmx_simd_inv_r(gmx_simd_mul_r(sin2_phi_S, sin2_phi_S)));
+
+        for (n = 0; n < 4*DIM; n++)
+        {
+            fac_S[n] = gmx_simd_mul_r(prefactor_S, fac_S[n]);
+        }
+
+        restcbt_store_forces_simd(fac_S,
+                                  dax_S, day_S, daz_S,
+                                  dcx_S, dcy_S, dcz_S,
+                                  dpx_S, dpy_S, dpz_S,
+                                  f_buf);
+
+        iu = i;
+        s  = 0;
+        do
+        {
+            for (m = 0; m < DIM; m++)
+            {
+                f[ai[s]][m] += f_buf[s + (0*DIM+m)*GMX_SIMD_REAL_WIDTH];
+                f[aj[s]][m] += f_buf[s + (1*DIM+m)*GMX_SIMD_REAL_WIDTH];
+                f[ak[s]][m] += f_buf[s + (2*DIM+m)*GMX_SIMD_REAL_WIDTH];
+                f[al[s]][m] += f_buf[s + (3*DIM+m)*GMX_SIMD_REAL_WIDTH];
+            }
+            s++;
+            iu += nfa1;
+        }
+        while (s < GMX_SIMD_REAL_WIDTH && iu < nbonds);
+    }
+}
+
+/* As cbtdihs, but using SIMD to calculate many dihedrals at once.
+ * This routines does not calculate energies and shift forces.
+ */
+void
+cbtdihs_noener_simd(int nbonds,
+                    const t_iatom forceatoms[], const t_iparams forceparams[],
+                    const rvec x[], rvec f[],
+                    const t_pbc *pbc, const t_graph gmx_unused *g,
+                    real gmx_unused lambda,
+                    const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                    int gmx_unused *global_atom_index)
+{
+    const int            nfa1 = 5;
+    int                  i, iu, s, m, n, j;
+    int                  type, ai[GMX_SIMD_REAL_WIDTH], aj[GMX_SIMD_REAL_WIDTH];
+    int                  ak[GMX_SIMD_REAL_WIDTH], al[GMX_SIMD_REAL_WIDTH];
+    real                 coeff_array[NR_CBTDIHS*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *coeff;
+    real                 dr_array[3*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *dr;
+    real                 f_buf_array[4*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *f_buf;
+    gmx_simd_real_t      c_S[NR_CBTDIHS];
+    gmx_simd_real_t      dax_S, day_S, daz_S;
+    gmx_simd_real_t      dcx_S, dcy_S, dcz_S;
+    gmx_simd_real_t      dpx_S, dpy_S, dpz_S;
+    gmx_simd_real_t      zero_S, one_S, two_S, three_S, four_S;
+    gmx_simd_real_t      c_self_ante_S, c_self_crnt_S, c_self_post_S;
+    gmx_simd_real_t      c_cros_ante_S, c_cros_post_S;
+    gmx_simd_real_t      norm_phi_S, cos_phi_S, norm_ante_S, norm_post_S;
+    gmx_simd_real_t      cos_ante_S, cos_post_S, sin2_ante_S, sin2_post_S;
+    gmx_simd_real_t      sin_ante_S, sin_post_S, sin3_ante_S, sin3_post_S;
+    gmx_simd_real_t      poly_S, dpoly_S;
+    gmx_simd_real_t      prefactor_phi_S, prefactor_ante_S, prefactor_post_S;
+    gmx_simd_real_t      ratio_ante_ante_S, ratio_ante_crnt_S;
+    gmx_simd_real_t      ratio_post_crnt_S, ratio_post_post_S;
+    gmx_simd_real_t      fac_S[4*DIM];
+    pbc_simd_t           pbc_simd;
+
+    /* Ensure register memory alignment */
+    coeff = gmx_simd_align_r(coeff_array);
+    dr    = gmx_simd_align_r(dr_array);
+    f_buf = gmx_simd_align_r(f_buf_array);
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    zero_S  = gmx_simd_setzero_r();
+    one_S   = gmx_simd_set1_r(1.0);
+    two_S   = gmx_simd_set1_r(2.0);
+    three_S = gmx_simd_set1_r(3.0);
+    four_S  = gmx_simd_set1_r(4.0);
+
+    /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms for GMX_SIMD_REAL_WIDTH dihedrals.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+            al[s] = forceatoms[iu+4];
+
+            for (j = 0; j < NR_CBTDIHS; j++)
+            {
+                coeff[j*GMX_SIMD_REAL_WIDTH+s] = forceparams[type].cbtdihs.cbtcA[j];
+            }
+
+            /* At the end fill the arrays with identical entries */
+            if (iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+
+        /* Store the non PBC corrected distances packed and aligned */
+        gmx_hack_simd_gather_rvec_dist_two_index(x, aj, ai, dr,
+                                                 &dax_S, &day_S, &daz_S);
+        gmx_hack_simd_gather_rvec_dist_two_index(x, ak, aj, dr + 3*GMX_SIMD_REAL_WIDTH,
+                                                 &dcx_S, &dcy_S, &dcz_S);
+        gmx_hack_simd_gather_rvec_dist_two_index(x, al, ak, dr + 6*GMX_SIMD_REAL_WIDTH,
+                                                 &dpx_S, &dpy_S, &dpz_S);
+
+        for (j = 0; j < NR_CBTDIHS; j++)
+        {
+            c_S[j] = gmx_simd_load_r(coeff + j*GMX_SIMD_REAL_WIDTH);
+        }
+
+        pbc_correct_dx_simd(&dax_S, &day_S, &daz_S, &pbc_simd);
+        pbc_correct_dx_simd(&dcx_S, &dcy_S, &dcz_S, &pbc_simd);
+        pbc_correct_dx_simd(&dpx_S, &dpy_S, &dpz_S, &pbc_simd);
+
+        restcbt_dihedral_factors_simd(dax_S, day_S, daz_S,
+                                      dcx_S, dcy_S, dcz_S,
+                                      dpx_S, dpy_S, dpz_S,
+                                      &c_self_ante_S, &c_self_crnt_S, &c_self_post_S,
+                                      &c_cros_ante_S, &c_cros_post_S,
+                                      &norm_phi_S, &cos_phi_S, fac_S);
+
+        /* The two bending angles, cos(theta) can be slightly larger
+         * than 1 due to rounding.
+         */
+        norm_ante_S = gmx_simd_invsqrt_r(gmx_simd_mul_r(c_self_ante_S, c_self_crnt_S));
+        norm_post_S = gmx_simd_invsqrt_r(gmx_simd_mul_r(c_self_crnt_S, c_self_post_S));
+        cos_ante_S  = gmx_simd_mul_r(c_cros_ante_S, norm_ante_S);
+        cos_post_S  = gmx_simd_mul_r(c_cros_post_S, norm_post_S);
+        sin2_ante_S = gmx_simd_max_r(gmx_simd_fnmadd_r(cos_ante_S, cos_ante_S, one_S), zero_S);
+        sin2_post_S = gmx_simd_max_r(gmx_simd_fnmadd_r(cos_post_S, cos_post_S, one_S), zero_S);
+        sin_ante_S  = gmx_simd_sqrt_r(sin2_ante_S);
+        sin_post_S  = gmx_simd_sqrt_r(sin2_post_S);
+        sin3_ante_S = gmx_simd_mul_r(sin2_ante_S, sin_ante_S);
+        sin3_post_S = gmx_simd_mul_r(sin2_post_S, sin_post_S);
+
+        /* The torsion polynomial c1 + c2 cos + ... + c5 cos^4 and its derivative */
+        poly_S  = gmx_simd_fmadd_r(cos_phi_S, c_S[5], c_S[4]);
+        poly_S  = gmx_simd_fmadd_r(cos_phi_S, poly_S, c_S[3]);
+        poly_S  = gmx_simd_fmadd_r(cos_phi_S, poly_S, c_S[2]);
+        poly_S  = gmx_simd_fmadd_r(cos_phi_S, poly_S, c_S[1]);
+        dpoly_S = gmx_simd_fmadd_r(cos_phi_S, gmx_simd_mul_r(four_S, c_S[5]),
+                                   gmx_simd_mul_r(three_S, c_S[4]));
+        dpoly_S = gmx_simd_fmadd_r(cos_phi_S, dpoly_S, gmx_simd_mul_r(two_S, c_S[3]));
+        dpoly_S = gmx_simd_fmadd_r(cos_phi_S, dpoly_S, c_S[2]);
+
+        /* -c0 norm_phi dpoly sin^3(theta_ante) sin^3(theta_post) */
+        prefactor_phi_S  = gmx_simd_mul_r(gmx_simd_fneg_r(c_S[0]),
+                                          gmx_simd_mul_r(norm_phi_S, dpoly_S));
+        prefactor_phi_S  = gmx_simd_mul_r(prefactor_phi_S,
+                                          gmx_simd_mul_r(sin3_ante_S, sin3_post_S));
+
+        /* 3 c0 norm_theta poly cos(theta) sin(theta) sin^3(other theta) */
+        prefactor_ante_S = gmx_simd_mul_r(gmx_simd_mul_r(three_S, c_S[0]), poly_S);
+        prefactor_post_S = gmx_simd_mul_r(prefactor_ante_S,
+                                          gmx_simd_mul_r(sin3_ante_S, sin_post_S));
+        prefactor_ante_S = gmx_simd_mul_r(prefactor_ante_S,
+                                          gmx_simd_mul_r(sin_ante_S, sin3_post_S));
+        prefactor_ante_S = gmx_simd_mul_r(prefactor_ante_S,
+                                          gmx_simd_mul_r(cos_ante_S, norm_ante_S));
+        prefactor_post_S = gmx_simd_mul_r(prefactor_post_S,
+                                          gmx_simd_mul_r(cos_post_S, norm_post_S));
+
+        ratio_ante_ante_S = gmx_simd_mul_r(c_cros_ante_S, gmx_simd_inv_r(c_self_ante_S));
+        ratio_ante_crnt_S = gmx_simd_mul_r(c_cros_ante_S, gmx_simd_inv_r(c_self_crnt_S));
+        ratio_post_crnt_S = gmx_simd_mul_r(c_cros_post_S, gmx_simd_inv_r(c_self_crnt_S));
+        ratio_post_post_S = gmx_simd_mul_r(c_cros_post_S, gmx_simd_inv_r(c_self_post_S));
+
+        for (n = 0; n < 4*DIM; n++)
+        {
+            fac_S[n] = gmx_simd_mul_r(prefactor_phi_S, fac_S[n]);
+        }
+
+        /* Add the derivatives of the bending angles, as in compute_factors_cbtdihs */
+        fac_S[0]  = gmx_simd_fmadd_r(prefactor_ante_S, ratio_ante_ante_S, fac_S[0]);
+        fac_S[1]  = gmx_simd_sub_r(fac_S[1], prefactor_ante_S);
+        fac_S[3]  = gmx_simd_fnmadd_r(prefactor_ante_S, gmx_simd_add_r(ratio_ante_ante_S, one_S), fac_S[3]);
+        fac_S[4]  = gmx_simd_fmadd_r(prefactor_ante_S, gmx_simd_add_r(ratio_ante_crnt_S, one_S), fac_S[4]);
+        fac_S[4]  = gmx_simd_fmadd_r(prefactor_post_S, ratio_post_crnt_S, fac_S[4]);
+        fac_S[5]  = gmx_simd_sub_r(fac_S[5], prefactor_post_S);
+        fac_S[6]  = gmx_simd_add_r(fac_S[6], prefactor_ante_S);
+        fac_S[7]  = gmx_simd_fnmadd_r(prefactor_ante_S, ratio_ante_crnt_S, fac_S[7]);
+        fac_S[7]  = gmx_simd_fnmadd_r(prefactor_post_S, gmx_simd_add_r(ratio_post_crnt_S, one_S), fac_S[7]);
+        fac_S[8]  = gmx_simd_fmadd_r(prefactor_post_S, gmx_simd_add_r(ratio_post_post_S, one_S), fac_S[8]);
+        fac_S[10] = gmx_simd_add_r(fac_S[10], prefactor_post_S);
+        fac_S[11] = gmx_simd_fnmadd_r(prefactor_post_S, ratio_post_post_S, fac_S[11]);
+
+        restcbt_store_forces_simd(fac_S,
+                                  dax_S, day_S, daz_S,
+                                  dcx_S, dcy_S, dcz_S,
+                                  dpx_S, dpy_S, dpz_S,
+                                  f_buf);
+
+        iu = i;
+        s  = 0;
+        do
+        {
+            for (m = 0; m < DIM; m++)
+            {
+                f[ai[s]][m] += f_buf[s + (0*DIM+m)*GMX_SIMD_REAL_WIDTH];
+                f[aj[s]][m] += f_buf[s + (1*DIM+m)*GMX_SIMD_REAL_WIDTH];
+                f[ak[s]][m] += f_buf[s + (2*DIM+m)*GMX_SIMD_REAL_WIDTH];
+                f[al[s]][m] += f_buf[s + (3*DIM+m)*GMX_SIMD_REAL_WIDTH];
+            }
+            s++;
+            iu += nfa1;
+        }
+        while (s < GMX_SIMD_REAL_WIDTH && iu < nbonds);
+    }
+}
+
+#endif /* GMX_SIMD_HAVE_REAL */
+
+/*! \brief Ryckaert-Bellemans dihedrals, templated on computing energies and shift forces
+ *
+ * With bCalcEnerVir=FALSE the energy and dvdl terms are not used,
+ * so the compiler can remove them.
+ */
+template <gmx_bool bCalcEnerVir>
+static real
+rbdihs_impl(int nbonds,
             const t_iatom forceatoms[], const t_iparams forceparams[],
             const rvec x[], rvec f[], rvec fshift[],
             const t_pbc *pbc, const t_graph *g,
-            real lambda, real *dvdlambda,
-            const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-            int gmx_unused *global_atom_index)
+            real lambda, real *dvdlambda)
 {
     const real c0 = 0.0, c1 = 1.0, c2 = 2.0, c3 = 3.0, c4 = 4.0, c5 = 5.0;
     int        type, ai, aj, ak, al, i, j;
@@ -3009,15 +3897,49 @@ real rbdihs(int nbonds,
 
         ddphi = -ddphi*sin_phi;         /*  11		*/
 
-        do_dih_fup(ai, aj, ak, al, ddphi, r_ij, r_kj, r_kl, m, n,
-                   f, fshift, pbc, g, x, t1, t2, t3); /* 112		*/
-        vtot += v;
+        if (bCalcEnerVir)
+        {
+            do_dih_fup(ai, aj, ak, al, ddphi, r_ij, r_kj, r_kl, m, n,
+                       f, fshift, pbc, g, x, t1, t2, t3); /* 112		*/
+            vtot += v;
+        }
+        else
+        {
+            do_dih_fup_noshiftf(ai, aj, ak, al, ddphi, r_ij, r_kj, r_kl, m, n, f);
+        }
+    }
+    if (bCalcEnerVir)
+    {
+        *dvdlambda += dvdl_term;
     }
-    *dvdlambda += dvdl_term;
 
     return vtot;
 }
 
+real rbdihs(int nbonds,
+            const t_iatom forceatoms[], const t_iparams forceparams[],
+            const rvec x[], rvec f[], rvec fshift[],
+            const t_pbc *pbc, const t_graph *g,
+            real lambda, real *dvdlambda,
+            const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+            int gmx_unused *global_atom_index)
+{
+    return rbdihs_impl<TRUE>(nbonds, forceatoms, forceparams, x, f, fshift,
+                             pbc, g, lambda, dvdlambda);
+}
+
+void rbdihs_noener(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const rvec x[], rvec f[],
+                   const t_pbc *pbc, const t_graph *g,
+                   real lambda,
+                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                   int gmx_unused *global_atom_index)
+{
+    rbdihs_impl<FALSE>(nbonds, forceatoms, forceparams, x, f, NULL,
+                       pbc, g, lambda, NULL);
+}
+
 //! \endcond
 
 /*! \brief Mysterious undocumented function */
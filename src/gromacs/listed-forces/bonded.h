@@ -128,6 +128,24 @@ void
                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
                  int gmx_unused *global_atom_index);
 
+/*! \brief Signature of the listed force functions that compute only forces
+ *
+ * These are used on steps without energy and virial calculation
+ * and without free-energy perturbation; they use the A-state parameters
+ * and do not update energies, shift forces or dV/dlambda.
+ */
+typedef void t_ifunc_noener (int nbonds,
+                             const t_iatom forceatoms[], const t_iparams forceparams[],
+                             const rvec x[], rvec f[],
+                             const struct t_pbc *pbc, const struct t_graph *g,
+                             real lambda,
+                             const t_mdatoms *md, t_fcdata *fcd,
+                             int *global_atom_index);
+
+/* As bonds(), angles(), etc., but without calculating energies and shift forces */
+t_ifunc_noener bonds_noener, angles_noener, urey_bradley_noener;
+t_ifunc_noener idihs_noener, rbdihs_noener;
+
 #ifdef GMX_SIMD_HAVE_REAL
 
 /* As angles(), but using SIMD to calculate many angles at once.
@@ -165,6 +183,69 @@ void
                        const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
                        int gmx_unused *global_atom_index);
 
+/* As urey_bradley(), but using SIMD to calculate many potentials at once.
+ * This routines does not calculate energies and shift forces.
+ */
+void
+    urey_bradley_noener_simd(int nbonds,
+                             const t_iatom forceatoms[], const t_iparams forceparams[],
+                             const rvec x[], rvec f[],
+                             const struct t_pbc *pbc,
+                             const struct t_graph gmx_unused *g,
+                             real gmx_unused lambda,
+                             const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                             int gmx_unused *global_atom_index);
+
+/* As restrangles(), but using SIMD to calculate many angles at once.
+ * This routines does not calculate energies and shift forces.
+ */
+void
+    restrangles_noener_simd(int nbonds,
+                            const t_iatom forceatoms[], const t_iparams forceparams[],
+                            const rvec x[], rvec f[],
+                            const struct t_pbc *pbc,
+                            const struct t_graph gmx_unused *g,
+                            real gmx_unused lambda,
+                            const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                            int gmx_unused *global_atom_index);
+
+/* As restrdihs(), but using SIMD to calculate many dihedrals at once.
+ * This routines does not calculate energies and shift forces.
+ */
+void
+    restrdihs_noener_simd(int nbonds,
+                          const t_iatom forceatoms[], const t_iparams forceparams[],
+                          const rvec x[], rvec f[],
+                          const struct t_pbc *pbc,
+                          const struct t_graph gmx_unused *g,
+                          real gmx_unused lambda,
+                          const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                          int gmx_unused *global_atom_index);
+
+/* As cbtdihs(), but using SIMD to calculate many dihedrals at once.
+ * This routines does not calculate energies and shift forces.
+ */
+void
+    cbtdihs_noener_simd(int nbonds,
+                        const t_iatom forceatoms[], const t_iparams forceparams[],
+                        const rvec x[], rvec f[],
+                        const struct t_pbc *pbc,
+                        const struct t_graph gmx_unused *g,
+                        real gmx_unused lambda,
+                        const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                        int gmx_unused *global_atom_index);
+
+/* As idihs(), when not needing energy, shift force or dvdl, using SIMD to calculate many dihedrals at once. */
+void
+    idihs_noener_simd(int nbonds,
+                      const t_iatom forceatoms[], const t_iparams forceparams[],
+                      const rvec x[], rvec f[],
+                      const struct t_pbc *pbc,
+                      const struct t_graph gmx_unused *g,
+                      real gmx_unused lambda,
+                      const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
+                      int gmx_unused *global_atom_index);
+
 #endif
 
 //! \endcond
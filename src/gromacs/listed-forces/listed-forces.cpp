@@ -84,9 +84,9 @@ isPairInteraction(int ftype)
 /*! \brief Zero thread-local force-output buffers */
 void
 zero_thread_forces(f_thread_t *f_t, int n,
-                   int nblock, int blocksize)
+                   int blocksize)
 {
-    int b, a0, a1, a, i, j;
+    int ib, b, a0, a1, a, i, j;
 
     if (n > f_t->f_nalloc)
     {
@@ -94,19 +94,15 @@ zero_thread_forces(f_thread_t *f_t, int n,
         srenew(f_t->f, f_t->f_nalloc);
     }
 
-    if (!bitmask_is_zero(f_t->red_mask))
+    /* Only clear the blocks this thread writes to */
+    for (ib = 0; ib < f_t->nblock_used; ib++)
     {
-        for (b = 0; b < nblock; b++)
+        b  = f_t->block_index[ib];
+        a0 = b*blocksize;
+        a1 = std::min((b+1)*blocksize, n);
+        for (a = a0; a < a1; a++)
         {
-            if (bitmask_is_set(f_t->red_mask, b))
-            {
-                a0 = b*blocksize;
-                a1 = std::min((b+1)*blocksize, n);
-                for (a = a0; a < a1; a++)
-                {
-                    clear_rvec(f_t->f[a]);
-                }
-            }
+            clear_rvec(f_t->f[a]);
         }
     }
     for (i = 0; i < SHIFTS; i++)
@@ -135,13 +131,17 @@ zero_thread_forces(f_thread_t *f_t, int n,
  * never useful performance wise. */
 #define MAX_BONDED_THREADS 256
 
-/*! \brief Reduce thread-local force buffers */
+/*! \brief Reduce thread-local force buffers
+ *
+ * Only the blocks used by threads > 0, as listed for thread 0,
+ * are reduced and only over the threads that contribute to each block.
+ */
 void
 reduce_thread_force_buffer(int n, rvec *f,
                            int nthreads, f_thread_t *f_t,
-                           int nblock, int block_size)
+                           int block_size)
 {
-    int b;
+    int ib;
 
     if (nthreads > MAX_BONDED_THREADS)
     {
@@ -153,17 +153,19 @@ reduce_thread_force_buffer(int n, rvec *f,
      * independently of nthreads.
      */
 #pragma omp parallel for num_threads(nthreads) schedule(static)
-    for (b = 0; b < nblock; b++)
+    for (ib = 0; ib < f_t[0].nblock_used; ib++)
     {
         rvec *fp[MAX_BONDED_THREADS];
-        int   nfb, ft, fb;
+        int   b, nfb, ft, fb;
         int   a0, a1, a;
 
+        b = f_t[0].block_index[ib];
+
         /* Determine which threads contribute to this block */
         nfb = 0;
         for (ft = 1; ft < nthreads; ft++)
         {
-            if (bitmask_is_set(f_t[ft].red_mask, b))
+            if (bitmask_is_set(f_t[0].mask[b], ft))
             {
                 fp[nfb++] = f_t[ft].f;
             }
@@ -190,14 +192,14 @@ void
 reduce_thread_forces(int n, rvec *f, rvec *fshift,
                      real *ener, gmx_grppairener_t *grpp, real *dvdl,
                      int nthreads, f_thread_t *f_t,
-                     int nblock, int block_size,
+                     int block_size,
                      gmx_bool bCalcEnerVir,
                      gmx_bool bDHDL)
 {
-    if (nblock > 0)
+    if (f_t[0].nblock_used > 0)
     {
         /* Reduce the bonded force buffer */
-        reduce_thread_force_buffer(n, f, nthreads, f_t, nblock, block_size);
+        reduce_thread_force_buffer(n, f, nthreads, f_t, block_size);
     }
 
     /* When necessary, reduce energy and virial using one thread only */
@@ -244,6 +246,48 @@ reduce_thread_forces(int n, rvec *f, rvec *fshift,
     }
 }
 
+/*! \brief Return the force-only kernel for \p ftype, or NULL when there is none
+ *
+ * The returned kernels compute forces with the A-state parameters
+ * only, so they may only be used without free-energy perturbation,
+ * except for the restricted and CBT potentials, which also only use
+ * the A-state parameters in the energy functions.
+ */
+t_ifunc_noener *
+select_noener_function(int ftype, gmx_bool gmx_unused bUseSIMD)
+{
+#ifdef GMX_SIMD_HAVE_REAL
+    if (bUseSIMD)
+    {
+        switch (ftype)
+        {
+            case F_ANGLES:       return angles_noener_simd;
+            case F_PDIHS:        return pdihs_noener_simd;
+            case F_RBDIHS:       return rbdihs_noener_simd;
+            case F_UREY_BRADLEY: return urey_bradley_noener_simd;
+            case F_RESTRANGLES:  return restrangles_noener_simd;
+            case F_RESTRDIHS:    return restrdihs_noener_simd;
+            case F_CBTDIHS:      return cbtdihs_noener_simd;
+            case F_IDIHS:        return idihs_noener_simd;
+            default:             break;
+        }
+    }
+#endif
+    switch (ftype)
+    {
+        case F_BONDS:
+        case F_HARMONIC:     return bonds_noener;
+        case F_ANGLES:       return angles_noener;
+        case F_UREY_BRADLEY: return urey_bradley_noener;
+        case F_PDIHS:
+        case F_PIDIHS:       return pdihs_noener;
+        case F_IDIHS:        return idihs_noener;
+        case F_RBDIHS:
+        case F_FOURDIHS:     return rbdihs_noener;
+        default:             return NULL;
+    }
+}
+
 /*! \brief Calculate one element of the list of bonded interactions
     for this thread */
 real
@@ -259,20 +303,19 @@ calc_one_bond(int thread,
               gmx_bool bCalcEnerVir,
               int *global_atom_index)
 {
-#ifdef GMX_SIMD_HAVE_REAL
     gmx_bool bUseSIMD;
+#if !defined GMX_SIMD_HAVE_REAL || (defined _MSC_VER && _MSC_VER < 1700 && !defined(__ICL))
     /* MSVC 2010 produces buggy SIMD PBC code, disable SIMD for MSVC <= 2010 */
-#if defined _MSC_VER && _MSC_VER < 1700 && !defined(__ICL)
     bUseSIMD = FALSE;
 #else
     bUseSIMD = fr->use_simd_kernels;
-#endif
 #endif
 
-    int      nat1, nbonds, efptFTYPE;
-    real     v = 0;
-    t_iatom *iatoms;
-    int      nb0, nbn;
+    int             nat1, nbonds, efptFTYPE;
+    real            v = 0;
+    t_iatom        *iatoms;
+    int             nb0, nbn;
+    t_ifunc_noener *ifunc_noener;
 
     if (IS_RESTRAINT_TYPE(ftype))
     {
@@ -304,56 +347,19 @@ calc_one_bond(int thread,
                           pbc, g, lambda[efptFTYPE], &(dvdl[efptFTYPE]),
                           md, fcd, global_atom_index);
         }
-#ifdef GMX_SIMD_HAVE_REAL
-        else if (ftype == F_ANGLES && bUseSIMD &&
-                 !bCalcEnerVir && fr->efep == efepNO)
+        else if (!bCalcEnerVir &&
+                 (fr->efep == efepNO || ftype == F_RESTRANGLES ||
+                  ftype == F_RESTRDIHS || ftype == F_CBTDIHS) &&
+                 (ifunc_noener = select_noener_function(ftype, bUseSIMD)) != NULL)
         {
             /* No energies, shift forces, dvdl */
-            angles_noener_simd(nbn, idef->il[ftype].iatoms+nb0,
-                               idef->iparams,
-                               x, f,
-                               pbc, g, lambda[efptFTYPE], md, fcd,
-                               global_atom_index);
+            ifunc_noener(nbn, iatoms+nb0,
+                         idef->iparams,
+                         x, f,
+                         pbc, g, lambda[efptFTYPE], md, fcd,
+                         global_atom_index);
             v = 0;
         }
-#endif
-        else if (ftype == F_PDIHS &&
-                 !bCalcEnerVir && fr->efep == efepNO)
-        {
-            /* No energies, shift forces, dvdl */
-#ifdef GMX_SIMD_HAVE_REAL
-            if (bUseSIMD)
-            {
-                pdihs_noener_simd(nbn, idef->il[ftype].iatoms+nb0,
-                                  idef->iparams,
-                                  x, f,
-                                  pbc, g, lambda[efptFTYPE], md, fcd,
-                                  global_atom_index);
-            }
-            else
-#endif
-            {
-                pdihs_noener(nbn, idef->il[ftype].iatoms+nb0,
-                             idef->iparams,
-                             x, f,
-                             pbc, g, lambda[efptFTYPE], md, fcd,
-                             global_atom_index);
-            }
-            v = 0;
-        }
-#ifdef GMX_SIMD_HAVE_REAL
-        else if (ftype == F_RBDIHS && bUseSIMD &&
-                 !bCalcEnerVir && fr->efep == efepNO)
-        {
-            /* No energies, shift forces, dvdl */
-            rbdihs_noener_simd(nbn, idef->il[ftype].iatoms+nb0,
-                               idef->iparams,
-                               (const rvec*)x, f,
-                               pbc, g, lambda[efptFTYPE], md, fcd,
-                               global_atom_index);
-            v = 0;
-        }
-#endif
         else
         {
             v = interaction_function[ftype].ifunc(nbn, iatoms+nb0,
@@ -369,7 +375,8 @@ calc_one_bond(int thread,
            to its own subtimer, but first wallcycle needs to be
            extended to support calling from multiple threads. */
         v = do_pairs(ftype, nbn, iatoms+nb0, idef->iparams, x, f, fshift,
-                     pbc, g, lambda, dvdl, md, fr, grpp, global_atom_index);
+                     pbc, g, lambda, dvdl, md, fr, grpp, bCalcEnerVir,
+                     global_atom_index);
     }
 
     if (thread == 0)
@@ -391,6 +398,32 @@ ftype_is_bonded_potential(int ftype)
         (ftype < F_GB12 || ftype > F_GB14);
 }
 
+gmx_bool
+ftype_is_slow_listed(const t_forcerec *fr, int ftype)
+{
+    switch (ftype)
+    {
+        /* Proper dihedrals, impropers are usually too stiff */
+        case F_PDIHS:
+        case F_RBDIHS:
+        case F_RESTRDIHS:
+        case F_CBTDIHS:
+        case F_FOURDIHS:
+        case F_PIDIHS:
+        case F_TABDIHS:
+        case F_CMAP:
+            return (fr->eSlowListed == eslowlistedDIHEDRALS ||
+                    fr->eSlowListed == eslowlistedDIHEDRALS_PAIRS);
+        case F_LJ14:
+        case F_COUL14:
+        case F_LJC14_Q:
+        case F_LJC_PAIRS_NB:
+            return (fr->eSlowListed == eslowlistedDIHEDRALS_PAIRS);
+        default:
+            return FALSE;
+    }
+}
+
 void calc_listed(const gmx_multisim_t *ms,
                  gmx_wallcycle        *wcycle,
                  const t_idef *idef,
@@ -403,7 +436,7 @@ void calc_listed(const gmx_multisim_t *ms,
                  real *lambda,
                  const t_mdatoms *md,
                  t_fcdata *fcd, int *global_atom_index,
-                 int force_flags)
+                 int force_flags, int listed_sel)
 {
     gmx_bool      bCalcEnerVir;
     int           i;
@@ -436,10 +469,11 @@ void calc_listed(const gmx_multisim_t *ms,
     }
 #endif
 
-    if ((idef->il[F_POSRES].nr > 0) ||
-        (idef->il[F_FBPOSRES].nr > 0) ||
-        (idef->il[F_ORIRES].nr > 0) ||
-        (idef->il[F_DISRES].nr > 0))
+    if (listed_sel != elistedSLOW &&
+        ((idef->il[F_POSRES].nr > 0) ||
+         (idef->il[F_FBPOSRES].nr > 0) ||
+         (idef->il[F_ORIRES].nr > 0) ||
+         (idef->il[F_DISRES].nr > 0)))
     {
         /* TODO Use of restraints triggers further function calls
            inside the loop over calc_one_bond(), but those are too
@@ -506,7 +540,7 @@ void calc_listed(const gmx_multisim_t *ms,
         else
         {
             zero_thread_forces(&fr->f_t[thread], fr->natoms_force,
-                               fr->red_nblock, 1<<fr->red_ashift);
+                               1<<fr->red_ashift);
 
             ft     = fr->f_t[thread].f;
             fshift = fr->f_t[thread].fshift;
@@ -517,7 +551,9 @@ void calc_listed(const gmx_multisim_t *ms,
         /* Loop over all bonded force types to calculate the bonded forces */
         for (ftype = 0; (ftype < F_NRE); ftype++)
         {
-            if (idef->il[ftype].nr > 0 && ftype_is_bonded_potential(ftype))
+            if (idef->il[ftype].nr > 0 && ftype_is_bonded_potential(ftype) &&
+                (listed_sel == elistedALL ||
+                 ftype_is_slow_listed(fr, ftype) == (listed_sel == elistedSLOW)))
             {
                 v = calc_one_bond(thread, ftype, idef, x,
                                   ft, fshift, fr, pbc_null, g, grpp,
@@ -536,7 +572,7 @@ void calc_listed(const gmx_multisim_t *ms,
         reduce_thread_forces(fr->natoms_force, f, fr->fshift,
                              enerd->term, &enerd->grpp, dvdl,
                              fr->nthreads, fr->f_t,
-                             fr->red_nblock, 1<<fr->red_ashift,
+                             1<<fr->red_ashift,
                              bCalcEnerVir,
                              force_flags & GMX_FORCE_DHDL);
         wallcycle_sub_stop(wcycle, ewcsLISTED_BUF_OPS);
@@ -635,6 +671,7 @@ do_force_listed(gmx_wallcycle        *wcycle,
                 const rvec            x[],
                 history_t            *hist,
                 rvec                  f[],
+                rvec                  f_slow[],
                 t_forcerec           *fr,
                 const struct t_pbc   *pbc,
                 const struct t_graph *graph,
@@ -659,9 +696,28 @@ do_force_listed(gmx_wallcycle        *wcycle,
         /* Not enough flops to bother counting */
         set_pbc(&pbc_full, fr->ePBC, box);
     }
-    calc_listed(ms, wcycle, idef, x, hist, f, fr, pbc, &pbc_full,
-                graph, enerd, nrnb, lambda, md, fcd,
-                global_atom_index, flags);
+    if (fr->eSlowListed == eslowlistedNO ||
+        (f_slow == f && !(flags & GMX_FORCE_NOSLOW)))
+    {
+        calc_listed(ms, wcycle, idef, x, hist, f, fr, pbc, &pbc_full,
+                    graph, enerd, nrnb, lambda, md, fcd,
+                    global_atom_index, flags, elistedALL);
+    }
+    else
+    {
+        calc_listed(ms, wcycle, idef, x, hist, f, fr, pbc, &pbc_full,
+                    graph, enerd, nrnb, lambda, md, fcd,
+                    global_atom_index, flags, elistedFAST);
+        if (!(flags & GMX_FORCE_NOSLOW))
+        {
+            /* The slow forces go to a separate buffer,
+             * the shift forces and energies are accumulated as usual.
+             */
+            calc_listed(ms, wcycle, idef, x, hist, f_slow, fr, pbc, &pbc_full,
+                        graph, enerd, nrnb, lambda, md, fcd,
+                        global_atom_index, flags, elistedSLOW);
+        }
+    }
 
     /* Check if we have to determine energy differences
      * at foreign lambda's.
@@ -81,7 +81,20 @@ extern "C" {
 gmx_bool
 ftype_is_bonded_potential(int ftype);
 
-/*! \brief Calculates all listed force interactions.
+/*! \brief Selection of the listed interactions to calculate
+ * with multiple time stepping */
+enum {
+    elistedALL,  /**< All listed interactions */
+    elistedFAST, /**< All but the slow listed interactions */
+    elistedSLOW  /**< Only the slow listed interactions */
+};
+
+/*! \brief Return whether ftype is a slow interaction with multiple time stepping */
+gmx_bool
+ftype_is_slow_listed(const t_forcerec *fr, int ftype);
+
+/*! \brief Calculates all listed force interactions, or the selection
+ * \p listed_sel of those with multiple time stepping.
  *
  * Note that pbc_full is used only for position restraints, and is
  * not initialized if there are none. */
@@ -95,7 +108,7 @@ void calc_listed(const gmx_multisim_t *ms,
                  gmx_enerdata_t *enerd, t_nrnb *nrnb, real *lambda,
                  const t_mdatoms *md,
                  t_fcdata *fcd, int *ddgatindex,
-                 int force_flags);
+                 int force_flags, int listed_sel);
 
 /*! \brief As calc_listed(), but only determines the potential energy
  * for the perturbed interactions.
@@ -111,7 +124,11 @@ void calc_listed_lambda(const t_idef *idef,
                         t_fcdata *fcd, int *global_atom_index);
 
 /*! \brief Do all aspects of energy and force calculations for mdrun
- * on the set of listed interactions */
+ * on the set of listed interactions
+ *
+ * With multiple time stepping, the slow listed forces are stored
+ * in \p f_slow, which can be equal to \p f, and they are skipped
+ * with GMX_FORCE_NOSLOW in \p flags. */
 void
 do_force_listed(struct gmx_wallcycle     *wcycle,
                 matrix                    box,
@@ -121,6 +138,7 @@ do_force_listed(struct gmx_wallcycle     *wcycle,
                 const rvec                x[],
                 history_t                *hist,
                 rvec                      f[],
+                rvec                      f_slow[],
                 t_forcerec               *fr,
                 const struct t_pbc       *pbc,
                 const struct t_graph     *graph,
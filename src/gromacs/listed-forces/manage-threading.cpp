@@ -47,8 +47,7 @@
 
 #include <assert.h>
 #include <limits.h>
-
-#include <algorithm>
+#include <stdlib.h>
 
 #include "gromacs/legacyheaders/gmx_omp_nthreads.h"
 #include "gromacs/listed-forces/listed-forces.h"
@@ -56,7 +55,6 @@
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/smalloc.h"
-#include "gromacs/utility/stringutil.h"
 
 /*! \brief struct for passing all data required for a function type */
 typedef struct {
@@ -297,15 +295,34 @@ static void divide_bondeds_over_threads(t_idef *idef,
     }
 }
 
-//! Construct a reduction mask for which interaction was computed on which thread
+//! Make the list of blocks of the force buffer thread t writes to
 static void
-calc_bonded_reduction_mask(gmx_bitmask_t *mask,
-                           const t_idef *idef,
-                           int shift,
-                           int t, int nt)
+calc_bonded_reduction_blocks(f_thread_t   *f_t,
+                             int           nblock,
+                             const t_idef *idef,
+                             int           shift,
+                             int           t, int nt)
 {
-    int           ftype, nb, nat1, nb0, nb1, i, a;
-    bitmask_clear(mask);
+    int ftype, nb, nat1, nb0, nb1, i, a, b, ib;
+
+    if (nblock > f_t->block_nalloc)
+    {
+        f_t->block_nalloc = over_alloc_large(nblock);
+        srenew(f_t->block_flag, f_t->block_nalloc);
+        srenew(f_t->block_index, f_t->block_nalloc);
+        for (b = 0; b < f_t->block_nalloc; b++)
+        {
+            f_t->block_flag[b] = FALSE;
+        }
+        f_t->nblock_used = 0;
+    }
+
+    /* Only unmark the blocks of the previous list, not all blocks */
+    for (ib = 0; ib < f_t->nblock_used; ib++)
+    {
+        f_t->block_flag[f_t->block_index[ib]] = FALSE;
+    }
+    f_t->nblock_used = 0;
 
     for (ftype = 0; ftype < F_NRE; ftype++)
     {
@@ -326,7 +343,12 @@ calc_bonded_reduction_mask(gmx_bitmask_t *mask,
                 {
                     for (a = 1; a < nat1; a++)
                     {
-                        bitmask_set_bit(mask, idef->il[ftype].iatoms[i+a]>>shift);
+                        b = idef->il[ftype].iatoms[i+a]>>shift;
+                        if (!f_t->block_flag[b])
+                        {
+                            f_t->block_flag[b]                   = TRUE;
+                            f_t->block_index[f_t->nblock_used++] = b;
+                        }
                     }
                 }
             }
@@ -335,15 +357,21 @@ calc_bonded_reduction_mask(gmx_bitmask_t *mask,
 }
 
 
-/*! \brief We divide the force array in a maximum of BITMASK_SIZE (default 32) blocks.
- * Minimum force block reduction size is thus 2^6=64.
+/*! \brief The force buffer is reduced in blocks of 2^reductionBlockBits atoms.
+ *
+ * Since bondeds are divided over threads based on atom order,
+ * a thread writes to a contiguous range of atoms. With blocks much smaller
+ * than the atom range per thread only the blocks at the boundaries between
+ * threads need to be reduced over more than one thread, independently
+ * of the thread count. Blocks should not be too small either, since
+ * the blocks are processed with SIMD-friendly inner loops.
  */
-const int maxBlockBits = BITMASK_SIZE;
+const int reductionBlockBits = 5;
 
 void setup_bonded_threading(t_forcerec *fr, t_idef *idef)
 {
-    int t;
-    int ctot, c, b;
+    f_thread_t *f_t0;
+    int         t, b, ctot;
 
     assert(fr->nthreads >= 1);
 
@@ -359,11 +387,8 @@ void setup_bonded_threading(t_forcerec *fr, t_idef *idef)
         return;
     }
 
-    fr->red_ashift = 6;
-    while (fr->natoms_force > (int)(maxBlockBits*(1U<<fr->red_ashift)))
-    {
-        fr->red_ashift++;
-    }
+    fr->red_ashift = reductionBlockBits;
+    fr->red_nblock = (fr->natoms_force + (1<<fr->red_ashift) - 1) >> fr->red_ashift;
     if (debug)
     {
         fprintf(debug, "bonded force buffer block atom shift %d bits\n",
@@ -371,47 +396,62 @@ void setup_bonded_threading(t_forcerec *fr, t_idef *idef)
     }
 
     /* Determine to which blocks each thread's bonded force calculation
-     * contributes. Store this is a mask for each thread.
+     * contributes. Store this as a list of blocks for each thread.
      */
 #pragma omp parallel for num_threads(fr->nthreads) schedule(static)
     for (t = 1; t < fr->nthreads; t++)
     {
-        calc_bonded_reduction_mask(&fr->f_t[t].red_mask,
-                                   idef, fr->red_ashift, t, fr->nthreads);
+        calc_bonded_reduction_blocks(&fr->f_t[t], fr->red_nblock,
+                                     idef, fr->red_ashift, t, fr->nthreads);
+    }
+
+    /* Thread 0 writes directly to f. Its mask and block list are used
+     * to store the union of the blocks of the other threads and the blocks
+     * which need to be reduced.
+     */
+    f_t0 = &fr->f_t[0];
+    if (fr->red_nblock > f_t0->block_nalloc)
+    {
+        f_t0->block_nalloc = over_alloc_large(fr->red_nblock);
+        srenew(f_t0->mask, f_t0->block_nalloc);
+        srenew(f_t0->block_index, f_t0->block_nalloc);
     }
 
-    /* Determine the maximum number of blocks we need to reduce over */
-    fr->red_nblock = 0;
-    ctot           = 0;
-    for (t = 0; t < fr->nthreads; t++)
+    for (b = 0; b < fr->red_nblock; b++)
     {
-        c = 0;
-        for (b = 0; b < maxBlockBits; b++)
+        bitmask_clear(&f_t0->mask[b]);
+    }
+    for (t = 1; t < fr->nthreads; t++)
+    {
+        const f_thread_t *f_t = &fr->f_t[t];
+        int               ib;
+
+        for (ib = 0; ib < f_t->nblock_used; ib++)
         {
-            if (bitmask_is_set(fr->f_t[t].red_mask, b))
-            {
-                fr->red_nblock = std::max(fr->red_nblock, b+1);
-                c++;
-            }
+            bitmask_set_bit(&f_t0->mask[f_t->block_index[ib]], t);
         }
-        if (debug)
+    }
+
+    f_t0->nblock_used = 0;
+    for (b = 0; b < fr->red_nblock; b++)
+    {
+        if (!bitmask_is_zero(f_t0->mask[b]))
         {
-#if BITMASK_SIZE <= 64 //move into bitmask when it is C++
-            std::string flags = gmx::formatString("%x", fr->f_t[t].red_mask);
-#else
-            std::string flags = gmx::formatAndJoin(fr->f_t[t].red_mask,
-                                                   fr->f_t[t].red_mask+BITMASK_ALEN,
-                                                   "", gmx::StringFormatter("%x"));
-#endif
-            fprintf(debug, "thread %d flags %s count %d\n",
-                    t, flags.c_str(), c);
+            f_t0->block_index[f_t0->nblock_used++] = b;
         }
-        ctot += c;
     }
+
     if (debug)
     {
-        fprintf(debug, "Number of blocks to reduce: %d of size %d\n",
-                fr->red_nblock, 1<<fr->red_ashift);
+        ctot = 0;
+        for (t = 1; t < fr->nthreads; t++)
+        {
+            fprintf(debug, "thread %d block count %d\n",
+                    t, fr->f_t[t].nblock_used);
+            ctot += fr->f_t[t].nblock_used;
+        }
+        fprintf(debug, "Number of blocks to reduce: %d of %d of size %d\n",
+                f_t0->nblock_used, fr->red_nblock, 1<<fr->red_ashift);
         fprintf(debug, "Reduction density %.2f density/#thread %.2f\n",
                 ctot*(1<<fr->red_ashift)/(double)fr->natoms_force,
                 ctot*(1<<fr->red_ashift)/(double)(fr->natoms_force*fr->nthreads));
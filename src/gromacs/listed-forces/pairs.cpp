@@ -329,17 +329,21 @@ free_energy_evaluate_single(real r2, real sc_r_power, real alpha_coul,
     return fscal;
 }
 
-} // namespace
-
+/*! \brief Calculate pair interactions, templated on computing energies and shift forces
+ *
+ * With bCalcEnerVir=FALSE the energy group terms and shift forces
+ * are not accumulated.
+ */
+template <gmx_bool bCalcEnerVir>
 real
-do_pairs(int ftype, int nbonds,
-         const t_iatom iatoms[], const t_iparams iparams[],
-         const rvec x[], rvec f[], rvec fshift[],
-         const struct t_pbc *pbc, const struct t_graph *g,
-         real *lambda, real *dvdl,
-         const t_mdatoms *md,
-         const t_forcerec *fr, gmx_grppairener_t *grppener,
-         int *global_atom_index)
+do_pairs_impl(int ftype, int nbonds,
+              const t_iatom iatoms[], const t_iparams iparams[],
+              const rvec x[], rvec f[], rvec fshift[],
+              const struct t_pbc *pbc, const struct t_graph *g,
+              real *lambda, real *dvdl,
+              const t_mdatoms *md,
+              const t_forcerec *fr, gmx_grppairener_t *grppener,
+              int *global_atom_index)
 {
     real             qq, c6, c12;
     rvec             dx;
@@ -491,25 +495,58 @@ do_pairs(int ftype, int nbonds,
             fscal            = evaluate_single(r2, fr->tab14.scale, fr->tab14.data, qq, c6, c12, &velec, &vvdw);
         }
 
-        energygrp_elec[gid]  += velec;
-        energygrp_vdw[gid]   += vvdw;
+        if (bCalcEnerVir)
+        {
+            energygrp_elec[gid]  += velec;
+            energygrp_vdw[gid]   += vvdw;
+        }
         svmul(fscal, dx, dx);
 
         /* Add the forces */
         rvec_inc(f[ai], dx);
         rvec_dec(f[aj], dx);
 
-        if (g)
-        {
-            /* Correct the shift forces using the graph */
-            ivec_sub(SHIFT_IVEC(g, ai), SHIFT_IVEC(g, aj), dt);
-            fshift_index = IVEC2IS(dt);
-        }
-        if (fshift_index != CENTRAL)
+        if (bCalcEnerVir)
         {
-            rvec_inc(fshift[fshift_index], dx);
-            rvec_dec(fshift[CENTRAL], dx);
+            if (g)
+            {
+                /* Correct the shift forces using the graph */
+                ivec_sub(SHIFT_IVEC(g, ai), SHIFT_IVEC(g, aj), dt);
+                fshift_index = IVEC2IS(dt);
+            }
+            if (fshift_index != CENTRAL)
+            {
+                rvec_inc(fshift[fshift_index], dx);
+                rvec_dec(fshift[CENTRAL], dx);
+            }
         }
     }
     return 0.0;
 }
+
+} // namespace
+
+real
+do_pairs(int ftype, int nbonds,
+         const t_iatom iatoms[], const t_iparams iparams[],
+         const rvec x[], rvec f[], rvec fshift[],
+         const struct t_pbc *pbc, const struct t_graph *g,
+         real *lambda, real *dvdl,
+         const t_mdatoms *md,
+         const t_forcerec *fr, gmx_grppairener_t *grppener,
+         gmx_bool bCalcEnerVir,
+         int *global_atom_index)
+{
+    if (bCalcEnerVir)
+    {
+        return do_pairs_impl<TRUE>(ftype, nbonds, iatoms, iparams, x, f, fshift,
+                                   pbc, g, lambda, dvdl, md, fr, grppener,
+                                   global_atom_index);
+    }
+    else
+    {
+        return do_pairs_impl<FALSE>(ftype, nbonds, iatoms, iparams, x, f, fshift,
+                                    pbc, g, lambda, dvdl, md, fr, grppener,
+                                    global_atom_index);
+    }
+}
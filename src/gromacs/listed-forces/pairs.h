@@ -56,13 +56,15 @@ struct t_pbc;
 /*! \brief Calculate VdW/charge listed pair interactions (usually 1-4
  * interactions).
  *
- * global_atom_index is only passed for printing error messages.
+ * Energies and shift forces are only computed when \p bCalcEnerVir
+ * is set. global_atom_index is only passed for printing error messages.
  */
 real
 do_pairs(int ftype, int nbonds, const t_iatom iatoms[], const t_iparams iparams[],
          const rvec x[], rvec f[], rvec fshift[],
          const struct t_pbc *pbc, const struct t_graph *g,
          real *lambda, real *dvdl, const t_mdatoms *md, const t_forcerec *fr,
-         gmx_grppairener_t *grppener, int *global_atom_index);
+         gmx_grppairener_t *grppener, gmx_bool bCalcEnerVir,
+         int *global_atom_index);
 
 #endif
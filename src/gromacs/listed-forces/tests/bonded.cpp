@@ -0,0 +1,382 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the force-only versions of the listed interaction functions.
+ *
+ * The plain-C and SIMD functions used on steps without energy
+ * calculation only compute forces, these are compared against
+ * the forces of the plain-C functions that also compute energies.
+ *
+ * \ingroup module_listed-forces
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/legacyheaders/types/ifunc.h"
+#include "gromacs/listed-forces/bonded.h"
+#include "gromacs/math/units.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/topology/idef.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+/*! \brief Test fixture with a periodic chain of particles
+ *
+ * The number of interactions is chosen such that it is not a multiple
+ * of the SIMD width and the chain crosses the periodic boundaries.
+ */
+class ListedNoEnergyTest : public ::testing::Test
+{
+    public:
+        //! Number of particles in the chain
+#ifdef GMX_SIMD_HAVE_REAL
+        static const int numAtoms_   = 2*GMX_SIMD_REAL_WIDTH + 7;
+#else
+        static const int numAtoms_   = 15;
+#endif
+        //! Number of different parameter sets
+        static const int numParams_  = 3;
+
+        ListedNoEnergyTest() : x_(numAtoms_)
+        {
+            matrix box = {{ 2.5, 0, 0 }, { 0, 2.7, 0 }, { 0, 0, 2.9 }};
+
+            set_pbc(&pbc_, epbcXYZ, box);
+
+            /* A chain with bond lengths around 0.15 nm and angles
+             * between 90 and 150 degrees, starting close to a box corner.
+             */
+            rvec pos = { 2.35, 2.55, 2.75 };
+            rvec dir = { 1, 0, 0 };
+            for (int i = 0; i < numAtoms_; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    real b = pos[d];
+                    while (b >= box[d][d])
+                    {
+                        b -= box[d][d];
+                    }
+                    x_[i][d] = b;
+                }
+                real theta = (60 + 30*std::sin(1.3*i))*DEG2RAD;
+                real phi   = 2.1*i;
+                rvec perp  = { -dir[YY], dir[XX], 0 };
+                rvec perp2, newdir;
+                if (norm2(perp) < 0.01)
+                {
+                    perp[XX] = 0;
+                    perp[YY] = -dir[ZZ];
+                    perp[ZZ] = dir[YY];
+                }
+                unitv(perp, perp);
+                cprod(dir, perp, perp2);
+                for (int d = 0; d < DIM; d++)
+                {
+                    newdir[d] = std::cos(theta)*dir[d] +
+                        std::sin(theta)*(std::cos(phi)*perp[d] + std::sin(phi)*perp2[d]);
+                }
+                unitv(newdir, dir);
+                for (int d = 0; d < DIM; d++)
+                {
+                    pos[d] += (0.15 + 0.01*std::cos(0.7*i))*dir[d];
+                }
+            }
+        }
+
+        //! Sets up the interaction list for consecutive atoms in the chain
+        void makeIatoms(int nratoms)
+        {
+            iatoms_.clear();
+            for (int i = 0; i + nratoms <= numAtoms_; i++)
+            {
+                iatoms_.push_back(i % numParams_);
+                for (int a = 0; a < nratoms; a++)
+                {
+                    iatoms_.push_back(i + a);
+                }
+            }
+        }
+
+        //! Compares the forces of the energy and the force-only functions
+        void testForces(t_ifunc refFunc, t_ifunc_noener *noenerFunc)
+        {
+            std::vector<gmx::RVec> fRef(numAtoms_, gmx::RVec(0, 0, 0));
+            std::vector<gmx::RVec> fNoEner(numAtoms_, gmx::RVec(0, 0, 0));
+            rvec                   fshift[SHIFTS];
+            real                   dvdlambda = 0;
+
+            clear_rvecs(SHIFTS, fshift);
+            refFunc(iatoms_.size(), &iatoms_[0], params_,
+                    as_rvec_array(&x_[0]), as_rvec_array(&fRef[0]), fshift,
+                    &pbc_, NULL, 0, &dvdlambda, NULL, NULL, NULL);
+            noenerFunc(iatoms_.size(), &iatoms_[0], params_,
+                       as_rvec_array(&x_[0]), as_rvec_array(&fNoEner[0]),
+                       &pbc_, NULL, 0, NULL, NULL, NULL);
+
+            /* The SIMD math functions are less accurate than libm,
+             * so we compare with a tolerance relative to the largest force.
+             */
+            real fMax = 0;
+            for (int i = 0; i < numAtoms_; i++)
+            {
+                fMax = std::max(fMax, std::sqrt(norm2(fRef[i])));
+            }
+            EXPECT_GT(fMax, 0);
+
+            gmx::test::FloatingPointTolerance tolerance =
+                gmx::test::relativeToleranceAsFloatingPoint(fMax, 1000*GMX_REAL_EPS);
+            for (int i = 0; i < numAtoms_; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ_TOL(fRef[i][d], fNoEner[i][d], tolerance)
+                    << "atom " << i << " dim " << d;
+                }
+            }
+        }
+
+        std::vector<gmx::RVec> x_;
+        std::vector<t_iatom>   iatoms_;
+        t_iparams              params_[numParams_];
+        t_pbc                  pbc_;
+};
+
+TEST_F(ListedNoEnergyTest, BondsMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        params_[p].harmonic.rA  = params_[p].harmonic.rB  = 0.14 + 0.01*p;
+        params_[p].harmonic.krA = params_[p].harmonic.krB = 2e5 + 5e4*p;
+    }
+    makeIatoms(2);
+    testForces(bonds, bonds_noener);
+}
+
+TEST_F(ListedNoEnergyTest, AnglesMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        params_[p].harmonic.rA  = params_[p].harmonic.rB  = 100 + 10*p;
+        params_[p].harmonic.krA = params_[p].harmonic.krB = 300 + 50*p;
+    }
+    makeIatoms(3);
+    testForces(angles, angles_noener);
+}
+
+TEST_F(ListedNoEnergyTest, UreyBradleyMatchesReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        params_[p].u_b.thetaA  = params_[p].u_b.thetaB  = 100 + 10*p;
+        params_[p].u_b.kthetaA = params_[p].u_b.kthetaB = 300 + 50*p;
+        params_[p].u_b.r13A    = params_[p].u_b.r13B    = 0.22 + 0.02*p;
+        params_[p].u_b.kUBA    = params_[p].u_b.kUBB    = 5000 + 1000*p;
+    }
+    makeIatoms(3);
+    testForces(urey_bradley, urey_bradley_noener);
+}
+
+TEST_F(ListedNoEnergyTest, ProperDihedralsMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        params_[p].pdihs.phiA = params_[p].pdihs.phiB = 20 + 80*p;
+        params_[p].pdihs.cpA  = params_[p].pdihs.cpB  = 5 + 2*p;
+        params_[p].pdihs.mult = 1 + p;
+    }
+    makeIatoms(4);
+    testForces(pdihs, pdihs_noener);
+}
+
+TEST_F(ListedNoEnergyTest, RyckaertBellemansDihedralsMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        for (int j = 0; j < NR_RBDIHS; j++)
+        {
+            params_[p].rbdihs.rbcA[j] = params_[p].rbdihs.rbcB[j] = (j % 2 == 0 ? 1 : -1)*(2 + p + j);
+        }
+    }
+    makeIatoms(4);
+    testForces(rbdihs, rbdihs_noener);
+}
+
+TEST_F(ListedNoEnergyTest, ImproperDihedralsMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        params_[p].harmonic.rA  = params_[p].harmonic.rB  = -170 + 120*p;
+        params_[p].harmonic.krA = params_[p].harmonic.krB = 40 + 10*p;
+    }
+    makeIatoms(4);
+    testForces(idihs, idihs_noener);
+}
+
+#ifdef GMX_SIMD_HAVE_REAL
+
+TEST_F(ListedNoEnergyTest, SimdAnglesMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        params_[p].harmonic.rA  = params_[p].harmonic.rB  = 100 + 10*p;
+        params_[p].harmonic.krA = params_[p].harmonic.krB = 300 + 50*p;
+    }
+    makeIatoms(3);
+    testForces(angles, angles_noener_simd);
+}
+
+TEST_F(ListedNoEnergyTest, SimdUreyBradleyMatchesReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        params_[p].u_b.thetaA  = params_[p].u_b.thetaB  = 100 + 10*p;
+        params_[p].u_b.kthetaA = params_[p].u_b.kthetaB = 300 + 50*p;
+        params_[p].u_b.r13A    = params_[p].u_b.r13B    = 0.22 + 0.02*p;
+        params_[p].u_b.kUBA    = params_[p].u_b.kUBB    = 5000 + 1000*p;
+    }
+    makeIatoms(3);
+    testForces(urey_bradley, urey_bradley_noener_simd);
+}
+
+TEST_F(ListedNoEnergyTest, SimdRestrictedAnglesMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        params_[p].harmonic.rA  = params_[p].harmonic.rB  = 110 + 10*p;
+        params_[p].harmonic.krA = params_[p].harmonic.krB = 25 + 5*p;
+    }
+    makeIatoms(3);
+    testForces(restrangles, restrangles_noener_simd);
+}
+
+TEST_F(ListedNoEnergyTest, SimdRestrictedDihedralsMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        params_[p].pdihs.phiA = params_[p].pdihs.phiB = -150 + 100*p;
+        params_[p].pdihs.cpA  = params_[p].pdihs.cpB  = 10 + 5*p;
+    }
+    makeIatoms(4);
+    testForces(restrdihs, restrdihs_noener_simd);
+}
+
+TEST_F(ListedNoEnergyTest, SimdCombinedBendingTorsionMatchesReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        for (int j = 0; j < NR_CBTDIHS; j++)
+        {
+            params_[p].cbtdihs.cbtcA[j] = params_[p].cbtdihs.cbtcB[j] = (j % 2 == 0 ? 1 : -1)*(2 + p + j);
+        }
+    }
+    makeIatoms(4);
+    testForces(cbtdihs, cbtdihs_noener_simd);
+}
+
+TEST_F(ListedNoEnergyTest, SimdCombinedBendingTorsionHandlesAlignedBeads)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        for (int j = 0; j < NR_CBTDIHS; j++)
+        {
+            params_[p].cbtdihs.cbtcA[j] = params_[p].cbtdihs.cbtcB[j] = (j % 2 == 0 ? 1 : -1)*(2 + p + j);
+        }
+    }
+    /* Put atoms 4, 5 and 6 exactly on a line, for which the dihedral
+     * is undefined and the CBT potential goes to zero.
+     */
+    for (int i = 4; i <= 6; i++)
+    {
+        x_[i][XX] = 1.0 + 0.125*(i - 4);
+        x_[i][YY] = 1.25;
+        x_[i][ZZ] = 1.5;
+    }
+    makeIatoms(4);
+    testForces(cbtdihs, cbtdihs_noener_simd);
+}
+
+TEST_F(ListedNoEnergyTest, SimdProperDihedralsMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        params_[p].pdihs.phiA = params_[p].pdihs.phiB = 20 + 80*p;
+        params_[p].pdihs.cpA  = params_[p].pdihs.cpB  = 5 + 2*p;
+        params_[p].pdihs.mult = 1 + p;
+    }
+    makeIatoms(4);
+    testForces(pdihs, pdihs_noener_simd);
+}
+
+TEST_F(ListedNoEnergyTest, SimdRyckaertBellemansDihedralsMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        for (int j = 0; j < NR_RBDIHS; j++)
+        {
+            params_[p].rbdihs.rbcA[j] = params_[p].rbdihs.rbcB[j] = (j % 2 == 0 ? 1 : -1)*(2 + p + j);
+        }
+    }
+    makeIatoms(4);
+    testForces(rbdihs, rbdihs_noener_simd);
+}
+
+TEST_F(ListedNoEnergyTest, SimdImproperDihedralsMatchReference)
+{
+    for (int p = 0; p < numParams_; p++)
+    {
+        /* Includes phi0 close to 180 degrees to test the periodicity */
+        params_[p].harmonic.rA  = params_[p].harmonic.rB  = -170 + 120*p;
+        params_[p].harmonic.krA = params_[p].harmonic.krB = 40 + 10*p;
+    }
+    makeIatoms(4);
+    testForces(idihs, idihs_noener_simd);
+}
+
+#endif
+
+} // namespace
@@ -57,6 +57,7 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc-simd.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/gather_scatter_rvec.h"
 #include "gromacs/simd/simd.h"
 #include "gromacs/simd/simd_math.h"
 #include "gromacs/simd/vector_operations.h"
@@ -73,248 +74,6 @@
 #endif
 
 
-#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
-
-// This was originally work-in-progress for augmenting the SIMD module with
-// masked load/store operations. Instead, that turned into and extended SIMD
-// interface that supports gather/scatter in all platforms, which will be
-// part of a future Gromacs version. However, since the code for bonded
-// interactions and LINCS was already written it would be a pity not to get
-// the performance gains in Gromacs-5.1. For this reason we have added it as
-// a bit of a hack in the two files that use it. It will be replaced with the
-// new generic functionality after version 5.1
-
-#    ifdef GMX_DOUBLE
-static gmx_inline void gmx_simdcall
-gmx_hack_simd_transpose4_r(gmx_simd_double_t *row0,
-                           gmx_simd_double_t *row1,
-                           gmx_simd_double_t *row2,
-                           gmx_simd_double_t *row3)
-{
-    __m256d tmp0, tmp1, tmp2, tmp3;
-
-    tmp0  = _mm256_unpacklo_pd(*row0, *row1);
-    tmp2  = _mm256_unpacklo_pd(*row2, *row3);
-    tmp1  = _mm256_unpackhi_pd(*row0, *row1);
-    tmp3  = _mm256_unpackhi_pd(*row2, *row3);
-    *row0 = _mm256_permute2f128_pd(tmp0, tmp2, 0b00100000);
-    *row1 = _mm256_permute2f128_pd(tmp1, tmp3, 0b00100000);
-    *row2 = _mm256_permute2f128_pd(tmp0, tmp2, 0b00110001);
-    *row3 = _mm256_permute2f128_pd(tmp1, tmp3, 0b00110001);
-}
-
-static gmx_inline void gmx_simdcall
-gmx_hack_simd4_transpose_to_simd_r(const gmx_simd4_double_t *a,
-                                   gmx_simd_double_t        *row0,
-                                   gmx_simd_double_t        *row1,
-                                   gmx_simd_double_t        *row2,
-                                   gmx_simd_double_t        *row3)
-{
-    *row0 = a[0];
-    *row1 = a[1];
-    *row2 = a[2];
-    *row3 = a[3];
-
-    gmx_hack_simd_transpose4_r(row0, row1, row2, row3);
-}
-
-static gmx_inline void gmx_simdcall
-gmx_hack_simd_transpose_to_simd4_r(gmx_simd_double_t   row0,
-                                   gmx_simd_double_t   row1,
-                                   gmx_simd_double_t   row2,
-                                   gmx_simd_double_t   row3,
-                                   gmx_simd4_double_t *a)
-{
-    a[0] = row0;
-    a[1] = row1;
-    a[2] = row2;
-    a[3] = row3;
-
-    gmx_hack_simd_transpose4_r(&a[0], &a[1], &a[2], &a[3]);
-}
-
-
-#    ifdef GMX_SIMD_X86_AVX_GCC_MASKLOAD_BUG
-#        define gmx_hack_simd4_load3_r(mem)      _mm256_maskload_pd((mem), _mm_castsi128_ps(_mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1)))
-#        define gmx_hack_simd4_store3_r(mem, x)   _mm256_maskstore_pd((mem), _mm_castsi128_ps(_mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1)), (x))
-#    else
-#        define gmx_hack_simd4_load3_r(mem)      _mm256_maskload_pd((mem), _mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1))
-#        define gmx_hack_simd4_store3_r(mem, x)   _mm256_maskstore_pd((mem), _mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1), (x))
-#    endif
-
-#    else /* single instead of double */
-static gmx_inline void gmx_simdcall
-gmx_hack_simd_transpose4_r(gmx_simd_float_t *row0,
-                           gmx_simd_float_t *row1,
-                           gmx_simd_float_t *row2,
-                           gmx_simd_float_t *row3)
-{
-    __m256 tmp0, tmp1, tmp2, tmp3;
-
-    tmp0  = _mm256_unpacklo_ps(*row0, *row1);
-    tmp2  = _mm256_unpacklo_ps(*row2, *row3);
-    tmp1  = _mm256_unpackhi_ps(*row0, *row1);
-    tmp3  = _mm256_unpackhi_ps(*row2, *row3);
-    *row0 = _mm256_shuffle_ps(tmp0, tmp2, 0b0100010001000100);
-    *row1 = _mm256_shuffle_ps(tmp0, tmp2, 0b1110111011101110);
-    *row2 = _mm256_shuffle_ps(tmp1, tmp3, 0b0100010001000100);
-    *row3 = _mm256_shuffle_ps(tmp1, tmp3, 0b1110111011101110);
-}
-
-static gmx_inline void gmx_simdcall
-gmx_hack_simd4_transpose_to_simd_r(const gmx_simd4_float_t *a,
-                                   gmx_simd_float_t        *row0,
-                                   gmx_simd_float_t        *row1,
-                                   gmx_simd_float_t        *row2,
-                                   gmx_simd_float_t        *row3)
-{
-    *row0 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[0]), a[4], 1);
-    *row1 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[1]), a[5], 1);
-    *row2 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[2]), a[6], 1);
-    *row3 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[3]), a[7], 1);
-
-    gmx_hack_simd_transpose4_r(row0, row1, row2, row3);
-}
-
-static gmx_inline void gmx_simdcall
-gmx_hack_simd_transpose_to_simd4_r(gmx_simd_float_t   row0,
-                                   gmx_simd_float_t   row1,
-                                   gmx_simd_float_t   row2,
-                                   gmx_simd_float_t   row3,
-                                   gmx_simd4_float_t *a)
-{
-    gmx_hack_simd_transpose4_r(&row0, &row1, &row2, &row3);
-
-    a[0] = _mm256_extractf128_ps(row0, 0);
-    a[1] = _mm256_extractf128_ps(row1, 0);
-    a[2] = _mm256_extractf128_ps(row2, 0);
-    a[3] = _mm256_extractf128_ps(row3, 0);
-    a[4] = _mm256_extractf128_ps(row0, 1);
-    a[5] = _mm256_extractf128_ps(row1, 1);
-    a[6] = _mm256_extractf128_ps(row2, 1);
-    a[7] = _mm256_extractf128_ps(row3, 1);
-}
-#ifdef GMX_SIMD_X86_AVX_GCC_MASKLOAD_BUG
-#        define gmx_hack_simd4_load3_r(mem)      _mm_maskload_ps((mem), _mm_castsi256_pd(_mm_set_epi32(0, -1, -1, -1)))
-#        define gmx_hack_simd4_store3_r(mem, x)   _mm_maskstore_ps((mem), _mm_castsi256_pd(_mm_set_epi32(0, -1, -1, -1)), (x))
-#else
-#        define gmx_hack_simd4_load3_r(mem)      _mm_maskload_ps((mem), _mm_set_epi32(0, -1, -1, -1))
-#        define gmx_hack_simd4_store3_r(mem, x)   _mm_maskstore_ps((mem), _mm_set_epi32(0, -1, -1, -1), (x))
-#endif
-
-#endif /* double */
-
-#endif /* AVX */
-
-#ifdef GMX_SIMD_HAVE_REAL
-/*! \brief Store differences between indexed rvecs in SIMD registers.
- *
- * Returns SIMD register with the difference vectors:
- *     v[pair_index[i*2]] - v[pair_index[i*2 + 1]]
- *
- * \param[in]     v           Array of rvecs
- * \param[in]     pair_index  Index pairs for GMX_SIMD_REAL_WIDTH vector pairs
- * \param[in,out] buf         Aligned tmp buffer of size 3*GMX_SIMD_REAL_WIDTH
- * \param[out]    dx          SIMD register with x difference
- * \param[out]    dy          SIMD register with y difference
- * \param[out]    dz          SIMD register with z difference
- */
-static gmx_inline void gmx_simdcall
-gmx_hack_simd_gather_rvec_dist_pair_index(const rvec      *v,
-                                          const int       *pair_index,
-                                          real gmx_unused *buf,
-                                          gmx_simd_real_t *dx,
-                                          gmx_simd_real_t *dy,
-                                          gmx_simd_real_t *dz)
-{
-#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
-    int              i;
-    gmx_simd4_real_t d[GMX_SIMD_REAL_WIDTH];
-    gmx_simd_real_t  tmp;
-
-    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
-    {
-        d[i] = gmx_simd4_sub_r(gmx_hack_simd4_load3_r(&(v[pair_index[i*2 + 0]][0])),
-                               gmx_hack_simd4_load3_r(&(v[pair_index[i*2 + 1]][0])));
-    }
-
-    gmx_hack_simd4_transpose_to_simd_r(d, dx, dy, dz, &tmp);
-#else
-#if GMX_ALIGNMENT
-    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) buf_aligned[3*GMX_SIMD_REAL_WIDTH];
-#else
-    real* buf_aligned = buf;
-#endif
-
-    int i, m;
-
-    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
-    {
-        /* Store the distances packed and aligned */
-        for (m = 0; m < DIM; m++)
-        {
-            buf_aligned[m*GMX_SIMD_REAL_WIDTH + i] =
-                v[pair_index[i*2]][m] - v[pair_index[i*2 + 1]][m];
-        }
-    }
-    *dx = gmx_simd_load_r(buf_aligned + 0*GMX_SIMD_REAL_WIDTH);
-    *dy = gmx_simd_load_r(buf_aligned + 1*GMX_SIMD_REAL_WIDTH);
-    *dz = gmx_simd_load_r(buf_aligned + 2*GMX_SIMD_REAL_WIDTH);
-#endif
-}
-
-
-/*! \brief Stores SIMD vector into multiple rvecs.
- *
- * \param[in]     x           SIMD register with x-components of the vectors
- * \param[in]     y           SIMD register with y-components of the vectors
- * \param[in]     z           SIMD register with z-components of the vectors
- * \param[in,out] buf         Aligned tmp buffer of size 3*GMX_SIMD_REAL_WIDTH
- * \param[out]    v           Array of GMX_SIMD_REAL_WIDTH rvecs
- */
-static gmx_inline void gmx_simdcall
-gmx_simd_store_vec_to_rvec(gmx_simd_real_t  x,
-                           gmx_simd_real_t  y,
-                           gmx_simd_real_t  z,
-                           real gmx_unused *buf,
-                           rvec            *v)
-{
-#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
-    int              i;
-    gmx_simd4_real_t s4[GMX_SIMD_REAL_WIDTH];
-    gmx_simd_real_t  zero = gmx_simd_setzero_r();
-
-    gmx_hack_simd_transpose_to_simd4_r(x, y, z, zero, s4);
-
-    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
-    {
-        gmx_hack_simd4_store3_r(v[i], s4[i]);
-    }
-#else
-#if GMX_ALIGNMENT
-    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) buf_aligned[3*GMX_SIMD_REAL_WIDTH];
-#else
-    real* buf_aligned = buf;
-#endif
-
-    int i, m;
-
-    gmx_simd_store_r(buf_aligned + 0*GMX_SIMD_REAL_WIDTH, x);
-    gmx_simd_store_r(buf_aligned + 1*GMX_SIMD_REAL_WIDTH, y);
-    gmx_simd_store_r(buf_aligned + 2*GMX_SIMD_REAL_WIDTH, z);
-
-    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
-    {
-        for (m = 0; m < DIM; m++)
-        {
-            v[i][m] = buf_aligned[m*GMX_SIMD_REAL_WIDTH + i];
-        }
-    }
-#endif
-}
-#endif /* GMX_SIMD_HAVE_REAL */
-
-
 typedef struct {
     int    b0;         /* first constraint for this task */
     int    b1;         /* b1-1 is the last constraint for this task */
@@ -359,6 +118,18 @@ typedef struct gmx_lincsdata {
     gmx_bool        bCommIter;    /* communicate before each LINCS interation */
     real           *blmf;         /* matrix of mass factors for constraint connections */
     real           *blmf1;        /* as blmf, but with all masses 1 */
+    /* The coupling matrix packed for SIMD: for each block of SIMD width
+     * constraints the connections are stored as rows of SIMD width entries.
+     * The number of rows is the maximum connection count in the block,
+     * shorter lists are padded with the constraint itself and zero factors.
+     */
+    int            *blnr_simd;     /* start row in the packed arrays per SIMD block */
+    int             ncc_simd;      /* the number of packed entries, including padding */
+    int             ncc_simd_alloc; /* the number we allocated memory for */
+    int            *blbnb_simd;    /* packed list of constraint connections */
+    real           *blmf_simd;     /* packed blmf */
+    real           *blmf1_simd;    /* packed blmf1 */
+    real           *blcc_simd;     /* packed coupling coefficients */
     real           *bllen;        /* the reference bond length */
     int            *nlocat;       /* the local atom count per constraint, can be NULL */
 
@@ -405,7 +176,49 @@ real lincs_rmsd(struct gmx_lincsdata *lincsd, gmx_bool bSD2)
     }
 }
 
+#ifdef LINCS_SIMD
+/* Do one LINCS matrix multiplication using the packed SIMD matrix.
+ * The padding entries have zero coefficients, so the sums are
+ * accumulated in the same order as in the plain-C code.
+ */
+static void gmx_simdcall
+lincs_matrix_mult_simd(int                       b0,
+                       int                       b1,
+                       const int *               blnr_simd,
+                       const int *               blbnb_simd,
+                       const real * gmx_restrict blcc_simd,
+                       real * gmx_restrict       vbuf,
+                       const real * gmx_restrict rhs1,
+                       real * gmx_restrict       rhs2,
+                       real * gmx_restrict       sol)
+{
+    int bs;
+
+    assert(b0 % GMX_SIMD_REAL_WIDTH == 0);
+
+    for (bs = b0; bs < b1; bs += GMX_SIMD_REAL_WIDTH)
+    {
+        gmx_simd_real_t mvb_S;
+        int             n, nr0, nr1;
+
+        nr0   = blnr_simd[bs/GMX_SIMD_REAL_WIDTH];
+        nr1   = blnr_simd[bs/GMX_SIMD_REAL_WIDTH + 1];
+
+        mvb_S = gmx_simd_setzero_r();
+        for (n = nr0; n < nr1; n++)
+        {
+            mvb_S = gmx_simd_fmadd_r(gmx_simd_load_r(blcc_simd + n*GMX_SIMD_REAL_WIDTH),
+                                     gmx_hack_simd_gather_real_index(rhs1, blbnb_simd + n*GMX_SIMD_REAL_WIDTH, vbuf),
+                                     mvb_S);
+        }
+        gmx_simd_store_r(rhs2 + bs, mvb_S);
+        gmx_simd_store_r(sol + bs, gmx_simd_add_r(gmx_simd_load_r(sol + bs), mvb_S));
+    }
+}
+#endif /* LINCS_SIMD */
+
 /* Do a set of nrec LINCS matrix multiplications.
+ * With SIMD blcc should be the packed matrix.
  * This function will return with up to date thread-local
  * constraint data, without an OpenMP barrier.
  */
@@ -424,12 +237,16 @@ static void lincs_matrix_expand(const struct gmx_lincsdata *lincsd,
 
     for (rec = 0; rec < nrec; rec++)
     {
-        int b;
-
         if (lincsd->bTaskDep)
         {
 #pragma omp barrier
         }
+#ifdef LINCS_SIMD
+        lincs_matrix_mult_simd(b0, b1, lincsd->blnr_simd, lincsd->blbnb_simd,
+                               blcc, li_task->simd_buf, rhs1, rhs2, sol);
+#else
+        int b;
+
         for (b = b0; b < b1; b++)
         {
             real mvb;
@@ -443,6 +260,7 @@ static void lincs_matrix_expand(const struct gmx_lincsdata *lincsd,
             rhs2[b] = mvb;
             sol[b]  = sol[b] + mvb;
         }
+#endif
 
         real *swap;
 
@@ -484,7 +302,7 @@ static void lincs_matrix_expand(const struct gmx_lincsdata *lincsd,
 
             for (tb = 0; tb < li_task->ntriangle; tb++)
             {
-                int  b, bits, nr0, nr1, n;
+                int  b, bits, nr0, nr1, n, cc0, cc_stride;
                 real mvb;
 
                 b    = triangle[tb];
@@ -492,11 +310,19 @@ static void lincs_matrix_expand(const struct gmx_lincsdata *lincsd,
                 mvb  = 0;
                 nr0  = blnr[b];
                 nr1  = blnr[b+1];
+#ifdef LINCS_SIMD
+                /* Locate the coefficients of b in the packed matrix */
+                cc0       = lincsd->blnr_simd[b/GMX_SIMD_REAL_WIDTH]*GMX_SIMD_REAL_WIDTH + b % GMX_SIMD_REAL_WIDTH;
+                cc_stride = GMX_SIMD_REAL_WIDTH;
+#else
+                cc0       = nr0;
+                cc_stride = 1;
+#endif
                 for (n = nr0; n < nr1; n++)
                 {
                     if (bits & (1 << (n - nr0)))
                     {
-                        mvb = mvb + blcc[n]*rhs1[blbnb[n]];
+                        mvb = mvb + blcc[cc0 + (n - nr0)*cc_stride]*rhs1[blbnb[n]];
                     }
                 }
                 rhs2[b] = mvb;
@@ -706,6 +532,51 @@ calc_dr_x_f_simd(int                       b0,
 }
 #endif /* LINCS_SIMD */
 
+#ifdef LINCS_SIMD
+/* Construct the packed LINCS coupling matrix from the constraint directions r */
+static void gmx_simdcall
+calc_lincs_matrix_simd(int                       b0,
+                       int                       b1,
+                       const int *               blnr_simd,
+                       const int *               blbnb_simd,
+                       const real * gmx_restrict blmf_simd,
+                       const rvec * gmx_restrict r,
+                       real * gmx_restrict       vbuf,
+                       real * gmx_restrict       blcc_simd)
+{
+    int bs;
+
+    assert(b0 % GMX_SIMD_REAL_WIDTH == 0);
+
+    for (bs = b0; bs < b1; bs += GMX_SIMD_REAL_WIDTH)
+    {
+        int             index[GMX_SIMD_REAL_WIDTH];
+        gmx_simd_real_t rx_S, ry_S, rz_S;
+        int             i, n;
+
+        for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+        {
+            index[i] = bs + i;
+        }
+        gmx_hack_simd_gather_rvec_index(r, index, vbuf, &rx_S, &ry_S, &rz_S);
+
+        for (n = blnr_simd[bs/GMX_SIMD_REAL_WIDTH]; n < blnr_simd[bs/GMX_SIMD_REAL_WIDTH + 1]; n++)
+        {
+            gmx_simd_real_t rnx_S, rny_S, rnz_S, ip_S;
+
+            gmx_hack_simd_gather_rvec_index(r, blbnb_simd + n*GMX_SIMD_REAL_WIDTH, vbuf,
+                                            &rnx_S, &rny_S, &rnz_S);
+
+            ip_S = gmx_simd_iprod_r(rx_S, ry_S, rz_S,
+                                    rnx_S, rny_S, rnz_S);
+
+            gmx_simd_store_r(blcc_simd + n*GMX_SIMD_REAL_WIDTH,
+                             gmx_simd_mul_r(gmx_simd_load_r(blmf_simd + n*GMX_SIMD_REAL_WIDTH), ip_S));
+        }
+    }
+}
+#endif /* LINCS_SIMD */
+
 /* LINCS projection, works on derivatives of the coordinates */
 static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
                       struct gmx_lincsdata *lincsd, int th,
@@ -714,7 +585,7 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
                       gmx_bool bCalcVir, tensor rmdf)
 {
     int      b0, b1, b;
-    int     *bla, *blnr, *blbnb;
+    int     *bla;
     rvec    *r;
     real    *blc, *blmf, *blcc, *rhs1, *rhs2, *sol;
 
@@ -723,21 +594,31 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
 
     bla    = lincsd->bla;
     r      = lincsd->tmpv;
-    blnr   = lincsd->blnr;
-    blbnb  = lincsd->blbnb;
     if (econq != econqForce)
     {
         /* Use mass-weighted parameters */
         blc  = lincsd->blc;
+#ifdef LINCS_SIMD
+        blmf = lincsd->blmf_simd;
+#else
         blmf = lincsd->blmf;
+#endif
     }
     else
     {
         /* Use non mass-weighted parameters */
         blc  = lincsd->blc1;
+#ifdef LINCS_SIMD
+        blmf = lincsd->blmf1_simd;
+#else
         blmf = lincsd->blmf1;
+#endif
     }
+#ifdef LINCS_SIMD
+    blcc   = lincsd->blcc_simd;
+#else
     blcc   = lincsd->tmpncc;
+#endif
     rhs1   = lincsd->tmp1;
     rhs2   = lincsd->tmp2;
     sol    = lincsd->tmp3;
@@ -812,6 +693,13 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
     }
 
     /* Construct the (sparse) LINCS matrix */
+#ifdef LINCS_SIMD
+    calc_lincs_matrix_simd(b0, b1, lincsd->blnr_simd, lincsd->blbnb_simd,
+                           blmf, r, lincsd->task[th].simd_buf, blcc);
+#else
+    const int *blnr  = lincsd->blnr;
+    const int *blbnb = lincsd->blbnb;
+
     for (b = b0; b < b1; b++)
     {
         int n;
@@ -821,6 +709,7 @@ static void do_lincsp(rvec *x, rvec *f, rvec *fp, t_pbc *pbc,
             blcc[n] = blmf[n]*iprod(r[b], r[blbnb[n]]);
         } /* 6 nr flops */
     }
+#endif
     /* Together: 23*ncons + 6*nrtot flops */
 
     lincs_matrix_expand(lincsd, &lincsd->task[th], blcc, rhs1, rhs2, sol);
@@ -1079,8 +968,8 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
                      real invdt, rvec * gmx_restrict v,
                      gmx_bool bCalcVir, tensor vir_r_m_dr)
 {
-    int      b0, b1, b, i, j, n, iter;
-    int     *bla, *blnr, *blbnb;
+    int      b0, b1, b, i, j, iter;
+    int     *bla;
     rvec    *r;
     real    *blc, *blmf, *bllen, *blcc, *rhs1, *rhs2, *sol, *blc_sol, *mlambda;
     int     *nlocat;
@@ -1090,12 +979,15 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
 
     bla     = lincsd->bla;
     r       = lincsd->tmpv;
-    blnr    = lincsd->blnr;
-    blbnb   = lincsd->blbnb;
     blc     = lincsd->blc;
-    blmf    = lincsd->blmf;
     bllen   = lincsd->bllen;
+#ifdef LINCS_SIMD
+    blmf    = lincsd->blmf_simd;
+    blcc    = lincsd->blcc_simd;
+#else
+    blmf    = lincsd->blmf;
     blcc    = lincsd->tmpncc;
+#endif
     rhs1    = lincsd->tmp1;
     rhs2    = lincsd->tmp2;
     sol     = lincsd->tmp3;
@@ -1183,13 +1075,23 @@ static void do_lincs(rvec *x, rvec *xp, matrix box, t_pbc *pbc,
     }
 
     /* Construct the (sparse) LINCS matrix */
+#ifdef LINCS_SIMD
+    calc_lincs_matrix_simd(b0, b1, lincsd->blnr_simd, lincsd->blbnb_simd,
+                           blmf, r, lincsd->task[th].simd_buf, blcc);
+#else
+    const int *blnr  = lincsd->blnr;
+    const int *blbnb = lincsd->blbnb;
+
     for (b = b0; b < b1; b++)
     {
+        int n;
+
         for (n = blnr[b]; n < blnr[b+1]; n++)
         {
             blcc[n] = blmf[n]*iprod(r[b], r[blbnb[n]]);
         }
     }
+#endif
     /* Together: 26*ncons + 6*nrtot flops */
 
     lincs_matrix_expand(lincsd, &lincsd->task[th], blcc, rhs1, rhs2, sol);
@@ -1435,6 +1337,40 @@ static void set_lincs_matrix_task(struct gmx_lincsdata *li,
             }
         }
     }
+
+#ifdef LINCS_SIMD
+    /* Copy the coefficients to the packed SIMD matrix, zero for padding */
+    int bs;
+
+    for (bs = li_task->b0; bs < li_task->b1; bs += GMX_SIMD_REAL_WIDTH)
+    {
+        int nr0, nr1, row, j;
+
+        nr0 = li->blnr_simd[bs/GMX_SIMD_REAL_WIDTH];
+        nr1 = li->blnr_simd[bs/GMX_SIMD_REAL_WIDTH + 1];
+        for (row = nr0; row < nr1; row++)
+        {
+            for (j = 0; j < GMX_SIMD_REAL_WIDTH; j++)
+            {
+                int b, n, ind;
+
+                b   = bs + j;
+                n   = li->blnr[b] + row - nr0;
+                ind = row*GMX_SIMD_REAL_WIDTH + j;
+                if (n < li->blnr[b + 1])
+                {
+                    li->blmf_simd[ind]  = li->blmf[n];
+                    li->blmf1_simd[ind] = li->blmf1[n];
+                }
+                else
+                {
+                    li->blmf_simd[ind]  = 0;
+                    li->blmf1_simd[ind] = 0;
+                }
+            }
+        }
+    }
+#endif
 }
 
 /* Sets the elements in the LINCS matrix */
@@ -2021,6 +1957,59 @@ static void check_assign_triangle(struct gmx_lincsdata *li,
     }
 }
 
+#ifdef LINCS_SIMD
+/* Sets up the packed SIMD matrix indices from blnr and blbnb */
+static void set_matrix_indices_simd(struct gmx_lincsdata *li)
+{
+    int nblock, block;
+
+    nblock = li->nc/GMX_SIMD_REAL_WIDTH;
+
+    li->blnr_simd[0] = 0;
+    for (block = 0; block < nblock; block++)
+    {
+        int bs, j, nrow;
+
+        bs   = block*GMX_SIMD_REAL_WIDTH;
+        nrow = 0;
+        for (j = 0; j < GMX_SIMD_REAL_WIDTH; j++)
+        {
+            nrow = std::max(nrow, li->blnr[bs + j + 1] - li->blnr[bs + j]);
+        }
+        li->blnr_simd[block + 1] = li->blnr_simd[block] + nrow;
+    }
+
+    li->ncc_simd = li->blnr_simd[nblock]*GMX_SIMD_REAL_WIDTH;
+    if (li->ncc_simd > li->ncc_simd_alloc)
+    {
+        li->ncc_simd_alloc = over_alloc_small(li->ncc_simd);
+        srenew(li->blbnb_simd, li->ncc_simd_alloc);
+        resize_real_aligned(&li->blmf_simd, li->ncc_simd_alloc);
+        resize_real_aligned(&li->blmf1_simd, li->ncc_simd_alloc);
+        resize_real_aligned(&li->blcc_simd, li->ncc_simd_alloc);
+    }
+
+    for (block = 0; block < nblock; block++)
+    {
+        int row, j;
+
+        for (row = li->blnr_simd[block]; row < li->blnr_simd[block + 1]; row++)
+        {
+            for (j = 0; j < GMX_SIMD_REAL_WIDTH; j++)
+            {
+                int b, n;
+
+                b = block*GMX_SIMD_REAL_WIDTH + j;
+                n = li->blnr[b] + row - li->blnr_simd[block];
+                /* Pad with the constraint itself, this has a zero factor */
+                li->blbnb_simd[row*GMX_SIMD_REAL_WIDTH + j] =
+                    (n < li->blnr[b + 1] ? li->blbnb[n] : b);
+            }
+        }
+    }
+}
+#endif
+
 static void set_matrix_indices(struct gmx_lincsdata *li,
                                const lincs_task_t   *li_task,
                                const t_blocka       *at2con,
@@ -2139,6 +2128,9 @@ void set_lincs(t_idef *idef, t_mdatoms *md,
         resize_real_aligned(&li->blc, li->nc_alloc);
         resize_real_aligned(&li->blc1, li->nc_alloc);
         srenew(li->blnr, li->nc_alloc + 1);
+#ifdef LINCS_SIMD
+        srenew(li->blnr_simd, li->nc_alloc/GMX_SIMD_REAL_WIDTH + 1);
+#endif
         resize_real_aligned(&li->bllen, li->nc_alloc);
         srenew(li->tmpv, li->nc_alloc);
         if (DOMAINDECOMP(cr))
@@ -2324,6 +2316,10 @@ void set_lincs(t_idef *idef, t_mdatoms *md,
 
     done_blocka(&at2con);
 
+#ifdef LINCS_SIMD
+    set_matrix_indices_simd(li);
+#endif
+
     if (cr->dd == NULL)
     {
         /* Since the matrix is static, we should free some memory */
@@ -62,6 +62,7 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/pulling/pull.h"
+#include "gromacs/simd/simd.h"
 #include "gromacs/topology/block.h"
 #include "gromacs/topology/invblock.h"
 #include "gromacs/topology/mtop_util.h"
@@ -169,6 +170,26 @@ void too_many_constraint_warnings(int eConstrAlg, int warncount)
               "adjust the lincs warning threshold in your mdp file\nor " : "\n");
 }
 
+/* Returns the start of the settle range of thread th out of nth.
+ * The ranges are aligned to the SIMD width, so csettle can process
+ * all, but the last, ranges in full SIMD batches of waters.
+ */
+static int settle_thread_start(int nsettle, int th, int nth)
+{
+#ifdef GMX_SIMD_HAVE_REAL
+    const int align = GMX_SIMD_REAL_WIDTH;
+#else
+    const int align = 1;
+#endif
+
+    if (th >= nth)
+    {
+        return nsettle;
+    }
+
+    return ((nsettle*th/nth)/align)*align;
+}
+
 static void write_constr_pdb(const char *fn, const char *title,
                              gmx_mtop_t *mtop,
                              int start, int homenr, t_commrec *cr,
@@ -465,8 +486,12 @@ gmx_bool constrain(FILE *fplog, gmx_bool bLog, gmx_bool bEner,
                         clear_mat(constr->vir_r_m_dr_th[th]);
                     }
 
-                    start_th = (nsettle* th   )/nth;
-                    end_th   = (nsettle*(th+1))/nth;
+                    start_th = settle_thread_start(nsettle, th,     nth);
+                    end_th   = settle_thread_start(nsettle, th + 1, nth);
+                    if (th > 0)
+                    {
+                        constr->settle_error[th] = -1;
+                    }
                     if (start_th >= 0 && end_th - start_th > 0)
                     {
                         csettle(constr->settled,
@@ -533,7 +558,11 @@ gmx_bool constrain(FILE *fplog, gmx_bool bLog, gmx_bool bEner,
         /* Combine virial and error info of the other threads */
         for (i = 1; i < nth; i++)
         {
-            settle_error = constr->settle_error[i];
+            /* The thread errors are indices in the thread ranges */
+            if (constr->settle_error[i] >= 0)
+            {
+                settle_error = settle_thread_start(nsettle, i, nth) + constr->settle_error[i];
+            }
         }
         if (vir != NULL)
         {
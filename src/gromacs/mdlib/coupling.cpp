@@ -95,20 +95,10 @@ static void NHC_trotter(t_grpopts *opts, int nvar, gmx_ekindata_t *ekind, real d
 {
     /* general routine for both barostat and thermostat nose hoover chains */
 
-    int           i, j, mi, mj;
-    double        Ekin, Efac, reft, kT, nd;
-    double        dt;
-    t_grp_tcstat *tcstat;
-    double       *ivxi, *ixi;
-    double       *iQinv;
-    double       *GQ;
     gmx_bool      bBarostat;
-    int           mstepsi, mstepsj;
     int           ns = SUZUKI_YOSHIDA_NUM; /* set the degree of integration in the types/state.h file */
     int           nh = opts->nhchainlength;
-
-    snew(GQ, nh);
-    mstepsi = mstepsj = ns;
+    int           nth;
 
 /* if scalefac is NULL, we are doing the NHC of the barostat */
 
@@ -118,110 +108,132 @@ static void NHC_trotter(t_grpopts *opts, int nvar, gmx_ekindata_t *ekind, real d
         bBarostat = TRUE;
     }
 
-    for (i = 0; i < nvar; i++)
+    /* The chains of different T-coupling groups are independent,
+     * so we can integrate them in parallel. The barostat chains
+     * all scale veta, so those are integrated serially.
+     */
+    nth = (bBarostat ? 1 : std::min(gmx_omp_nthreads_get(emntUpdate), nvar));
+
+#pragma omp parallel num_threads(nth)
     {
+        int           i, j, mi, mj;
+        double        Ekin, Efac, reft, kT, nd;
+        double        dt;
+        t_grp_tcstat *tcstat;
+        double       *ivxi, *ixi;
+        double       *iQinv;
+        double       *GQ;
+        int           mstepsi, mstepsj;
+
+        snew(GQ, nh);
+        mstepsi = mstepsj = ns;
+
+#pragma omp for schedule(static)
+        for (i = 0; i < nvar; i++)
+        {
 
-        /* make it easier to iterate by selecting
-           out the sub-array that corresponds to this T group */
+            /* make it easier to iterate by selecting
+               out the sub-array that corresponds to this T group */
 
-        ivxi = &vxi[i*nh];
-        ixi  = &xi[i*nh];
-        if (bBarostat)
-        {
-            iQinv = &(MassQ->QPinv[i*nh]);
-            nd    = 1.0; /* THIS WILL CHANGE IF NOT ISOTROPIC */
-            reft  = std::max<real>(0, opts->ref_t[0]);
-            Ekin  = sqr(*veta)/MassQ->Winv;
-        }
-        else
-        {
-            iQinv  = &(MassQ->Qinv[i*nh]);
-            tcstat = &ekind->tcstat[i];
-            nd     = opts->nrdf[i];
-            reft   = std::max<real>(0, opts->ref_t[i]);
-            if (bEkinAveVel)
+            ivxi = &vxi[i*nh];
+            ixi  = &xi[i*nh];
+            if (bBarostat)
             {
-                Ekin = 2*trace(tcstat->ekinf)*tcstat->ekinscalef_nhc;
+                iQinv = &(MassQ->QPinv[i*nh]);
+                nd    = 1.0; /* THIS WILL CHANGE IF NOT ISOTROPIC */
+                reft  = std::max<real>(0, opts->ref_t[0]);
+                Ekin  = sqr(*veta)/MassQ->Winv;
             }
             else
             {
-                Ekin = 2*trace(tcstat->ekinh)*tcstat->ekinscaleh_nhc;
+                iQinv  = &(MassQ->Qinv[i*nh]);
+                tcstat = &ekind->tcstat[i];
+                nd     = opts->nrdf[i];
+                reft   = std::max<real>(0, opts->ref_t[i]);
+                if (bEkinAveVel)
+                {
+                    Ekin = 2*trace(tcstat->ekinf)*tcstat->ekinscalef_nhc;
+                }
+                else
+                {
+                    Ekin = 2*trace(tcstat->ekinh)*tcstat->ekinscaleh_nhc;
+                }
             }
-        }
-        kT = BOLTZ*reft;
+            kT = BOLTZ*reft;
 
-        for (mi = 0; mi < mstepsi; mi++)
-        {
-            for (mj = 0; mj < mstepsj; mj++)
+            for (mi = 0; mi < mstepsi; mi++)
             {
-                /* weighting for this step using Suzuki-Yoshida integration - fixed at 5 */
-                dt = sy_const[ns][mj] * dtfull / mstepsi;
+                for (mj = 0; mj < mstepsj; mj++)
+                {
+                    /* weighting for this step using Suzuki-Yoshida integration - fixed at 5 */
+                    dt = sy_const[ns][mj] * dtfull / mstepsi;
 
-                /* compute the thermal forces */
-                GQ[0] = iQinv[0]*(Ekin - nd*kT);
+                    /* compute the thermal forces */
+                    GQ[0] = iQinv[0]*(Ekin - nd*kT);
 
-                for (j = 0; j < nh-1; j++)
-                {
-                    if (iQinv[j+1] > 0)
+                    for (j = 0; j < nh-1; j++)
                     {
-                        /* we actually don't need to update here if we save the
-                           state of the GQ, but it's easier to just recompute*/
-                        GQ[j+1] = iQinv[j+1]*((sqr(ivxi[j])/iQinv[j])-kT);
+                        if (iQinv[j+1] > 0)
+                        {
+                            /* we actually don't need to update here if we save the
+                               state of the GQ, but it's easier to just recompute*/
+                            GQ[j+1] = iQinv[j+1]*((sqr(ivxi[j])/iQinv[j])-kT);
+                        }
+                        else
+                        {
+                            GQ[j+1] = 0;
+                        }
                     }
-                    else
+
+                    ivxi[nh-1] += 0.25*dt*GQ[nh-1];
+                    for (j = nh-1; j > 0; j--)
                     {
-                        GQ[j+1] = 0;
+                        Efac      = exp(-0.125*dt*ivxi[j]);
+                        ivxi[j-1] = Efac*(ivxi[j-1]*Efac + 0.25*dt*GQ[j-1]);
                     }
-                }
-
-                ivxi[nh-1] += 0.25*dt*GQ[nh-1];
-                for (j = nh-1; j > 0; j--)
-                {
-                    Efac      = exp(-0.125*dt*ivxi[j]);
-                    ivxi[j-1] = Efac*(ivxi[j-1]*Efac + 0.25*dt*GQ[j-1]);
-                }
 
-                Efac = exp(-0.5*dt*ivxi[0]);
-                if (bBarostat)
-                {
-                    *veta *= Efac;
-                }
-                else
-                {
-                    scalefac[i] *= Efac;
-                }
-                Ekin *= (Efac*Efac);
+                    Efac = exp(-0.5*dt*ivxi[0]);
+                    if (bBarostat)
+                    {
+                        *veta *= Efac;
+                    }
+                    else
+                    {
+                        scalefac[i] *= Efac;
+                    }
+                    Ekin *= (Efac*Efac);
 
-                /* Issue - if the KE is an average of the last and the current temperatures, then we might not be
-                   able to scale the kinetic energy directly with this factor.  Might take more bookkeeping -- have to
-                   think about this a bit more . . . */
+                    /* Issue - if the KE is an average of the last and the current temperatures, then we might not be
+                       able to scale the kinetic energy directly with this factor.  Might take more bookkeeping -- have to
+                       think about this a bit more . . . */
 
-                GQ[0] = iQinv[0]*(Ekin - nd*kT);
+                    GQ[0] = iQinv[0]*(Ekin - nd*kT);
 
-                /* update thermostat positions */
-                for (j = 0; j < nh; j++)
-                {
-                    ixi[j] += 0.5*dt*ivxi[j];
-                }
-
-                for (j = 0; j < nh-1; j++)
-                {
-                    Efac    = exp(-0.125*dt*ivxi[j+1]);
-                    ivxi[j] = Efac*(ivxi[j]*Efac + 0.25*dt*GQ[j]);
-                    if (iQinv[j+1] > 0)
+                    /* update thermostat positions */
+                    for (j = 0; j < nh; j++)
                     {
-                        GQ[j+1] = iQinv[j+1]*((sqr(ivxi[j])/iQinv[j])-kT);
+                        ixi[j] += 0.5*dt*ivxi[j];
                     }
-                    else
+
+                    for (j = 0; j < nh-1; j++)
                     {
-                        GQ[j+1] = 0;
+                        Efac    = exp(-0.125*dt*ivxi[j+1]);
+                        ivxi[j] = Efac*(ivxi[j]*Efac + 0.25*dt*GQ[j]);
+                        if (iQinv[j+1] > 0)
+                        {
+                            GQ[j+1] = iQinv[j+1]*((sqr(ivxi[j])/iQinv[j])-kT);
+                        }
+                        else
+                        {
+                            GQ[j+1] = 0;
+                        }
                     }
+                    ivxi[nh-1] += 0.25*dt*GQ[nh-1];
                 }
-                ivxi[nh-1] += 0.25*dt*GQ[nh-1];
             }
         }
+        sfree(GQ);
     }
-    sfree(GQ);
 }
 
 static void boxv_trotter(t_inputrec *ir, real *veta, real dt, tensor box,
@@ -836,7 +848,7 @@ void trotter_update(t_inputrec *ir, gmx_int64_t step, gmx_ekindata_t *ekind,
                     t_extmass *MassQ, int **trotter_seqlist, int trotter_seqno)
 {
 
-    int             n, i, d, ngtc, gc = 0;
+    int             n, i, d, ngtc, nth;
     t_grp_tcstat   *tcstat;
     t_grpopts      *opts;
     gmx_int64_t     step_eff;
@@ -921,18 +933,25 @@ void trotter_update(t_inputrec *ir, gmx_int64_t step, gmx_ekindata_t *ekind,
                 /* but do we actually need the total? */
 
                 /* modify the velocities as well */
+                nth = gmx_omp_nthreads_get(emntUpdate);
+#pragma omp parallel for num_threads(nth) schedule(static)
                 for (n = 0; n < md->homenr; n++)
                 {
+                    int gc = 0, m;
+
                     if (md->cTC) /* does this conditional need to be here? is this always true?*/
                     {
                         gc = md->cTC[n];
                     }
-                    for (d = 0; d < DIM; d++)
+                    for (m = 0; m < DIM; m++)
                     {
-                        state->v[n][d] *= scalefac[gc];
+                        state->v[n][m] *= scalefac[gc];
                     }
+                }
 
-                    if (debug)
+                if (debug)
+                {
+                    for (n = 0; n < md->homenr; n++)
                     {
                         for (d = 0; d < DIM; d++)
                         {
@@ -43,9 +43,19 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/pbcutil/pbc-simd.h"
+#include "gromacs/simd/gather_scatter_rvec.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
+#include "gromacs/simd/vector_operations.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/smalloc.h"
 
+/* MSVC 2010 produces buggy SIMD PBC code, disable SIMD for MSVC <= 2010 */
+#if defined GMX_SIMD_HAVE_REAL && !(defined _MSC_VER && _MSC_VER < 1700) && !defined(__ICL)
+#define SETTLE_SIMD
+#endif
+
 typedef struct
 {
     real   mO;
@@ -275,13 +285,18 @@ void settle_proj(gmx_settledata_t settled, int econq,
 }
 
 
-void csettle(gmx_settledata_t settled,
-             int nsettle, t_iatom iatoms[],
-             const t_pbc *pbc,
-             real b4[], real after[],
-             real invdt, real *v, int CalcVirAtomEnd,
-             tensor vir_r_m_dr,
-             int *error)
+/* Settles the waters start to end-1 in iatoms with scalar code.
+ * Sets *error to the index of a water that could not be settled,
+ * but does not reset *error when all waters were settled.
+ * CalcVirAtomEnd should be passed as a coordinate index, i.e. times DIM.
+ */
+static void settle_scalar(const settleparam_t *p,
+                          int start, int end, const t_iatom iatoms[],
+                          const t_pbc *pbc,
+                          real b4[], real after[],
+                          real invdt, real *v, int CalcVirAtomEnd,
+                          tensor vir_r_m_dr,
+                          int *error)
 {
     /* ***************************************************************** */
     /*                                                               ** */
@@ -295,7 +310,6 @@ void csettle(gmx_settledata_t settled,
     /* ***************************************************************** */
 
     /* Initialized data */
-    settleparam_t *p;
     real           wh, ra, rb, rc, irc2;
     real           mO, mH;
 
@@ -322,11 +336,6 @@ void csettle(gmx_settledata_t settled,
     rvec     doh2, doh3;
     int      is;
 
-    *error = -1;
-
-    CalcVirAtomEnd *= 3;
-
-    p     = &settled->massw;
     wh    = p->wh;
     rc    = p->rc;
     ra    = p->ra;
@@ -338,7 +347,7 @@ void csettle(gmx_settledata_t settled,
 #ifdef PRAGMAS
 #pragma ivdep
 #endif
-    for (i = 0; i < nsettle; ++i)
+    for (i = start; i < end; ++i)
     {
         bOK = TRUE;
         /*    --- Step1  A1' ---      */
@@ -606,3 +615,376 @@ void csettle(gmx_settledata_t settled,
 #endif
     }
 }
+
+#ifdef SETTLE_SIMD
+
+/* Settles nsettle waters, which should be a multiple of the SIMD width,
+ * GMX_SIMD_REAL_WIDTH waters at a time. This is the same algorithm
+ * as in settle_scalar. When a batch contains a water that can not be
+ * settled, the batch is processed with settle_scalar, so the waters
+ * that can be settled are and the error is reported as with scalar code.
+ */
+static void settle_simd(const settleparam_t *p,
+                        int nsettle, const t_iatom iatoms[],
+                        const t_pbc *pbc,
+                        real b4[], real after[],
+                        real invdt, real *v, int CalcVirAtomEnd,
+                        tensor vir_r_m_dr,
+                        int *error)
+{
+    int             i, s, d, d2;
+    int             ow1[GMX_SIMD_REAL_WIDTH], hw2[GMX_SIMD_REAL_WIDTH];
+    int             hw3[GMX_SIMD_REAL_WIDTH];
+    real            buf_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
+    real            mask_array[2*GMX_SIMD_REAL_WIDTH], *vir_mask;
+    gmx_bool        bCalcVir;
+    pbc_simd_t      pbc_simd;
+    gmx_simd_real_t one_S, zero_S, invdt_S;
+    gmx_simd_real_t wh_S, ra_S, rb_S, rc_S, irc2_S, invra_S, mO_S, mH_S;
+    gmx_simd_real_t sum_S[DIM][DIM];
+    gmx_simd_real_t x_ow1_S, y_ow1_S, z_ow1_S;
+    gmx_simd_real_t xa_S, ya_S, za_S, xh2_S, yh2_S, zh2_S, xh3_S, yh3_S, zh3_S;
+    gmx_simd_real_t xb0_S, yb0_S, zb0_S, xc0_S, yc0_S, zc0_S;
+    gmx_simd_real_t xdoh2_S, ydoh2_S, zdoh2_S, xdoh3_S, ydoh3_S, zdoh3_S;
+    gmx_simd_real_t xsh2_S, ysh2_S, zsh2_S, xsh3_S, ysh3_S, zsh3_S;
+    gmx_simd_real_t xa1_S, ya1_S, za1_S, xcom_S, ycom_S, zcom_S;
+    gmx_simd_real_t xb1_S, yb1_S, zb1_S, xc1_S, yc1_S, zc1_S;
+    gmx_simd_real_t xakszd_S, yakszd_S, zakszd_S;
+    gmx_simd_real_t xaksxd_S, yaksxd_S, zaksxd_S;
+    gmx_simd_real_t xaksyd_S, yaksyd_S, zaksyd_S;
+    gmx_simd_real_t axlng_S, aylng_S, azlng_S;
+    gmx_simd_real_t trns11_S, trns21_S, trns31_S, trns12_S, trns22_S, trns32_S;
+    gmx_simd_real_t trns13_S, trns23_S, trns33_S;
+    gmx_simd_real_t xb0d_S, yb0d_S, xc0d_S, yc0d_S, za1d_S;
+    gmx_simd_real_t xb1d_S, yb1d_S, zb1d_S, xc1d_S, yc1d_S, zc1d_S;
+    gmx_simd_real_t sinphi_S, cosphi_S, sinpsi_S, cospsi_S, sinthe_S, costhe_S;
+    gmx_simd_real_t tmp_S, tmp2_S, t1_S, t2_S;
+    gmx_simd_real_t ya2d_S, xb2d_S, yb2d_S, yc2d_S;
+    gmx_simd_real_t alpa_S, beta_S, gama_S, al2be2_S;
+    gmx_simd_real_t xa3d_S, ya3d_S, xb3d_S, yb3d_S, xc3d_S, yc3d_S;
+    gmx_simd_real_t xa3_S, ya3_S, za3_S, xb3_S, yb3_S, zb3_S, xc3_S, yc3_S, zc3_S;
+    gmx_simd_real_t dax_S, day_S, daz_S, dbx_S, dby_S, dbz_S, dcx_S, dcy_S, dcz_S;
+    gmx_simd_real_t vx_S, vy_S, vz_S;
+    gmx_simd_real_t mOm_S, mHm_S;
+    gmx_simd_bool_t bError_S;
+
+    /* Ensure register memory alignment */
+    buf      = gmx_simd_align_r(buf_array);
+    vir_mask = gmx_simd_align_r(mask_array);
+
+    /* Without PBC, set_pbc_simd sets zero shifts, so we can always do PBC */
+    set_pbc_simd(pbc, &pbc_simd);
+
+    one_S   = gmx_simd_set1_r(1.0);
+    zero_S  = gmx_simd_setzero_r();
+    invdt_S = gmx_simd_set1_r(invdt);
+    wh_S    = gmx_simd_set1_r(p->wh);
+    ra_S    = gmx_simd_set1_r(p->ra);
+    rb_S    = gmx_simd_set1_r(p->rb);
+    rc_S    = gmx_simd_set1_r(p->rc);
+    irc2_S  = gmx_simd_set1_r(p->irc2);
+    invra_S = gmx_simd_set1_r(gmx_invsqrt(p->ra*p->ra));
+    mO_S    = gmx_simd_set1_r(p->mO);
+    mH_S    = gmx_simd_set1_r(p->mH);
+
+    bCalcVir = (CalcVirAtomEnd > 0);
+    for (d = 0; d < DIM; d++)
+    {
+        for (d2 = 0; d2 < DIM; d2++)
+        {
+            sum_S[d][d2] = zero_S;
+        }
+    }
+
+    for (i = 0; i < nsettle; i += GMX_SIMD_REAL_WIDTH)
+    {
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            ow1[s]      = iatoms[(i + s)*4 + 1];
+            hw2[s]      = iatoms[(i + s)*4 + 2];
+            hw3[s]      = iatoms[(i + s)*4 + 3];
+            vir_mask[s] = (ow1[s]*DIM < CalcVirAtomEnd ? 1 : 0);
+        }
+
+        /*    --- Step1  A1' ---      */
+        gmx_hack_simd_gather_rvec_index((const rvec *)b4, ow1, buf, &x_ow1_S, &y_ow1_S, &z_ow1_S);
+        gmx_hack_simd_gather_rvec_index((const rvec *)b4, hw2, buf, &xb0_S, &yb0_S, &zb0_S);
+        gmx_hack_simd_gather_rvec_index((const rvec *)b4, hw3, buf, &xc0_S, &yc0_S, &zc0_S);
+        xb0_S = gmx_simd_sub_r(xb0_S, x_ow1_S);
+        yb0_S = gmx_simd_sub_r(yb0_S, y_ow1_S);
+        zb0_S = gmx_simd_sub_r(zb0_S, z_ow1_S);
+        xc0_S = gmx_simd_sub_r(xc0_S, x_ow1_S);
+        yc0_S = gmx_simd_sub_r(yc0_S, y_ow1_S);
+        zc0_S = gmx_simd_sub_r(zc0_S, z_ow1_S);
+        pbc_correct_dx_simd(&xb0_S, &yb0_S, &zb0_S, &pbc_simd);
+        pbc_correct_dx_simd(&xc0_S, &yc0_S, &zc0_S, &pbc_simd);
+
+        gmx_hack_simd_gather_rvec_index((const rvec *)after, ow1, buf, &xa_S, &ya_S, &za_S);
+        gmx_hack_simd_gather_rvec_index((const rvec *)after, hw2, buf, &xh2_S, &yh2_S, &zh2_S);
+        gmx_hack_simd_gather_rvec_index((const rvec *)after, hw3, buf, &xh3_S, &yh3_S, &zh3_S);
+        xsh2_S  = gmx_simd_sub_r(xh2_S, xa_S);
+        ysh2_S  = gmx_simd_sub_r(yh2_S, ya_S);
+        zsh2_S  = gmx_simd_sub_r(zh2_S, za_S);
+        xsh3_S  = gmx_simd_sub_r(xh3_S, xa_S);
+        ysh3_S  = gmx_simd_sub_r(yh3_S, ya_S);
+        zsh3_S  = gmx_simd_sub_r(zh3_S, za_S);
+        xdoh2_S = xsh2_S;
+        ydoh2_S = ysh2_S;
+        zdoh2_S = zsh2_S;
+        xdoh3_S = xsh3_S;
+        ydoh3_S = ysh3_S;
+        zdoh3_S = zsh3_S;
+        pbc_correct_dx_simd(&xdoh2_S, &ydoh2_S, &zdoh2_S, &pbc_simd);
+        pbc_correct_dx_simd(&xdoh3_S, &ydoh3_S, &zdoh3_S, &pbc_simd);
+        /* The PBC shifts of the hydrogens, these are exactly zero
+         * when no shift was applied.
+         */
+        xsh2_S  = gmx_simd_sub_r(xsh2_S, xdoh2_S);
+        ysh2_S  = gmx_simd_sub_r(ysh2_S, ydoh2_S);
+        zsh2_S  = gmx_simd_sub_r(zsh2_S, zdoh2_S);
+        xsh3_S  = gmx_simd_sub_r(xsh3_S, xdoh3_S);
+        ysh3_S  = gmx_simd_sub_r(ysh3_S, ydoh3_S);
+        zsh3_S  = gmx_simd_sub_r(zsh3_S, zdoh3_S);
+
+        /* Compute the center of mass using the O-H distances,
+         * see the comment in settle_scalar.
+         */
+        xa1_S  = gmx_simd_mul_r(gmx_simd_add_r(xdoh2_S, xdoh3_S), gmx_simd_sub_r(zero_S, wh_S));
+        ya1_S  = gmx_simd_mul_r(gmx_simd_add_r(ydoh2_S, ydoh3_S), gmx_simd_sub_r(zero_S, wh_S));
+        za1_S  = gmx_simd_mul_r(gmx_simd_add_r(zdoh2_S, zdoh3_S), gmx_simd_sub_r(zero_S, wh_S));
+
+        xcom_S = gmx_simd_sub_r(xa_S, xa1_S);
+        ycom_S = gmx_simd_sub_r(ya_S, ya1_S);
+        zcom_S = gmx_simd_sub_r(za_S, za1_S);
+
+        xb1_S  = gmx_simd_sub_r(gmx_simd_sub_r(xh2_S, xsh2_S), xcom_S);
+        yb1_S  = gmx_simd_sub_r(gmx_simd_sub_r(yh2_S, ysh2_S), ycom_S);
+        zb1_S  = gmx_simd_sub_r(gmx_simd_sub_r(zh2_S, zsh2_S), zcom_S);
+        xc1_S  = gmx_simd_sub_r(gmx_simd_sub_r(xh3_S, xsh3_S), xcom_S);
+        yc1_S  = gmx_simd_sub_r(gmx_simd_sub_r(yh3_S, ysh3_S), ycom_S);
+        zc1_S  = gmx_simd_sub_r(gmx_simd_sub_r(zh3_S, zsh3_S), zcom_S);
+
+        gmx_simd_cprod_r(xb0_S, yb0_S, zb0_S, xc0_S, yc0_S, zc0_S,
+                         &xakszd_S, &yakszd_S, &zakszd_S);
+        gmx_simd_cprod_r(xa1_S, ya1_S, za1_S, xakszd_S, yakszd_S, zakszd_S,
+                         &xaksxd_S, &yaksxd_S, &zaksxd_S);
+        gmx_simd_cprod_r(xakszd_S, yakszd_S, zakszd_S, xaksxd_S, yaksxd_S, zaksxd_S,
+                         &xaksyd_S, &yaksyd_S, &zaksyd_S);
+
+        axlng_S  = gmx_simd_invsqrt_r(gmx_simd_norm2_r(xaksxd_S, yaksxd_S, zaksxd_S));
+        aylng_S  = gmx_simd_invsqrt_r(gmx_simd_norm2_r(xaksyd_S, yaksyd_S, zaksyd_S));
+        azlng_S  = gmx_simd_invsqrt_r(gmx_simd_norm2_r(xakszd_S, yakszd_S, zakszd_S));
+
+        trns11_S = gmx_simd_mul_r(xaksxd_S, axlng_S);
+        trns21_S = gmx_simd_mul_r(yaksxd_S, axlng_S);
+        trns31_S = gmx_simd_mul_r(zaksxd_S, axlng_S);
+        trns12_S = gmx_simd_mul_r(xaksyd_S, aylng_S);
+        trns22_S = gmx_simd_mul_r(yaksyd_S, aylng_S);
+        trns32_S = gmx_simd_mul_r(zaksyd_S, aylng_S);
+        trns13_S = gmx_simd_mul_r(xakszd_S, azlng_S);
+        trns23_S = gmx_simd_mul_r(yakszd_S, azlng_S);
+        trns33_S = gmx_simd_mul_r(zakszd_S, azlng_S);
+
+        xb0d_S   = gmx_simd_iprod_r(trns11_S, trns21_S, trns31_S, xb0_S, yb0_S, zb0_S);
+        yb0d_S   = gmx_simd_iprod_r(trns12_S, trns22_S, trns32_S, xb0_S, yb0_S, zb0_S);
+        xc0d_S   = gmx_simd_iprod_r(trns11_S, trns21_S, trns31_S, xc0_S, yc0_S, zc0_S);
+        yc0d_S   = gmx_simd_iprod_r(trns12_S, trns22_S, trns32_S, xc0_S, yc0_S, zc0_S);
+        za1d_S   = gmx_simd_iprod_r(trns13_S, trns23_S, trns33_S, xa1_S, ya1_S, za1_S);
+        xb1d_S   = gmx_simd_iprod_r(trns11_S, trns21_S, trns31_S, xb1_S, yb1_S, zb1_S);
+        yb1d_S   = gmx_simd_iprod_r(trns12_S, trns22_S, trns32_S, xb1_S, yb1_S, zb1_S);
+        zb1d_S   = gmx_simd_iprod_r(trns13_S, trns23_S, trns33_S, xb1_S, yb1_S, zb1_S);
+        xc1d_S   = gmx_simd_iprod_r(trns11_S, trns21_S, trns31_S, xc1_S, yc1_S, zc1_S);
+        yc1d_S   = gmx_simd_iprod_r(trns12_S, trns22_S, trns32_S, xc1_S, yc1_S, zc1_S);
+        zc1d_S   = gmx_simd_iprod_r(trns13_S, trns23_S, trns33_S, xc1_S, yc1_S, zc1_S);
+
+        /* Check if all waters in this batch can be settled before
+         * taking square roots, when not, let the scalar code handle
+         * and report the waters in this batch.
+         */
+        sinphi_S = gmx_simd_mul_r(za1d_S, invra_S);
+        tmp_S    = gmx_simd_fnmadd_r(sinphi_S, sinphi_S, one_S);
+        bError_S = gmx_simd_cmple_r(tmp_S, zero_S);
+        if (gmx_simd_anytrue_b(bError_S))
+        {
+            settle_scalar(p, i, i + GMX_SIMD_REAL_WIDTH, iatoms, pbc, b4, after,
+                          invdt, v, CalcVirAtomEnd, vir_r_m_dr, error);
+            continue;
+        }
+        tmp2_S   = gmx_simd_invsqrt_r(tmp_S);
+        cosphi_S = gmx_simd_mul_r(tmp_S, tmp2_S);
+        sinpsi_S = gmx_simd_mul_r(gmx_simd_mul_r(gmx_simd_sub_r(zb1d_S, zc1d_S), irc2_S), tmp2_S);
+        tmp2_S   = gmx_simd_fnmadd_r(sinpsi_S, sinpsi_S, one_S);
+        bError_S = gmx_simd_cmple_r(tmp2_S, zero_S);
+        if (gmx_simd_anytrue_b(bError_S))
+        {
+            settle_scalar(p, i, i + GMX_SIMD_REAL_WIDTH, iatoms, pbc, b4, after,
+                          invdt, v, CalcVirAtomEnd, vir_r_m_dr, error);
+            continue;
+        }
+        cospsi_S = gmx_simd_mul_r(tmp2_S, gmx_simd_invsqrt_r(tmp2_S));
+
+        ya2d_S   = gmx_simd_mul_r(ra_S, cosphi_S);
+        xb2d_S   = gmx_simd_sub_r(zero_S, gmx_simd_mul_r(rc_S, cospsi_S));
+        t1_S     = gmx_simd_sub_r(zero_S, gmx_simd_mul_r(rb_S, cosphi_S));
+        t2_S     = gmx_simd_mul_r(gmx_simd_mul_r(rc_S, sinpsi_S), sinphi_S);
+        yb2d_S   = gmx_simd_sub_r(t1_S, t2_S);
+        yc2d_S   = gmx_simd_add_r(t1_S, t2_S);
+
+        /*     --- Step3  al,be,ga            --- */
+        alpa_S   = gmx_simd_fmadd_r(xb2d_S, gmx_simd_sub_r(xb0d_S, xc0d_S),
+                                    gmx_simd_fmadd_r(yb0d_S, yb2d_S,
+                                                     gmx_simd_mul_r(yc0d_S, yc2d_S)));
+        beta_S   = gmx_simd_fmadd_r(xb2d_S, gmx_simd_sub_r(yc0d_S, yb0d_S),
+                                    gmx_simd_fmadd_r(xb0d_S, yb2d_S,
+                                                     gmx_simd_mul_r(xc0d_S, yc2d_S)));
+        gama_S   = gmx_simd_sub_r(gmx_simd_fmsub_r(xb0d_S, yb1d_S, gmx_simd_mul_r(xb1d_S, yb0d_S)),
+                                  gmx_simd_fnmadd_r(xc0d_S, yc1d_S, gmx_simd_mul_r(xc1d_S, yc0d_S)));
+        al2be2_S = gmx_simd_fmadd_r(alpa_S, alpa_S, gmx_simd_mul_r(beta_S, beta_S));
+        tmp2_S   = gmx_simd_fnmadd_r(gama_S, gama_S, al2be2_S);
+        sinthe_S = gmx_simd_mul_r(gmx_simd_fnmadd_r(beta_S,
+                                                    gmx_simd_mul_r(tmp2_S, gmx_simd_invsqrt_r(tmp2_S)),
+                                                    gmx_simd_mul_r(alpa_S, gama_S)),
+                                  gmx_simd_invsqrt_r(gmx_simd_mul_r(al2be2_S, al2be2_S)));
+
+        /*  --- Step4  A3' --- */
+        tmp2_S   = gmx_simd_fnmadd_r(sinthe_S, sinthe_S, one_S);
+        costhe_S = gmx_simd_mul_r(tmp2_S, gmx_simd_invsqrt_r(tmp2_S));
+        xa3d_S   = gmx_simd_sub_r(zero_S, gmx_simd_mul_r(ya2d_S, sinthe_S));
+        ya3d_S   = gmx_simd_mul_r(ya2d_S, costhe_S);
+        xb3d_S   = gmx_simd_fmsub_r(xb2d_S, costhe_S, gmx_simd_mul_r(yb2d_S, sinthe_S));
+        yb3d_S   = gmx_simd_fmadd_r(xb2d_S, sinthe_S, gmx_simd_mul_r(yb2d_S, costhe_S));
+        xc3d_S   = gmx_simd_fnmadd_r(xb2d_S, costhe_S, gmx_simd_sub_r(zero_S, gmx_simd_mul_r(yc2d_S, sinthe_S)));
+        yc3d_S   = gmx_simd_fnmadd_r(xb2d_S, sinthe_S, gmx_simd_mul_r(yc2d_S, costhe_S));
+
+        /*    --- Step5  A3 --- */
+        xa3_S    = gmx_simd_iprod_r(trns11_S, trns12_S, trns13_S, xa3d_S, ya3d_S, za1d_S);
+        ya3_S    = gmx_simd_iprod_r(trns21_S, trns22_S, trns23_S, xa3d_S, ya3d_S, za1d_S);
+        za3_S    = gmx_simd_iprod_r(trns31_S, trns32_S, trns33_S, xa3d_S, ya3d_S, za1d_S);
+        xb3_S    = gmx_simd_iprod_r(trns11_S, trns12_S, trns13_S, xb3d_S, yb3d_S, zb1d_S);
+        yb3_S    = gmx_simd_iprod_r(trns21_S, trns22_S, trns23_S, xb3d_S, yb3d_S, zb1d_S);
+        zb3_S    = gmx_simd_iprod_r(trns31_S, trns32_S, trns33_S, xb3d_S, yb3d_S, zb1d_S);
+        xc3_S    = gmx_simd_iprod_r(trns11_S, trns12_S, trns13_S, xc3d_S, yc3d_S, zc1d_S);
+        yc3_S    = gmx_simd_iprod_r(trns21_S, trns22_S, trns23_S, xc3d_S, yc3d_S, zc1d_S);
+        zc3_S    = gmx_simd_iprod_r(trns31_S, trns32_S, trns33_S, xc3d_S, yc3d_S, zc1d_S);
+
+        gmx_hack_simd_scatter_rvec_index(gmx_simd_add_r(xcom_S, xa3_S),
+                                         gmx_simd_add_r(ycom_S, ya3_S),
+                                         gmx_simd_add_r(zcom_S, za3_S),
+                                         buf, (rvec *)after, ow1);
+        gmx_hack_simd_scatter_rvec_index(gmx_simd_add_r(gmx_simd_add_r(xcom_S, xb3_S), xsh2_S),
+                                         gmx_simd_add_r(gmx_simd_add_r(ycom_S, yb3_S), ysh2_S),
+                                         gmx_simd_add_r(gmx_simd_add_r(zcom_S, zb3_S), zsh2_S),
+                                         buf, (rvec *)after, hw2);
+        gmx_hack_simd_scatter_rvec_index(gmx_simd_add_r(gmx_simd_add_r(xcom_S, xc3_S), xsh3_S),
+                                         gmx_simd_add_r(gmx_simd_add_r(ycom_S, yc3_S), ysh3_S),
+                                         gmx_simd_add_r(gmx_simd_add_r(zcom_S, zc3_S), zsh3_S),
+                                         buf, (rvec *)after, hw3);
+
+        dax_S = gmx_simd_sub_r(xa3_S, xa1_S);
+        day_S = gmx_simd_sub_r(ya3_S, ya1_S);
+        daz_S = gmx_simd_sub_r(za3_S, za1_S);
+        dbx_S = gmx_simd_sub_r(xb3_S, xb1_S);
+        dby_S = gmx_simd_sub_r(yb3_S, yb1_S);
+        dbz_S = gmx_simd_sub_r(zb3_S, zb1_S);
+        dcx_S = gmx_simd_sub_r(xc3_S, xc1_S);
+        dcy_S = gmx_simd_sub_r(yc3_S, yc1_S);
+        dcz_S = gmx_simd_sub_r(zc3_S, zc1_S);
+
+        if (v != NULL)
+        {
+            gmx_hack_simd_gather_rvec_index((const rvec *)v, ow1, buf, &vx_S, &vy_S, &vz_S);
+            gmx_hack_simd_scatter_rvec_index(gmx_simd_fmadd_r(dax_S, invdt_S, vx_S),
+                                             gmx_simd_fmadd_r(day_S, invdt_S, vy_S),
+                                             gmx_simd_fmadd_r(daz_S, invdt_S, vz_S),
+                                             buf, (rvec *)v, ow1);
+            gmx_hack_simd_gather_rvec_index((const rvec *)v, hw2, buf, &vx_S, &vy_S, &vz_S);
+            gmx_hack_simd_scatter_rvec_index(gmx_simd_fmadd_r(dbx_S, invdt_S, vx_S),
+                                             gmx_simd_fmadd_r(dby_S, invdt_S, vy_S),
+                                             gmx_simd_fmadd_r(dbz_S, invdt_S, vz_S),
+                                             buf, (rvec *)v, hw2);
+            gmx_hack_simd_gather_rvec_index((const rvec *)v, hw3, buf, &vx_S, &vy_S, &vz_S);
+            gmx_hack_simd_scatter_rvec_index(gmx_simd_fmadd_r(dcx_S, invdt_S, vx_S),
+                                             gmx_simd_fmadd_r(dcy_S, invdt_S, vy_S),
+                                             gmx_simd_fmadd_r(dcz_S, invdt_S, vz_S),
+                                             buf, (rvec *)v, hw3);
+        }
+
+        if (bCalcVir)
+        {
+            gmx_simd_real_t xO_S[DIM], xb_S[DIM], xc_S[DIM];
+            gmx_simd_real_t mda_S[DIM], mdb_S[DIM], mdc_S[DIM];
+
+            /* Zero the masses of waters that do not contribute */
+            mOm_S    = gmx_simd_mul_r(mO_S, gmx_simd_load_r(vir_mask));
+            mHm_S    = gmx_simd_mul_r(mH_S, gmx_simd_load_r(vir_mask));
+
+            xO_S[XX] = x_ow1_S;
+            xO_S[YY] = y_ow1_S;
+            xO_S[ZZ] = z_ow1_S;
+            xb_S[XX] = gmx_simd_add_r(x_ow1_S, xb0_S);
+            xb_S[YY] = gmx_simd_add_r(y_ow1_S, yb0_S);
+            xb_S[ZZ] = gmx_simd_add_r(z_ow1_S, zb0_S);
+            xc_S[XX] = gmx_simd_add_r(x_ow1_S, xc0_S);
+            xc_S[YY] = gmx_simd_add_r(y_ow1_S, yc0_S);
+            xc_S[ZZ] = gmx_simd_add_r(z_ow1_S, zc0_S);
+
+            mda_S[XX] = gmx_simd_mul_r(mOm_S, dax_S);
+            mda_S[YY] = gmx_simd_mul_r(mOm_S, day_S);
+            mda_S[ZZ] = gmx_simd_mul_r(mOm_S, daz_S);
+            mdb_S[XX] = gmx_simd_mul_r(mHm_S, dbx_S);
+            mdb_S[YY] = gmx_simd_mul_r(mHm_S, dby_S);
+            mdb_S[ZZ] = gmx_simd_mul_r(mHm_S, dbz_S);
+            mdc_S[XX] = gmx_simd_mul_r(mHm_S, dcx_S);
+            mdc_S[YY] = gmx_simd_mul_r(mHm_S, dcy_S);
+            mdc_S[ZZ] = gmx_simd_mul_r(mHm_S, dcz_S);
+
+            for (d = 0; d < DIM; d++)
+            {
+                for (d2 = 0; d2 < DIM; d2++)
+                {
+                    sum_S[d][d2] = gmx_simd_fmadd_r(xO_S[d], mda_S[d2], sum_S[d][d2]);
+                    sum_S[d][d2] = gmx_simd_fmadd_r(xb_S[d], mdb_S[d2], sum_S[d][d2]);
+                    sum_S[d][d2] = gmx_simd_fmadd_r(xc_S[d], mdc_S[d2], sum_S[d][d2]);
+                }
+            }
+        }
+    }
+
+    if (bCalcVir)
+    {
+        for (d = 0; d < DIM; d++)
+        {
+            for (d2 = 0; d2 < DIM; d2++)
+            {
+                vir_r_m_dr[d][d2] -= gmx_simd_reduce_r(sum_S[d][d2]);
+            }
+        }
+    }
+}
+
+#endif /* SETTLE_SIMD */
+
+void csettle(gmx_settledata_t settled,
+             int nsettle, t_iatom iatoms[],
+             const t_pbc *pbc,
+             real b4[], real after[],
+             real invdt, real *v, int CalcVirAtomEnd,
+             tensor vir_r_m_dr,
+             int *error)
+{
+    int start_scalar;
+
+    *error = -1;
+
+    CalcVirAtomEnd *= DIM;
+
+    start_scalar = 0;
+#ifdef SETTLE_SIMD
+    /* Settle full SIMD batches of waters, the remainder with scalar code */
+    start_scalar = (nsettle/GMX_SIMD_REAL_WIDTH)*GMX_SIMD_REAL_WIDTH;
+    settle_simd(&settled->massw, start_scalar, iatoms, pbc, b4, after,
+                invdt, v, CalcVirAtomEnd, vir_r_m_dr, error);
+#endif
+    settle_scalar(&settled->massw, start_scalar, nsettle, iatoms, pbc, b4, after,
+                  invdt, v, CalcVirAtomEnd, vir_r_m_dr, error);
+}
@@ -66,6 +66,7 @@
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/mshift.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/timing/cyclecounter.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/smalloc.h"
@@ -164,14 +165,15 @@ void do_force_lowlevel(t_forcerec *fr,      t_inputrec *ir,
                        int        flags,
                        float      *cycles_pme)
 {
-    int         i, j;
-    int         donb_flags;
-    gmx_bool    bSB;
-    int         pme_flags;
-    matrix      boxs;
-    rvec        box_size;
-    t_pbc       pbc;
-    real        dvdl_dum[efptNR], dvdl_nb[efptNR];
+    int          i, j;
+    int          donb_flags;
+    gmx_bool     bSB;
+    int          pme_flags;
+    matrix       boxs;
+    rvec         box_size;
+    t_pbc        pbc;
+    real         dvdl_dum[efptNR], dvdl_nb[efptNR];
+    gmx_cycles_t cycles_listed = 0;
 
 #ifdef GMX_MPI
     double  t0 = 0.0, t1, t2, t3; /* time measurement for coarse load balancing */
@@ -385,12 +387,24 @@ void do_force_lowlevel(t_forcerec *fr,      t_inputrec *ir,
     }
     debug_gmx();
 
+    if (DOMAINDECOMP(cr))
+    {
+        /* The dynamic load balancing needs the listed part of the force load */
+        cycles_listed = gmx_cycles_read();
+    }
+
     do_force_listed(wcycle, box, ir->fepvals, cr->ms,
-                    idef, (const rvec *) x, hist, f, fr,
+                    idef, (const rvec *) x, hist, f, f_longrange, fr,
                     &pbc, graph, enerd, nrnb, lambda, md, fcd,
                     DOMAINDECOMP(cr) ? cr->dd->gatindex : NULL,
                     flags);
 
+    if (DOMAINDECOMP(cr))
+    {
+        cycles_listed = gmx_cycles_read() - cycles_listed;
+        dd_cycles_add(cr->dd, (float)cycles_listed, ddCyclListed);
+    }
+
     where();
 
     *cycles_pme = 0;
@@ -400,7 +414,8 @@ void do_force_lowlevel(t_forcerec *fr,      t_inputrec *ir,
     /* Do long-range electrostatics and/or LJ-PME, including related short-range
      * corrections.
      */
-    if (EEL_FULL(fr->eeltype) || EVDW_PME(fr->vdwtype))
+    if ((EEL_FULL(fr->eeltype) || EVDW_PME(fr->vdwtype)) &&
+        !(flags & GMX_FORCE_NOSLOW))
     {
         int  status            = 0;
         real Vlr_q             = 0, Vlr_lj = 0, Vcorr_q = 0, Vcorr_lj = 0;
@@ -538,6 +553,11 @@ void do_force_lowlevel(t_forcerec *fr,      t_inputrec *ir,
                     if (flags & GMX_FORCE_VIRIAL)
                     {
                         pme_flags |= GMX_PME_CALC_ENER_VIR;
+                        if (fr->f_novirsum == f)
+                        {
+                            /* The mesh forces go into the single sum virial */
+                            pme_flags |= GMX_PME_F_IN_VIRSUM;
+                        }
                     }
                     if (fr->n_tpi > 0)
                     {
@@ -45,7 +45,13 @@ extern "C" {
 struct f_thread_t {
     rvec             *f;
     int               f_nalloc;
-    gmx_bitmask_t     red_mask; /* Mask for marking which parts of f are filled */
+    gmx_bitmask_t    *mask;         /* Only for thread 0: mask for each block of f,
+                                     * bit t marks use by thread t */
+    gmx_bool         *block_flag;   /* Only for threads > 0: marks the used blocks */
+    int               nblock_used;  /* Number of blocks used by this thread,
+                                     * for thread 0 by any other thread */
+    int              *block_index;  /* Index of the used blocks, size nblock_used */
+    int               block_nalloc; /* Allocation size of the block arrays */
     rvec             *fshift;
     real              ener[F_NRE];
     gmx_grppairener_t grpp;
@@ -68,6 +68,7 @@
 #include "gromacs/math/units.h"
 #include "gromacs/math/utilities.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/mdlib/calc_verletbuf.h"
 #include "gromacs/mdlib/forcerec-threading.h"
 #include "gromacs/mdlib/nb_verlet.h"
 #include "gromacs/mdlib/nbnxn_atomdata.h"
@@ -1430,7 +1431,7 @@ void forcerec_set_ranges(t_forcerec *fr,
     {
         fr->nalloc_force = over_alloc_dd(fr->natoms_force_constr);
 
-        if (fr->bTwinRange)
+        if (fr->bTwinRange || fr->nstcalcslow > 1)
         {
             srenew(fr->f_twin, fr->nalloc_force);
         }
@@ -2284,6 +2285,87 @@ static void init_nb_verlet(FILE                *fp,
     }
 }
 
+/* Set up dynamic pruning of the pair lists between searches.
+ * This is enabled by setting env.var. GMX_NSTLIST_DYNAMICPRUNING
+ * to the pruning interval in steps. The cut-off of the inner, pruned list
+ * is set with the Verlet buffer estimate for a list lifetime equal to
+ * the pruning interval, such that the outer list can live much longer.
+ */
+static void init_nbnxn_dynamic_pruning(FILE               *fp,
+                                       const t_commrec    *cr,
+                                       nonbonded_verlet_t *nbv,
+                                       const t_inputrec   *ir,
+                                       const gmx_mtop_t   *mtop,
+                                       matrix              box)
+{
+    char                  *env, *end;
+    int                    nstlistPrune, i;
+    t_inputrec             irPrune;
+    verletbuf_list_setup_t ls;
+    real                   rlistInner;
+
+    nbv->bDynamicPruning = FALSE;
+    nbv->nstlistPrune    = 0;
+    nbv->rlistInner      = ir->rlist;
+
+    if ((env = getenv("GMX_NSTLIST_DYNAMICPRUNING")) == NULL)
+    {
+        return;
+    }
+
+    nstlistPrune = strtol(env, &end, 10);
+    if (!end || (*end != 0) || nstlistPrune <= 0)
+    {
+        gmx_fatal(FARGS, "Invalid value passed in GMX_NSTLIST_DYNAMICPRUNING=%s, positive integer required", env);
+    }
+
+    if (!EI_DYNAMICS(ir->eI) || ir->verletbuf_tol <= 0 ||
+        (EI_MD(ir->eI) && ir->etc == etcNO))
+    {
+        md_print_warn(cr, fp, "NOTE: Dynamic pair-list pruning requires dynamics with temperature coupling and verlet-buffer-tolerance, not pruning\n");
+        return;
+    }
+    for (i = 0; i < nbv->ngrp; i++)
+    {
+        if (nbv->grp[i].kernel_type != nbnxnk4xN_SIMD_4xN &&
+            nbv->grp[i].kernel_type != nbnxnk4xN_SIMD_2xNN)
+        {
+            md_print_warn(cr, fp, "NOTE: Dynamic pair-list pruning is only supported with the CPU SIMD kernels, not pruning\n");
+            return;
+        }
+    }
+    if (nstlistPrune >= ir->nstlist)
+    {
+        /* Pruning would never occur between searches */
+        return;
+    }
+
+    /* Determine the buffer required for a list lifetime of nstlistPrune */
+    irPrune         = *ir;
+    irPrune.nstlist = nstlistPrune;
+    verletbuf_get_list_setup(FALSE, &ls);
+    calc_verlet_buffer_size(mtop, det(box), &irPrune, -1, &ls, NULL,
+                            &rlistInner);
+    if (rlistInner >= ir->rlist)
+    {
+        return;
+    }
+
+    nbv->bDynamicPruning = TRUE;
+    nbv->nstlistPrune    = nstlistPrune;
+    nbv->rlistInner      = rlistInner;
+    for (i = 0; i < nbv->ngrp; i++)
+    {
+        nbv->grp[i].nbl_lists.bDynamicPruning = TRUE;
+    }
+
+    if (fp != NULL)
+    {
+        fprintf(fp, "Using dynamic pair-list pruning every %d steps with rlist %g, outer list with rlist %g every %d steps\n\n",
+                nbv->nstlistPrune, nbv->rlistInner, ir->rlist, ir->nstlist);
+    }
+}
+
 gmx_bool usingGpu(nonbonded_verlet_t *nbv)
 {
     return nbv != NULL && nbv->bUseGPU;
@@ -2650,6 +2732,9 @@ void init_forcerec(FILE              *fp,
     fr->bTwinRange = fr->rlistlong > fr->rlist;
     fr->bEwald     = (EEL_PME(fr->eeltype) || fr->eeltype == eelEWALD);
 
+    fr->nstcalcslow = ir->nstcalcslow;
+    fr->eSlowListed = (ir->nstcalcslow > 1 ? ir->eSlowListed : eslowlistedNO);
+
     fr->reppow     = mtop->ffparams.reppow;
 
     if (ir->cutoff_scheme == ecutsGROUP)
@@ -2806,6 +2891,34 @@ void init_forcerec(FILE              *fp,
                        (fr->adress_icor != eAdressICOff)
                        );
 
+    /* With the Verlet scheme the Ewald exclusion forces are computed
+     * in the non-bonded kernels, so with tin-foil boundary conditions
+     * only the PME gather writes to f_novirsum.
+     */
+    fr->bF_NoVirSumInF = (fr->bF_NoVirSum &&
+                          fr->cutoff_scheme == ecutsVERLET &&
+                          !PAR(cr) &&
+                          (EEL_PME(fr->eeltype) || !EEL_FULL(fr->eeltype)) &&
+                          ir->ewald_geometry == eewg3D &&
+                          ir->epsilon_surface == 0 &&
+                          gmx_mtop_ftype_count(mtop, F_POSRES) == 0 &&
+                          gmx_mtop_ftype_count(mtop, F_FBPOSRES) == 0 &&
+                          !IR_ELEC_FIELD(*ir) &&
+                          fr->adress_icor == eAdressICOff &&
+                          getenv("GMX_PME_NO_F_IN_VIRSUM") == NULL);
+
+    if (fr->nstcalcslow > 1 &&
+        (gmx_mtop_ftype_count(mtop, F_POSRES) > 0 ||
+         gmx_mtop_ftype_count(mtop, F_FBPOSRES) > 0 ||
+         IR_ELEC_FIELD(*ir) ||
+         fr->adress_icor != eAdressICOff))
+    {
+        /* These forces are computed every step in f_novirsum,
+         * which holds the slow mesh forces at the slow steps.
+         */
+        gmx_fatal(FARGS, "Multiple time stepping (nstcalcslow > 1) is not supported with position restraints, an electric field or AdResS");
+    }
+
     if (fr->cutoff_scheme == ecutsGROUP &&
         ncg_mtop(mtop) > fr->cg_nalloc && !DOMAINDECOMP(cr))
     {
@@ -3225,6 +3338,8 @@ void init_forcerec(FILE              *fp,
         }
 
         init_nb_verlet(fp, &fr->nbv, bFEP_NonBonded, ir, fr, cr, nbpu_opt);
+
+        init_nbnxn_dynamic_pruning(fp, cr, fr->nbv, ir, mtop, box);
     }
 
     initialize_gpu_constants(cr, fr->ic, fr->nbv);
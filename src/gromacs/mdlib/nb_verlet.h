@@ -105,6 +105,9 @@ typedef struct nonbonded_verlet_t {
     gmx_nbnxn_gpu_t         *gpu_nbv;         /* pointer to GPU nb verlet data     */
     int                      min_ci_balanced; /* pair list balancing parameter
                                                  used for the 8x8x8 GPU kernels    */
+    gmx_bool                 bDynamicPruning; /* Prune the pair lists between searches */
+    int                      nstlistPrune;    /* The pruning interval in steps     */
+    real                     rlistInner;      /* The cut-off of the pruned lists   */
 } nonbonded_verlet_t;
 
 /*! \brief Getter for bUseGPU */
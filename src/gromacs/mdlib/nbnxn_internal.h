@@ -258,6 +258,10 @@ typedef struct nbnxn_search {
     int                *a;               /* Atom index for grid, the inverse of cell   */
     int                 a_nalloc;        /* Allocation size of a                       */
 
+    gmx_bool            bLocalDensity;   /* Size the grid on the local atom density    */
+    int                *dens_bin;        /* Atom count histogram for the local density */
+    int                 dens_bin_nalloc; /* Allocation size of dens_bin                */
+
     int                 natoms_local;    /* The local atoms run from 0 to natoms_local */
     int                 natoms_nonlocal; /* The non-local atoms run from natoms_local
                                           * to natoms_nonlocal */
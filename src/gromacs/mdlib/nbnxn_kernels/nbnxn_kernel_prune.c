@@ -0,0 +1,71 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#include "gmxpre.h"
+
+#include "nbnxn_kernel_prune.h"
+
+#include "gromacs/legacyheaders/gmx_omp_nthreads.h"
+#include "gromacs/utility/fatalerror.h"
+
+void
+nbnxn_kernel_cpu_prune(nonbonded_verlet_group_t *nbvg,
+                       rvec                     *shift_vec,
+                       real                      rlistInner)
+{
+    nbnxn_pairlist_t **nbl;
+    int                nnbl, nb;
+
+    if (nbvg->kernel_type != nbnxnk4xN_SIMD_4xN &&
+        nbvg->kernel_type != nbnxnk4xN_SIMD_2xNN)
+    {
+        gmx_incons("Dynamic pair-list pruning is only implemented for the SIMD kernels");
+    }
+
+    nnbl = nbvg->nbl_lists.nnbl;
+    nbl  = nbvg->nbl_lists.nbl;
+
+#pragma omp parallel for schedule(static) num_threads(gmx_omp_nthreads_get(emntNonbonded))
+    for (nb = 0; nb < nnbl; nb++)
+    {
+        if (nbvg->kernel_type == nbnxnk4xN_SIMD_4xN)
+        {
+            nbnxn_kernel_prune_4xn(nbl[nb], nbvg->nbat, shift_vec, rlistInner);
+        }
+        else
+        {
+            nbnxn_kernel_prune_2xnn(nbl[nb], nbvg->nbat, shift_vec, rlistInner);
+        }
+    }
+}
@@ -0,0 +1,74 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#ifndef _nbnxn_kernel_prune_h
+#define _nbnxn_kernel_prune_h
+
+#include "gromacs/legacyheaders/typedefs.h"
+#include "gromacs/mdlib/nb_verlet.h"
+#include "gromacs/mdlib/nbnxn_pairlist.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Prune the outer pair-lists of nbvg with cut-off rlistInner.
+ * The outer lists, generated at the last pair search, are left untouched,
+ * the inner lists (ci and cj), on which the non-bonded kernels operate,
+ * are overwritten. Only supported with the CPU SIMD kernels.
+ */
+void
+nbnxn_kernel_cpu_prune(nonbonded_verlet_group_t *nbvg,
+                       rvec                     *shift_vec,
+                       real                      rlistInner);
+
+/* Prune the outer list of nbl with the 4xN SIMD kernel layout */
+void
+nbnxn_kernel_prune_4xn(nbnxn_pairlist_t       *nbl,
+                       const nbnxn_atomdata_t *nbat,
+                       rvec                   *shift_vec,
+                       real                    rlistInner);
+
+/* Prune the outer list of nbl with the 2x(N+N) SIMD kernel layout */
+void
+nbnxn_kernel_prune_2xnn(nbnxn_pairlist_t       *nbl,
+                        const nbnxn_atomdata_t *nbat,
+                        rvec                   *shift_vec,
+                        real                    rlistInner);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,187 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include "gromacs/mdlib/nbnxn_kernels/nbnxn_kernel_prune.h"
+#include "gromacs/mdlib/nbnxn_simd.h"
+
+#ifdef GMX_NBNXN_SIMD_2XNN
+
+#define GMX_SIMD_J_UNROLL_SIZE 2
+#include "gromacs/mdlib/nbnxn_kernels/simd_2xnn/nbnxn_kernel_simd_2xnn_common.h"
+
+/* Prune a single nbnxn_pairlist_t entry with distance rlistInner */
+void
+nbnxn_kernel_prune_2xnn(nbnxn_pairlist_t       *nbl,
+                        const nbnxn_atomdata_t *nbat,
+                        rvec                   *shift_vec,
+                        real                    rlistInner)
+{
+    const nbnxn_ci_t * gmx_restrict ciOuter = nbl->ciOuter;
+    nbnxn_ci_t       * gmx_restrict ciInner = nbl->ci;
+    const nbnxn_cj_t * gmx_restrict cjOuter = nbl->cjOuter;
+    nbnxn_cj_t       * gmx_restrict cjInner = nbl->cj;
+    const real       * gmx_restrict shiftvec;
+    const real       * gmx_restrict x;
+    gmx_simd_real_t                 rlist2_S;
+    int                             nciInner, ncjInner;
+    int                             ciIndex, cjind;
+
+    shiftvec = shift_vec[0];
+    x        = nbat->x;
+
+    rlist2_S = gmx_simd_set1_r(rlistInner*rlistInner);
+
+    /* Initialize the new list as empty and add pairs that are in range */
+    nciInner = 0;
+    ncjInner = 0;
+    for (ciIndex = 0; ciIndex < nbl->nciOuter; ciIndex++)
+    {
+        const nbnxn_ci_t *ciEntry = &ciOuter[ciIndex];
+        int               ish, ish3, ci;
+        int               sci, scix, sciy, sciz;
+        gmx_simd_real_t   shX_S, shY_S, shZ_S;
+        gmx_simd_real_t   ix_S0, iy_S0, iz_S0;
+        gmx_simd_real_t   ix_S2, iy_S2, iz_S2;
+
+        /* Copy the original list entry to the pruned entry */
+        ciInner[nciInner].ci           = ciEntry->ci;
+        ciInner[nciInner].shift        = ciEntry->shift;
+        ciInner[nciInner].cj_ind_start = ncjInner;
+
+        ish              = (ciEntry->shift & NBNXN_CI_SHIFT);
+        ish3             = ish*3;
+        ci               = ciEntry->ci;
+
+        shX_S = gmx_simd_load1_r(shiftvec+ish3);
+        shY_S = gmx_simd_load1_r(shiftvec+ish3+1);
+        shZ_S = gmx_simd_load1_r(shiftvec+ish3+2);
+
+#if UNROLLJ <= 4
+        sci              = ci*STRIDE;
+        scix             = sci*DIM;
+#else
+        sci              = (ci>>1)*STRIDE;
+        scix             = sci*DIM + (ci & 1)*(STRIDE>>1);
+#endif
+        sciy             = scix + STRIDE;
+        sciz             = sciy + STRIDE;
+
+        /* Load i atom data */
+        gmx_load1p1_pr(&ix_S0, x+scix);
+        gmx_load1p1_pr(&ix_S2, x+scix+2);
+        gmx_load1p1_pr(&iy_S0, x+sciy);
+        gmx_load1p1_pr(&iy_S2, x+sciy+2);
+        gmx_load1p1_pr(&iz_S0, x+sciz);
+        gmx_load1p1_pr(&iz_S2, x+sciz+2);
+        ix_S0          = gmx_simd_add_r(ix_S0, shX_S);
+        ix_S2          = gmx_simd_add_r(ix_S2, shX_S);
+        iy_S0          = gmx_simd_add_r(iy_S0, shY_S);
+        iy_S2          = gmx_simd_add_r(iy_S2, shY_S);
+        iz_S0          = gmx_simd_add_r(iz_S0, shZ_S);
+        iz_S2          = gmx_simd_add_r(iz_S2, shZ_S);
+
+        for (cjind = ciEntry->cj_ind_start; cjind < ciEntry->cj_ind_end; cjind++)
+        {
+            int              cj, ajx, ajy, ajz;
+            gmx_simd_real_t  jx_S, jy_S, jz_S;
+            gmx_simd_real_t  rsq_S0, rsq_S2;
+            gmx_simd_bool_t  wco_S0, wco_S2;
+
+            /* j-cluster index */
+            cj            = cjOuter[cjind].cj;
+
+            /* Atom indices (of the first atom in the cluster) */
+            ajx           = cj*UNROLLJ*DIM;
+            ajy           = ajx + STRIDE;
+            ajz           = ajy + STRIDE;
+
+            /* load j atom coordinates */
+            gmx_loaddh_pr(&jx_S, x+ajx);
+            gmx_loaddh_pr(&jy_S, x+ajy);
+            gmx_loaddh_pr(&jz_S, x+ajz);
+
+            /* rsq = dx*dx+dy*dy+dz*dz */
+            rsq_S0        = gmx_simd_calc_rsq_r(gmx_simd_sub_r(ix_S0, jx_S),
+                                                gmx_simd_sub_r(iy_S0, jy_S),
+                                                gmx_simd_sub_r(iz_S0, jz_S));
+            rsq_S2        = gmx_simd_calc_rsq_r(gmx_simd_sub_r(ix_S2, jx_S),
+                                                gmx_simd_sub_r(iy_S2, jy_S),
+                                                gmx_simd_sub_r(iz_S2, jz_S));
+
+            wco_S0        = gmx_simd_cmplt_r(rsq_S0, rlist2_S);
+            wco_S2        = gmx_simd_cmplt_r(rsq_S2, rlist2_S);
+
+            wco_S0        = gmx_simd_or_b(wco_S0, wco_S2);
+
+            /* Keep the entry when any atom pair is within range,
+             * the exclusion mask is copied unchanged.
+             */
+            if (gmx_simd_anytrue_b(wco_S0))
+            {
+                cjInner[ncjInner] = cjOuter[cjind];
+                ncjInner++;
+            }
+        }
+
+        /* Add the i-entry only when it has j-entries left */
+        if (ncjInner > ciInner[nciInner].cj_ind_start)
+        {
+            ciInner[nciInner].cj_ind_end = ncjInner;
+            nciInner++;
+        }
+    }
+
+    nbl->nci = nciInner;
+    nbl->ncj = ncjInner;
+}
+
+#else /* GMX_NBNXN_SIMD_2XNN */
+
+#include "gromacs/utility/fatalerror.h"
+
+void
+nbnxn_kernel_prune_2xnn(nbnxn_pairlist_t       gmx_unused *nbl,
+                        const nbnxn_atomdata_t gmx_unused *nbat,
+                        rvec                   gmx_unused *shift_vec,
+                        real                   gmx_unused  rlistInner)
+{
+    gmx_incons("nbnxn_kernel_prune_2xnn called when such kernels "
+               " are not enabled.");
+}
+
+#endif /* GMX_NBNXN_SIMD_2XNN */
@@ -162,6 +162,16 @@ typedef struct nbnxn_pairlist_t {
     int                     excl_nalloc; /* The allocation size for excl             */
     int                     nci_tot;     /* The total number of i clusters           */
 
+    /* With dynamic pruning the list generated by the search is stored
+     * in the outer lists below and ci/cj contain the pruned, inner list.
+     */
+    int                     nciOuter;       /* The number of i-clusters in the outer list, -1 without pruning */
+    nbnxn_ci_t             *ciOuter;        /* The outer i-cluster list, size nciOuter   */
+    int                     ciOuter_nalloc; /* The allocation size of ciOuter            */
+    int                     ncjOuter;       /* The number of j-clusters in the outer list */
+    nbnxn_cj_t             *cjOuter;        /* The outer j-cluster list, size ncjOuter   */
+    int                     cjOuter_nalloc; /* The allocation size of cjOuter            */
+
     struct nbnxn_list_work *work;
 
     gmx_cache_protect_t     cp1;
@@ -173,6 +183,7 @@ typedef struct {
     gmx_bool           bCombined;   /* TRUE if lists get combined into one (the 1st) */
     gmx_bool           bSimple;     /* TRUE if the list of of type "simple"
                                        (na_sc=na_s, no super-clusters used) */
+    gmx_bool           bDynamicPruning; /* TRUE when the lists are pruned between searches */
     int                natpair_ljq; /* Total number of atom pairs for LJ+Q kernel */
     int                natpair_lj;  /* Total number of atom pairs for LJ kernel   */
     int                natpair_q;   /* Total number of atom pairs for Q kernel    */
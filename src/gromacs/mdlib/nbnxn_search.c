@@ -386,6 +386,13 @@ void nbnxn_init_search(nbnxn_search_t    * nbs_ptr,
     nbs->a           = NULL;
     nbs->a_nalloc    = 0;
 
+    /* Size the grid cells on the density in the occupied regions,
+     * unless a uniform density is requested.
+     */
+    nbs->bLocalDensity   = (getenv("GMX_NBNXN_UNIFORM_GRID") == NULL);
+    nbs->dens_bin        = NULL;
+    nbs->dens_bin_nalloc = 0;
+
     nbs->nthread_max = nthread_max;
 
     /* Initialize the work data structures for each thread */
@@ -426,6 +433,100 @@ static real grid_atom_density(int n, rvec corner0, rvec corner1)
     return n/(size[XX]*size[YY]*size[ZZ]);
 }
 
+/* The average number of atoms per bin for estimating the local density */
+#define NBNXN_DENS_BIN_NATOMS  64
+/* The local density is only used when it is larger than the uniform
+ * density by this factor, to avoid changing the grid due to noise.
+ */
+#define NBNXN_DENS_INHOMOGENEOUS_FAC  1.2
+
+/* Returns the atom density as experienced by the atoms, i.e. the density
+ * averaged over the atoms instead of over the volume. For systems with
+ * large empty regions, such as membranes, interfaces or solutes in vacuum,
+ * this is larger than the uniform density, whereas it is equal for
+ * homogeneous systems. Sizing the grid on this density gives cells which
+ * are close to cubic in the occupied regions and thus fewer, better filled
+ * clusters. The density is determined from a coarse histogram with on
+ * average NBNXN_DENS_BIN_NATOMS atoms per bin. We use the estimator
+ * sum_b n_b(n_b - 1)/(n V_b), which is unbiased for Poisson distributed n_b.
+ */
+static real grid_atom_density_local(nbnxn_search_t nbs,
+                                    int a0, int a1, rvec *x, const int *move,
+                                    rvec corner0, rvec corner1)
+{
+    rvec   size, inv_bin_size;
+    ivec   nbin;
+    int    nbin_tot, n, i, d, b, bd;
+    real   bin_size;
+    double sum_nn;
+
+    rvec_sub(corner1, corner0, size);
+
+    n = 0;
+    for (i = a0; i < a1; i++)
+    {
+        if (move == NULL || move[i] >= 0)
+        {
+            n++;
+        }
+    }
+
+    if (n < 2*NBNXN_DENS_BIN_NATOMS)
+    {
+        /* Too few atoms for a meaningful estimate */
+        return grid_atom_density(n, corner0, corner1);
+    }
+
+    /* Use (nearly) cubic bins */
+    bin_size = pow(NBNXN_DENS_BIN_NATOMS*size[XX]*size[YY]*size[ZZ]/n, 1.0/3.0);
+    nbin_tot = 1;
+    for (d = 0; d < DIM; d++)
+    {
+        nbin[d]         = max(1, (int)(size[d]/bin_size + 0.5));
+        inv_bin_size[d] = nbin[d]/size[d];
+        nbin_tot       *= nbin[d];
+    }
+
+    if (nbin_tot > nbs->dens_bin_nalloc)
+    {
+        nbs->dens_bin_nalloc = over_alloc_large(nbin_tot);
+        srenew(nbs->dens_bin, nbs->dens_bin_nalloc);
+    }
+    for (b = 0; b < nbin_tot; b++)
+    {
+        nbs->dens_bin[b] = 0;
+    }
+
+    for (i = a0; i < a1; i++)
+    {
+        if (move == NULL || move[i] >= 0)
+        {
+            b = 0;
+            for (d = 0; d < DIM; d++)
+            {
+                /* Atoms can be slightly outside the bounding box */
+                bd = (int)((x[i][d] - corner0[d])*inv_bin_size[d]);
+                bd = min(max(bd, 0), nbin[d] - 1);
+                b  = b*nbin[d] + bd;
+            }
+            nbs->dens_bin[b]++;
+        }
+    }
+
+    sum_nn = 0;
+    for (b = 0; b < nbin_tot; b++)
+    {
+        sum_nn += nbs->dens_bin[b]*(double)(nbs->dens_bin[b] - 1);
+    }
+
+    if (sum_nn == 0)
+    {
+        return grid_atom_density(n, corner0, corner1);
+    }
+
+    return sum_nn*nbin_tot/(n*(double)(size[XX]*size[YY]*size[ZZ]));
+}
+
 static int set_grid_size_xy(const nbnxn_search_t nbs,
                             nbnxn_grid_t *grid,
                             int dd_zone,
@@ -1830,6 +1931,28 @@ void nbnxn_put_on_grid(nbnxn_search_t nbs,
             grid->atom_density = grid_atom_density(n-nmoved, corner0, corner1);
         }
 
+        if (nbs->bLocalDensity)
+        {
+            real atom_density_local;
+
+            /* With inhomogeneous systems, a grid based on the average
+             * density has too large cells in the occupied regions,
+             * which leads to many partially filled clusters.
+             */
+            atom_density_local =
+                grid_atom_density_local(nbs, a0, a1, x, move,
+                                        corner0, corner1);
+            if (debug)
+            {
+                fprintf(debug, "atom density uniform %5.1f local %5.1f\n",
+                        grid->atom_density, atom_density_local);
+            }
+            if (atom_density_local > NBNXN_DENS_INHOMOGENEOUS_FAC*grid->atom_density)
+            {
+                grid->atom_density = atom_density_local;
+            }
+        }
+
         grid->cell0 = 0;
 
         nbs->natoms_local    = a1 - nmoved;
@@ -2523,6 +2646,13 @@ static void nbnxn_init_pairlist(nbnxn_pairlist_t *nbl,
     nbl->cj4         = NULL;
     nbl->nci_tot     = 0;
 
+    nbl->nciOuter       = -1;
+    nbl->ciOuter        = NULL;
+    nbl->ciOuter_nalloc = 0;
+    nbl->ncjOuter       = 0;
+    nbl->cjOuter        = NULL;
+    nbl->cjOuter_nalloc = 0;
+
     if (!nbl->bSimple)
     {
         nbl->excl        = NULL;
@@ -2566,8 +2696,9 @@ void nbnxn_init_pairlist_set(nbnxn_pairlist_set_t *nbl_list,
 {
     int i;
 
-    nbl_list->bSimple   = bSimple;
-    nbl_list->bCombined = bCombined;
+    nbl_list->bSimple         = bSimple;
+    nbl_list->bCombined       = bCombined;
+    nbl_list->bDynamicPruning = FALSE;
 
     nbl_list->nnbl = gmx_omp_nthreads_get(emntNonbonded);
 
@@ -2612,6 +2743,7 @@ static void print_nblist_statistics_simple(FILE *fp, const nbnxn_pairlist_t *nbl
     int                 cs[SHIFTS];
     int                 s, i, j;
     int                 npexcl;
+    int                 natoms_grid;
 
     /* This code only produces correct statistics with domain decomposition */
     grid = &nbs->grid[0];
@@ -2626,6 +2758,15 @@ static void print_nblist_statistics_simple(FILE *fp, const nbnxn_pairlist_t *nbl
     fprintf(fp, "nbl average j cell list length %.1f\n",
             0.25*nbl->ncj/(double)nbl->nci);
 
+    natoms_grid = 0;
+    for (i = 0; i < grid->ncx*grid->ncy; i++)
+    {
+        natoms_grid += grid->cxy_na[i];
+    }
+    fprintf(fp, "nbl grid %d x %d columns, %d cells, atom density %.1f, cell fill %.1f%%\n",
+            grid->ncx, grid->ncy, grid->nc, grid->atom_density,
+            100*natoms_grid/(double)(grid->nc*grid->na_sc));
+
     for (s = 0; s < SHIFTS; s++)
     {
         cs[s] = 0;
@@ -3825,6 +3966,45 @@ static void nb_realloc_sci(nbnxn_pairlist_t *nbl, int n)
                        nbl->alloc, nbl->free);
 }
 
+/* Moves the simple list generated by the search to the outer list storage
+ * and makes sure the ci and cj arrays can hold a pruned copy of it.
+ */
+static void nbnxn_pairlist_set_outer(nbnxn_pairlist_t *nbl)
+{
+    nbnxn_ci_t *ci_tmp;
+    nbnxn_cj_t *cj_tmp;
+    int         nalloc_tmp;
+
+    ci_tmp              = nbl->ciOuter;
+    nbl->ciOuter        = nbl->ci;
+    nbl->ci             = ci_tmp;
+    nalloc_tmp          = nbl->ciOuter_nalloc;
+    nbl->ciOuter_nalloc = nbl->ci_nalloc;
+    nbl->ci_nalloc      = nalloc_tmp;
+
+    cj_tmp              = nbl->cjOuter;
+    nbl->cjOuter        = nbl->cj;
+    nbl->cj             = cj_tmp;
+    nalloc_tmp          = nbl->cjOuter_nalloc;
+    nbl->cjOuter_nalloc = nbl->cj_nalloc;
+    nbl->cj_nalloc      = nalloc_tmp;
+
+    nbl->nciOuter       = nbl->nci;
+    nbl->ncjOuter       = nbl->ncj;
+
+    /* The pruned list is filled by the prune kernel, contents not needed */
+    nbl->nci            = 0;
+    nbl->ncj            = 0;
+    if (nbl->ciOuter_nalloc > nbl->ci_nalloc)
+    {
+        nb_realloc_ci(nbl, nbl->ciOuter_nalloc);
+    }
+    if (nbl->cjOuter_nalloc > nbl->cj_nalloc)
+    {
+        check_subcell_list_space_simple(nbl, nbl->cjOuter_nalloc);
+    }
+}
+
 /* Make a new ci entry at index nbl->nci */
 static void new_ci_entry(nbnxn_pairlist_t *nbl, int ci, int shift, int flags)
 {
@@ -5857,4 +6037,13 @@ void nbnxn_make_pairlist(const nbnxn_search_t  nbs,
             print_reduction_cost(&nbat->buffer_flags, nnbl);
         }
     }
+
+    if (nbl_list->bDynamicPruning)
+    {
+        /* The kernels will run on the pruned lists, generated later */
+        for (th = 0; th < nnbl; th++)
+        {
+            nbnxn_pairlist_set_outer(nbl[th]);
+        }
+    }
 }
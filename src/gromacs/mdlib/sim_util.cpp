@@ -79,6 +79,7 @@
 #include "gromacs/mdlib/nbnxn_gpu_data_mgmt.h"
 #include "gromacs/mdlib/nbnxn_search.h"
 #include "gromacs/mdlib/nbnxn_kernels/nbnxn_kernel_gpu_ref.h"
+#include "gromacs/mdlib/nbnxn_kernels/nbnxn_kernel_prune.h"
 #include "gromacs/mdlib/nbnxn_kernels/nbnxn_kernel_ref.h"
 #include "gromacs/mdlib/nbnxn_kernels/simd_2xnn/nbnxn_kernel_simd_2xnn.h"
 #include "gromacs/mdlib/nbnxn_kernels/simd_4xn/nbnxn_kernel_simd_4xn.h"
@@ -418,9 +419,12 @@ static void post_process_forces(t_commrec *cr,
                            &top->idef, fr->ePBC, fr->bMolPBC, graph, box, cr);
             wallcycle_stop(wcycle, ewcVSITESPREAD);
         }
-        if (flags & GMX_FORCE_VIRIAL)
+        /* Now add the forces, this is local.
+         * Without virial, or when the mesh virial has been corrected
+         * for gathering the mesh forces into f, f_novirsum=f.
+         */
+        if (fr->f_novirsum != f)
         {
-            /* Now add the forces, this is local */
             if (fr->bDomDec)
             {
                 sum_forces(0, fr->f_novirsum_n, f, fr->f_novirsum);
@@ -430,6 +434,9 @@ static void post_process_forces(t_commrec *cr,
                 sum_forces(0, mdatoms->homenr,
                            f, fr->f_novirsum);
             }
+        }
+        if (flags & GMX_FORCE_VIRIAL)
+        {
             if (EEL_FULL(fr->eeltype))
             {
                 /* Add the mesh contribution to the virial */
@@ -603,6 +610,28 @@ static void do_nb_verlet(t_forcerec *fr,
     }
 }
 
+/* Prune the pair list for locality ilocality with the inner cut-off,
+ * on search steps and every nstlistPrune steps in between searches.
+ */
+static void do_nb_verlet_prune(t_forcerec     *fr,
+                               int             ilocality,
+                               gmx_int64_t     step,
+                               gmx_bool        bNS,
+                               gmx_wallcycle_t wcycle)
+{
+    nonbonded_verlet_t *nbv = fr->nbv;
+
+    if (!nbv->bDynamicPruning || !(bNS || step % nbv->nstlistPrune == 0))
+    {
+        return;
+    }
+
+    wallcycle_sub_start(wcycle, ewcsNONBONDED_PRUNING);
+    nbnxn_kernel_cpu_prune(&nbv->grp[ilocality], fr->shift_vec,
+                           nbv->rlistInner);
+    wallcycle_sub_stop(wcycle, ewcsNONBONDED_PRUNING);
+}
+
 static void do_nb_verlet_fep(nbnxn_pairlist_set_t *nbl_lists,
                              t_forcerec           *fr,
                              rvec                  x[],
@@ -738,7 +767,9 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     double              mu[2*DIM];
     gmx_bool            bStateChanged, bNS, bFillGrid, bCalcCGCM;
     gmx_bool            bDoLongRange, bDoForces, bSepLRF, bUseGPU, bUseOrEmulGPU;
+    gmx_bool            bDoSlowF;
     gmx_bool            bDiffKernels = FALSE;
+    gmx_bool            bOverlapMoveX;
     rvec                vzero, box_diag;
     float               cycles_pme, cycles_force, cycles_wait_gpu;
     nonbonded_verlet_t *nbv;
@@ -772,6 +803,14 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     bDoLongRange  = (fr->bTwinRange && bNS && (flags & GMX_FORCE_DO_LR));
     bDoForces     = (flags & GMX_FORCE_FORCES);
     bSepLRF       = (bDoLongRange && bDoForces && (flags & GMX_FORCE_SEPLRF));
+    /* With multiple time stepping the slow forces are stored in f_twin,
+     * as the long-range forces with twin-range cut-offs.
+     */
+    bDoSlowF      = !(flags & GMX_FORCE_NOSLOW);
+    if (fr->nstcalcslow > 1 && bDoSlowF && bDoForces && (flags & GMX_FORCE_SEPLRF))
+    {
+        bSepLRF = TRUE;
+    }
     bUseGPU       = fr->nbv->bUseGPU;
     bUseOrEmulGPU = bUseGPU || (nbv->grp[0].kernel_type == nbnxnk8x8x8_PlainC);
 
@@ -815,7 +854,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
                                  fr->shift_vec, nbv->grp[0].nbat);
 
 #ifdef GMX_MPI
-    if (!(cr->duty & DUTY_PME))
+    if (!(cr->duty & DUTY_PME) && bDoSlowF)
     {
         gmx_bool bBS;
         matrix   boxs;
@@ -966,6 +1005,12 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         wallcycle_stop(wcycle, ewcLAUNCH_GPU_NB);
     }
 
+    /* With CPU non-bonded kernels only, we overlap the halo coordinate
+     * communication with the local non-bonded kernel on steps without
+     * search. At search steps, dd_partition_system communicated already.
+     */
+    bOverlapMoveX = (DOMAINDECOMP(cr) && !bNS && !bUseOrEmulGPU);
+
     /* Communicate coordinates and sum dipole if necessary +
        do non-local pair search */
     if (DOMAINDECOMP(cr))
@@ -1021,7 +1066,17 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         else
         {
             wallcycle_start(wcycle, ewcMOVEX);
-            dd_move_x(cr->dd, box, x);
+            if (bOverlapMoveX)
+            {
+                /* Only start the communication here, the local non-bonded
+                 * kernel is computed while the halo coordinates are in flight.
+                 */
+                dd_move_x_start(cr->dd, box, x);
+            }
+            else
+            {
+                dd_move_x(cr->dd, box, x);
+            }
 
             /* When we don't need the total dipole we sum it in global_stat */
             if (bStateChanged && NEED_MUTOT(*inputrec))
@@ -1030,12 +1085,15 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             }
             wallcycle_stop(wcycle, ewcMOVEX);
 
-            wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
-            wallcycle_sub_start(wcycle, ewcsNB_X_BUF_OPS);
-            nbnxn_atomdata_copy_x_to_nbat_x(nbv->nbs, eatNonlocal, FALSE, x,
-                                            nbv->grp[eintNonlocal].nbat);
-            wallcycle_sub_stop(wcycle, ewcsNB_X_BUF_OPS);
-            cycles_force += wallcycle_stop(wcycle, ewcNB_XF_BUF_OPS);
+            if (!bOverlapMoveX)
+            {
+                wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
+                wallcycle_sub_start(wcycle, ewcsNB_X_BUF_OPS);
+                nbnxn_atomdata_copy_x_to_nbat_x(nbv->nbs, eatNonlocal, FALSE, x,
+                                                nbv->grp[eintNonlocal].nbat);
+                wallcycle_sub_stop(wcycle, ewcsNB_X_BUF_OPS);
+                cycles_force += wallcycle_stop(wcycle, ewcNB_XF_BUF_OPS);
+            }
         }
 
         if (bUseGPU && !bDiffKernels)
@@ -1123,7 +1181,12 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
          * PME/Ewald forces if necessary */
         if (fr->bF_NoVirSum)
         {
-            if (flags & GMX_FORCE_VIRIAL)
+            /* With multiple time stepping we need the mesh forces
+             * separately, since they should also go into f_twin.
+             */
+            if (((flags & GMX_FORCE_VIRIAL) &&
+                 !(fr->bF_NoVirSumInF && vsite == NULL && graph == NULL)) ||
+                bSepLRF)
             {
                 fr->f_novirsum = fr->f_novirsum_alloc;
                 if (fr->bDomDec)
@@ -1137,9 +1200,10 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             }
             else
             {
-                /* We are not calculating the pressure so we do not need
-                 * a separate array for forces that do not contribute
-                 * to the pressure.
+                /* We are not calculating the pressure, or the PME mesh
+                 * virial is corrected for the single sum virial,
+                 * so we do not need a separate array for forces that
+                 * do not contribute to the pressure.
                  */
                 fr->f_novirsum = f;
             }
@@ -1147,7 +1211,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
 
         /* Clear the short- and long-range forces */
         clear_rvecs(fr->natoms_force_constr, f);
-        if (bSepLRF && do_per_step(step, inputrec->nstcalclr))
+        if (bSepLRF)
         {
             clear_rvecs(fr->natoms_force_constr, fr->f_twin);
         }
@@ -1170,11 +1234,33 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
 
     if (!bUseOrEmulGPU)
     {
+        do_nb_verlet_prune(fr, eintLocal, step, bNS, wcycle);
+
         /* Maybe we should move this into do_force_lowlevel */
         do_nb_verlet(fr, ic, enerd, flags, eintLocal, enbvClearFYes,
                      nrnb, wcycle);
     }
 
+    if (bOverlapMoveX)
+    {
+        /* Complete the halo communication. The waiting time should not
+         * be counted as force time, as that would affect the DD load
+         * balancing.
+         */
+        cycles_force += wallcycle_stop(wcycle, ewcFORCE);
+        wallcycle_start_nocount(wcycle, ewcMOVEX);
+        dd_move_x_finish(cr->dd, box, x);
+        wallcycle_stop(wcycle, ewcMOVEX);
+
+        wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
+        wallcycle_sub_start(wcycle, ewcsNB_X_BUF_OPS);
+        nbnxn_atomdata_copy_x_to_nbat_x(nbv->nbs, eatNonlocal, FALSE, x,
+                                        nbv->grp[eintNonlocal].nbat);
+        wallcycle_sub_stop(wcycle, ewcsNB_X_BUF_OPS);
+        cycles_force += wallcycle_stop(wcycle, ewcNB_XF_BUF_OPS);
+        wallcycle_start_nocount(wcycle, ewcFORCE);
+    }
+
     if (fr->efep != efepNO)
     {
         /* Calculate the local and non-local free energy interactions here.
@@ -1204,6 +1290,8 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
 
         if (DOMAINDECOMP(cr))
         {
+            do_nb_verlet_prune(fr, eintNonlocal, step, bNS, wcycle);
+
             do_nb_verlet(fr, ic, enerd, flags, eintNonlocal,
                          bDiffKernels ? enbvClearFYes : enbvClearFNo,
                          nrnb, wcycle);
@@ -1257,13 +1345,10 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
 
     if (bSepLRF)
     {
-        if (do_per_step(step, inputrec->nstcalclr))
+        /* Add the long range forces to the short range forces */
+        for (i = 0; i < fr->natoms_force_constr; i++)
         {
-            /* Add the long range forces to the short range forces */
-            for (i = 0; i < fr->natoms_force_constr; i++)
-            {
-                rvec_add(fr->f_twin[i], f[i], f[i]);
-            }
+            rvec_add(fr->f_twin[i], f[i], f[i]);
         }
     }
 
@@ -1430,7 +1515,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         /* If we have NoVirSum forces, but we do not calculate the virial,
          * we sum fr->f_novirsum=f later.
          */
-        if (vsite && !(fr->bF_NoVirSum && !(flags & GMX_FORCE_VIRIAL)))
+        if (vsite && !(fr->bF_NoVirSum && fr->f_novirsum == f))
         {
             wallcycle_start(wcycle, ewcVSITESPREAD);
             spread_vsite_f(vsite, x, f, fr->fshift, FALSE, NULL, nrnb,
@@ -1476,7 +1561,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     /* Add forces from interactive molecular dynamics (IMD), if bIMD == TRUE. */
     IMD_apply_forces(inputrec->bIMD, inputrec->imd, cr, f, wcycle);
 
-    if (PAR(cr) && !(cr->duty & DUTY_PME))
+    if (PAR(cr) && !(cr->duty & DUTY_PME) && bDoSlowF)
     {
         /* In case of node-splitting, the PP nodes receive the long-range
          * forces, virial and energy from the PME nodes here.
@@ -1489,6 +1574,19 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         post_process_forces(cr, step, nrnb, wcycle,
                             top, box, x, f, vir_force, mdatoms, graph, fr, vsite,
                             flags);
+
+        if (bSepLRF && fr->bF_NoVirSum)
+        {
+            /* The mesh forces are slow forces with multiple time stepping */
+            if (fr->bDomDec)
+            {
+                sum_forces(0, fr->f_novirsum_n, fr->f_twin, fr->f_novirsum);
+            }
+            else
+            {
+                sum_forces(0, homenr, fr->f_twin, fr->f_novirsum);
+            }
+        }
     }
 
     /* Sum the potential energy terms from group contributions */
@@ -0,0 +1,282 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the Nose-Hoover chain integration.
+ *
+ * The chains of multiple T-coupling groups, integrated with multiple
+ * threads, are compared against single-threaded runs and against runs
+ * with each group on its own.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/legacyheaders/gmx_omp_nthreads.h"
+#include "gromacs/legacyheaders/update.h"
+#include "gromacs/legacyheaders/types/inputrec.h"
+#include "gromacs/legacyheaders/types/mdatom.h"
+#include "gromacs/legacyheaders/types/state.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+//! Number of T-coupling groups with parameters
+const int  numGroupParams           = 3;
+//! Reference temperatures of the groups
+const real refT[numGroupParams]     = { 300, 320, 280 };
+//! Coupling times of the groups
+const real tauT[numGroupParams]     = { 0.1, 0.2, 0.5 };
+//! Degrees of freedom of the groups
+const real nrdf[numGroupParams]     = { 30, 45, 20 };
+//! Kinetic energies of the groups, away from the reference temperatures
+const real ekinDiag[numGroupParams] = { 50, 45, 30 };
+
+/*! \brief Test fixture for the Nose-Hoover chains with velocity Verlet
+ *
+ * Each group has a chain of length 4, the 12 atoms are distributed
+ * over the groups.
+ */
+class NoseHooverChainTest : public ::testing::Test
+{
+    public:
+        //! Number of atoms in the system
+        static const int numAtoms_    = 12;
+        //! Length of the Nose-Hoover chains
+        static const int chainLength_ = 4;
+
+        NoseHooverChainTest() : trotterSeq_(NULL)
+        {
+            std::memset(&massQ_, 0, sizeof(massQ_));
+        }
+
+        ~NoseHooverChainTest()
+        {
+            freeSystem();
+        }
+
+        /*! \brief Sets up \p numGroups T-coupling groups
+         *
+         * Group g uses parameter set \p groupParams[g].
+         */
+        void initSystem(int numGroups, const int *groupParams)
+        {
+            freeSystem();
+
+            std::memset(&ir_, 0, sizeof(ir_));
+            ir_.eI                 = eiVV;
+            ir_.delta_t            = 0.002;
+            ir_.etc                = etcNOSEHOOVER;
+            ir_.epc                = epcNO;
+            ir_.nsttcouple         = 1;
+            ir_.tau_p              = 1;
+            ir_.opts.ngtc          = numGroups;
+            ir_.opts.nhchainlength = chainLength_;
+            ir_.opts.ref_t         = refT_;
+            ir_.opts.tau_t         = tauT_;
+            ir_.opts.nrdf          = nrdf_;
+
+            std::memset(&tcstat_, 0, sizeof(tcstat_));
+            for (int g = 0; g < numGroups; g++)
+            {
+                int p = groupParams[g];
+
+                refT_[g] = refT[p];
+                tauT_[g] = tauT[p];
+                nrdf_[g] = nrdf[p];
+                for (int d = 0; d < DIM; d++)
+                {
+                    tcstat_[g].ekinf[d][d] = ekinDiag[p];
+                }
+                tcstat_[g].ekinscalef_nhc = 1;
+                tcstat_[g].ekinscaleh_nhc = 1;
+            }
+            std::memset(&ekind_, 0, sizeof(ekind_));
+            ekind_.ngtc   = numGroups;
+            ekind_.tcstat = tcstat_;
+
+            std::memset(&md_, 0, sizeof(md_));
+            md_.nr      = numAtoms_;
+            md_.homenr  = numAtoms_;
+            md_.invmass = invmass_;
+            md_.cTC     = cTC_;
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                invmass_[a] = 1.0/(a % 2 == 0 ? 15.999 : 12.011);
+                cTC_[a]     = a % numGroups;
+                v_[a][XX]   = 1.2*std::sin(1.1*a);
+                v_[a][YY]   = 0.9*std::cos(0.7*a);
+                v_[a][ZZ]   = 1.1*std::sin(0.4*a + 1);
+            }
+
+            xi_.assign(numGroups*chainLength_, 0);
+            vxi_.assign(numGroups*chainLength_, 0);
+            std::memset(&state_, 0, sizeof(state_));
+            state_.natoms         = numAtoms_;
+            state_.nalloc         = numAtoms_;
+            state_.v              = v_;
+            state_.nhchainlength  = chainLength_;
+            state_.nnhpres        = 1;
+            state_.nosehoover_xi  = &xi_[0];
+            state_.nosehoover_vxi = &vxi_[0];
+            clear_mat(state_.box);
+            state_.box[XX][XX]    = 3;
+            state_.box[YY][YY]    = 3;
+            state_.box[ZZ][ZZ]    = 3;
+
+            trotterSeq_ = init_npt_vars(&ir_, &state_, &massQ_, TRUE);
+        }
+
+        //! Frees the memory allocated by init_npt_vars
+        void freeSystem()
+        {
+            if (trotterSeq_ != NULL)
+            {
+                for (int i = 0; i < ettTSEQMAX; i++)
+                {
+                    sfree(trotterSeq_[i]);
+                }
+                sfree(trotterSeq_);
+                trotterSeq_ = NULL;
+            }
+            sfree(massQ_.Qinv);
+            massQ_.Qinv = NULL;
+        }
+
+        //! Does the thermostat half steps of three steps with \p numThreads threads
+        void runNoseHooverChains(int numThreads)
+        {
+            tensor vir;
+
+            clear_mat(vir);
+            gmx_omp_nthreads_set(emntUpdate, numThreads);
+            for (int step = 1; step <= 3; step++)
+            {
+                trotter_update(&ir_, step, &ekind_, NULL, &state_, vir, &md_,
+                               &massQ_, trotterSeq_, ettTSEQ2);
+                trotter_update(&ir_, step, &ekind_, NULL, &state_, vir, &md_,
+                               &massQ_, trotterSeq_, ettTSEQ3);
+            }
+        }
+
+        t_inputrec          ir_;
+        t_state             state_;
+        t_mdatoms           md_;
+        gmx_ekindata_t      ekind_;
+        t_grp_tcstat        tcstat_[numGroupParams];
+        t_extmass           massQ_;
+        int               **trotterSeq_;
+        real                refT_[numGroupParams];
+        real                tauT_[numGroupParams];
+        real                nrdf_[numGroupParams];
+        real                invmass_[numAtoms_];
+        unsigned short      cTC_[numAtoms_];
+        rvec                v_[numAtoms_];
+        std::vector<double> xi_;
+        std::vector<double> vxi_;
+};
+
+TEST_F(NoseHooverChainTest, MultipleThreadsMatchSingleThread)
+{
+    const int groupParams[numGroupParams] = { 0, 1, 2 };
+
+    initSystem(numGroupParams, groupParams);
+    runNoseHooverChains(1);
+    std::vector<double> xiRef(xi_), vxiRef(vxi_);
+    rvec                vRef[numAtoms_];
+    for (int a = 0; a < numAtoms_; a++)
+    {
+        copy_rvec(v_[a], vRef[a]);
+    }
+
+    initSystem(numGroupParams, groupParams);
+    runNoseHooverChains(numGroupParams);
+
+    /* Each group is integrated with the same operations */
+    for (size_t i = 0; i < xi_.size(); i++)
+    {
+        EXPECT_EQ(xiRef[i], xi_[i]) << "xi " << i;
+        EXPECT_EQ(vxiRef[i], vxi_[i]) << "vxi " << i;
+    }
+    for (int a = 0; a < numAtoms_; a++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_EQ(vRef[a][d], v_[a][d]) << "v of atom " << a << " dim " << d;
+        }
+    }
+}
+
+TEST_F(NoseHooverChainTest, GroupsMatchSingleGroupRuns)
+{
+    const int groupParams[numGroupParams] = { 0, 1, 2 };
+
+    initSystem(numGroupParams, groupParams);
+    runNoseHooverChains(numGroupParams);
+    std::vector<double> xiAll(xi_), vxiAll(vxi_);
+    double              vscaleAll[numGroupParams];
+    for (int g = 0; g < numGroupParams; g++)
+    {
+        vscaleAll[g] = tcstat_[g].vscale_nhc;
+    }
+
+    for (int g = 0; g < numGroupParams; g++)
+    {
+        SCOPED_TRACE(g);
+
+        initSystem(1, &groupParams[g]);
+        runNoseHooverChains(1);
+
+        for (int j = 0; j < chainLength_; j++)
+        {
+            EXPECT_EQ(xi_[j], xiAll[g*chainLength_ + j]) << "xi " << j;
+            EXPECT_EQ(vxi_[j], vxiAll[g*chainLength_ + j]) << "vxi " << j;
+        }
+        EXPECT_EQ(tcstat_[0].vscale_nhc, vscaleAll[g]);
+    }
+}
+
+} // namespace
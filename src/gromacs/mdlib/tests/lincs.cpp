@@ -0,0 +1,308 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for LINCS.
+ *
+ * The constrained coordinates, velocities, virial and projected
+ * derivatives are compared against reference data.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/legacyheaders/constr.h"
+#include "gromacs/legacyheaders/gmx_omp_nthreads.h"
+#include "gromacs/legacyheaders/nrnb.h"
+#include "gromacs/legacyheaders/types/commrec.h"
+#include "gromacs/legacyheaders/types/inputrec.h"
+#include "gromacs/legacyheaders/types/mdatom.h"
+#include "gromacs/legacyheaders/types/simple.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/topology/block.h"
+#include "gromacs/topology/topology.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/refdata.h"
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+/*! \brief Test fixture for LINCS
+ *
+ * The system is a single molecule with a chain of 16 heavy atoms,
+ * one angle constraint forming a constraint triangle and
+ * four hydrogens, 20 constraints in total. This gives several
+ * SIMD blocks of constraints, with varying coupling counts.
+ */
+class LincsTest : public ::testing::Test
+{
+    public:
+        //! Number of atoms in the test molecule
+        static const int numAtoms_ = 20;
+
+        LincsTest() : checker_(data_.rootChecker())
+        {
+#ifdef GMX_DOUBLE
+            /* The reference data has been generated in single precision */
+            checker_.setDefaultTolerance(
+                    gmx::test::relativeToleranceAsFloatingPoint(1.0, 1e-6));
+#else
+            checker_.setDefaultTolerance(
+                    gmx::test::relativeToleranceAsUlp(1.0, 4));
+#endif
+
+            init_mtop(&mtop_);
+            mtop_.natoms            = numAtoms_;
+            mtop_.ffparams.ntypes   = 3;
+            snew(mtop_.ffparams.functype, mtop_.ffparams.ntypes);
+            snew(mtop_.ffparams.iparams, mtop_.ffparams.ntypes);
+            mtop_.ffparams.iparams[0].constr.dA = 0.153;
+            mtop_.ffparams.iparams[1].constr.dA = 0.250;
+            mtop_.ffparams.iparams[2].constr.dA = 0.109;
+            for (int i = 0; i < mtop_.ffparams.ntypes; i++)
+            {
+                mtop_.ffparams.functype[i]          = F_CONSTR;
+                mtop_.ffparams.iparams[i].constr.dB = mtop_.ffparams.iparams[i].constr.dA;
+            }
+
+            for (int a = 0; a < 15; a++)
+            {
+                addConstraint(0, a, a + 1);
+            }
+            addConstraint(1, 0, 2);
+            addConstraint(2, 5, 16);
+            addConstraint(2, 5, 17);
+            addConstraint(2, 5, 18);
+            addConstraint(2, 10, 19);
+
+            mtop_.nmoltype = 1;
+            snew(mtop_.moltype, mtop_.nmoltype);
+            mtop_.moltype[0].atoms.nr            = numAtoms_;
+            mtop_.moltype[0].ilist[F_CONSTR].nr  = iatoms_.size();
+            mtop_.moltype[0].ilist[F_CONSTR].iatoms = &iatoms_[0];
+            mtop_.nmolblock = 1;
+            snew(mtop_.molblock, mtop_.nmolblock);
+            mtop_.molblock[0].type       = 0;
+            mtop_.molblock[0].nmol       = 1;
+            mtop_.molblock[0].natoms_mol = numAtoms_;
+
+            std::memset(&idef_, 0, sizeof(idef_));
+            idef_.ntypes             = mtop_.ffparams.ntypes;
+            idef_.functype           = mtop_.ffparams.functype;
+            idef_.iparams            = mtop_.ffparams.iparams;
+            idef_.il[F_CONSTR].nr     = iatoms_.size();
+            idef_.il[F_CONSTR].iatoms = &iatoms_[0];
+
+            std::memset(&md_, 0, sizeof(md_));
+            md_.nr      = numAtoms_;
+            md_.homenr  = numAtoms_;
+            md_.invmass = invmass_;
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                invmass_[a] = 1.0/(a < 16 ? (a % 3 == 1 ? 15.999 : 12.011) : 1.008);
+            }
+
+            std::memset(&ir_, 0, sizeof(ir_));
+            ir_.eI             = eiMD;
+            ir_.efep           = efepNO;
+            ir_.delta_t        = 0.002;
+            ir_.LincsWarnAngle = 30;
+
+            std::memset(&cr_, 0, sizeof(cr_));
+            cr_.nnodes = 1;
+
+            init_nrnb(&nrnb_);
+
+            /* A zig-zag chain with the hydrogens roughly tetrahedral */
+            for (int a = 0; a < 16; a++)
+            {
+                x_[a][XX] = 1.0 + 0.125*a;
+                x_[a][YY] = 1.0 + 0.088*(a % 2);
+                x_[a][ZZ] = 1.0 + 0.01*std::sin(1.0*a);
+            }
+            const real hdir[4][DIM] = {
+                { 0, 0.577, 0.816 }, { 0, 0.577, -0.816 }, { 0.3, -0.95, 0 }, { 0, 0.6, 0.8 }
+            };
+            const int  hcenter[4]   = { 5, 5, 5, 10 };
+            for (int h = 0; h < 4; h++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    x_[16 + h][d] = x_[hcenter[h]][d] + 0.109*hdir[h][d];
+                }
+            }
+            /* Displace the atoms as an MD step with high velocities would */
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                v_[a][XX]      = 2.0*std::sin(1.1*a);
+                v_[a][YY]      = 2.0*std::cos(0.7*a);
+                v_[a][ZZ]      = 1.5*std::sin(0.4*a + 1);
+                for (int d = 0; d < DIM; d++)
+                {
+                    xprime_[a][d] = x_[a][d] + ir_.delta_t*v_[a][d];
+                }
+            }
+        }
+
+        ~LincsTest()
+        {
+            sfree(mtop_.ffparams.functype);
+            sfree(mtop_.ffparams.iparams);
+            sfree(mtop_.moltype);
+            sfree(mtop_.molblock);
+        }
+
+        //! Adds a constraint of type \p type between atoms \p a1 and \p a2
+        void addConstraint(int type, int a1, int a2)
+        {
+            iatoms_.push_back(type);
+            iatoms_.push_back(a1);
+            iatoms_.push_back(a2);
+        }
+
+        //! Sets up LINCS with \p numTasks tasks and returns the LINCS data
+        gmx_lincsdata_t initLincs(int numTasks, int numIter, int order)
+        {
+            t_blocka at2con;
+            int      nflexcon;
+
+            gmx_omp_nthreads_set(emntLINCS, numTasks);
+
+            at2con = make_at2con(0, numAtoms_, mtop_.moltype[0].ilist,
+                                 mtop_.ffparams.iparams, TRUE, &nflexcon);
+            gmx_lincsdata_t lincsd = init_lincs(NULL, &mtop_, nflexcon, &at2con,
+                                                FALSE, numIter, order);
+            done_blocka(&at2con);
+
+            set_lincs(&idef_, &md_, TRUE, &cr_, lincsd);
+
+            return lincsd;
+        }
+
+        //! Constrains the coordinates and velocities and checks the results
+        void testConstrainCoordinates(int numTasks, int numIter, int order)
+        {
+            gmx_lincsdata_t lincsd = initLincs(numTasks, numIter, order);
+            matrix          box    = {{ 0 }};
+            tensor          vir    = {{ 0 }};
+            int             warncount = 0;
+            gmx_bool        bOK;
+
+            bOK = constrain_lincs(NULL, FALSE, FALSE, &ir_, 0, lincsd, &md_, &cr_,
+                                  x_, xprime_, NULL, box, NULL,
+                                  0, NULL, 1/ir_.delta_t, v_,
+                                  TRUE, vir, econqCoord, &nrnb_,
+                                  1000, &warncount);
+            EXPECT_TRUE(bOK);
+            EXPECT_EQ(0, warncount);
+
+            for (size_t c = 0; c < iatoms_.size(); c += 3)
+            {
+                real len = idef_.iparams[iatoms_[c]].constr.dA;
+                rvec dx;
+
+                rvec_sub(xprime_[iatoms_[c + 1]], xprime_[iatoms_[c + 2]], dx);
+                EXPECT_REAL_EQ_TOL(len, norm(dx),
+                                   gmx::test::relativeToleranceAsFloatingPoint(len, 1e-3));
+            }
+
+            checker_.checkSequenceArray(numAtoms_*DIM, xprime_[0], "ConstrainedCoordinates");
+            checker_.checkSequenceArray(numAtoms_*DIM, v_[0], "ConstrainedVelocities");
+            checker_.checkSequenceArray(DIM*DIM, vir[0], "Virial");
+        }
+
+        gmx::test::TestReferenceData    data_;
+        gmx::test::TestReferenceChecker checker_;
+        gmx_mtop_t                      mtop_;
+        t_idef                          idef_;
+        std::vector<int>                iatoms_;
+        t_mdatoms                       md_;
+        real                            invmass_[numAtoms_];
+        t_inputrec                      ir_;
+        t_commrec                       cr_;
+        t_nrnb                          nrnb_;
+        rvec                            x_[numAtoms_];
+        rvec                            xprime_[numAtoms_];
+        rvec                            v_[numAtoms_];
+};
+
+TEST_F(LincsTest, ConstrainsCoordinates)
+{
+    testConstrainCoordinates(1, 1, 4);
+}
+
+TEST_F(LincsTest, ConstrainsCoordinatesWithHighOrder)
+{
+    testConstrainCoordinates(1, 2, 8);
+}
+
+#ifdef GMX_OPENMP
+TEST_F(LincsTest, ConstrainsCoordinatesWithDependentTasks)
+{
+    testConstrainCoordinates(2, 1, 4);
+}
+#endif
+
+TEST_F(LincsTest, ProjectsDerivatives)
+{
+    gmx_lincsdata_t lincsd = initLincs(1, 1, 4);
+    matrix          box    = {{ 0 }};
+    tensor          vir    = {{ 0 }};
+    rvec            proj[numAtoms_];
+    int             warncount = 0;
+
+    clear_rvecs(numAtoms_, proj);
+    EXPECT_TRUE(constrain_lincs(NULL, FALSE, FALSE, &ir_, 0, lincsd, &md_, &cr_,
+                                x_, v_, proj, box, NULL,
+                                0, NULL, 0, NULL,
+                                TRUE, vir, econqDeriv, &nrnb_,
+                                1000, &warncount));
+
+    checker_.checkSequenceArray(numAtoms_*DIM, proj[0], "ProjectedDerivatives");
+    checker_.checkSequenceArray(DIM*DIM, vir[0], "Virial");
+}
+
+} // namespace
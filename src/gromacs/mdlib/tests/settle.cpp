@@ -0,0 +1,292 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for SETTLE.
+ *
+ * The settled coordinates, velocities and virial are compared against
+ * reference data, with and without periodic boundary conditions.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/legacyheaders/constr.h"
+#include "gromacs/legacyheaders/types/simple.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/refdata.h"
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+//! Oxygen-hydrogen distance of the test water model
+const real dOH = 0.09572;
+//! Hydrogen-hydrogen distance of the test water model
+const real dHH = 0.15139;
+//! Oxygen mass
+const real mO  = 15.9994;
+//! Hydrogen mass
+const real mH  = 1.008;
+
+/*! \brief Test fixture for SETTLE
+ *
+ * The system consists of 19 waters with different orientations,
+ * which gives several SIMD batches of waters plus a remainder.
+ */
+class SettleTest : public ::testing::Test
+{
+    public:
+        //! Number of waters in the system
+        static const int numSettles_ = 19;
+        //! Number of atoms in the system
+        static const int numAtoms_   = 3*numSettles_;
+
+        SettleTest() : checker_(data_.rootChecker())
+        {
+#ifdef GMX_DOUBLE
+            /* The reference data has been generated in single precision */
+            checker_.setDefaultTolerance(
+                    gmx::test::relativeToleranceAsFloatingPoint(1.0, 1e-6));
+#else
+            checker_.setDefaultTolerance(
+                    gmx::test::relativeToleranceAsUlp(1.0, 8));
+#endif
+
+            settled_ = settle_init(mO, mH, 1/mO, 1/mH, dOH, dHH);
+
+            /* The waters are stored in reverse order in the settle list */
+            for (int s = 0; s < numSettles_; s++)
+            {
+                int a = 3*(numSettles_ - 1 - s);
+
+                iatoms_[s*4 + 0] = 0;
+                iatoms_[s*4 + 1] = a;
+                iatoms_[s*4 + 2] = a + 1;
+                iatoms_[s*4 + 3] = a + 2;
+            }
+
+            const real box = 1.2;
+            clear_mat(box_);
+            box_[XX][XX] = box;
+            box_[YY][YY] = box;
+            box_[ZZ][ZZ] = box;
+
+            /* Build rotated ideal waters on a grid and give them
+             * velocities of a hot system.
+             */
+            const real hx = 0.5*dHH;
+            const real hy = std::sqrt(dOH*dOH - hx*hx);
+            const real ideal[3][DIM] = { { 0, 0, 0 }, { hx, hy, 0 }, { -hx, hy, 0 } };
+            for (int w = 0; w < numSettles_; w++)
+            {
+                real   phi = 0.7*w;
+                real   psi = 1.3*w + 0.2;
+                matrix rot;
+
+                rot[XX][XX] =  std::cos(phi);
+                rot[XX][YY] = -std::sin(phi)*std::cos(psi);
+                rot[XX][ZZ] =  std::sin(phi)*std::sin(psi);
+                rot[YY][XX] =  std::sin(phi);
+                rot[YY][YY] =  std::cos(phi)*std::cos(psi);
+                rot[YY][ZZ] = -std::cos(phi)*std::sin(psi);
+                rot[ZZ][XX] =  0;
+                rot[ZZ][YY] =  std::sin(psi);
+                rot[ZZ][ZZ] =  std::cos(psi);
+
+                for (int i = 0; i < 3; i++)
+                {
+                    int a = 3*w + i;
+
+                    mvmul(rot, ideal[i], x_[a]);
+                    x_[a][XX] += 0.3*(w % 4);
+                    x_[a][YY] += 0.3*((w/4) % 4);
+                    x_[a][ZZ] += 0.3*(w/16);
+
+                    v_[a][XX]  = 2.0*std::sin(1.1*a);
+                    v_[a][YY]  = 2.0*std::cos(0.7*a);
+                    v_[a][ZZ]  = 1.5*std::sin(0.4*a + 1);
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        xprime_[a][d] = x_[a][d] + dt_*v_[a][d];
+                    }
+                }
+            }
+        }
+
+        ~SettleTest()
+        {
+            sfree(settled_);
+        }
+
+        //! Moves some atoms over the box edge, both in x_ and xprime_
+        void shiftAtomsOverBoxEdges()
+        {
+            for (int a = 1; a < numAtoms_; a += 4)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    real shift = ((a/4 + d) % 3 - 1)*box_[d][d];
+
+                    x_[a][d]      += shift;
+                    xprime_[a][d] += shift;
+                }
+            }
+        }
+
+        //! Runs SETTLE and checks the results, with PBC when \p pbc != NULL
+        void testSettle(const t_pbc *pbc)
+        {
+            tensor vir   = {{ 0 }};
+            int    error = -2;
+
+            csettle(settled_, numSettles_, iatoms_, pbc,
+                    x_[0], xprime_[0], 1/dt_, v_[0], numAtoms_,
+                    vir, &error);
+            EXPECT_EQ(-1, error);
+
+            for (int s = 0; s < numSettles_; s++)
+            {
+                const t_iatom *ia = iatoms_ + s*4;
+                rvec           dx;
+
+                for (int i = 0; i < 3; i++)
+                {
+                    int  a1  = ia[1 + (i == 2 ? 1 : 0)];
+                    int  a2  = ia[2 + (i == 0 ? 0 : 1)];
+                    real ref = (i == 2 ? dHH : dOH);
+
+                    if (pbc != NULL)
+                    {
+                        pbc_dx_aiuc(pbc, xprime_[a1], xprime_[a2], dx);
+                    }
+                    else
+                    {
+                        rvec_sub(xprime_[a1], xprime_[a2], dx);
+                    }
+                    EXPECT_REAL_EQ_TOL(ref, norm(dx),
+                                       gmx::test::relativeToleranceAsFloatingPoint(ref, 1e-4));
+                }
+            }
+
+            checker_.checkSequenceArray(numAtoms_*DIM, xprime_[0], "SettledCoordinates");
+            checker_.checkSequenceArray(DIM*DIM, vir[0], "Virial");
+            /* The velocity updates are coordinate displacements divided
+             * by the time step, so their precision is set by that of
+             * the coordinates, which are of order 1.
+             */
+            checker_.setDefaultTolerance(
+                    gmx::test::absoluteTolerance(GMX_FLOAT_EPS/dt_));
+            checker_.checkSequenceArray(numAtoms_*DIM, v_[0], "SettledVelocities");
+        }
+
+        gmx::test::TestReferenceData    data_;
+        gmx::test::TestReferenceChecker checker_;
+        //! The time step
+        static const real               dt_;
+        gmx_settledata_t                settled_;
+        t_iatom                         iatoms_[numSettles_*4];
+        matrix                          box_;
+        rvec                            x_[numAtoms_];
+        rvec                            xprime_[numAtoms_];
+        rvec                            v_[numAtoms_];
+};
+
+const real SettleTest::dt_ = 0.002;
+
+TEST_F(SettleTest, SettlesWaters)
+{
+    testSettle(NULL);
+}
+
+TEST_F(SettleTest, SettlesWatersWithPbc)
+{
+    t_pbc pbc;
+
+    shiftAtomsOverBoxEdges();
+    set_pbc(&pbc, epbcXYZ, box_);
+    testSettle(&pbc);
+}
+
+TEST_F(SettleTest, ReportsWaterThatCannotBeSettled)
+{
+    tensor vir   = {{ 0 }};
+    int    error = -2;
+    rvec   xprimeRef[numAtoms_];
+
+    /* Stretch the first hydrogen of the water at settle index 13
+     * so far that it can not be settled.
+     */
+    const int badSettle = 13;
+    const int badAtom   = iatoms_[badSettle*4 + 2];
+    xprime_[badAtom][XX] += 1.0;
+    copy_rvecn(xprime_, xprimeRef, 0, numAtoms_);
+
+    csettle(settled_, numSettles_, iatoms_, NULL,
+            x_[0], xprime_[0], 1/dt_, v_[0], numAtoms_,
+            vir, &error);
+    EXPECT_EQ(badSettle, error);
+
+    /* The water that failed should be left untouched */
+    for (int i = 1; i < 4; i++)
+    {
+        int a = iatoms_[badSettle*4 + i];
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_EQ(xprimeRef[a][d], xprime_[a][d]);
+        }
+    }
+    /* All other waters should have been settled */
+    for (int s = 0; s < numSettles_; s++)
+    {
+        if (s != badSettle)
+        {
+            rvec dx;
+
+            rvec_sub(xprime_[iatoms_[s*4 + 1]], xprime_[iatoms_[s*4 + 2]], dx);
+            EXPECT_REAL_EQ_TOL(dOH, norm(dx),
+                               gmx::test::relativeToleranceAsFloatingPoint(dOH, 1e-4));
+        }
+    }
+}
+
+} // namespace
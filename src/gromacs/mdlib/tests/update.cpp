@@ -0,0 +1,308 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the coordinate update.
+ *
+ * The SIMD leap-frog and velocity Verlet updates are compared against
+ * the scalar update, which is selected by passing group index arrays.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/legacyheaders/gmx_omp_nthreads.h"
+#include "gromacs/legacyheaders/nrnb.h"
+#include "gromacs/legacyheaders/update.h"
+#include "gromacs/legacyheaders/types/commrec.h"
+#include "gromacs/legacyheaders/types/inputrec.h"
+#include "gromacs/legacyheaders/types/mdatom.h"
+#include "gromacs/legacyheaders/types/state.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+/*! \brief Test fixture for the coordinate update
+ *
+ * The system consists of 61 atoms, which gives several SIMD blocks
+ * plus a remainder for each of the two update threads. One atom is
+ * a virtual site and one is a shell, these should not move.
+ */
+class UpdateTest : public ::testing::Test
+{
+    public:
+        //! Number of atoms in the system
+        static const int numAtoms_ = 61;
+
+        UpdateTest()
+        {
+            std::memset(&ir_, 0, sizeof(ir_));
+            ir_.eI             = eiMD;
+            ir_.delta_t        = 0.002;
+            ir_.etc            = etcBERENDSEN;
+            ir_.epc            = epcNO;
+            ir_.opts.ngtc      = 1;
+            ir_.opts.nrdf      = nrdf_;
+            ir_.opts.nFreeze   = nFreeze_;
+            ir_.opts.acc       = acc_;
+            nrdf_[0]           = 3*numAtoms_ - 3;
+            clear_ivec(nFreeze_[0]);
+            clear_rvec(acc_[0]);
+
+            std::memset(&md_, 0, sizeof(md_));
+            md_.nr      = numAtoms_;
+            md_.homenr  = numAtoms_;
+            md_.invmass = invmass_;
+            md_.ptype   = ptype_;
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                invmass_[a]   = 1.0/(a % 3 == 0 ? 15.999 : 1.008);
+                ptype_[a]     = eptAtom;
+                groupZero_[a] = 0;
+            }
+            ptype_[6]   = eptVSite;
+            invmass_[6] = 0;
+            ptype_[40]  = eptShell;
+
+            std::memset(&tcstat_, 0, sizeof(tcstat_));
+            tcstat_[0].lambda = 0.97;
+            std::memset(&ekind_, 0, sizeof(ekind_));
+            ekind_.ngtc   = 1;
+            ekind_.tcstat = tcstat_;
+
+            std::memset(&cr_, 0, sizeof(cr_));
+            cr_.nnodes = 1;
+
+            init_nrnb(&nrnb_);
+
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                x0_[a][XX] = 1.0 + 0.05*a;
+                x0_[a][YY] = 2.0 + 0.5*std::sin(0.9*a);
+                x0_[a][ZZ] = 1.5 + 0.5*std::cos(1.3*a);
+                v0_[a][XX] = 1.2*std::sin(1.1*a);
+                v0_[a][YY] = 0.9*std::cos(0.7*a);
+                v0_[a][ZZ] = 1.1*std::sin(0.4*a + 1);
+                f_[a][XX]  = 500*std::cos(0.3*a);
+                f_[a][YY]  = 300*std::sin(2.1*a);
+                f_[a][ZZ]  = -400*std::cos(1.7*a + 0.5);
+            }
+
+            veta_ = 0;
+
+            gmx_omp_nthreads_set(emntUpdate, 2);
+        }
+
+        /*! \brief Initializes the state and the update struct
+         *
+         * This should be called after changing ir_.
+         */
+        void initState()
+        {
+            std::memset(&state_, 0, sizeof(state_));
+            state_.natoms = numAtoms_;
+            state_.nalloc = numAtoms_;
+            state_.x      = x_;
+            state_.v      = v_;
+            state_.veta   = veta_;
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                copy_rvec(x0_[a], x_[a]);
+                copy_rvec(v0_[a], v_[a]);
+            }
+
+            upd_ = init_update(&ir_);
+        }
+
+        //! Copies the updated coordinates from the update buffer to x_
+        void finishUpdate()
+        {
+            real   dvdlambda = 0;
+            tensor vir;
+
+            update_constraints(NULL, 0, &dvdlambda, &ir_, &md_, &state_, FALSE,
+                               NULL, f_, NULL, vir, &cr_, &nrnb_, NULL,
+                               upd_, NULL, FALSE, FALSE);
+        }
+
+        //! Does one leap-frog step, stores the result in \p x and \p v
+        void runLeapFrogStep(rvec *x, rvec *v)
+        {
+            matrix M;
+
+            clear_mat(M);
+            initState();
+            update_coords(NULL, 0, &ir_, &md_, &state_, FALSE, f_,
+                          FALSE, NULL, NULL, NULL, &ekind_, M, upd_, FALSE,
+                          etrtPOSITION, &cr_, &nrnb_, NULL, NULL);
+            finishUpdate();
+            copyResult(x, v);
+        }
+
+        //! Does one velocity Verlet step, stores the result in \p x and \p v
+        void runVelocityVerletStep(rvec *x, rvec *v)
+        {
+            matrix M;
+
+            clear_mat(M);
+            initState();
+            update_coords(NULL, 0, &ir_, &md_, &state_, FALSE, f_,
+                          FALSE, NULL, NULL, NULL, &ekind_, M, upd_, FALSE,
+                          etrtVELOCITY1, &cr_, &nrnb_, NULL, NULL);
+            update_coords(NULL, 0, &ir_, &md_, &state_, FALSE, f_,
+                          FALSE, NULL, NULL, NULL, &ekind_, M, upd_, FALSE,
+                          etrtPOSITION, &cr_, &nrnb_, NULL, NULL);
+            finishUpdate();
+            copyResult(x, v);
+        }
+
+        //! Copies the state to \p x and \p v
+        void copyResult(rvec *x, rvec *v)
+        {
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                copy_rvec(x_[a], x[a]);
+                copy_rvec(v_[a], v[a]);
+            }
+        }
+
+        //! Expects \p x and \p v to match the reference within rounding
+        void compareWithReference(const rvec *xRef, const rvec *vRef,
+                                  const rvec *x, const rvec *v)
+        {
+            /* SIMD uses FMA and single precision for dt/m */
+            gmx::test::FloatingPointTolerance xTolerance(
+                    gmx::test::relativeToleranceAsFloatingPoint(4.0, 1e-6));
+            gmx::test::FloatingPointTolerance vTolerance(
+                    gmx::test::relativeToleranceAsFloatingPoint(2.0, 1e-6));
+
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ_TOL(xRef[a][d], x[a][d], xTolerance)
+                    << "x of atom " << a << " dim " << d;
+                    EXPECT_REAL_EQ_TOL(vRef[a][d], v[a][d], vTolerance)
+                    << "v of atom " << a << " dim " << d;
+                }
+            }
+            /* The virtual site and the shell do not move */
+            EXPECT_EQ(x0_[6][XX], x[6][XX]);
+            EXPECT_EQ(0, v[6][XX]);
+            EXPECT_EQ(x0_[40][XX], x[40][XX]);
+            EXPECT_EQ(0, v[40][XX]);
+        }
+
+        t_inputrec     ir_;
+        t_mdatoms      md_;
+        t_state        state_;
+        gmx_ekindata_t ekind_;
+        t_grp_tcstat   tcstat_[1];
+        t_commrec      cr_;
+        t_nrnb         nrnb_;
+        gmx_update_t   upd_;
+        real           veta_;
+        real           nrdf_[1];
+        ivec           nFreeze_[1];
+        rvec           acc_[1];
+        real           invmass_[numAtoms_];
+        unsigned short ptype_[numAtoms_];
+        unsigned short groupZero_[numAtoms_];
+        rvec           x0_[numAtoms_];
+        rvec           v0_[numAtoms_];
+        rvec           x_[numAtoms_];
+        rvec           v_[numAtoms_];
+        rvec           f_[numAtoms_];
+};
+
+TEST_F(UpdateTest, LeapFrogSingleGroupMatchesScalarUpdate)
+{
+    rvec xRef[numAtoms_], vRef[numAtoms_], x[numAtoms_], v[numAtoms_];
+
+    /* With a T-coupling group index array the scalar update is used */
+    md_.cTC = groupZero_;
+    runLeapFrogStep(xRef, vRef);
+
+    /* Without, the SIMD update is used, when supported */
+    md_.cTC = NULL;
+    runLeapFrogStep(x, v);
+
+    compareWithReference(xRef, vRef, x, v);
+}
+
+TEST_F(UpdateTest, VelocityVerletMatchesScalarUpdate)
+{
+    rvec xRef[numAtoms_], vRef[numAtoms_], x[numAtoms_], v[numAtoms_];
+
+    ir_.eI = eiVV;
+
+    /* With a freeze group index array the scalar update is used */
+    md_.cFREEZE = groupZero_;
+    runVelocityVerletStep(xRef, vRef);
+
+    md_.cFREEZE = NULL;
+    runVelocityVerletStep(x, v);
+
+    compareWithReference(xRef, vRef, x, v);
+}
+
+TEST_F(UpdateTest, VelocityVerletWithExtendedEnsembleMatchesScalarUpdate)
+{
+    rvec xRef[numAtoms_], vRef[numAtoms_], x[numAtoms_], v[numAtoms_];
+
+    /* With Nose-Hoover, the velocities and positions are scaled with veta */
+    ir_.eI  = eiVV;
+    ir_.etc = etcNOSEHOOVER;
+    veta_   = 2.5;
+
+    md_.cFREEZE = groupZero_;
+    runVelocityVerletStep(xRef, vRef);
+
+    md_.cFREEZE = NULL;
+    runVelocityVerletStep(x, v);
+
+    compareWithReference(xRef, vRef, x, v);
+}
+
+} // namespace
@@ -0,0 +1,266 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the SIMD virtual site kernels.
+ *
+ * The constructed positions and velocities, the spread forces and
+ * the shift forces are compared between the SIMD and the scalar code,
+ * with and without periodic boundary conditions.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/legacyheaders/nrnb.h"
+#include "gromacs/legacyheaders/types/commrec.h"
+#include "gromacs/legacyheaders/types/ifunc.h"
+#include "gromacs/legacyheaders/types/simple.h"
+#include "gromacs/legacyheaders/vsite.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/topology/idef.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+/*! \brief Test fixture for the SIMD vsite kernels
+ *
+ * The system consists of 19 three-atom constructed vsites of the type
+ * given by the test parameter, which gives several SIMD batches plus
+ * a remainder. The vsites use three different sets of parameters.
+ */
+class VsiteTest : public ::testing::TestWithParam<int>
+{
+    public:
+        //! Number of vsites in the system
+        static const int numVsites_ = 19;
+        //! Number of atoms in the system
+        static const int numAtoms_  = 4*numVsites_;
+        //! Number of entries per vsite in the interaction list
+        static const int nral1_     = 5;
+
+        VsiteTest() : ftype_(GetParam())
+        {
+            snew(vsite_, 1);
+            vsite_->bHaveChargeGroups = FALSE;
+            vsite_->n_intercg_vsite   = numVsites_;
+            vsite_->nthreads          = 1;
+            snew(vsite_->tdata, 1);
+
+            snew(cr_, 1);
+            cr_->nnodes = 1;
+
+            snew(idef_, 1);
+            for (int t = 0; t < 3; t++)
+            {
+                ip_[t].vsite.a = 0.25 + 0.1*t;
+                ip_[t].vsite.b = 0.4 - 0.05*t;
+                ip_[t].vsite.c = 2.5 + 1.5*t;
+            }
+            idef_->ntypes  = 3;
+            idef_->iparams = ip_;
+
+            /* The vsites are stored in reverse order and the atoms
+             * in the list are permuted, so all accesses are indexed.
+             */
+            for (int v = 0; v < numVsites_; v++)
+            {
+                int a = 4*(numVsites_ - 1 - v);
+
+                iatoms_[v*nral1_ + 0] = v % 3;
+                iatoms_[v*nral1_ + 1] = a + 1;
+                iatoms_[v*nral1_ + 2] = a + 2;
+                iatoms_[v*nral1_ + 3] = a;
+                iatoms_[v*nral1_ + 4] = a + 3;
+            }
+            idef_->il[ftype_].nr     = numVsites_*nral1_;
+            idef_->il[ftype_].iatoms = iatoms_;
+
+            const real box = 1.2;
+            clear_mat(box_);
+            box_[XX][XX] = box;
+            box_[YY][YY] = box;
+            box_[ZZ][ZZ] = box;
+
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                int w = a/4;
+
+                x_[a][XX] = 0.3*(w % 4);
+                x_[a][YY] = 0.3*((w/4) % 4);
+                x_[a][ZZ] = 0.3*(w/16);
+                if (a % 4 > 0)
+                {
+                    x_[a][XX] += 0.1*std::cos(0.9*a);
+                    x_[a][YY] += 0.1*std::sin(0.9*a);
+                    x_[a][ZZ] += 0.05*std::sin(0.3*a + 1);
+                }
+
+                v_[a][XX] = 0;
+                v_[a][YY] = 0;
+                v_[a][ZZ] = 0;
+
+                f_[a][XX] = 2.0*std::sin(1.1*a);
+                f_[a][YY] = 2.0*std::cos(0.7*a);
+                f_[a][ZZ] = 1.5*std::sin(0.4*a + 1);
+            }
+        }
+
+        ~VsiteTest()
+        {
+            sfree(vsite_->tdata);
+            sfree(vsite_);
+            sfree(cr_);
+            sfree(idef_);
+        }
+
+        //! Moves some atoms over the box edge
+        void shiftAtomsOverBoxEdges()
+        {
+            for (int a = 1; a < numAtoms_; a += 5)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    x_[a][d] += ((a/5 + d) % 3 - 1)*box_[d][d];
+                }
+            }
+        }
+
+        /*! \brief Constructs the vsites and spreads their forces
+         *
+         * \param[in]  bSimd   Whether the SIMD kernels may be used
+         * \param[in]  ePBC    The type of periodic boundary conditions
+         * \param[out] x       The coordinates with constructed vsites
+         * \param[out] v       The velocities of the vsites
+         * \param[out] f       The forces after spreading
+         * \param[out] fshift  The shift forces
+         */
+        void runVsites(gmx_bool bSimd, int ePBC,
+                       rvec x[], rvec v[], rvec f[], rvec fshift[])
+        {
+            matrix vir;
+            t_nrnb nrnb;
+
+            vsite_->bSimd[ftype_ - F_VSITE2] = bSimd;
+
+            copy_rvecn(x_, x, 0, numAtoms_);
+            copy_rvecn(v_, v, 0, numAtoms_);
+            copy_rvecn(f_, f, 0, numAtoms_);
+            for (int i = 0; i < SHIFTS; i++)
+            {
+                clear_rvec(fshift[i]);
+            }
+            clear_mat(vir);
+            init_nrnb(&nrnb);
+
+            construct_vsites(vsite_, x, dt_, v, ip_, idef_->il,
+                             ePBC, TRUE, cr_, box_);
+            spread_vsite_f(vsite_, x, f, fshift, FALSE, vir, &nrnb, idef_,
+                           ePBC, TRUE, NULL, box_, cr_);
+        }
+
+        //! Checks that the SIMD and scalar kernels give the same results
+        void testVsites(int ePBC)
+        {
+            rvec xRef[numAtoms_], vRef[numAtoms_], fRef[numAtoms_];
+            rvec fshiftRef[SHIFTS];
+            rvec x[numAtoms_], v[numAtoms_], f[numAtoms_];
+            rvec fshift[SHIFTS];
+
+            runVsites(FALSE, ePBC, xRef, vRef, fRef, fshiftRef);
+            runVsites(TRUE, ePBC, x, v, f, fshift);
+
+            gmx::test::FloatingPointTolerance xTol(gmx::test::relativeToleranceAsUlp(1.0, 16));
+            gmx::test::FloatingPointTolerance vTol(gmx::test::relativeToleranceAsUlp(1.0/dt_, 16));
+            gmx::test::FloatingPointTolerance fTol(gmx::test::relativeToleranceAsUlp(10.0, 16));
+            for (int a = 0; a < numAtoms_; a++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ_TOL(xRef[a][d], x[a][d], xTol) << "atom " << a << " dim " << d;
+                    EXPECT_REAL_EQ_TOL(vRef[a][d], v[a][d], vTol) << "atom " << a << " dim " << d;
+                    EXPECT_REAL_EQ_TOL(fRef[a][d], f[a][d], fTol) << "atom " << a << " dim " << d;
+                }
+            }
+            for (int i = 0; i < SHIFTS; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ_TOL(fshiftRef[i][d], fshift[i][d], fTol) << "shift " << i << " dim " << d;
+                }
+            }
+        }
+
+        //! The vsite type
+        int                   ftype_;
+        //! The time step
+        static const real     dt_;
+        gmx_vsite_t          *vsite_;
+        t_commrec            *cr_;
+        t_idef               *idef_;
+        t_iparams             ip_[3];
+        t_iatom               iatoms_[numVsites_*nral1_];
+        matrix                box_;
+        rvec                  x_[numAtoms_];
+        rvec                  v_[numAtoms_];
+        rvec                  f_[numAtoms_];
+};
+
+const real VsiteTest::dt_ = 0.002;
+
+TEST_P(VsiteTest, SimdMatchesScalar)
+{
+    testVsites(epbcNONE);
+}
+
+TEST_P(VsiteTest, SimdMatchesScalarWithPbc)
+{
+    shiftAtomsOverBoxEdges();
+    testVsites(epbcXYZ);
+}
+
+INSTANTIATE_TEST_CASE_P(VsiteTypes, VsiteTest,
+                            ::testing::Values(F_VSITE3, F_VSITE3OUT));
+
+} // namespace
@@ -63,11 +63,17 @@
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/pulling/pull.h"
 #include "gromacs/random/random.h"
+#include "gromacs/simd/simd.h"
 #include "gromacs/timing/wallcycle.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
+/* The SIMD leap-frog update uses unaligned loads and stores */
+#if defined GMX_SIMD_HAVE_REAL && defined GMX_SIMD_HAVE_LOADU && defined GMX_SIMD_HAVE_STOREU
+#define UPDATE_SIMD
+#endif
+
 /*For debugging, start at v(-dt/2) for velolcity verlet -- uncomment next line */
 /*#define STARTFROMDT2*/
 
@@ -114,6 +120,109 @@ typedef struct gmx_update
 } t_gmx_update;
 
 
+/* Plain leap-frog update with Berendsen/v-rescale coupling */
+static void do_update_md_plain(int start, int nrend, double dt,
+                               t_grp_tcstat *tcstat,
+                               real invmass[], unsigned short ptype[],
+                               unsigned short cTC[],
+                               rvec x[], rvec xprime[], rvec v[], rvec f[])
+{
+    double w_dt;
+    int    gt = 0;
+    real   vn, lg;
+    int    n, d;
+
+    for (n = start; n < nrend; n++)
+    {
+        if ((ptype[n] != eptVSite) && (ptype[n] != eptShell))
+        {
+            w_dt = invmass[n]*dt;
+            if (cTC)
+            {
+                gt = cTC[n];
+            }
+            lg = tcstat[gt].lambda;
+
+            for (d = 0; d < DIM; d++)
+            {
+                vn           = lg*v[n][d] + f[n][d]*w_dt;
+                v[n][d]      = vn;
+                xprime[n][d] = x[n][d] + vn*dt;
+            }
+        }
+        else
+        {
+            for (d = 0; d < DIM; d++)
+            {
+                v[n][d]        = 0.0;
+                xprime[n][d]   = x[n][d];
+            }
+        }
+    }
+}
+
+#ifdef UPDATE_SIMD
+/* Plain leap-frog update for a single temperature coupling group with SIMD.
+ * GMX_SIMD_REAL_WIDTH atoms are updated at a time by treating the rvec
+ * arrays as flat real arrays, the new positions are stored directly
+ * in xprime for the constraints. Blocks containing virtual sites or
+ * shells and the remainder are updated with do_update_md_plain.
+ */
+static void do_update_md_plain_simd(int start, int nrend, double dt,
+                                    t_grp_tcstat *tcstat,
+                                    real invmass[], unsigned short ptype[],
+                                    rvec x[], rvec xprime[], rvec v[], rvec f[])
+{
+    real            imdt_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *imdt;
+    gmx_simd_real_t dt_S, lg_S, v_S, x_S;
+    gmx_bool        bPlain;
+    real            w_dt;
+    int             n, i, d;
+
+    /* Ensure register memory alignment */
+    imdt = gmx_simd_align_r(imdt_array);
+
+    dt_S = gmx_simd_set1_r(dt);
+    lg_S = gmx_simd_set1_r(tcstat[0].lambda);
+
+    for (n = start; n + GMX_SIMD_REAL_WIDTH <= nrend; n += GMX_SIMD_REAL_WIDTH)
+    {
+        /* Spread the inverse masses times dt over the flat rvec layout */
+        bPlain = TRUE;
+        for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+        {
+            w_dt           = invmass[n + i]*dt;
+            imdt[i*DIM+XX] = w_dt;
+            imdt[i*DIM+YY] = w_dt;
+            imdt[i*DIM+ZZ] = w_dt;
+            bPlain         = bPlain && (ptype[n + i] != eptVSite) && (ptype[n + i] != eptShell);
+        }
+        if (!bPlain)
+        {
+            do_update_md_plain(n, n + GMX_SIMD_REAL_WIDTH, dt,
+                               tcstat, invmass, ptype, NULL,
+                               x, xprime, v, f);
+            continue;
+        }
+
+        for (d = 0; d < DIM; d++)
+        {
+            v_S = gmx_simd_loadu_r(v[n] + d*GMX_SIMD_REAL_WIDTH);
+            v_S = gmx_simd_fmadd_r(gmx_simd_loadu_r(f[n] + d*GMX_SIMD_REAL_WIDTH),
+                                   gmx_simd_load_r(imdt + d*GMX_SIMD_REAL_WIDTH),
+                                   gmx_simd_mul_r(lg_S, v_S));
+            x_S = gmx_simd_fmadd_r(v_S, dt_S,
+                                   gmx_simd_loadu_r(x[n] + d*GMX_SIMD_REAL_WIDTH));
+            gmx_simd_storeu_r(v[n] + d*GMX_SIMD_REAL_WIDTH, v_S);
+            gmx_simd_storeu_r(xprime[n] + d*GMX_SIMD_REAL_WIDTH, x_S);
+        }
+    }
+
+    do_update_md_plain(n, nrend, dt, tcstat, invmass, ptype, NULL,
+                       x, xprime, v, f);
+}
+#endif
+
 static void do_update_md(int start, int nrend, double dt,
                          t_grp_tcstat *tcstat,
                          double nh_vxi[],
@@ -228,35 +337,130 @@ static void do_update_md(int start, int nrend, double dt,
     else
     {
         /* Plain update with Berendsen/v-rescale coupling */
-        for (n = start; n < nrend; n++)
+#ifdef UPDATE_SIMD
+        if (cTC == NULL)
         {
-            if ((ptype[n] != eptVSite) && (ptype[n] != eptShell))
-            {
-                w_dt = invmass[n]*dt;
-                if (cTC)
-                {
-                    gt = cTC[n];
-                }
-                lg = tcstat[gt].lambda;
+            do_update_md_plain_simd(start, nrend, dt, tcstat, invmass, ptype,
+                                    x, xprime, v, f);
+            return;
+        }
+#endif
+        do_update_md_plain(start, nrend, dt, tcstat, invmass, ptype, cTC,
+                           x, xprime, v, f);
+    }
+}
 
-                for (d = 0; d < DIM; d++)
-                {
-                    vn           = lg*v[n][d] + f[n][d]*w_dt;
-                    v[n][d]      = vn;
-                    xprime[n][d] = x[n][d] + vn*dt;
-                }
-            }
-            else
-            {
-                for (d = 0; d < DIM; d++)
-                {
-                    v[n][d]        = 0.0;
-                    xprime[n][d]   = x[n][d];
-                }
-            }
+#ifdef UPDATE_SIMD
+/* Sets up the per-coordinate factors for the velocity Verlet SIMD updates
+ * of the GMX_SIMD_REAL_WIDTH atoms starting at atom n in the flat rvec
+ * layout. Normal particles get factors a and b*invmass, virtual sites
+ * and shells get factors a_special and 0.
+ */
+static gmx_inline void spread_vv_factors(int n,
+                                         real a, real a_special, real b,
+                                         const real invmass[],
+                                         const unsigned short ptype[],
+                                         real *fac_a, real *fac_b)
+{
+    int  i, d;
+    real fa, fb;
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        if ((ptype[n + i] != eptVSite) && (ptype[n + i] != eptShell))
+        {
+            fa = a;
+            fb = (invmass != NULL ? b*invmass[n + i] : b);
+        }
+        else
+        {
+            fa = a_special;
+            fb = 0;
+        }
+        for (d = 0; d < DIM; d++)
+        {
+            fac_a[i*DIM + d] = fa;
+            fac_b[i*DIM + d] = fb;
+        }
+    }
+}
+
+/* Velocity Verlet velocity update without freezing and acceleration
+ * in a single SIMD pass over the flat rvec arrays, GMX_SIMD_REAL_WIDTH
+ * atoms at a time. Returns the atom index where the remaining atoms,
+ * less than a SIMD width, start.
+ */
+static int do_update_vv_vel_simd(int start, int nrend, double dt,
+                                 real invmass[], unsigned short ptype[],
+                                 rvec v[], rvec f[],
+                                 double mv1, double mv2)
+{
+    real            fac_array[2*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH];
+    real           *fac_v, *fac_f;
+    gmx_simd_real_t v_S;
+    int             n, d;
+
+    /* Ensure register memory alignment */
+    fac_v = gmx_simd_align_r(fac_array);
+    fac_f = fac_v + DIM*GMX_SIMD_REAL_WIDTH;
+
+    for (n = start; n + GMX_SIMD_REAL_WIDTH <= nrend; n += GMX_SIMD_REAL_WIDTH)
+    {
+        spread_vv_factors(n, mv1*mv1, 0, 0.5*dt*mv1*mv2, invmass, ptype,
+                          fac_v, fac_f);
+
+        for (d = 0; d < DIM; d++)
+        {
+            v_S = gmx_simd_mul_r(gmx_simd_load_r(fac_v + d*GMX_SIMD_REAL_WIDTH),
+                                 gmx_simd_loadu_r(v[n] + d*GMX_SIMD_REAL_WIDTH));
+            v_S = gmx_simd_fmadd_r(gmx_simd_load_r(fac_f + d*GMX_SIMD_REAL_WIDTH),
+                                   gmx_simd_loadu_r(f[n] + d*GMX_SIMD_REAL_WIDTH),
+                                   v_S);
+            gmx_simd_storeu_r(v[n] + d*GMX_SIMD_REAL_WIDTH, v_S);
         }
     }
+
+    return n;
+}
+
+/* Velocity Verlet position update without freezing in a single SIMD
+ * pass over the flat rvec arrays, GMX_SIMD_REAL_WIDTH atoms at a time.
+ * Returns the atom index where the remaining atoms,
+ * less than a SIMD width, start.
+ */
+static int do_update_vv_pos_simd(int start, int nrend, double dt,
+                                 unsigned short ptype[],
+                                 rvec x[], rvec xprime[], rvec v[],
+                                 double mr1, double mr2)
+{
+    real            fac_array[2*DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH];
+    real           *fac_x, *fac_v;
+    gmx_simd_real_t x_S;
+    int             n, d;
+
+    /* Ensure register memory alignment */
+    fac_x = gmx_simd_align_r(fac_array);
+    fac_v = fac_x + DIM*GMX_SIMD_REAL_WIDTH;
+
+    for (n = start; n + GMX_SIMD_REAL_WIDTH <= nrend; n += GMX_SIMD_REAL_WIDTH)
+    {
+        spread_vv_factors(n, mr1*mr1, 1, mr1*mr2*dt, NULL, ptype,
+                          fac_x, fac_v);
+
+        for (d = 0; d < DIM; d++)
+        {
+            x_S = gmx_simd_mul_r(gmx_simd_load_r(fac_x + d*GMX_SIMD_REAL_WIDTH),
+                                 gmx_simd_loadu_r(x[n] + d*GMX_SIMD_REAL_WIDTH));
+            x_S = gmx_simd_fmadd_r(gmx_simd_load_r(fac_v + d*GMX_SIMD_REAL_WIDTH),
+                                   gmx_simd_loadu_r(v[n] + d*GMX_SIMD_REAL_WIDTH),
+                                   x_S);
+            gmx_simd_storeu_r(xprime[n] + d*GMX_SIMD_REAL_WIDTH, x_S);
+        }
+    }
+
+    return n;
 }
+#endif
 
 static void do_update_vv_vel(int start, int nrend, double dt,
                              rvec accel[], ivec nFreeze[], real invmass[],
@@ -280,7 +484,17 @@ static void do_update_vv_vel(int start, int nrend, double dt,
         mv1      = 1.0;
         mv2      = 1.0;
     }
-    for (n = start; n < nrend; n++)
+
+    n = start;
+#ifdef UPDATE_SIMD
+    if (cFREEZE == NULL && cACC == NULL &&
+        !nFreeze[0][XX] && !nFreeze[0][YY] && !nFreeze[0][ZZ] &&
+        accel[0][XX] == 0 && accel[0][YY] == 0 && accel[0][ZZ] == 0)
+    {
+        n = do_update_vv_vel_simd(start, nrend, dt, invmass, ptype, v, f, mv1, mv2);
+    }
+#endif
+    for (; n < nrend; n++)
     {
         w_dt = invmass[n]*dt;
         if (cFREEZE)
@@ -329,7 +543,15 @@ static void do_update_vv_pos(int start, int nrend, double dt,
         mr2      = 1.0;
     }
 
-    for (n = start; n < nrend; n++)
+    n = start;
+#ifdef UPDATE_SIMD
+    if (cFREEZE == NULL &&
+        !nFreeze[0][XX] && !nFreeze[0][YY] && !nFreeze[0][ZZ])
+    {
+        n = do_update_vv_pos_simd(start, nrend, dt, ptype, x, xprime, v, mr1, mr2);
+    }
+#endif
+    for (; n < nrend; n++)
     {
 
         if (cFREEZE)
@@ -1914,15 +2136,30 @@ void update_coords(FILE             *fplog,
     bNH = inputrec->etc == etcNOSEHOOVER;
     bPR = ((inputrec->epc == epcPARRINELLORAHMAN) || (inputrec->epc == epcMTTK));
 
-    if (bDoLR && inputrec->nstcalclr > 1 && !EI_VV(inputrec->eI))  /* get this working with VV? */
+    if (bDoLR && (inputrec->nstcalclr > 1 || inputrec->nstcalcslow > 1) &&
+        !EI_VV(inputrec->eI))  /* get this working with VV? */
     {
+        int nstlr;
+
         /* Store the total force + nstcalclr-1 times the LR force
          * in forces_lr, so it can be used in a normal update algorithm
          * to produce twin time stepping.
          */
+        if (inputrec->nstcalcslow > 1)
+        {
+            /* With multiple time stepping the slow forces can also have
+             * been computed at an intermediate step for energies or virial,
+             * then they should not contribute to the update at all.
+             */
+            nstlr = (do_per_step(step, inputrec->nstcalcslow) ? inputrec->nstcalcslow : 0);
+        }
+        else
+        {
+            nstlr = inputrec->nstcalclr;
+        }
         /* is this correct in the new construction? MRS */
         combine_forces(upd,
-                       inputrec->nstcalclr, constr, inputrec, md, idef, cr,
+                       nstlr, constr, inputrec, md, idef, cr,
                        step, state, bMolPBC,
                        start, nrend, f, f_lr, vir_lr_constr, nrnb);
         force = f_lr;
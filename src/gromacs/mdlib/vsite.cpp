@@ -53,10 +53,19 @@
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/mshift.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/pbcutil/pbc-simd.h"
+#include "gromacs/simd/gather_scatter_rvec.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/vector_operations.h"
 #include "gromacs/topology/mtop_util.h"
 #include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/smalloc.h"
 
+/* MSVC 2010 produces buggy SIMD PBC code, disable SIMD for MSVC <= 2010 */
+#if defined GMX_SIMD_HAVE_REAL && !(defined _MSC_VER && _MSC_VER < 1700) && !defined(__ICL)
+#define VSITE_SIMD
+#endif
+
 /* Routines to send/recieve coordinates and force
  * of constructing atoms.
  */
@@ -309,6 +318,148 @@ static int constr_vsiten(t_iatom *ia, t_iparams ip[],
 }
 
 
+#ifdef VSITE_SIMD
+
+/* Reads the atom indices and the parameters of GMX_SIMD_REAL_WIDTH
+ * consecutive 3-atom vsites starting at ia into the aligned buffer par.
+ */
+static void gather_vsite3_simd(const t_iatom *ia, const t_iparams ip[],
+                               int av[], int ai[], int aj[], int ak[],
+                               real *par,
+                               gmx_simd_real_t *a_S, gmx_simd_real_t *b_S,
+                               gmx_simd_real_t *c_S)
+{
+    int s, tp;
+
+    for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+    {
+        tp    = ia[0];
+        av[s] = ia[1];
+        ai[s] = ia[2];
+        aj[s] = ia[3];
+        ak[s] = ia[4];
+        par[s]                         = ip[tp].vsite.a;
+        par[GMX_SIMD_REAL_WIDTH + s]   = ip[tp].vsite.b;
+        par[2*GMX_SIMD_REAL_WIDTH + s] = ip[tp].vsite.c;
+        ia += 1 + NRAL(F_VSITE3);
+    }
+    *a_S = gmx_simd_load_r(par);
+    *b_S = gmx_simd_load_r(par + GMX_SIMD_REAL_WIDTH);
+    *c_S = gmx_simd_load_r(par + 2*GMX_SIMD_REAL_WIDTH);
+}
+
+/* Constructs the vsites of type ftype, F_VSITE3 or F_VSITE3OUT,
+ * in batches of GMX_SIMD_REAL_WIDTH, using the same algorithm as
+ * constr_vsite3 and constr_vsite3OUT. With pbc!=NULL each vsite
+ * follows its own pbc. Returns the number of ilist entries processed,
+ * the remaining vsites should be constructed by the scalar code.
+ */
+static int construct_vsites_simd(int ftype, int nr, const t_iatom *ia,
+                                 const t_iparams ip[], rvec x[],
+                                 real inv_dt, rvec *v, const t_pbc *pbc)
+{
+    const int       stride = (1 + NRAL(ftype))*GMX_SIMD_REAL_WIDTH;
+    int             nr_simd, i;
+    int             av[GMX_SIMD_REAL_WIDTH], ai[GMX_SIMD_REAL_WIDTH];
+    int             aj[GMX_SIMD_REAL_WIDTH], ak[GMX_SIMD_REAL_WIDTH];
+    real            buf_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
+    real            par_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *par;
+    pbc_simd_t      pbc_simd;
+    gmx_simd_real_t one_S, inv_dt_S, a_S, b_S, c_S;
+    gmx_simd_real_t xi_S, yi_S, zi_S, xj_S, yj_S, zj_S, xk_S, yk_S, zk_S;
+    gmx_simd_real_t dxj_S, dyj_S, dzj_S, dxk_S, dyk_S, dzk_S;
+    gmx_simd_real_t tx_S, ty_S, tz_S, xv_S, yv_S, zv_S;
+    gmx_simd_real_t xo_S, yo_S, zo_S, dx_S, dy_S, dz_S;
+
+    buf = gmx_simd_align_r(buf_array);
+    par = gmx_simd_align_r(par_array);
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    one_S    = gmx_simd_set1_r(1.0);
+    inv_dt_S = gmx_simd_set1_r(inv_dt);
+
+    nr_simd = (nr/stride)*stride;
+    for (i = 0; i < nr_simd; i += stride)
+    {
+        gather_vsite3_simd(ia + i, ip, av, ai, aj, ak, par, &a_S, &b_S, &c_S);
+
+        gmx_hack_simd_gather_rvec_index(x, ai, buf, &xi_S, &yi_S, &zi_S);
+        gmx_hack_simd_gather_rvec_index(x, aj, buf, &xj_S, &yj_S, &zj_S);
+        gmx_hack_simd_gather_rvec_index(x, ak, buf, &xk_S, &yk_S, &zk_S);
+
+        dxj_S = gmx_simd_sub_r(xj_S, xi_S);
+        dyj_S = gmx_simd_sub_r(yj_S, yi_S);
+        dzj_S = gmx_simd_sub_r(zj_S, zi_S);
+        dxk_S = gmx_simd_sub_r(xk_S, xi_S);
+        dyk_S = gmx_simd_sub_r(yk_S, yi_S);
+        dzk_S = gmx_simd_sub_r(zk_S, zi_S);
+        if (pbc)
+        {
+            pbc_correct_dx_simd(&dxj_S, &dyj_S, &dzj_S, &pbc_simd);
+            pbc_correct_dx_simd(&dxk_S, &dyk_S, &dzk_S, &pbc_simd);
+        }
+
+        if (ftype == F_VSITE3 && pbc == NULL)
+        {
+            c_S  = gmx_simd_sub_r(gmx_simd_sub_r(one_S, a_S), b_S);
+            xv_S = gmx_simd_fmadd_r(b_S, xk_S, gmx_simd_fmadd_r(a_S, xj_S, gmx_simd_mul_r(c_S, xi_S)));
+            yv_S = gmx_simd_fmadd_r(b_S, yk_S, gmx_simd_fmadd_r(a_S, yj_S, gmx_simd_mul_r(c_S, yi_S)));
+            zv_S = gmx_simd_fmadd_r(b_S, zk_S, gmx_simd_fmadd_r(a_S, zj_S, gmx_simd_mul_r(c_S, zi_S)));
+        }
+        else
+        {
+            xv_S = gmx_simd_fmadd_r(b_S, dxk_S, gmx_simd_fmadd_r(a_S, dxj_S, xi_S));
+            yv_S = gmx_simd_fmadd_r(b_S, dyk_S, gmx_simd_fmadd_r(a_S, dyj_S, yi_S));
+            zv_S = gmx_simd_fmadd_r(b_S, dzk_S, gmx_simd_fmadd_r(a_S, dzj_S, zi_S));
+            if (ftype == F_VSITE3OUT)
+            {
+                gmx_simd_cprod_r(dxj_S, dyj_S, dzj_S, dxk_S, dyk_S, dzk_S,
+                                 &tx_S, &ty_S, &tz_S);
+                xv_S = gmx_simd_fmadd_r(c_S, tx_S, xv_S);
+                yv_S = gmx_simd_fmadd_r(c_S, ty_S, yv_S);
+                zv_S = gmx_simd_fmadd_r(c_S, tz_S, zv_S);
+            }
+        }
+
+        if (pbc || v != NULL)
+        {
+            gmx_hack_simd_gather_rvec_index(x, av, buf, &xo_S, &yo_S, &zo_S);
+        }
+        if (pbc)
+        {
+            /* Put the vsite in the periodic image closest to its old
+             * position. We subtract the shift, which is exactly zero
+             * for vsites that do not need to be shifted.
+             */
+            dx_S = gmx_simd_sub_r(xv_S, xo_S);
+            dy_S = gmx_simd_sub_r(yv_S, yo_S);
+            dz_S = gmx_simd_sub_r(zv_S, zo_S);
+            tx_S = dx_S;
+            ty_S = dy_S;
+            tz_S = dz_S;
+            pbc_correct_dx_simd(&tx_S, &ty_S, &tz_S, &pbc_simd);
+            xv_S = gmx_simd_sub_r(xv_S, gmx_simd_sub_r(dx_S, tx_S));
+            yv_S = gmx_simd_sub_r(yv_S, gmx_simd_sub_r(dy_S, ty_S));
+            zv_S = gmx_simd_sub_r(zv_S, gmx_simd_sub_r(dz_S, tz_S));
+        }
+        gmx_hack_simd_scatter_rvec_index(xv_S, yv_S, zv_S, buf, x, av);
+
+        if (v != NULL)
+        {
+            /* Calculate velocity of vsite... */
+            gmx_hack_simd_scatter_rvec_index(gmx_simd_mul_r(inv_dt_S, gmx_simd_sub_r(xv_S, xo_S)),
+                                             gmx_simd_mul_r(inv_dt_S, gmx_simd_sub_r(yv_S, yo_S)),
+                                             gmx_simd_mul_r(inv_dt_S, gmx_simd_sub_r(zv_S, zo_S)),
+                                             buf, v, av);
+        }
+    }
+
+    return nr_simd;
+}
+
+#endif /* VSITE_SIMD */
+
 void construct_vsites_thread(gmx_vsite_t *vsite,
                              rvec x[],
                              real dt, rvec *v,
@@ -356,7 +507,16 @@ void construct_vsites_thread(gmx_vsite_t *vsite,
                 vsite_pbc = vsite->vsite_pbc_loc[ftype-F_VSITE2];
             }
 
-            for (i = 0; i < nr; )
+            i = 0;
+#ifdef VSITE_SIMD
+            if (vsite->bSimd[ftype-F_VSITE2] && (pbc_null == NULL || bPBCAll))
+            {
+                i   = construct_vsites_simd(ftype, nr, ia, ip, x, inv_dt, v,
+                                            pbc_null2);
+                ia += i;
+            }
+#endif
+            while (i < nr)
             {
                 tp   = ia[0];
 
@@ -1291,6 +1451,210 @@ static int spread_vsiten(t_iatom ia[], t_iparams ip[],
 }
 
 
+#ifdef VSITE_SIMD
+
+/* Spreads the forces of the vsites of type ftype, F_VSITE3 or F_VSITE3OUT,
+ * in batches of GMX_SIMD_REAL_WIDTH, using the same algorithm as
+ * spread_vsite3 and spread_vsite3OUT. The forces on the constructing
+ * atoms are computed with SIMD and added with scalar code, since
+ * vsites in a batch often share constructing atoms.
+ * Vsites which need shift force contributions are spread with the scalar
+ * code. Returns the number of ilist entries processed, the remaining
+ * vsites should be spread by the scalar code.
+ */
+static int spread_vsites_simd(int ftype, int nr, t_iatom *ia,
+                              const t_iparams ip[],
+                              rvec x[], rvec f[], rvec fshift[],
+                              t_pbc *pbc)
+{
+    const int       nral1  = 1 + NRAL(ftype);
+    const int       stride = nral1*GMX_SIMD_REAL_WIDTH;
+    int             nr_simd, i, s, m;
+    int             av[GMX_SIMD_REAL_WIDTH], ai[GMX_SIMD_REAL_WIDTH];
+    int             aj[GMX_SIMD_REAL_WIDTH], ak[GMX_SIMD_REAL_WIDTH];
+    real            buf_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *buf;
+    real            par_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *par;
+    real            fi_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *fi;
+    real            fj_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *fj;
+    real            fk_array[DIM*GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *fk;
+    real            sh_array[GMX_SIMD_REAL_WIDTH+GMX_SIMD_REAL_WIDTH], *sh;
+    gmx_bool        bShift;
+    pbc_simd_t      pbc_simd;
+    gmx_simd_real_t one_S, a_S, b_S, c_S, sh_S;
+    gmx_simd_real_t xi_S, yi_S, zi_S, xj_S, yj_S, zj_S, xk_S, yk_S, zk_S;
+    gmx_simd_real_t dx_S, dy_S, dz_S, tx_S, ty_S, tz_S;
+    gmx_simd_real_t fvx_S, fvy_S, fvz_S, cfx_S, cfy_S, cfz_S;
+    gmx_simd_real_t fjx_S, fjy_S, fjz_S, fkx_S, fky_S, fkz_S;
+
+    buf = gmx_simd_align_r(buf_array);
+    par = gmx_simd_align_r(par_array);
+    fi  = gmx_simd_align_r(fi_array);
+    fj  = gmx_simd_align_r(fj_array);
+    fk  = gmx_simd_align_r(fk_array);
+    sh  = gmx_simd_align_r(sh_array);
+
+    set_pbc_simd(pbc, &pbc_simd);
+
+    one_S = gmx_simd_set1_r(1.0);
+
+    /* The j and k distances are only used when they have been gathered,
+     * we set them here to avoid uninitialized variable warnings.
+     */
+    xj_S  = gmx_simd_setzero_r();
+    yj_S  = gmx_simd_setzero_r();
+    zj_S  = gmx_simd_setzero_r();
+    xk_S  = gmx_simd_setzero_r();
+    yk_S  = gmx_simd_setzero_r();
+    zk_S  = gmx_simd_setzero_r();
+
+    /* We only need the shifts with pbc and shift forces */
+    bShift = (pbc != NULL && fshift != NULL);
+
+    nr_simd = (nr/stride)*stride;
+    for (i = 0; i < nr_simd; i += stride)
+    {
+        gather_vsite3_simd(ia + i, ip, av, ai, aj, ak, par, &a_S, &b_S, &c_S);
+
+        gmx_hack_simd_gather_rvec_index(f, av, buf, &fvx_S, &fvy_S, &fvz_S);
+
+        sh_S = gmx_simd_setzero_r();
+        if (ftype == F_VSITE3OUT || bShift)
+        {
+            gmx_hack_simd_gather_rvec_index(x, ai, buf, &xi_S, &yi_S, &zi_S);
+            gmx_hack_simd_gather_rvec_index(x, aj, buf, &xj_S, &yj_S, &zj_S);
+            gmx_hack_simd_gather_rvec_index(x, ak, buf, &xk_S, &yk_S, &zk_S);
+            xj_S = gmx_simd_sub_r(xj_S, xi_S);
+            yj_S = gmx_simd_sub_r(yj_S, yi_S);
+            zj_S = gmx_simd_sub_r(zj_S, zi_S);
+            xk_S = gmx_simd_sub_r(xk_S, xi_S);
+            yk_S = gmx_simd_sub_r(yk_S, yi_S);
+            zk_S = gmx_simd_sub_r(zk_S, zi_S);
+            if (pbc)
+            {
+                /* Correct for pbc and sum the square shifts for all pairs
+                 * in sh_S, which is exactly zero without shifts.
+                 */
+                tx_S = xj_S;
+                ty_S = yj_S;
+                tz_S = zj_S;
+                pbc_correct_dx_simd(&xj_S, &yj_S, &zj_S, &pbc_simd);
+                sh_S = gmx_simd_add_r(sh_S,
+                                      gmx_simd_norm2_r(gmx_simd_sub_r(tx_S, xj_S),
+                                                       gmx_simd_sub_r(ty_S, yj_S),
+                                                       gmx_simd_sub_r(tz_S, zj_S)));
+                tx_S = xk_S;
+                ty_S = yk_S;
+                tz_S = zk_S;
+                pbc_correct_dx_simd(&xk_S, &yk_S, &zk_S, &pbc_simd);
+                sh_S = gmx_simd_add_r(sh_S,
+                                      gmx_simd_norm2_r(gmx_simd_sub_r(tx_S, xk_S),
+                                                       gmx_simd_sub_r(ty_S, yk_S),
+                                                       gmx_simd_sub_r(tz_S, zk_S)));
+            }
+            if (bShift)
+            {
+                gmx_hack_simd_gather_rvec_index(x, av, buf, &dx_S, &dy_S, &dz_S);
+                dx_S = gmx_simd_sub_r(dx_S, xi_S);
+                dy_S = gmx_simd_sub_r(dy_S, yi_S);
+                dz_S = gmx_simd_sub_r(dz_S, zi_S);
+                tx_S = dx_S;
+                ty_S = dy_S;
+                tz_S = dz_S;
+                pbc_correct_dx_simd(&dx_S, &dy_S, &dz_S, &pbc_simd);
+                sh_S = gmx_simd_add_r(sh_S,
+                                      gmx_simd_norm2_r(gmx_simd_sub_r(tx_S, dx_S),
+                                                       gmx_simd_sub_r(ty_S, dy_S),
+                                                       gmx_simd_sub_r(tz_S, dz_S)));
+            }
+        }
+        gmx_simd_store_r(sh, sh_S);
+
+        if (ftype == F_VSITE3)
+        {
+            c_S   = gmx_simd_sub_r(gmx_simd_sub_r(one_S, a_S), b_S);
+            fjx_S = gmx_simd_mul_r(a_S, fvx_S);
+            fjy_S = gmx_simd_mul_r(a_S, fvy_S);
+            fjz_S = gmx_simd_mul_r(a_S, fvz_S);
+            fkx_S = gmx_simd_mul_r(b_S, fvx_S);
+            fky_S = gmx_simd_mul_r(b_S, fvy_S);
+            fkz_S = gmx_simd_mul_r(b_S, fvz_S);
+            gmx_simd_store_r(fi + XX*GMX_SIMD_REAL_WIDTH, gmx_simd_mul_r(c_S, fvx_S));
+            gmx_simd_store_r(fi + YY*GMX_SIMD_REAL_WIDTH, gmx_simd_mul_r(c_S, fvy_S));
+            gmx_simd_store_r(fi + ZZ*GMX_SIMD_REAL_WIDTH, gmx_simd_mul_r(c_S, fvz_S));
+        }
+        else
+        {
+            cfx_S = gmx_simd_mul_r(c_S, fvx_S);
+            cfy_S = gmx_simd_mul_r(c_S, fvy_S);
+            cfz_S = gmx_simd_mul_r(c_S, fvz_S);
+
+            fjx_S = gmx_simd_sub_r(gmx_simd_mul_r(a_S, fvx_S),
+                                   gmx_simd_fmsub_r(zk_S, cfy_S, gmx_simd_mul_r(yk_S, cfz_S)));
+            fjy_S = gmx_simd_add_r(gmx_simd_mul_r(a_S, fvy_S),
+                                   gmx_simd_fmsub_r(zk_S, cfx_S, gmx_simd_mul_r(xk_S, cfz_S)));
+            fjz_S = gmx_simd_add_r(gmx_simd_mul_r(a_S, fvz_S),
+                                   gmx_simd_fmsub_r(xk_S, cfy_S, gmx_simd_mul_r(yk_S, cfx_S)));
+
+            fkx_S = gmx_simd_add_r(gmx_simd_mul_r(b_S, fvx_S),
+                                   gmx_simd_fmsub_r(zj_S, cfy_S, gmx_simd_mul_r(yj_S, cfz_S)));
+            fky_S = gmx_simd_sub_r(gmx_simd_mul_r(b_S, fvy_S),
+                                   gmx_simd_fmsub_r(zj_S, cfx_S, gmx_simd_mul_r(xj_S, cfz_S)));
+            fkz_S = gmx_simd_sub_r(gmx_simd_mul_r(b_S, fvz_S),
+                                   gmx_simd_fmsub_r(xj_S, cfy_S, gmx_simd_mul_r(yj_S, cfx_S)));
+
+            gmx_simd_store_r(fi + XX*GMX_SIMD_REAL_WIDTH, gmx_simd_sub_r(gmx_simd_sub_r(fvx_S, fjx_S), fkx_S));
+            gmx_simd_store_r(fi + YY*GMX_SIMD_REAL_WIDTH, gmx_simd_sub_r(gmx_simd_sub_r(fvy_S, fjy_S), fky_S));
+            gmx_simd_store_r(fi + ZZ*GMX_SIMD_REAL_WIDTH, gmx_simd_sub_r(gmx_simd_sub_r(fvz_S, fjz_S), fkz_S));
+        }
+        gmx_simd_store_r(fj + XX*GMX_SIMD_REAL_WIDTH, fjx_S);
+        gmx_simd_store_r(fj + YY*GMX_SIMD_REAL_WIDTH, fjy_S);
+        gmx_simd_store_r(fj + ZZ*GMX_SIMD_REAL_WIDTH, fjz_S);
+        gmx_simd_store_r(fk + XX*GMX_SIMD_REAL_WIDTH, fkx_S);
+        gmx_simd_store_r(fk + YY*GMX_SIMD_REAL_WIDTH, fky_S);
+        gmx_simd_store_r(fk + ZZ*GMX_SIMD_REAL_WIDTH, fkz_S);
+
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            if (bShift && sh[s] != 0)
+            {
+                /* This vsite contributes to the shift forces */
+                if (ftype == F_VSITE3)
+                {
+                    spread_vsite3(ia + i + s*nral1,
+                                  ip[ia[i + s*nral1]].vsite.a,
+                                  ip[ia[i + s*nral1]].vsite.b,
+                                  x, f, fshift, pbc, NULL);
+                }
+                else
+                {
+                    spread_vsite3OUT(ia + i + s*nral1,
+                                     ip[ia[i + s*nral1]].vsite.a,
+                                     ip[ia[i + s*nral1]].vsite.b,
+                                     ip[ia[i + s*nral1]].vsite.c,
+                                     x, f, fshift, FALSE, NULL, pbc, NULL);
+                }
+            }
+            else
+            {
+                for (m = 0; m < DIM; m++)
+                {
+                    f[ai[s]][m] += fi[m*GMX_SIMD_REAL_WIDTH + s];
+                    f[aj[s]][m] += fj[m*GMX_SIMD_REAL_WIDTH + s];
+                    f[ak[s]][m] += fk[m*GMX_SIMD_REAL_WIDTH + s];
+                }
+            }
+        }
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            clear_rvec(f[av[s]]);
+        }
+    }
+
+    return nr_simd;
+}
+
+#endif /* VSITE_SIMD */
+
 static int vsite_count(const t_ilist *ilist, int ftype)
 {
     if (ftype == F_VSITEN)
@@ -1346,7 +1710,18 @@ static void spread_vsite_f_thread(gmx_vsite_t *vsite,
                 vsite_pbc = vsite->vsite_pbc_loc[ftype-F_VSITE2];
             }
 
-            for (i = 0; i < nr; )
+            i = 0;
+#ifdef VSITE_SIMD
+            if (vsite->bSimd[ftype-F_VSITE2] && g == NULL &&
+                (pbc_null == NULL || bPBCAll) &&
+                !(ftype == F_VSITE3OUT && VirCorr))
+            {
+                i   = spread_vsites_simd(ftype, nr, ia, ip, x, f, fshift,
+                                         pbc_null2);
+                ia += i;
+            }
+#endif
+            while (i < nr)
             {
                 if (vsite_pbc != NULL)
                 {
@@ -1746,6 +2121,45 @@ static int **get_vsite_pbc(t_iparams *iparams, t_ilist *ilist,
 }
 
 
+/* Returns whether any vsite of type ftype in mtop is constructed
+ * from a vsite of the same type. Such vsites can not be constructed
+ * or spread in batches, as the order within the batch matters.
+ */
+static gmx_bool vsite_type_depends_on_itself(const gmx_mtop_t *mtop, int ftype)
+{
+    int                  mt, nral1, i, a;
+    const gmx_moltype_t *molt;
+    const t_iatom       *ia;
+    gmx_bool            *bVsite;
+    gmx_bool             bDepends;
+
+    nral1    = 1 + NRAL(ftype);
+    bDepends = FALSE;
+    for (mt = 0; mt < mtop->nmoltype && !bDepends; mt++)
+    {
+        molt = &mtop->moltype[mt];
+        ia   = molt->ilist[ftype].iatoms;
+        snew(bVsite, molt->atoms.nr);
+        for (i = 0; i < molt->ilist[ftype].nr; i += nral1)
+        {
+            bVsite[ia[i + 1]] = TRUE;
+        }
+        for (i = 0; i < molt->ilist[ftype].nr; i += nral1)
+        {
+            for (a = 2; a < nral1; a++)
+            {
+                if (bVsite[ia[i + a]])
+                {
+                    bDepends = TRUE;
+                }
+            }
+        }
+        sfree(bVsite);
+    }
+
+    return bDepends;
+}
+
 gmx_vsite_t *init_vsite(gmx_mtop_t *mtop, t_commrec *cr,
                         gmx_bool bSerial_NoPBC)
 {
@@ -1815,6 +2229,10 @@ gmx_vsite_t *init_vsite(gmx_mtop_t *mtop, t_commrec *cr,
     vsite->th_ind        = NULL;
     vsite->th_ind_nalloc = 0;
 
+    /* We have SIMD kernels for the most common vsite types */
+    vsite->bSimd[F_VSITE3-F_VSITE2]    = !vsite_type_depends_on_itself(mtop, F_VSITE3);
+    vsite->bSimd[F_VSITE3OUT-F_VSITE2] = !vsite_type_depends_on_itself(mtop, F_VSITE3OUT);
+
     return vsite;
 }
 
@@ -0,0 +1,503 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ *
+ * \brief SIMD loads and stores of indexed rvecs.
+ *
+ * These transpose between arrays of rvecs and SIMD registers with the x, y
+ * and z components of GMX_SIMD_REAL_WIDTH vectors, as needed by kernels that
+ * process GMX_SIMD_REAL_WIDTH interactions or constraints at once.
+ * With 256-bit AVX, masked loads and stores and in-register transposes are
+ * used, other SIMD architectures transpose through an aligned buffer.
+ *
+ * \inlibraryapi
+ * \ingroup module_simd
+ */
+#ifndef GMX_SIMD_GATHER_SCATTER_RVEC_H
+#define GMX_SIMD_GATHER_SCATTER_RVEC_H
+
+#include "config.h"
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/real.h"
+
+//! \cond libapi
+
+#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
+
+// This was originally work-in-progress for augmenting the SIMD module with
+// masked load/store operations. Instead, that turned into and extended SIMD
+// interface that supports gather/scatter in all platforms, which will be
+// part of a future Gromacs version. However, since the code for bonded
+// interactions and LINCS was already written it would be a pity not to get
+// the performance gains in Gromacs-5.1. For this reason we have added it as
+// a bit of a hack in this header, which is shared by the files that use it.
+// It will be replaced with the new generic functionality after version 5.1
+
+#    ifdef GMX_DOUBLE
+static gmx_inline void gmx_simdcall
+gmx_hack_simd_transpose4_r(gmx_simd_double_t *row0,
+                           gmx_simd_double_t *row1,
+                           gmx_simd_double_t *row2,
+                           gmx_simd_double_t *row3)
+{
+    __m256d tmp0, tmp1, tmp2, tmp3;
+
+    tmp0  = _mm256_unpacklo_pd(*row0, *row1);
+    tmp2  = _mm256_unpacklo_pd(*row2, *row3);
+    tmp1  = _mm256_unpackhi_pd(*row0, *row1);
+    tmp3  = _mm256_unpackhi_pd(*row2, *row3);
+    *row0 = _mm256_permute2f128_pd(tmp0, tmp2, 0b00100000);
+    *row1 = _mm256_permute2f128_pd(tmp1, tmp3, 0b00100000);
+    *row2 = _mm256_permute2f128_pd(tmp0, tmp2, 0b00110001);
+    *row3 = _mm256_permute2f128_pd(tmp1, tmp3, 0b00110001);
+}
+
+static gmx_inline void gmx_simdcall
+gmx_hack_simd4_transpose_to_simd_r(const gmx_simd4_double_t *a,
+                                   gmx_simd_double_t        *row0,
+                                   gmx_simd_double_t        *row1,
+                                   gmx_simd_double_t        *row2,
+                                   gmx_simd_double_t        *row3)
+{
+    *row0 = a[0];
+    *row1 = a[1];
+    *row2 = a[2];
+    *row3 = a[3];
+
+    gmx_hack_simd_transpose4_r(row0, row1, row2, row3);
+}
+
+static gmx_inline void gmx_simdcall
+gmx_hack_simd_transpose_to_simd4_r(gmx_simd_double_t   row0,
+                                   gmx_simd_double_t   row1,
+                                   gmx_simd_double_t   row2,
+                                   gmx_simd_double_t   row3,
+                                   gmx_simd4_double_t *a)
+{
+    a[0] = row0;
+    a[1] = row1;
+    a[2] = row2;
+    a[3] = row3;
+
+    gmx_hack_simd_transpose4_r(&a[0], &a[1], &a[2], &a[3]);
+}
+
+
+#    ifdef GMX_SIMD_X86_AVX_GCC_MASKLOAD_BUG
+#        define gmx_hack_simd4_load3_r(mem)      _mm256_maskload_pd((mem), _mm_castsi128_ps(_mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1)))
+#        define gmx_hack_simd4_store3_r(mem, x)   _mm256_maskstore_pd((mem), _mm_castsi128_ps(_mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1)), (x))
+#    else
+#        define gmx_hack_simd4_load3_r(mem)      _mm256_maskload_pd((mem), _mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1))
+#        define gmx_hack_simd4_store3_r(mem, x)   _mm256_maskstore_pd((mem), _mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1), (x))
+#    endif
+
+#    else /* single instead of double */
+static gmx_inline void gmx_simdcall
+gmx_hack_simd_transpose4_r(gmx_simd_float_t *row0,
+                           gmx_simd_float_t *row1,
+                           gmx_simd_float_t *row2,
+                           gmx_simd_float_t *row3)
+{
+    __m256 tmp0, tmp1, tmp2, tmp3;
+
+    tmp0  = _mm256_unpacklo_ps(*row0, *row1);
+    tmp2  = _mm256_unpacklo_ps(*row2, *row3);
+    tmp1  = _mm256_unpackhi_ps(*row0, *row1);
+    tmp3  = _mm256_unpackhi_ps(*row2, *row3);
+    *row0 = _mm256_shuffle_ps(tmp0, tmp2, 0b0100010001000100);
+    *row1 = _mm256_shuffle_ps(tmp0, tmp2, 0b1110111011101110);
+    *row2 = _mm256_shuffle_ps(tmp1, tmp3, 0b0100010001000100);
+    *row3 = _mm256_shuffle_ps(tmp1, tmp3, 0b1110111011101110);
+}
+
+static gmx_inline void gmx_simdcall
+gmx_hack_simd4_transpose_to_simd_r(const gmx_simd4_float_t *a,
+                                   gmx_simd_float_t        *row0,
+                                   gmx_simd_float_t        *row1,
+                                   gmx_simd_float_t        *row2,
+                                   gmx_simd_float_t        *row3)
+{
+    *row0 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[0]), a[4], 1);
+    *row1 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[1]), a[5], 1);
+    *row2 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[2]), a[6], 1);
+    *row3 = _mm256_insertf128_ps(_mm256_castps128_ps256(a[3]), a[7], 1);
+
+    gmx_hack_simd_transpose4_r(row0, row1, row2, row3);
+}
+
+static gmx_inline void gmx_simdcall
+gmx_hack_simd_transpose_to_simd4_r(gmx_simd_float_t   row0,
+                                   gmx_simd_float_t   row1,
+                                   gmx_simd_float_t   row2,
+                                   gmx_simd_float_t   row3,
+                                   gmx_simd4_float_t *a)
+{
+    gmx_hack_simd_transpose4_r(&row0, &row1, &row2, &row3);
+
+    a[0] = _mm256_extractf128_ps(row0, 0);
+    a[1] = _mm256_extractf128_ps(row1, 0);
+    a[2] = _mm256_extractf128_ps(row2, 0);
+    a[3] = _mm256_extractf128_ps(row3, 0);
+    a[4] = _mm256_extractf128_ps(row0, 1);
+    a[5] = _mm256_extractf128_ps(row1, 1);
+    a[6] = _mm256_extractf128_ps(row2, 1);
+    a[7] = _mm256_extractf128_ps(row3, 1);
+}
+#ifdef GMX_SIMD_X86_AVX_GCC_MASKLOAD_BUG
+#        define gmx_hack_simd4_load3_r(mem)      _mm_maskload_ps((mem), _mm_castsi256_pd(_mm_set_epi32(0, -1, -1, -1)))
+#        define gmx_hack_simd4_store3_r(mem, x)   _mm_maskstore_ps((mem), _mm_castsi256_pd(_mm_set_epi32(0, -1, -1, -1)), (x))
+#else
+#        define gmx_hack_simd4_load3_r(mem)      _mm_maskload_ps((mem), _mm_set_epi32(0, -1, -1, -1))
+#        define gmx_hack_simd4_store3_r(mem, x)   _mm_maskstore_ps((mem), _mm_set_epi32(0, -1, -1, -1), (x))
+#endif
+
+#endif /* double */
+
+#endif /* AVX */
+
+#ifdef GMX_SIMD_HAVE_REAL
+/*! \brief Store differences between indexed rvecs in SIMD registers.
+ *
+ * Returns SIMD register with the difference vectors:
+ *     v[pair_index[i*2]] - v[pair_index[i*2 + 1]]
+ *
+ * \param[in]     v           Array of rvecs
+ * \param[in]     pair_index  Index pairs for GMX_SIMD_REAL_WIDTH vector pairs
+ * \param[in,out] buf         Aligned tmp buffer of size 3*GMX_SIMD_REAL_WIDTH
+ * \param[out]    dx          SIMD register with x difference
+ * \param[out]    dy          SIMD register with y difference
+ * \param[out]    dz          SIMD register with z difference
+ */
+static gmx_inline void gmx_simdcall
+gmx_hack_simd_gather_rvec_dist_pair_index(const rvec      *v,
+                                          const int       *pair_index,
+                                          real gmx_unused *buf,
+                                          gmx_simd_real_t *dx,
+                                          gmx_simd_real_t *dy,
+                                          gmx_simd_real_t *dz)
+{
+#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
+    int              i;
+    gmx_simd4_real_t d[GMX_SIMD_REAL_WIDTH];
+    gmx_simd_real_t  tmp;
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        d[i] = gmx_simd4_sub_r(gmx_hack_simd4_load3_r(&(v[pair_index[i*2 + 0]][0])),
+                               gmx_hack_simd4_load3_r(&(v[pair_index[i*2 + 1]][0])));
+    }
+
+    gmx_hack_simd4_transpose_to_simd_r(d, dx, dy, dz, &tmp);
+#else
+#if GMX_ALIGNMENT
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) buf_aligned[3*GMX_SIMD_REAL_WIDTH];
+#else
+    real* buf_aligned = buf;
+#endif
+
+    int i, m;
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        /* Store the distances packed and aligned */
+        for (m = 0; m < DIM; m++)
+        {
+            buf_aligned[m*GMX_SIMD_REAL_WIDTH + i] =
+                v[pair_index[i*2]][m] - v[pair_index[i*2 + 1]][m];
+        }
+    }
+    *dx = gmx_simd_load_r(buf_aligned + 0*GMX_SIMD_REAL_WIDTH);
+    *dy = gmx_simd_load_r(buf_aligned + 1*GMX_SIMD_REAL_WIDTH);
+    *dz = gmx_simd_load_r(buf_aligned + 2*GMX_SIMD_REAL_WIDTH);
+#endif
+}
+
+
+/*! \brief Store differences between indexed rvecs in SIMD registers.
+ *
+ * Returns SIMD register with the difference vectors:
+ *     v[index0[i]] - v[index1[i]]
+ *
+ * \param[in]     v           Array of rvecs
+ * \param[in]     index0      Index into the vector array
+ * \param[in]     index1      Index into the vector array
+ * \param[in,out] buf         Aligned tmp buffer of size 3*GMX_SIMD_REAL_WIDTH
+ * \param[out]    dx          SIMD register with x difference
+ * \param[out]    dy          SIMD register with y difference
+ * \param[out]    dz          SIMD register with z difference
+ */
+static gmx_inline void gmx_simdcall
+gmx_hack_simd_gather_rvec_dist_two_index(const rvec      *v,
+                                         const int       *index0,
+                                         const int       *index1,
+                                         real gmx_unused *buf,
+                                         gmx_simd_real_t *dx,
+                                         gmx_simd_real_t *dy,
+                                         gmx_simd_real_t *dz)
+{
+#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
+    int              i;
+    gmx_simd4_real_t d[GMX_SIMD_REAL_WIDTH];
+    gmx_simd_real_t  tmp;
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        d[i] = gmx_simd4_sub_r(gmx_hack_simd4_load3_r(&(v[index0[i]][0])),
+                               gmx_hack_simd4_load3_r(&(v[index1[i]][0])));
+
+    }
+    gmx_hack_simd4_transpose_to_simd_r(d, dx, dy, dz, &tmp);
+#else /* generic SIMD */
+#if GMX_ALIGNMENT
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) buf_aligned[3*GMX_SIMD_REAL_WIDTH];
+#else
+    real* buf_aligned = buf;
+#endif
+
+    int i, m;
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        /* Store the distances packed and aligned */
+        for (m = 0; m < DIM; m++)
+        {
+            buf_aligned[m*GMX_SIMD_REAL_WIDTH + i] =
+                v[index0[i]][m] - v[index1[i]][m];
+        }
+    }
+    *dx = gmx_simd_load_r(buf_aligned + 0*GMX_SIMD_REAL_WIDTH);
+    *dy = gmx_simd_load_r(buf_aligned + 1*GMX_SIMD_REAL_WIDTH);
+    *dz = gmx_simd_load_r(buf_aligned + 2*GMX_SIMD_REAL_WIDTH);
+#endif
+}
+
+/*! \brief Load indexed rvecs into SIMD registers.
+ *
+ * Returns SIMD registers with the components of the vectors v[index[i]].
+ *
+ * \param[in]     v           Array of rvecs
+ * \param[in]     index       Indices for GMX_SIMD_REAL_WIDTH vectors
+ * \param[in,out] buf         Aligned tmp buffer of size 3*GMX_SIMD_REAL_WIDTH
+ * \param[out]    x           SIMD register with x-components of the vectors
+ * \param[out]    y           SIMD register with y-components of the vectors
+ * \param[out]    z           SIMD register with z-components of the vectors
+ */
+static gmx_inline void gmx_simdcall
+gmx_hack_simd_gather_rvec_index(const rvec      *v,
+                                const int       *index,
+                                real gmx_unused *buf,
+                                gmx_simd_real_t *x,
+                                gmx_simd_real_t *y,
+                                gmx_simd_real_t *z)
+{
+#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
+    int              i;
+    gmx_simd4_real_t d[GMX_SIMD_REAL_WIDTH];
+    gmx_simd_real_t  tmp;
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        d[i] = gmx_hack_simd4_load3_r(&(v[index[i]][0]));
+    }
+
+    gmx_hack_simd4_transpose_to_simd_r(d, x, y, z, &tmp);
+#else
+#if GMX_ALIGNMENT
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) buf_aligned[3*GMX_SIMD_REAL_WIDTH];
+#else
+    real* buf_aligned = buf;
+#endif
+
+    int i, m;
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        for (m = 0; m < DIM; m++)
+        {
+            buf_aligned[m*GMX_SIMD_REAL_WIDTH + i] = v[index[i]][m];
+        }
+    }
+    *x = gmx_simd_load_r(buf_aligned + 0*GMX_SIMD_REAL_WIDTH);
+    *y = gmx_simd_load_r(buf_aligned + 1*GMX_SIMD_REAL_WIDTH);
+    *z = gmx_simd_load_r(buf_aligned + 2*GMX_SIMD_REAL_WIDTH);
+#endif
+}
+
+/*! \brief Load indexed reals into a SIMD register.
+ *
+ * Returns a SIMD register with the values v[index[i]].
+ *
+ * \param[in]     v           Array of reals
+ * \param[in]     index       Indices for GMX_SIMD_REAL_WIDTH values
+ * \param[in,out] buf         Aligned tmp buffer of size GMX_SIMD_REAL_WIDTH
+ */
+static gmx_inline gmx_simd_real_t gmx_simdcall
+gmx_hack_simd_gather_real_index(const real      *v,
+                                const int       *index,
+                                real gmx_unused *buf)
+{
+#if defined(GMX_SIMD_X86_AVX2_256)
+#ifdef GMX_DOUBLE
+    return _mm256_i32gather_pd(v, _mm_loadu_si128(reinterpret_cast<const __m128i *>(index)), sizeof(double));
+#else
+    return _mm256_i32gather_ps(v, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(index)), sizeof(float));
+#endif
+#else
+#if GMX_ALIGNMENT
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) buf_aligned[GMX_SIMD_REAL_WIDTH];
+#else
+    real* buf_aligned = buf;
+#endif
+
+    int i;
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        buf_aligned[i] = v[index[i]];
+    }
+    return gmx_simd_load_r(buf_aligned);
+#endif
+}
+
+
+/*! \brief Stores SIMD vector into multiple rvecs.
+ *
+ * \param[in]     x           SIMD register with x-components of the vectors
+ * \param[in]     y           SIMD register with y-components of the vectors
+ * \param[in]     z           SIMD register with z-components of the vectors
+ * \param[in,out] buf         Aligned tmp buffer of size 3*GMX_SIMD_REAL_WIDTH
+ * \param[out]    v           Array of GMX_SIMD_REAL_WIDTH rvecs
+ */
+static gmx_inline void gmx_simdcall
+gmx_simd_store_vec_to_rvec(gmx_simd_real_t  x,
+                           gmx_simd_real_t  y,
+                           gmx_simd_real_t  z,
+                           real gmx_unused *buf,
+                           rvec            *v)
+{
+#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
+    int              i;
+    gmx_simd4_real_t s4[GMX_SIMD_REAL_WIDTH];
+    gmx_simd_real_t  zero = gmx_simd_setzero_r();
+
+    gmx_hack_simd_transpose_to_simd4_r(x, y, z, zero, s4);
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        gmx_hack_simd4_store3_r(v[i], s4[i]);
+    }
+#else
+#if GMX_ALIGNMENT
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) buf_aligned[3*GMX_SIMD_REAL_WIDTH];
+#else
+    real* buf_aligned = buf;
+#endif
+
+    int i, m;
+
+    gmx_simd_store_r(buf_aligned + 0*GMX_SIMD_REAL_WIDTH, x);
+    gmx_simd_store_r(buf_aligned + 1*GMX_SIMD_REAL_WIDTH, y);
+    gmx_simd_store_r(buf_aligned + 2*GMX_SIMD_REAL_WIDTH, z);
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        for (m = 0; m < DIM; m++)
+        {
+            v[i][m] = buf_aligned[m*GMX_SIMD_REAL_WIDTH + i];
+        }
+    }
+#endif
+}
+
+/*! \brief Stores SIMD registers into indexed rvecs.
+ *
+ * Sets v[index[i]] to the components of element i of x, y and z.
+ *
+ * \param[in]     x           SIMD register with x-components of the vectors
+ * \param[in]     y           SIMD register with y-components of the vectors
+ * \param[in]     z           SIMD register with z-components of the vectors
+ * \param[in,out] buf         Aligned tmp buffer of size 3*GMX_SIMD_REAL_WIDTH
+ * \param[out]    v           Array of rvecs
+ * \param[in]     index       Indices for GMX_SIMD_REAL_WIDTH vectors
+ */
+static gmx_inline void gmx_simdcall
+gmx_hack_simd_scatter_rvec_index(gmx_simd_real_t  x,
+                                 gmx_simd_real_t  y,
+                                 gmx_simd_real_t  z,
+                                 real gmx_unused *buf,
+                                 rvec            *v,
+                                 const int       *index)
+{
+#if defined(GMX_SIMD_X86_AVX_256) || defined(GMX_SIMD_X86_AVX2_256)
+    int              i;
+    gmx_simd4_real_t s4[GMX_SIMD_REAL_WIDTH];
+    gmx_simd_real_t  zero = gmx_simd_setzero_r();
+
+    gmx_hack_simd_transpose_to_simd4_r(x, y, z, zero, s4);
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        gmx_hack_simd4_store3_r(v[index[i]], s4[i]);
+    }
+#else
+#if GMX_ALIGNMENT
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) buf_aligned[3*GMX_SIMD_REAL_WIDTH];
+#else
+    real* buf_aligned = buf;
+#endif
+
+    int i, m;
+
+    gmx_simd_store_r(buf_aligned + 0*GMX_SIMD_REAL_WIDTH, x);
+    gmx_simd_store_r(buf_aligned + 1*GMX_SIMD_REAL_WIDTH, y);
+    gmx_simd_store_r(buf_aligned + 2*GMX_SIMD_REAL_WIDTH, z);
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        for (m = 0; m < DIM; m++)
+        {
+            v[index[i]][m] = buf_aligned[m*GMX_SIMD_REAL_WIDTH + i];
+        }
+    }
+#endif
+}
+#endif /* GMX_SIMD_HAVE_REAL */
+
+//! \endcond
+
+#endif
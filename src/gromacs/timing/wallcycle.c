@@ -119,6 +119,7 @@ static const char *wcsn[ewcsNR] =
     "Restraints F",
     "Listed buffer ops.",
     "Nonbonded F",
+    "Nonbonded pruning",
     "Ewald F correction",
     "NB X buffer ops.",
     "NB F buffer ops.",
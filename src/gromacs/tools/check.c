@@ -46,6 +46,7 @@
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trnio.h"
+#include "gromacs/fileio/trxindex.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/legacyheaders/macros.h"
@@ -731,7 +732,12 @@ int gmx_check(int argc, char *argv[])
         "For free energy simulations the A and B state topology from one",
         "run input file can be compared with options [TT]-s1[tt] and [TT]-ab[tt].[PAR]",
         "In case the [TT]-m[tt] flag is given a LaTeX file will be written",
-        "consisting of a rough outline for a methods section for a paper."
+        "consisting of a rough outline for a methods section for a paper.[PAR]",
+        "With [TT]-idx[tt] a frame index is written for the [REF].trr[ref] or",
+        "[REF].xtc[ref] trajectory given with [TT]-f[tt], e.g. to traj.xtc.idx",
+        "for traj.xtc. Tools use this index to quickly jump to the frame",
+        "set with [TT]-b[tt]. [TT]gmx mdrun -trjidx[tt] writes the index",
+        "during the simulation."
     };
     t_filenm        fnm[] = {
         { efTRX, "-f",  NULL, ffOPTRD },
@@ -755,6 +761,7 @@ int gmx_check(int argc, char *argv[])
     static real     ftol     = 0.001;
     static real     abstol   = 0.001;
     static gmx_bool bCompAB  = FALSE;
+    static gmx_bool bIndex   = FALSE;
     static char    *lastener = NULL;
     static t_pargs  pa[]     = {
         { "-vdwfac", FALSE, etREAL, {&vdw_fac},
@@ -771,6 +778,8 @@ int gmx_check(int argc, char *argv[])
           "Absolute tolerance, useful when sums are close to zero." },
         { "-ab",     FALSE, etBOOL, {&bCompAB},
           "Compare the A and B topology from one file" },
+        { "-idx",    FALSE, etBOOL, {&bIndex},
+          "Write a frame index for the trajectory given with -f" },
         { "-lastener", FALSE, etSTR,  {&lastener},
           "Last energy term to compare (if not given all are tested). It makes sense to go up until the Pressure." }
     };
@@ -788,6 +797,11 @@ int gmx_check(int argc, char *argv[])
     {
         comp_trx(oenv, fn1, fn2, bRMSD, ftol, abstol);
     }
+    else if (fn1 && bIndex)
+    {
+        fprintf(stderr, "Wrote a frame index with %d frames for %s\n",
+                build_trxindex(fn1), fn1);
+    }
     else if (fn1)
     {
         chk_trj(oenv, fn1, opt2fn_null("-s1", NFILE, fnm), ftol);
@@ -43,8 +43,15 @@
 
 #include "runnercommon.h"
 
+#include <stdlib.h>
 #include <string.h>
 
+#include <vector>
+
+#include <boost/scoped_ptr.hpp>
+
+#include "thread_mpi/threads.h"
+
 #include "gromacs/fileio/timecontrol.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trx.h"
@@ -71,6 +78,256 @@
 namespace gmx
 {
 
+namespace
+{
+
+/*! \brief
+ * Default number of frames read ahead of the analysis.
+ *
+ * Only used with more than one hardware thread, and can be changed with
+ * the GMX_TRAJ_PREFETCH environment variable. Zero reads the frames only
+ * when they are needed.
+ */
+const int c_defaultPrefetchFrames = 2;
+
+/*! \internal
+ * \brief
+ * Reads trajectory frames ahead of the analysis in a separate thread.
+ *
+ * The frames are read directly into a ring of frame buffers.
+ * The frame returned by nextFrame() belongs to the caller until the next
+ * call, while the reader thread fills the other buffers. This hides the
+ * time spent in I/O and decompression behind the analysis of the frame.
+ * Frames can only be read sequentially, so a single reader thread is used.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+class TrajectoryFramePrefetcher
+{
+    public:
+        /*! \brief
+         * Creates a prefetcher that reads frames after \p firstFrame.
+         *
+         * Takes ownership of \p firstFrame, which is the current frame until
+         * nextFrame() is called. Until start() is called, or if the reader
+         * thread can not be started, nextFrame() reads the frames itself.
+         */
+        TrajectoryFramePrefetcher(const output_env_t oenv, t_trxstatus *status,
+                                  t_trxframe *firstFrame, int nprefetch);
+        //! Stops reading and frees all the frames.
+        ~TrajectoryFramePrefetcher();
+
+        //! Starts the reader thread.
+        void start();
+        //! Stops reading frames, may be called repeatedly.
+        void stop();
+        /*! \brief
+         * Returns the next frame, or NULL if there are no more frames.
+         *
+         * The previously returned frame can be reused after this call.
+         */
+        t_trxframe *nextFrame();
+
+    private:
+        static void *readerThread(void *arg);
+        void readFrames();
+        //! Reads the frame after the last read one into \p frames_[index].
+        bool readFrame(int index);
+
+        const output_env_t          oenv_;
+        t_trxstatus                *status_;
+        //! Ring of frame buffers, the first one is the frame passed on creation.
+        std::vector<t_trxframe *>   frames_;
+        /*! \brief
+         * Reader state after the last read frame.
+         *
+         * The reader keeps its state (frame times, flags, number of atoms)
+         * in the frame, so each frame is read starting from a copy of the
+         * previous one. The copy is kept here, as the caller may already be
+         * using the previous frame.
+         */
+        t_trxframe                  state_;
+        //! Index in \p frames_ of the frame that belongs to the caller.
+        int                         current_;
+        //! Number of frames read after the current frame.
+        int                         nready_;
+        //! Whether the reader thread has reached the end of the trajectory.
+        bool                        bEnd_;
+        //! Tells the reader thread to stop.
+        bool                        bStop_;
+        bool                        bRunning_;
+        tMPI_Thread_t               thread_;
+        tMPI_Thread_mutex_t         mutex_;
+        tMPI_Thread_cond_t          cond_;
+};
+
+TrajectoryFramePrefetcher::TrajectoryFramePrefetcher(
+        const output_env_t oenv, t_trxstatus *status,
+        t_trxframe *firstFrame, int nprefetch)
+    : oenv_(oenv), status_(status), state_(*firstFrame), current_(0),
+      nready_(0), bEnd_(false), bStop_(false), bRunning_(false)
+{
+    frames_.push_back(firstFrame);
+    for (int i = 0; i < nprefetch; i++)
+    {
+        t_trxframe *fr;
+
+        snew(fr, 1);
+        // XTC and plain text readers need the coordinate buffers,
+        // the others allocate the buffers they need themselves.
+        if (firstFrame->x != NULL)
+        {
+            snew(fr->x, firstFrame->natoms);
+        }
+        if (firstFrame->v != NULL)
+        {
+            snew(fr->v, firstFrame->natoms);
+        }
+        if (firstFrame->f != NULL)
+        {
+            snew(fr->f, firstFrame->natoms);
+        }
+        frames_.push_back(fr);
+    }
+    tMPI_Thread_mutex_init(&mutex_);
+    tMPI_Thread_cond_init(&cond_);
+}
+
+TrajectoryFramePrefetcher::~TrajectoryFramePrefetcher()
+{
+    stop();
+    tMPI_Thread_cond_destroy(&cond_);
+    tMPI_Thread_mutex_destroy(&mutex_);
+    for (size_t i = 0; i < frames_.size(); i++)
+    {
+        sfree(frames_[i]->x);
+        sfree(frames_[i]->v);
+        sfree(frames_[i]->f);
+        sfree(frames_[i]);
+    }
+}
+
+void TrajectoryFramePrefetcher::start()
+{
+    bRunning_ = (tMPI_Thread_support() == TMPI_THREAD_SUPPORT_YES &&
+                 tMPI_Thread_create(&thread_, readerThread, this) == 0);
+}
+
+void TrajectoryFramePrefetcher::stop()
+{
+    if (bRunning_)
+    {
+        tMPI_Thread_mutex_lock(&mutex_);
+        bStop_ = true;
+        tMPI_Thread_cond_broadcast(&cond_);
+        tMPI_Thread_mutex_unlock(&mutex_);
+        tMPI_Thread_join(thread_, NULL);
+        bRunning_ = false;
+    }
+    // The trajectory may be closed after this, so we can not read more.
+    bEnd_ = true;
+}
+
+t_trxframe *TrajectoryFramePrefetcher::nextFrame()
+{
+    t_trxframe *fr = NULL;
+
+    if (!bRunning_)
+    {
+        if (bEnd_ || !readFrame((current_ + 1) % frames_.size()))
+        {
+            bEnd_ = true;
+            return NULL;
+        }
+        current_ = (current_ + 1) % frames_.size();
+        return frames_[current_];
+    }
+
+    tMPI_Thread_mutex_lock(&mutex_);
+    while (nready_ == 0 && !bEnd_)
+    {
+        tMPI_Thread_cond_wait(&cond_, &mutex_);
+    }
+    if (nready_ > 0)
+    {
+        // Hand the current frame back to the reader thread.
+        current_ = (current_ + 1) % frames_.size();
+        nready_--;
+        fr       = frames_[current_];
+        tMPI_Thread_cond_broadcast(&cond_);
+    }
+    tMPI_Thread_mutex_unlock(&mutex_);
+
+    return fr;
+}
+
+void *TrajectoryFramePrefetcher::readerThread(void *arg)
+{
+    static_cast<TrajectoryFramePrefetcher *>(arg)->readFrames();
+    return NULL;
+}
+
+bool TrajectoryFramePrefetcher::readFrame(int index)
+{
+    t_trxframe *fr = frames_[index];
+    rvec       *x  = fr->x;
+    rvec       *v  = fr->v;
+    rvec       *f  = fr->f;
+
+    *fr   = state_;
+    fr->x = x;
+    fr->v = v;
+    fr->f = f;
+    if (!read_next_frame(oenv_, status_, fr))
+    {
+        return false;
+    }
+    state_ = *fr;
+    return true;
+}
+
+void TrajectoryFramePrefetcher::readFrames()
+{
+    const int nframes = frames_.size();
+    int       next    = 1;
+
+    while (true)
+    {
+        tMPI_Thread_mutex_lock(&mutex_);
+        while (nready_ == nframes - 1 && !bStop_)
+        {
+            tMPI_Thread_cond_wait(&cond_, &mutex_);
+        }
+        const bool bStop = bStop_;
+        tMPI_Thread_mutex_unlock(&mutex_);
+        if (bStop)
+        {
+            break;
+        }
+
+        const bool bOK = readFrame(next);
+
+        tMPI_Thread_mutex_lock(&mutex_);
+        if (bOK)
+        {
+            nready_++;
+        }
+        else
+        {
+            bEnd_ = true;
+        }
+        tMPI_Thread_cond_broadcast(&cond_);
+        tMPI_Thread_mutex_unlock(&mutex_);
+        if (!bOK)
+        {
+            break;
+        }
+        next = (next + 1) % nframes;
+    }
+}
+
+}   // namespace
+
 class TrajectoryAnalysisRunnerCommon::Impl
 {
     public:
@@ -100,6 +357,8 @@ class TrajectoryAnalysisRunnerCommon::Impl
         //! Used to store the status variable from read_first_frame().
         t_trxstatus                *status_;
         output_env_t                oenv_;
+        //! Reads frames ahead of the analysis, owns \p fr when not NULL.
+        boost::scoped_ptr<TrajectoryFramePrefetcher> prefetcher_;
 };
 
 
@@ -119,6 +378,11 @@ TrajectoryAnalysisRunnerCommon::Impl::~Impl()
         gmx_ana_indexgrps_free(grps_);
     }
     finishTrajectory();
+    if (prefetcher_)
+    {
+        prefetcher_.reset();
+        fr = NULL;
+    }
     if (fr)
     {
         // There doesn't seem to be a function for freeing frame data
@@ -137,6 +401,10 @@ TrajectoryAnalysisRunnerCommon::Impl::~Impl()
 void
 TrajectoryAnalysisRunnerCommon::Impl::finishTrajectory()
 {
+    if (prefetcher_)
+    {
+        prefetcher_->stop();
+    }
     if (bTrajOpen_)
     {
         close_trx(status_);
@@ -399,6 +667,29 @@ TrajectoryAnalysisRunnerCommon::initFirstFrame()
         impl_->gpbc_ = gmx_rmpbc_init(&top.topology()->idef, top.ePBC(),
                                       impl_->fr->natoms);
     }
+
+    // The prefetcher reads each frame starting from a copy of the first
+    // one, so the first frame needs to be complete before it is created.
+    if (hasTrajectory())
+    {
+        const char *env       = getenv("GMX_TRAJ_PREFETCH");
+        int         nprefetch = 0;
+        if (env != NULL)
+        {
+            nprefetch = atoi(env);
+        }
+        else if (tMPI_Thread_get_hw_number() > 1)
+        {
+            nprefetch = c_defaultPrefetchFrames;
+        }
+        if (nprefetch > 0)
+        {
+            impl_->prefetcher_.reset(
+                    new TrajectoryFramePrefetcher(impl_->oenv_, impl_->status_,
+                                                  impl_->fr, nprefetch));
+            impl_->prefetcher_->start();
+        }
+    }
 }
 
 
@@ -406,7 +697,16 @@ bool
 TrajectoryAnalysisRunnerCommon::readNextFrame()
 {
     bool bContinue = false;
-    if (hasTrajectory())
+    if (impl_->prefetcher_)
+    {
+        t_trxframe *fr = impl_->prefetcher_->nextFrame();
+        if (fr != NULL)
+        {
+            impl_->fr = fr;
+            bContinue = true;
+        }
+    }
+    else if (hasTrajectory())
     {
         bContinue = read_next_frame(impl_->oenv_, impl_->status_, impl_->fr);
     }
@@ -0,0 +1,205 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for frame reading in gmx::TrajectoryAnalysisRunnerCommon.
+ *
+ * \ingroup module_trajectoryanalysis
+ */
+#include "gmxpre.h"
+
+#include "gromacs/trajectoryanalysis/runnercommon.h"
+
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/trx.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/options/options.h"
+#include "gromacs/options/optionsassigner.h"
+#include "gromacs/pbcutil/pbc.h"
+#include "gromacs/selection/selectioncollection.h"
+#include "gromacs/selection/selectionoptionmanager.h"
+#include "gromacs/trajectoryanalysis/analysissettings.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+//! Number of frames in the test trajectory.
+const int c_numFrames = 6;
+
+//! Contents of a trajectory frame that are compared between reads.
+struct FrameData
+{
+    real              time;
+    gmx_int64_t       step;
+    int               ePBC;
+    gmx_bool          bPBC;
+    matrix            box;
+    std::vector<real> x;
+};
+
+/*! \brief
+ * Test fixture for reading frames with TrajectoryAnalysisRunnerCommon.
+ *
+ * The trajectory has c_numFrames frames made by displacing the atoms
+ * of freevolume.xtc, which has a single frame, and freevolume.tpr is
+ * used as the topology.
+ */
+class TrajectoryAnalysisRunnerCommonTest : public ::testing::Test
+{
+    public:
+        TrajectoryAnalysisRunnerCommonTest()
+            : trajectoryFile_(fileManager_.getTemporaryFilePath("traj.xtc"))
+        {
+            std::string inputFile =
+                gmx::test::TestFileManager::getInputFilePath("freevolume.xtc");
+            t_fileio   *in  = open_xtc(inputFile.c_str(), "r");
+            t_fileio   *out = open_xtc(trajectoryFile_.c_str(), "w");
+            int         natoms, step;
+            real        time, prec;
+            matrix      box;
+            rvec       *x;
+            gmx_bool    bOK;
+
+            read_first_xtc(in, &natoms, &step, &time, box, &x, &prec, &bOK);
+            for (int f = 0; f < c_numFrames; f++)
+            {
+                write_xtc(out, natoms, step + 10*f, time + f, box, x, prec);
+                for (int i = 0; i < natoms; i++)
+                {
+                    x[i][XX] += 0.01;
+                }
+            }
+            sfree(x);
+            close_xtc(out);
+            close_xtc(in);
+        }
+
+        /*! \brief
+         * Reads all frames of the trajectory.
+         *
+         * \p prefetch sets GMX_TRAJ_PREFETCH, the number of frames read ahead.
+         */
+        std::vector<FrameData> readFrames(const char *prefetch)
+        {
+            gmx::TrajectoryAnalysisSettings     settings;
+            gmx::TrajectoryAnalysisRunnerCommon common(&settings);
+            gmx::SelectionCollection            selections;
+            gmx::SelectionOptionManager         seloptManager(&selections);
+            gmx::Options                        options(NULL, NULL);
+
+            options.addManager(&seloptManager);
+            common.initOptions(&options);
+            gmx::OptionsAssigner assigner(&options);
+            assigner.start();
+            assigner.startOption("f");
+            assigner.appendValue(trajectoryFile_);
+            assigner.finishOption();
+            assigner.startOption("s");
+            assigner.appendValue(gmx::test::TestFileManager::getInputFilePath("freevolume.tpr"));
+            assigner.finishOption();
+            assigner.finish();
+            options.finish();
+            common.optionsFinished(&options);
+            common.initTopology(&selections);
+
+            setenv("GMX_TRAJ_PREFETCH", prefetch, 1);
+            common.initFirstFrame();
+            unsetenv("GMX_TRAJ_PREFETCH");
+
+            std::vector<FrameData> frames;
+            do
+            {
+                common.initFrame();
+                const t_trxframe &fr = common.frame();
+                FrameData         data;
+
+                data.time = fr.time;
+                data.step = fr.step;
+                data.ePBC = fr.ePBC;
+                data.bPBC = fr.bPBC;
+                copy_mat(fr.box, data.box);
+                data.x.assign(fr.x[0], fr.x[0] + fr.natoms*DIM);
+                frames.push_back(data);
+            }
+            while (common.readNextFrame());
+
+            return frames;
+        }
+
+        gmx::test::TestFileManager fileManager_;
+        std::string                trajectoryFile_;
+};
+
+TEST_F(TrajectoryAnalysisRunnerCommonTest, PrefetchedFramesMatchFramesReadOnDemand)
+{
+    std::vector<FrameData> reference  = readFrames("0");
+    std::vector<FrameData> prefetched = readFrames("2");
+
+    ASSERT_EQ(c_numFrames, static_cast<int>(reference.size()));
+    ASSERT_EQ(reference.size(), prefetched.size());
+    for (size_t f = 0; f < reference.size(); f++)
+    {
+        SCOPED_TRACE(::testing::Message() << "frame " << f);
+        EXPECT_EQ(epbcXYZ, reference[f].ePBC);
+        EXPECT_EQ(reference[f].ePBC, prefetched[f].ePBC);
+        EXPECT_EQ(reference[f].bPBC, prefetched[f].bPBC);
+        EXPECT_EQ(reference[f].step, prefetched[f].step);
+        EXPECT_EQ(reference[f].time, prefetched[f].time);
+        for (int d1 = 0; d1 < DIM; d1++)
+        {
+            for (int d2 = 0; d2 < DIM; d2++)
+            {
+                EXPECT_EQ(reference[f].box[d1][d2], prefetched[f].box[d1][d2]);
+            }
+        }
+        ASSERT_EQ(reference[f].x.size(), prefetched[f].x.size());
+        for (size_t i = 0; i < reference[f].x.size(); i++)
+        {
+            EXPECT_EQ(reference[f].x[i], prefetched[f].x[i]) << "element " << i;
+        }
+    }
+}
+
+} // namespace
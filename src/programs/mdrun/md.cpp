@@ -735,6 +735,11 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
 
         wallcycle_start(wcycle, ewcSTEP);
 
+        if (DOMAINDECOMP(cr))
+        {
+            dd_start_step_message_count(cr->dd);
+        }
+
         if (bRerunMD)
         {
             if (rerun_fr.bStep)
@@ -1020,6 +1025,15 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
             }
         }
 
+        if (ir->nstcalcslow > 1 && !bRerunMD &&
+            !(do_per_step(step, ir->nstcalcslow) || bCalcEner || bCalcVir))
+        {
+            /* With multiple time stepping we only need the slow forces
+             * every nstcalcslow steps, or when we need energies or virial.
+             */
+            force_flags |= GMX_FORCE_NOSLOW;
+        }
+
         if (shellfc)
         {
             /* Now is the time to relax the shells */
@@ -1398,7 +1412,8 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                 }
                 copy_rvecn(state->x, cbuf, 0, state->natoms);
             }
-            bUpdateDoLR = (fr->bTwinRange && do_per_step(step, ir->nstcalclr));
+            bUpdateDoLR = ((fr->bTwinRange && do_per_step(step, ir->nstcalclr)) ||
+                           (ir->nstcalcslow > 1 && !(force_flags & GMX_FORCE_NOSLOW)));
 
             update_coords(fplog, step, ir, mdatoms, state, fr->bMolPBC, f,
                           bUpdateDoLR, fr->f_twin, bCalcVir ? &fr->vir_twin_constr : NULL, fcd,
@@ -1411,7 +1426,8 @@ double do_md(FILE *fplog, t_commrec *cr, int nfile, const t_filenm fnm[],
                                cr, nrnb, wcycle, upd, constr,
                                FALSE, bCalcVir);
 
-            if (bCalcVir && bUpdateDoLR && ir->nstcalclr > 1)
+            if (bCalcVir && bUpdateDoLR &&
+                (ir->nstcalclr > 1 || ir->nstcalcslow > 1))
             {
                 /* Correct the virial for multiple time stepping */
                 m_sub(shake_vir, fr->vir_twin_constr, shake_vir);
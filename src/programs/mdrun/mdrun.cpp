@@ -302,6 +302,7 @@ int gmx_mdrun(int argc, char *argv[])
     real            cpt_period            = 15.0, max_hours = -1;
     gmx_bool        bAppendFiles          = TRUE;
     gmx_bool        bKeepAndNumCPT        = FALSE;
+    gmx_bool        bTrjIndex             = FALSE;
     gmx_bool        bResetCountersHalfWay = FALSE;
     output_env_t    oenv                  = NULL;
 
@@ -385,6 +386,8 @@ int gmx_mdrun(int argc, char *argv[])
           "Keep and number checkpoint files" },
         { "-append",  FALSE, etBOOL, {&bAppendFiles},
           "Append to previous output files when continuing from checkpoint instead of adding the simulation part number to all file names" },
+        { "-trjidx",  FALSE, etBOOL, {&bTrjIndex},
+          "Write a frame index file (.idx) next to the trr and xtc output for fast seeking" },
         { "-nsteps",  FALSE, etINT64, {&nsteps},
           "Run this number of steps, overrides .mdp file option (-1 means infinite, -2 means use mdp option, smaller is invalid)" },
         { "-maxh",   FALSE, etREAL, {&max_hours},
@@ -569,6 +572,7 @@ int gmx_mdrun(int argc, char *argv[])
     Flags = Flags | (bAppendFiles  ? MD_APPENDFILES  : 0);
     Flags = Flags | (opt2parg_bSet("-append", asize(pa), pa) ? MD_APPENDFILESSET : 0);
     Flags = Flags | (bKeepAndNumCPT ? MD_KEEPANDNUMCPT : 0);
+    Flags = Flags | (bTrjIndex     ? MD_TRJINDEX     : 0);
     Flags = Flags | (sim_part > 1    ? MD_STARTFROMCPT : 0);
     Flags = Flags | (bResetCountersHalfWay ? MD_RESETCOUNTERSHALFWAY : 0);
     Flags = Flags | (bIMDwait      ? MD_IMDWAIT      : 0);
@@ -49,6 +49,7 @@
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/essentialdynamics/edsam.h"
 #include "gromacs/ewald/pme.h"
+#include "gromacs/fft/fft.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/gmxlib/gpu_utils/gpu_utils.h"
 #include "gromacs/legacyheaders/checkpoint.h"
@@ -980,6 +981,7 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
     int                       nChargePerturbed = -1, nTypePerturbed = 0, status;
     gmx_wallcycle_t           wcycle;
     gmx_bool                  bReadEkin;
+    const char               *fft_wisdom_fn;
     gmx_walltime_accounting_t walltime_accounting = NULL;
     int                       rc;
     gmx_int64_t               reset_counters;
@@ -1020,6 +1022,17 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
      * global for this process (MPI rank). */
     hwinfo = gmx_detect_hardware(fplog, cr, bTryUseGPU);
 
+    /* Import FFT planning data from previous runs, also global for this
+     * process. This avoids (most of) the cost of measuring FFT plans
+     * at startup and for the grids tried during PME tuning.
+     */
+    fft_wisdom_fn = getenv("GMX_FFTW_WISDOM");
+    if (fft_wisdom_fn != NULL && gmx_fft_wisdom_import(fft_wisdom_fn))
+    {
+        md_print_info(cr, fplog, "Imported FFT planning data from %s\n",
+                      fft_wisdom_fn);
+    }
+
 
     snew(state, 1);
     if (SIMMASTER(cr))
@@ -1672,6 +1685,16 @@ int mdrunner(gmx_hw_opt_t *hw_opt,
                EI_DYNAMICS(inputrec->eI) && !MULTISIM(cr));
 
 
+    /* All ranks are done with planning, so we can store the planning data.
+     * Note that with MPI, only the plans of the master rank are stored.
+     */
+    if (fft_wisdom_fn != NULL && MASTER(cr) &&
+        !gmx_fft_wisdom_export(fft_wisdom_fn))
+    {
+        md_print_warn(cr, fplog, "Could not write FFT planning data to %s\n",
+                      fft_wisdom_fn);
+    }
+
     /* Free GPU memory and context */
     free_gpu_resources(fr, cr, &hwinfo->gpu_info, fr ? fr->gpu_opt : NULL);
 
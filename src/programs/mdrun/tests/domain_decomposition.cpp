@@ -42,11 +42,17 @@
  */
 #include "gmxpre.h"
 
+#include "config.h"
+
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include "gromacs/fileio/trnio.h"
+
 #include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
 
 #include "moduletest.h"
 
@@ -74,4 +80,107 @@ TEST_F(DomainDecompositionSpecialCasesTest, AnEmptyDomainWorks)
     ASSERT_EQ(0, runner_.callMdrun());
 }
 
+#ifdef GMX_THREAD_MPI
+
+//! Number of atoms in the propanol-and-water test system
+const int c_numAtoms = 12*5 + 311*3;
+
+/*! \brief Test fixture comparing domain decomposition with a single rank
+ *
+ * The number of ranks is set with -ntmpi for each run, so this
+ * needs thread-MPI.
+ */
+class DomainDecompositionTest : public gmx::test::MdrunTestFixture
+{
+    public:
+        DomainDecompositionTest()
+        {
+            runner_.useTopGroAndNdxFromDatabase("propanol-and-water");
+            runner_.useStringAsMdpFile("integrator = md\n"
+                                       "cutoff-scheme = Verlet\n"
+                                       "coulombtype = PME\n"
+                                       "rcoulomb = 0.8\n"
+                                       "rvdw = 0.8\n"
+                                       "nstlist = 10\n"
+                                       "constraints = h-bonds\n"
+                                       "dt = 0.002\n"
+                                       "nsteps = 20\n"
+                                       "nstxout = 1\n"
+                                       "nstfout = 1\n"
+                                       "gen-vel = yes\n"
+                                       "gen-temp = 300\n"
+                                       "gen-seed = 1993\n");
+            EXPECT_EQ(0, runner_.callGrompp());
+        }
+
+        /*! \brief Runs mdrun on \p numRanks ranks without separate PME
+         * ranks and returns the coordinates and forces of all frames
+         */
+        void runAndReadTrajectory(const char        *name,
+                                  int                numRanks,
+                                  std::vector<real> *x,
+                                  std::vector<real> *f)
+        {
+            runner_.fullPrecisionTrajectoryFileName_ =
+                fileManager_.getTemporaryFilePath((std::string(name) + ".trr").c_str());
+            gmx::test::CommandLine caller;
+            caller.append("mdrun");
+            caller.addOption("-ntmpi", numRanks);
+            caller.addOption("-npme", 0);
+            ASSERT_EQ(0, runner_.callMdrun(caller));
+
+            t_fileio         *fio = open_trn(runner_.fullPrecisionTrajectoryFileName_.c_str(), "r");
+            t_trnheader       sh;
+            gmx_bool          bOK;
+            matrix            box;
+            std::vector<real> xFrame(c_numAtoms*DIM), fFrame(c_numAtoms*DIM);
+
+            while (fread_trnheader(fio, &sh, &bOK))
+            {
+                ASSERT_EQ(c_numAtoms, sh.natoms);
+                ASSERT_TRUE(fread_htrn(fio, &sh, box,
+                                       reinterpret_cast<rvec *>(&xFrame[0]), NULL,
+                                       reinterpret_cast<rvec *>(&fFrame[0])));
+                x->insert(x->end(), xFrame.begin(), xFrame.end());
+                f->insert(f->end(), fFrame.begin(), fFrame.end());
+            }
+            close_trn(fio);
+        }
+
+        //! Checks that \p test agrees with \p reference within \p tolerance
+        static void compareVectors(const char                              *name,
+                                   const std::vector<real>                 &reference,
+                                   const std::vector<real>                 &test,
+                                   const gmx::test::FloatingPointTolerance &tolerance)
+        {
+            ASSERT_EQ(reference.size(), test.size());
+            for (size_t i = 0; i < reference.size(); i++)
+            {
+                EXPECT_REAL_EQ_TOL(reference[i], test[i], tolerance)
+                << name << " frame " << i/(c_numAtoms*DIM) << " element " << i % (c_numAtoms*DIM);
+            }
+        }
+};
+
+/* On steps without pair search, the halo coordinates are sent with
+ * non-blocking communication that overlaps with the local non-bonded
+ * kernel. The trajectory with two domains should match that of a
+ * single rank up to rounding. The forces differ by up to 0.2 over
+ * 20 steps. Without the halo exchange on the steps between pair
+ * searches, they differ by 100 after one step.
+ */
+TEST_F(DomainDecompositionTest, OverlappedHaloExchangeMatchesSingleRank)
+{
+    std::vector<real> xReference, fReference, x, f;
+
+    runAndReadTrajectory("single", 1, &xReference, &fReference);
+    runAndReadTrajectory("dd", 2, &x, &f);
+
+    ASSERT_EQ(21*c_numAtoms*DIM, static_cast<int>(xReference.size()));
+    compareVectors("x", xReference, x, gmx::test::absoluteTolerance(1e-4));
+    compareVectors("f", fReference, f, gmx::test::relativeToleranceAsFloatingPoint(1000, 5e-4));
+}
+
+#endif
+
 } // namespace
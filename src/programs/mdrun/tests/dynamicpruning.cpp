@@ -0,0 +1,209 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for dynamic pruning of the nbnxn pair list
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include <cstdlib>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/trnio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/nbnxn_simd.h"
+#include "gromacs/utility/file.h"
+
+#include "testutils/testasserts.h"
+
+#include "moduletest.h"
+
+namespace
+{
+
+/* Dynamic pruning is only supported with the nbnxn SIMD kernels */
+#if defined GMX_NBNXN_SIMD && !defined GMX_NATIVE_WINDOWS
+
+//! Number of atoms in the test system
+const int c_numAtoms = 648;
+
+/*! \brief Test fixture for mdrun with dynamic pair-list pruning
+ *
+ * The parameter is the environment variable that selects
+ * the nbnxn SIMD kernel layout and thus the pruning kernel.
+ */
+class DynamicPruningTest : public gmx::test::MdrunTestFixture,
+                           public ::testing::WithParamInterface<const char *>
+{
+    public:
+        DynamicPruningTest()
+        {
+            setenv(GetParam(), "1", 1);
+        }
+
+        ~DynamicPruningTest()
+        {
+            unsetenv(GetParam());
+        }
+
+        /*! \brief Runs 8 steps of a PME simulation with a pair search
+         * every 20 steps and returns the forces of all output frames
+         *
+         * With \p nstlistPrune > 0 the pair list is pruned every
+         * \p nstlistPrune steps.
+         */
+        std::vector<real> runSimulation(const char *name, int nstlistPrune)
+        {
+            runner_.useTopGroAndNdxFromDatabase("spc216");
+            runner_.useStringAsMdpFile("integrator = md\n"
+                                       "cutoff-scheme = Verlet\n"
+                                       "coulombtype = PME\n"
+                                       "rcoulomb = 0.8\n"
+                                       "rvdw = 0.8\n"
+                                       "nstlist = 20\n"
+                                       "dt = 0.002\n"
+                                       "nsteps = 8\n"
+                                       "nstcalcenergy = 4\n"
+                                       "nstenergy = 4\n"
+                                       "nstfout = 4\n"
+                                       "verlet-buffer-tolerance = 0.0005\n"
+                                       "tcoupl = v-rescale\n"
+                                       "tc-grps = System\n"
+                                       "tau-t = 0.1\n"
+                                       "ref-t = 300\n"
+                                       "ld-seed = 1993\n"
+                                       "gen-vel = yes\n"
+                                       "gen-temp = 300\n"
+                                       "gen-seed = 1993\n");
+            EXPECT_EQ(0, runner_.callGrompp());
+
+            runner_.fullPrecisionTrajectoryFileName_ =
+                fileManager_.getTemporaryFilePath((std::string(name) + ".trr").c_str());
+            runner_.logFileName_ =
+                fileManager_.getTemporaryFilePath((std::string(name) + ".log").c_str());
+            if (nstlistPrune > 0)
+            {
+                char buf[STEPSTRSIZE];
+
+                sprintf(buf, "%d", nstlistPrune);
+                setenv("GMX_NSTLIST_DYNAMICPRUNING", buf, 1);
+            }
+            EXPECT_EQ(0, runner_.callMdrun());
+            unsetenv("GMX_NSTLIST_DYNAMICPRUNING");
+
+            return readForces(runner_.fullPrecisionTrajectoryFileName_);
+        }
+
+        //! Returns the forces of all frames in the trr file \p fileName
+        static std::vector<real> readForces(const std::string &fileName)
+        {
+            std::vector<real> forces;
+            std::vector<real> f(c_numAtoms*DIM);
+            t_fileio         *fio = open_trn(fileName.c_str(), "r");
+            t_trnheader       sh;
+            gmx_bool          bOK;
+            matrix            box;
+
+            while (fread_trnheader(fio, &sh, &bOK))
+            {
+                EXPECT_EQ(c_numAtoms, sh.natoms);
+                EXPECT_TRUE(fread_htrn(fio, &sh, box, NULL, NULL,
+                                       reinterpret_cast<rvec *>(&f[0])));
+                forces.insert(forces.end(), f.begin(), f.end());
+            }
+            close_trn(fio);
+
+            return forces;
+        }
+};
+
+/* The inner buffer of the pruned list is set by the Verlet buffer
+ * tolerance for the pruning interval, so a pair can occasionally move
+ * within the cut-off between prunings and be missed. At the search
+ * step both lists contain all pairs and the forces must agree to
+ * rounding accuracy. After that the missed pairs and the chaotic
+ * divergence of the trajectories give force differences of up to
+ * 0.025 kJ/mol/nm over 8 steps, whereas pruning with a radius only
+ * 0.02 nm too short already gives differences of 0.09 kJ/mol/nm.
+ */
+TEST_P(DynamicPruningTest, PrunedListGivesSameForcesAsFullList)
+{
+    std::vector<real> reference = runSimulation("full", 0);
+    std::vector<real> pruned    = runSimulation("pruned", 4);
+
+    /* Check that the list was actually pruned */
+    std::string log = gmx::File::readToString(runner_.logFileName_);
+    EXPECT_NE(std::string::npos, log.find("Using dynamic pair-list pruning every 4 steps"));
+
+    /* 3 frames, every 4 steps */
+    ASSERT_EQ(3*c_numAtoms*DIM, static_cast<int>(reference.size()));
+    ASSERT_EQ(reference.size(), pruned.size());
+    for (int i = 0; i < c_numAtoms*DIM; i++)
+    {
+        EXPECT_REAL_EQ_TOL(reference[i], pruned[i], gmx::test::defaultRealTolerance())
+        << "search step element " << i;
+    }
+    for (size_t i = c_numAtoms*DIM; i < reference.size(); i++)
+    {
+        EXPECT_REAL_EQ_TOL(reference[i], pruned[i], gmx::test::absoluteTolerance(0.04))
+        << "frame " << i/(c_numAtoms*DIM) << " element " << i % (c_numAtoms*DIM);
+    }
+}
+
+//! Environment variables that select the nbnxn SIMD kernel layouts
+const char *kernelLayoutVariables[] = {
+#ifdef GMX_NBNXN_SIMD_4XN
+    "GMX_NBNXN_SIMD_4XN",
+#endif
+#ifdef GMX_NBNXN_SIMD_2XNN
+    "GMX_NBNXN_SIMD_2XNN",
+#endif
+};
+
+INSTANTIATE_TEST_CASE_P(WithKernelLayout,
+                        DynamicPruningTest,
+                            ::testing::ValuesIn(gmx::ArrayRef<const char*>(kernelLayoutVariables)));
+
+#endif
+
+} // namespace
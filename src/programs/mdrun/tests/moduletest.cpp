@@ -45,6 +45,8 @@
 
 #include "config.h"
 
+#include <cstring>
+
 #include "gromacs/gmxpreprocess/grompp.h"
 #include "gromacs/options/basicoptions.h"
 #include "gromacs/options/options.h"
@@ -93,6 +95,21 @@ GMX_TEST_OPTIONS(MdrunTestOptions, options)
 }
 //! \endcond
 
+#if defined(GMX_THREAD_MPI) || defined(DOXYGEN)
+//! Returns whether \p option is given on \p commandLine
+bool hasOption(const CommandLine &commandLine, const char *option)
+{
+    for (int i = 0; i < commandLine.argc(); i++)
+    {
+        if (std::strcmp(commandLine.arg(i), option) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
 }
 
 SimulationRunner::SimulationRunner(IntegrationTestFixture *fixture) :
@@ -230,7 +247,11 @@ SimulationRunner::callMdrun(const CommandLine &callerRef)
 #endif
 
 #ifdef GMX_THREAD_MPI
-    caller.addOption("-nt", g_numThreads);
+    /* Tests that need a specific number of ranks set -ntmpi themselves */
+    if (!hasOption(caller, "-ntmpi"))
+    {
+        caller.addOption("-nt", g_numThreads);
+    }
 #endif
 
 #ifdef GMX_OPENMP
@@ -0,0 +1,323 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2015, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for multiple time stepping with nstcalcslow
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/enxio.h"
+#include "gromacs/fileio/trnio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
+
+#include "moduletest.h"
+
+namespace
+{
+
+//! Number of atoms in the propanol-and-water test system
+const int c_numAtoms = 12*5 + 311*3;
+
+//! Output of a run
+struct RunOutput
+{
+    //! The steps of the trajectory frames
+    std::vector<int>         steps;
+    //! The coordinates of all frames
+    std::vector<real>        x;
+    //! The velocities of all frames
+    std::vector<real>        v;
+    //! The forces of all frames
+    std::vector<real>        f;
+    //! Names of the potential energy terms
+    std::vector<std::string> energyNames;
+    //! The potential energy terms of all energy frames
+    std::vector<real>        energies;
+};
+
+/*! \brief Test fixture for mdrun with multiple time stepping
+ *
+ * The test system has propanol molecules with RB and proper
+ * dihedrals and 1-4 pairs, solvated in water.
+ */
+class MultipleTimeSteppingTest : public gmx::test::MdrunTestFixture
+{
+    public:
+        MultipleTimeSteppingTest()
+        {
+            runner_.useTopGroAndNdxFromDatabase("propanol-and-water");
+        }
+
+        /*! \brief Runs a PME simulation of \p nsteps steps with
+         * \p mdpExtra appended to the mdp options and output of all
+         * data every \p nstout steps
+         *
+         * With \p rerunFile non-empty the trajectory in that file is
+         * rerun instead.
+         */
+        RunOutput runSimulation(const char        *name,
+                                int                nsteps,
+                                int                nstout,
+                                const char        *mdpExtra,
+                                const std::string &rerunFile = std::string())
+        {
+            std::string mdpString(gmx::formatString("integrator = md\n"
+                                                    "cutoff-scheme = Verlet\n"
+                                                    "coulombtype = PME\n"
+                                                    "rcoulomb = 0.8\n"
+                                                    "rvdw = 0.8\n"
+                                                    "verlet-buffer-tolerance = -1\n"
+                                                    "rlist = 1.0\n"
+                                                    "constraints = h-bonds\n"
+                                                    "dt = 0.002\n"
+                                                    "nsteps = %d\n"
+                                                    "nstcalcenergy = %d\n"
+                                                    "nstenergy = %d\n"
+                                                    "nstxout = %d\n"
+                                                    "nstvout = %d\n"
+                                                    "nstfout = %d\n"
+                                                    "tcoupl = v-rescale\n"
+                                                    "tc-grps = System\n"
+                                                    "tau-t = 0.1\n"
+                                                    "ref-t = 300\n"
+                                                    "ld-seed = 1993\n"
+                                                    "gen-vel = yes\n"
+                                                    "gen-temp = 300\n"
+                                                    "gen-seed = 1993\n",
+                                                    nsteps, nstout, nstout,
+                                                    nstout, nstout, nstout));
+            mdpString += mdpExtra;
+            runner_.useStringAsMdpFile(mdpString);
+            EXPECT_EQ(0, runner_.callGrompp());
+
+            runner_.fullPrecisionTrajectoryFileName_ =
+                fileManager_.getTemporaryFilePath((std::string(name) + ".trr").c_str());
+            runner_.edrFileName_ =
+                fileManager_.getTemporaryFilePath((std::string(name) + ".edr").c_str());
+            gmx::test::CommandLine caller;
+            caller.append("mdrun");
+            if (!rerunFile.empty())
+            {
+                caller.addOption("-rerun", rerunFile);
+            }
+            EXPECT_EQ(0, runner_.callMdrun(caller));
+
+            RunOutput output;
+            readTrajectory(runner_.fullPrecisionTrajectoryFileName_, &output);
+            readPotentialEnergies(runner_.edrFileName_, &output);
+
+            return output;
+        }
+
+        //! Reads all frames of the trr file \p fileName into \p output
+        static void readTrajectory(const std::string &fileName, RunOutput *output)
+        {
+            t_fileio         *fio = open_trn(fileName.c_str(), "r");
+            t_trnheader       sh;
+            gmx_bool          bOK;
+            matrix            box;
+            std::vector<real> x(c_numAtoms*DIM), v(c_numAtoms*DIM), f(c_numAtoms*DIM);
+
+            while (fread_trnheader(fio, &sh, &bOK))
+            {
+                EXPECT_EQ(c_numAtoms, sh.natoms);
+                EXPECT_TRUE(fread_htrn(fio, &sh, box,
+                                       sh.x_size ? reinterpret_cast<rvec *>(&x[0]) : NULL,
+                                       sh.v_size ? reinterpret_cast<rvec *>(&v[0]) : NULL,
+                                       sh.f_size ? reinterpret_cast<rvec *>(&f[0]) : NULL));
+                output->steps.push_back(sh.step);
+                if (sh.x_size)
+                {
+                    output->x.insert(output->x.end(), x.begin(), x.end());
+                }
+                if (sh.v_size)
+                {
+                    output->v.insert(output->v.end(), v.begin(), v.end());
+                }
+                if (sh.f_size)
+                {
+                    output->f.insert(output->f.end(), f.begin(), f.end());
+                }
+            }
+            close_trn(fio);
+        }
+
+        /*! \brief Reads the potential energy terms of all frames
+         * of the energy file \p fileName into \p output
+         *
+         * These are the terms up to and including the total
+         * potential energy, the later terms depend on the update.
+         */
+        static void readPotentialEnergies(const std::string &fileName, RunOutput *output)
+        {
+            ener_file_t  ef  = open_enx(fileName.c_str(), "r");
+            int          nre = 0;
+            gmx_enxnm_t *enm = NULL;
+            t_enxframe  *fr;
+
+            do_enxnms(ef, &nre, &enm);
+            for (int i = 0; i < nre; i++)
+            {
+                output->energyNames.push_back(enm[i].name);
+                if (output->energyNames.back() == "Potential")
+                {
+                    break;
+                }
+            }
+            snew(fr, 1);
+            init_enxframe(fr);
+            while (do_enx(ef, fr))
+            {
+                for (size_t i = 0; i < output->energyNames.size() && fr->nre > 0; i++)
+                {
+                    output->energies.push_back(fr->ener[i].e);
+                }
+            }
+            free_enxframe(fr);
+            sfree(fr);
+            free_enxnms(nre, enm);
+            close_enx(ef);
+        }
+
+        //! Checks that \p test agrees with \p reference within \p tolerance
+        static void compareVectors(const char                              *name,
+                                   const std::vector<real>                 &reference,
+                                   const std::vector<real>                 &test,
+                                   const gmx::test::FloatingPointTolerance &tolerance)
+        {
+            ASSERT_EQ(reference.size(), test.size());
+            for (size_t i = 0; i < reference.size(); i++)
+            {
+                EXPECT_REAL_EQ_TOL(reference[i], test[i], tolerance)
+                << name << " frame " << i/(c_numAtoms*DIM) << " element " << i % (c_numAtoms*DIM);
+            }
+        }
+
+        //! Checks that the potential energies of \p test agree with \p reference
+        static void compareEnergies(const RunOutput                         &reference,
+                                    const RunOutput                         &test,
+                                    const gmx::test::FloatingPointTolerance &tolerance)
+        {
+            const size_t numTerms = reference.energyNames.size();
+
+            ASSERT_EQ(reference.energyNames, test.energyNames);
+            ASSERT_EQ(reference.energies.size(), test.energies.size());
+            for (size_t i = 0; i < reference.energies.size(); i++)
+            {
+                EXPECT_REAL_EQ_TOL(reference.energies[i], test.energies[i], tolerance)
+                << reference.energyNames[i % numTerms] << " frame " << i/numTerms;
+            }
+        }
+};
+
+//! Test fixture for the choices of slow listed interactions
+class MultipleTimeSteppingSlowListedTest : public MultipleTimeSteppingTest,
+                                           public ::testing::WithParamInterface<const char *>
+{
+};
+
+/* At step 0 the fast and slow forces are both computed, so the total
+ * force and the potential energy terms should equal those of a normal
+ * run up to rounding, whatever the listed interactions that are slow.
+ */
+TEST_P(MultipleTimeSteppingSlowListedTest, SlowStepGivesNormalForcesAndEnergies)
+{
+    RunOutput reference = runSimulation("normal", 0, 2, "");
+    RunOutput mts       = runSimulation("mts", 0, 2,
+                                        gmx::formatString("nstcalcslow = 2\n"
+                                                          "slow-listed = %s\n",
+                                                          GetParam()).c_str());
+
+    ASSERT_EQ(c_numAtoms*DIM, static_cast<int>(reference.f.size()));
+    compareVectors("f", reference.f, mts.f, gmx::test::relativeToleranceAsFloatingPoint(100, 1e-5));
+    compareEnergies(reference, mts, gmx::test::relativeToleranceAsFloatingPoint(100, 1e-5));
+}
+
+INSTANTIATE_TEST_CASE_P(WithSlowListed, MultipleTimeSteppingSlowListedTest,
+                            ::testing::Values("no", "dihedrals", "dihedrals-pairs"));
+
+/* At every slow step the forces and energies written by a multiple
+ * time stepping run should be those of the positions at that step,
+ * which is what a rerun of its trajectory computes.
+ */
+TEST_F(MultipleTimeSteppingTest, SlowStepsMatchRerun)
+{
+    RunOutput mts   = runSimulation("mts", 10, 2,
+                                    "nstcalcslow = 2\n"
+                                    "slow-listed = dihedrals-pairs\n");
+    std::string mtsTrajectory(runner_.fullPrecisionTrajectoryFileName_);
+    RunOutput   rerun = runSimulation("rerun", 10, 2, "", mtsTrajectory);
+
+    ASSERT_EQ(6*c_numAtoms*DIM, static_cast<int>(mts.f.size()));
+    ASSERT_EQ(mts.steps, rerun.steps);
+    ASSERT_EQ(6*static_cast<int>(mts.energyNames.size()), static_cast<int>(mts.energies.size()));
+    compareVectors("f", rerun.f, mts.f, gmx::test::relativeToleranceAsFloatingPoint(100, 1e-5));
+    compareEnergies(rerun, mts, gmx::test::relativeToleranceAsFloatingPoint(100, 1e-5));
+}
+
+/* With the mesh forces, dihedrals and pairs computed every second
+ * step, a short run should stay close to the normal run. After 20
+ * steps the coordinates deviate up to 2e-3 nm, the velocities up to
+ * 0.12 nm/ps and the potential energy terms up to 1.2 kJ/mol.
+ * Applying the slow listed forces without the impulse factor gives
+ * deviations of 1e-2 nm, 0.37 nm/ps and 4.5 kJ/mol, without any
+ * impulse factor the coordinates deviate by 2 nm.
+ */
+TEST_F(MultipleTimeSteppingTest, TwoStepsStaysCloseToNormalRun)
+{
+    RunOutput reference = runSimulation("normal", 20, 20, "");
+    RunOutput mts       = runSimulation("mts", 20, 20,
+                                        "nstcalcslow = 2\n"
+                                        "slow-listed = dihedrals-pairs\n");
+
+    ASSERT_EQ(2*c_numAtoms*DIM, static_cast<int>(reference.x.size()));
+    compareVectors("x", reference.x, mts.x, gmx::test::absoluteTolerance(4e-3));
+    compareVectors("v", reference.v, mts.v, gmx::test::absoluteTolerance(0.25));
+    compareEnergies(reference, mts, gmx::test::absoluteTolerance(2.0));
+}
+
+} // namespace